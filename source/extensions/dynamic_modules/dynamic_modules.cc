@@ -1,34 +1,219 @@
 #include "source/extensions/dynamic_modules/dynamic_modules.h"
 
 #include <dlfcn.h>
+#include <link.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
+#include <cstring>
 #include <filesystem>
 #include <string>
 
 #include "envoy/common/exception.h"
 
+#include "source/common/common/logger.h"
+#include "source/common/common/macros.h"
 #include "source/extensions/dynamic_modules/abi/abi.h"
+#include "source/extensions/dynamic_modules/file_identity.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/optional.h"
 
 namespace Envoy {
 namespace Extensions {
 namespace DynamicModules {
 
-absl::StatusOr<DynamicModuleSharedPtr> newDynamicModule(const absl::string_view object_file_path,
-                                                        const bool do_not_close) {
+namespace {
+
+/**
+ * Process-wide registry of the loaded modules. This holds weak references so that a module is
+ * still unloaded when the last filter chain referencing it goes away.
+ */
+class DynamicModuleRegistry {
+public:
+  static DynamicModuleRegistry& get() { MUTABLE_CONSTRUCT_ON_FIRST_USE(DynamicModuleRegistry); }
+
+  DynamicModuleSharedPtr find(const FileIdentity& id) {
+    absl::MutexLock lock(&mutex_);
+    auto it = modules_.find(id);
+    if (it == modules_.end()) {
+      return nullptr;
+    }
+    DynamicModuleSharedPtr module = it->second.lock();
+    if (module == nullptr) {
+      modules_.erase(it);
+    }
+    return module;
+  }
+
+  DynamicModuleSharedPtr findByHandle(void* handle) {
+    absl::MutexLock lock(&mutex_);
+    for (const auto& [id, weak_module] : modules_) {
+      DynamicModuleSharedPtr module = weak_module.lock();
+      if (module != nullptr && module->handle() == handle) {
+        return module;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Returns the lock to be held while loading the object file, so that concurrent loads of the same
+   * file, e.g. from the parallel initialization, load and initialize it only once.
+   */
+  std::shared_ptr<absl::Mutex> loadLock(const FileIdentity& id) {
+    absl::MutexLock lock(&mutex_);
+    absl::erase_if(load_locks_, [](const auto& entry) { return entry.second.expired(); });
+    std::shared_ptr<absl::Mutex> load_lock = load_locks_[id].lock();
+    if (load_lock == nullptr) {
+      load_lock = std::make_shared<absl::Mutex>();
+      load_locks_[id] = load_lock;
+    }
+    return load_lock;
+  }
+
+  void insert(const FileIdentity& id, const DynamicModuleSharedPtr& module) {
+    absl::MutexLock lock(&mutex_);
+    // Sweep the expired entries here so that the registry doesn't grow with the number of distinct
+    // files ever loaded.
+    absl::erase_if(modules_, [](const auto& entry) { return entry.second.expired(); });
+    modules_[id] = module;
+  }
+
+private:
+  absl::Mutex mutex_;
+  absl::flat_hash_map<FileIdentity, std::weak_ptr<DynamicModule>> modules_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<FileIdentity, std::weak_ptr<absl::Mutex>> load_locks_ ABSL_GUARDED_BY(mutex_);
+};
+
+/**
+ * Resolves the identity of the object file. Returns nullopt if the file cannot be stat'ed, in which
+ * case the loading is not cached and dlopen reports the error.
+ */
+absl::optional<FileIdentity> fileIdentity(const std::filesystem::path& path) {
+  std::error_code ec;
+  const std::filesystem::path canonical = std::filesystem::canonical(path, ec);
+  if (ec) {
+    return absl::nullopt;
+  }
+  struct stat st;
+  if (stat(canonical.c_str(), &st) != 0) {
+    return absl::nullopt;
+  }
+  return FileIdentity::fromStat(canonical.string(), st);
+}
+
+std::chrono::nanoseconds elapsedSince(const std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                              start);
+}
+
+/**
+ * Calls the function for each executable segment of the loaded object, with the page aligned start
+ * address and the length.
+ */
+template <typename F> void forEachExecutableSegment(void* handle, F f) {
+  struct link_map* link_map = nullptr;
+  if (dlinfo(handle, RTLD_DI_LINKMAP, &link_map) != 0 || link_map == nullptr) {
+    return;
+  }
+  struct Context {
+    const struct link_map* link_map_;
+    F& f_;
+  } context{link_map, f};
+  dl_iterate_phdr(
+      [](struct dl_phdr_info* info, size_t, void* data) -> int {
+        Context* context = static_cast<Context*>(data);
+        if (info->dlpi_addr != context->link_map_->l_addr ||
+            info->dlpi_name == nullptr ||
+            std::string_view(info->dlpi_name) != context->link_map_->l_name) {
+          return 0;
+        }
+        const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+        for (int i = 0; i < info->dlpi_phnum; i++) {
+          const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+          if (phdr.p_type != PT_LOAD || (phdr.p_flags & PF_X) == 0) {
+            continue;
+          }
+          const uintptr_t start = (info->dlpi_addr + phdr.p_vaddr) & ~(page_size - 1);
+          const uintptr_t end = info->dlpi_addr + phdr.p_vaddr + phdr.p_memsz;
+          context->f_(reinterpret_cast<void*>(start), end - start, page_size);
+        }
+        // The object is found, so stop iterating.
+        return 1;
+      },
+      &context);
+}
+
+/**
+ * Prefaults or locks the executable segments as requested. This is only called when the object is
+ * first loaded.
+ */
+void applyLoadMode(void* handle, const std::string& path, const LoadMode& load_mode,
+                   LoadTimings& timings) {
+  if (load_mode.prefault_ || load_mode.mlock_) {
+    const auto start = std::chrono::steady_clock::now();
+    forEachExecutableSegment(handle, [](void* addr, size_t length, uintptr_t page_size) {
+      madvise(addr, length, MADV_WILLNEED);
+      // MADV_WILLNEED only starts the read-ahead, so touch every page to map them in.
+      const volatile char* page = static_cast<const volatile char*>(addr);
+      for (size_t offset = 0; offset < length; offset += page_size) {
+        (void)page[offset];
+      }
+    });
+    timings.prefault_ = elapsedSince(start);
+  }
+  if (load_mode.mlock_) {
+    const auto start = std::chrono::steady_clock::now();
+    forEachExecutableSegment(handle, [&path](void* addr, size_t length, uintptr_t) {
+      if (mlock(addr, length) != 0) {
+        // This is not fatal since the segments are prefaulted anyway. Usually RLIMIT_MEMLOCK is
+        // too small.
+        ENVOY_LOG_MISC(warn, "failed to mlock the dynamic module {}: {}", path, strerror(errno));
+      }
+    });
+    timings.mlock_ = elapsedSince(start);
+  }
+}
+
+void logLoadTimings(const std::string& path, const LoadTimings& timings) {
+  ENVOY_LOG_MISC(info,
+                 "loaded dynamic module {}: dlopen {}us, program init {}us, prefault {}us, mlock "
+                 "{}us",
+                 path, timings.dlopen_.count() / 1000, timings.program_init_.count() / 1000,
+                 timings.prefault_.count() / 1000, timings.mlock_.count() / 1000);
+}
+
+absl::StatusOr<DynamicModuleSharedPtr> loadDynamicModule(const std::filesystem::path& file_path,
+                                                         const absl::string_view object_file_path,
+                                                         const bool do_not_close,
+                                                         const LoadMode& load_mode) {
   // RTLD_LOCAL is always needed to avoid collisions between multiple modules.
-  // RTLD_LAZY is required for not only performance but also simply to load the module, otherwise
-  // dlopen results in Invalid argument.
-  int mode = RTLD_LOCAL | RTLD_LAZY;
+  // One of RTLD_LAZY or RTLD_NOW is required, otherwise dlopen results in Invalid argument.
+  // RTLD_LAZY is the default as it makes dlopen faster, but it defers the symbol resolution to the
+  // first call of each function, which is on the first requests.
+  int mode = RTLD_LOCAL | (load_mode.eager_bind_ ? RTLD_NOW : RTLD_LAZY);
   if (do_not_close) {
     mode |= RTLD_NODELETE;
   }
 
-  const std::filesystem::path file_path_absolute = std::filesystem::absolute(object_file_path);
-  void* handle = dlopen(file_path_absolute.c_str(), mode);
+  LoadTimings timings;
+  auto start = std::chrono::steady_clock::now();
+  void* handle = dlopen(file_path.c_str(), mode);
+  timings.dlopen_ = elapsedSince(start);
   if (handle == nullptr) {
     return absl::InvalidArgumentError(
         absl::StrCat("Failed to load dynamic module: ", object_file_path, " : ", dlerror()));
   }
+  // The dynamic loader returns the already loaded object when an object file is replaced in place
+  // under the same name. Reuse the module in that case rather than initializing it twice.
+  if (DynamicModuleSharedPtr loaded = DynamicModuleRegistry::get().findByHandle(handle);
+      loaded != nullptr) {
+    dlclose(handle);
+    return loaded;
+  }
   DynamicModuleSharedPtr dynamic_module = std::make_shared<DynamicModule>(handle);
 
   const auto init_function =
@@ -40,15 +225,61 @@ absl::StatusOr<DynamicModuleSharedPtr> newDynamicModule(const absl::string_view
         absl::StrCat("Failed to resolve envoy_dynamic_module_on_program_init: ", dlerror()));
   }
 
+  start = std::chrono::steady_clock::now();
   const size_t result = (*init_function)();
+  timings.program_init_ = elapsedSince(start);
   if (result != 0) {
     return absl::InvalidArgumentError(
         absl::StrCat("envoy_dynamic_module_on_program_init failed: ", object_file_path,
                      " : returned non-zero status: ", result));
   }
+  applyLoadMode(handle, file_path.string(), load_mode, timings);
+  dynamic_module->load_timings_ = timings;
+  logLoadTimings(file_path.string(), timings);
   return dynamic_module;
 }
 
+} // namespace
+
+absl::StatusOr<DynamicModuleSharedPtr> newDynamicModule(const absl::string_view object_file_path,
+                                                        const bool do_not_close,
+                                                        const LoadMode& load_mode) {
+  const std::filesystem::path file_path_absolute = std::filesystem::absolute(object_file_path);
+  const absl::optional<FileIdentity> id = fileIdentity(file_path_absolute);
+  if (!id.has_value()) {
+    return loadDynamicModule(file_path_absolute, object_file_path, do_not_close, load_mode);
+  }
+
+  DynamicModuleRegistry& registry = DynamicModuleRegistry::get();
+  const std::shared_ptr<absl::Mutex> load_lock = registry.loadLock(id.value());
+  absl::MutexLock lock(load_lock.get());
+  if (DynamicModuleSharedPtr cached = registry.find(id.value()); cached != nullptr) {
+    if (do_not_close || load_mode.eager_bind_) {
+      // The module might have been loaded without RTLD_NODELETE or with RTLD_LAZY. Promote it by
+      // re-opening the already loaded object, which doesn't run the initializers again.
+      const int mode = RTLD_LOCAL | RTLD_NOLOAD | (load_mode.eager_bind_ ? RTLD_NOW : RTLD_LAZY) |
+                       (do_not_close ? RTLD_NODELETE : 0);
+      void* handle = dlopen(id->canonical_path_.c_str(), mode);
+      if (handle != nullptr) {
+        dlclose(handle);
+      }
+    }
+    // The segments were already prefaulted or locked as requested by the first load. Walking them
+    // again for every filter config sharing the module would only slow down the config updates.
+    return cached;
+  }
+
+  // The canonical path is passed to dlopen since the dynamic loader reuses an already loaded object
+  // with the same name. This way, re-pointing a symlink to a new object file loads the new one.
+  absl::StatusOr<DynamicModuleSharedPtr> module =
+      loadDynamicModule(id->canonical_path_, object_file_path, do_not_close, load_mode);
+  if (module.ok()) {
+    module.value()->file_identity_ = id;
+    registry.insert(id.value(), module.value());
+  }
+  return module;
+}
+
 DynamicModule::~DynamicModule() { dlclose(handle_); }
 
 void* DynamicModule::getSymbol(const absl::string_view symbol_ref) const {
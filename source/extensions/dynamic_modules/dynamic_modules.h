@@ -1,15 +1,42 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 
+#include "source/extensions/dynamic_modules/file_identity.h"
+
 #include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
 
 namespace Envoy {
 namespace Extensions {
 namespace DynamicModules {
 
+/**
+ * How the object file is loaded. This corresponds to the LoadMode message in the http config.proto.
+ */
+struct LoadMode {
+  // Resolve all the symbols on load with RTLD_NOW instead of RTLD_LAZY.
+  bool eager_bind_ = false;
+  // Prefault the executable segments on load, so that the first calls don't page fault.
+  bool prefault_ = false;
+  // Lock the executable segments in memory. This implies prefault_.
+  bool mlock_ = false;
+};
+
+/**
+ * The elapsed time of each step of loading an object file. The steps that were not performed are
+ * zero.
+ */
+struct LoadTimings {
+  std::chrono::nanoseconds dlopen_{0};
+  std::chrono::nanoseconds program_init_{0};
+  std::chrono::nanoseconds prefault_{0};
+  std::chrono::nanoseconds mlock_{0};
+};
+
 /**
  * A class for loading and managing dynamic modules. This corresponds to a single dlopen handle.
  * When the DynamicModule object is destroyed, the dlopen handle is closed.
@@ -37,6 +64,18 @@ public:
 
   void* handleForTesting() const { return handle_; }
 
+  /**
+   * @return the handle returned by dlopen.
+   */
+  void* handle() const { return handle_; }
+
+  // The elapsed time of each step of loading this module, set by newDynamicModule.
+  LoadTimings load_timings_;
+
+  // The identity of the object file, set by newDynamicModule. nullopt if the file couldn't be
+  // stat'ed, in which case the module is not shared.
+  absl::optional<FileIdentity> file_identity_;
+
 private:
   /**
    * Get a symbol from the dynamic module.
@@ -52,15 +91,22 @@ private:
 using DynamicModuleSharedPtr = std::shared_ptr<DynamicModule>;
 
 /**
- * Creates a new DynamicModule.
+ * Creates a new DynamicModule, or returns the already loaded one if the same object file is still
+ * referenced somewhere in the process. The object file is identified by its canonical path, inode
+ * and modification time, so envoy_dynamic_module_on_program_init is called only once per loaded
+ * object file.
  * @param object_file_path the path to the object file to load.
  * @param do_not_close if true, the dlopen will be called with RTLD_NODELETE, so the loaded object
  * will not be destroyed. This is useful when an object has some global state that should not be
  * terminated. For example, c-shared objects compiled by Go doesn't support dlclose
  * https://github.com/golang/go/issues/11100.
+ * @param load_mode how the object file is loaded. When the module is already loaded, the symbols
+ * are bound as requested on top of the previous load, but prefault and mlock are only applied by
+ * the first load.
  */
 absl::StatusOr<DynamicModuleSharedPtr> newDynamicModule(const absl::string_view object_file_path,
-                                                        const bool do_not_close);
+                                                        const bool do_not_close,
+                                                        const LoadMode& load_mode = {});
 
 } // namespace DynamicModules
 } // namespace Extensions
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <utility>
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+
+/**
+ * Identifies a file on disk, e.g. an object file or a filter config file. The canonical path alone
+ * is not enough since a file can be replaced in place, in which case the new file must be treated
+ * as a different one.
+ */
+struct FileIdentity {
+  std::string canonical_path_;
+  dev_t device_;
+  ino_t inode_;
+  off_t size_;
+  int64_t mtime_ns_;
+
+  /**
+   * @param canonical_path the canonical path of the file.
+   * @param st the result of stat on the file.
+   */
+  static FileIdentity fromStat(std::string canonical_path, const struct stat& st) {
+    return FileIdentity{std::move(canonical_path), st.st_dev, st.st_ino, st.st_size,
+                        static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec};
+  }
+
+  bool operator==(const FileIdentity& other) const {
+    return std::tie(canonical_path_, device_, inode_, size_, mtime_ns_) ==
+           std::tie(other.canonical_path_, other.device_, other.inode_, other.size_,
+                    other.mtime_ns_);
+  }
+
+  template <typename H> friend H AbslHashValue(H h, const FileIdentity& id) {
+    return H::combine(std::move(h), id.canonical_path_, id.device_, id.inode_, id.size_,
+                      id.mtime_ns_);
+  }
+};
+
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -1,3 +1,4 @@
+#include <chrono>
 #include <filesystem>
 #include <optional>
 #include <string>
@@ -7,6 +8,7 @@
 #include "source/extensions/dynamic_modules/abi/abi.h"
 
 #include "source/common/common/assert.h"
+#include "source/common/http/message_impl.h"
 #include "envoy/common/exception.h"
 
 namespace Envoy {
@@ -15,6 +17,10 @@ namespace {
 extern "C" {
 
 using HttpFilter = Envoy::Extensions::DynamicModules::Http::HttpFilter;
+using ContinueQueue = Envoy::Extensions::DynamicModules::Http::ContinueQueue;
+using ContinueQueueSharedPtr = Envoy::Extensions::DynamicModules::Http::ContinueQueueSharedPtr;
+using StreamHandleTable = Envoy::Extensions::DynamicModules::Http::StreamHandleTable;
+using SharedDataStore = Envoy::Extensions::DynamicModules::Http::SharedDataStore;
 
 #define GET_HEADER_VALUE(header_map_type, request_or_response)                                     \
   const std::string_view key_str(static_cast<const char*>(key), key_length);                       \
@@ -148,6 +154,28 @@ void envoy_dynamic_module_http_get_response_body_buffer_slice(
   GET_BUFFER_SLICE(buffer, nth);
 }
 
+#define GET_BUFFER_SLICES(buffer_ptr)                                                              \
+  Buffer::Instance* _buffer = static_cast<Buffer::Instance*>(buffer_ptr);                          \
+  auto _result_slices = static_cast<envoy_dynamic_module_type_DataSlice*>(result_slices);          \
+  const auto slices = _buffer->getRawSlices(std::nullopt);                                         \
+  for (size_t i = 0; i < slices.size() && i < result_slices_capacity; i++) {                       \
+    _result_slices[i].data = static_cast<envoy_dynamic_module_type_DataSlicePtr>(slices[i].mem_);  \
+    _result_slices[i].length = slices[i].len_;                                                     \
+  }                                                                                                \
+  return slices.size();
+
+size_t envoy_dynamic_module_http_get_request_body_buffer_slices(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_DataSliceVectorPtr result_slices, size_t result_slices_capacity) {
+  GET_BUFFER_SLICES(buffer);
+}
+
+size_t envoy_dynamic_module_http_get_response_body_buffer_slices(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_DataSliceVectorPtr result_slices, size_t result_slices_capacity) {
+  GET_BUFFER_SLICES(buffer);
+}
+
 #define SET_HEADER_VALUE(header_map_type, request_or_response)                                     \
   const std::string key_str(static_cast<const char*>(key), key_length);                            \
   if (value == nullptr) {                                                                          \
@@ -258,27 +286,162 @@ void envoy_dynamic_module_http_drain_response_body_buffer(
 void envoy_dynamic_module_http_continue_request(
     envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr) {
   auto filter = static_cast<HttpFilter*>(envoy_filter_instance_ptr)->shared_from_this();
-  auto& dispatcher = filter->decoder_callbacks_->dispatcher();
-  dispatcher.post([filter] {
-    auto decoder_callbacks = filter->decoder_callbacks_;
-    if (decoder_callbacks && !filter->in_continue_) {
-      decoder_callbacks->continueDecoding();
-      filter->in_continue_ = true;
-    }
-  });
+  ContinueQueueSharedPtr queue = filter->continue_queue_;
+  if (queue) {
+    queue->push(std::move(filter), ContinueQueue::Direction::Request);
+  }
 }
 
 void envoy_dynamic_module_http_continue_response(
     envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr) {
   auto filter = static_cast<HttpFilter*>(envoy_filter_instance_ptr)->shared_from_this();
-  auto& dispatcher = filter->encoder_callbacks_->dispatcher();
-  dispatcher.post([filter] {
-    auto encoder_callbacks = filter->encoder_callbacks_;
-    if (encoder_callbacks && !filter->in_continue_) {
-      encoder_callbacks->continueEncoding();
-      filter->in_continue_ = true;
-    }
-  });
+  ContinueQueueSharedPtr queue = filter->continue_queue_;
+  if (queue) {
+    queue->push(std::move(filter), ContinueQueue::Direction::Response);
+  }
+}
+
+envoy_dynamic_module_type_StreamHandle envoy_dynamic_module_http_get_stream_handle(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr) {
+  return static_cast<HttpFilter*>(envoy_filter_instance_ptr)->streamHandle();
+}
+
+uint32_t envoy_dynamic_module_http_get_worker_index(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr) {
+  return static_cast<HttpFilter*>(envoy_filter_instance_ptr)->workerIndex();
+}
+
+size_t envoy_dynamic_module_http_continue_request_by_handle(
+    envoy_dynamic_module_type_StreamHandle stream_handle) {
+  std::shared_ptr<HttpFilter> filter = StreamHandleTable::get().lookup(stream_handle);
+  if (!filter || !filter->continue_queue_) {
+    return 0;
+  }
+  ContinueQueueSharedPtr queue = filter->continue_queue_;
+  queue->push(std::move(filter), ContinueQueue::Direction::Request);
+  return 1;
+}
+
+size_t envoy_dynamic_module_http_continue_response_by_handle(
+    envoy_dynamic_module_type_StreamHandle stream_handle) {
+  std::shared_ptr<HttpFilter> filter = StreamHandleTable::get().lookup(stream_handle);
+  if (!filter || !filter->continue_queue_) {
+    return 0;
+  }
+  ContinueQueueSharedPtr queue = filter->continue_queue_;
+  queue->push(std::move(filter), ContinueQueue::Direction::Response);
+  return 1;
+}
+
+size_t envoy_dynamic_module_http_offload(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_OffloadWork work, envoy_dynamic_module_type_OffloadDone done,
+    envoy_dynamic_module_raw_pointer context) {
+  return static_cast<HttpFilter*>(envoy_filter_instance_ptr)->offload(work, done, context);
+}
+
+envoy_dynamic_module_type_TimerPtr envoy_dynamic_module_http_create_timer(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_TimerCallback callback, envoy_dynamic_module_raw_pointer context) {
+  return static_cast<HttpFilter*>(envoy_filter_instance_ptr)->createTimer(callback, context);
+}
+
+void envoy_dynamic_module_http_enable_timer(envoy_dynamic_module_type_TimerPtr timer,
+                                            uint64_t timeout_milliseconds) {
+  static_cast<Event::Timer*>(timer)->enableTimer(std::chrono::milliseconds(timeout_milliseconds));
+}
+
+void envoy_dynamic_module_http_disable_timer(envoy_dynamic_module_type_TimerPtr timer) {
+  static_cast<Event::Timer*>(timer)->disableTimer();
+}
+
+size_t envoy_dynamic_module_http_send_callout(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr cluster_name,
+    envoy_dynamic_module_type_InModuleBufferLength cluster_name_length,
+    envoy_dynamic_module_type_InModuleHeadersPtr headers_vector,
+    envoy_dynamic_module_type_InModuleHeadersSize headers_vector_size,
+    envoy_dynamic_module_type_InModuleBufferPtr body_ptr,
+    envoy_dynamic_module_type_InModuleBufferLength body_length, uint64_t timeout_milliseconds,
+    envoy_dynamic_module_type_HttpCalloutDone done, envoy_dynamic_module_raw_pointer context) {
+  auto filter = static_cast<HttpFilter*>(envoy_filter_instance_ptr);
+  auto message = std::make_unique<RequestMessageImpl>();
+  auto headers_ptr = reinterpret_cast<envoy_dynamic_module_type_InModuleHeader*>(headers_vector);
+  for (size_t i = 0; i < headers_vector_size; i++) {
+    const auto& header = &headers_ptr[i];
+    const std::string_view key(static_cast<const char*>(header->header_key),
+                               header->header_key_length);
+    const std::string_view value(static_cast<const char*>(header->header_value),
+                                 header->header_value_length);
+    message->headers().addCopy(Http::LowerCaseString(key), value);
+  }
+  if (body_ptr && body_length > 0) {
+    message->body().add(body_ptr, body_length);
+  }
+  const std::string_view cluster(static_cast<const char*>(cluster_name), cluster_name_length);
+  return filter->sendCallout(cluster, std::move(message),
+                             std::chrono::milliseconds(timeout_milliseconds), done, context);
+}
+
+envoy_dynamic_module_type_SharedDataValuePtr envoy_dynamic_module_http_shared_data_get(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr, uint64_t* version) {
+  auto filter = static_cast<HttpFilter*>(envoy_filter_instance_ptr);
+  envoy_dynamic_module_type_DataSlicePtr* _result_buffer_ptr =
+      reinterpret_cast<envoy_dynamic_module_type_DataSlicePtr*>(result_buffer_ptr);
+  envoy_dynamic_module_type_DataSliceLength* _result_buffer_length_ptr =
+      reinterpret_cast<envoy_dynamic_module_type_DataSliceLength*>(result_buffer_length_ptr);
+  const std::string_view key_str(static_cast<const char*>(key), key_length);
+  auto result = filter->sharedData().get(key_str, filter->now());
+  if (!result.has_value()) {
+    *_result_buffer_ptr = nullptr;
+    *_result_buffer_length_ptr = 0;
+    *version = 0;
+    return nullptr;
+  }
+  *_result_buffer_ptr = const_cast<char*>(result->value_->data());
+  *_result_buffer_length_ptr = result->value_->size();
+  *version = result->version_;
+  // The reference handed to the module keeps the value alive until it is released.
+  return new SharedDataStore::Value(std::move(result->value_));
+}
+
+void envoy_dynamic_module_http_shared_data_release(
+    envoy_dynamic_module_type_SharedDataValuePtr value) {
+  delete static_cast<SharedDataStore::Value*>(value);
+}
+
+uint64_t envoy_dynamic_module_http_shared_data_set(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_InModuleBufferPtr value,
+    envoy_dynamic_module_type_InModuleBufferLength value_length, uint64_t expected_version,
+    uint64_t ttl_milliseconds) {
+  auto filter = static_cast<HttpFilter*>(envoy_filter_instance_ptr);
+  const std::string_view key_str(static_cast<const char*>(key), key_length);
+  const std::string_view value_str(static_cast<const char*>(value), value_length);
+  return filter->sharedData().set(key_str, value_str, expected_version,
+                                  std::chrono::milliseconds(ttl_milliseconds), filter->now());
+}
+
+size_t envoy_dynamic_module_http_shared_data_increment(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length, int64_t delta,
+    uint64_t ttl_milliseconds, int64_t* result) {
+  auto filter = static_cast<HttpFilter*>(envoy_filter_instance_ptr);
+  const std::string_view key_str(static_cast<const char*>(key), key_length);
+  auto counter = filter->sharedData().increment(
+      key_str, delta, std::chrono::milliseconds(ttl_milliseconds), filter->now());
+  if (!counter.has_value()) {
+    return 0;
+  }
+  *result = *counter;
+  return 1;
 }
 
 void envoy_dynamic_module_http_copy_out_request_body_buffer(
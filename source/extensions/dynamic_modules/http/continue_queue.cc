@@ -0,0 +1,68 @@
+#include "source/extensions/dynamic_modules/http/continue_queue.h"
+
+#include "source/extensions/dynamic_modules/http/filter.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+ContinueQueue::~ContinueQueue() {
+  // A pending drain holds a reference to the queue, so this is only reached with entries left
+  // when the dispatcher dropped the drain, e.g. at the shutdown.
+  Entry* entry = head_.exchange(nullptr, std::memory_order_acquire);
+  while (entry != nullptr) {
+    Entry* next = entry->next_;
+    delete entry;
+    entry = next;
+  }
+}
+
+ContinueQueueSharedPtr ContinueQueue::forDispatcher(Event::Dispatcher& dispatcher) {
+  // The dispatcher of a worker is only ever run on the same thread, so the queue can be looked up
+  // without any lock. This holds a weak reference so that the queue is not tied to the lifetime of
+  // the thread, and a new one is created once all the filters using the previous one are gone.
+  static thread_local std::weak_ptr<ContinueQueue> current;
+  ContinueQueueSharedPtr queue = current.lock();
+  if (queue == nullptr || &queue->dispatcher_ != &dispatcher) {
+    queue = std::make_shared<ContinueQueue>(dispatcher);
+    current = queue;
+  }
+  return queue;
+}
+
+void ContinueQueue::push(std::shared_ptr<HttpFilter> filter, Direction direction) {
+  Entry* entry = new Entry{head_.load(std::memory_order_relaxed), std::move(filter), direction};
+  while (!head_.compare_exchange_weak(entry->next_, entry, std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+  }
+  // Only the push onto an empty queue schedules a drain. The others are picked up by it, as the
+  // drain takes the whole list at once.
+  if (entry->next_ == nullptr) {
+    wakeups_.fetch_add(1, std::memory_order_relaxed);
+    dispatcher_.post([queue = shared_from_this()]() { queue->drain(); });
+  }
+}
+
+void ContinueQueue::drain() {
+  Entry* entry = head_.exchange(nullptr, std::memory_order_acquire);
+  // The list is in the reverse order of the pushes.
+  Entry* ordered = nullptr;
+  while (entry != nullptr) {
+    Entry* next = entry->next_;
+    entry->next_ = ordered;
+    ordered = entry;
+    entry = next;
+  }
+  while (ordered != nullptr) {
+    Entry* next = ordered->next_;
+    ordered->filter_->onContinue(ordered->direction_);
+    delete ordered;
+    ordered = next;
+  }
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
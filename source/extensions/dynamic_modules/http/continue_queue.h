@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "envoy/event/dispatcher.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class HttpFilter;
+
+/**
+ * Collects the continue requests made by the modules from any thread for the streams on a single
+ * worker, and runs them on the worker in a batch. Only the first request after a drain posts to
+ * the dispatcher, so a burst of completions from the module threads costs a single wakeup of the
+ * worker instead of one per stream. Producers push onto a lock-free list, so they never contend
+ * on a lock with each other or with the worker.
+ *
+ * A worker has at most one queue at a time, shared by all the filters on it. It is kept alive by
+ * the filters referencing it and by a pending drain.
+ */
+class ContinueQueue : public std::enable_shared_from_this<ContinueQueue> {
+public:
+  enum class Direction { Request, Response };
+
+  explicit ContinueQueue(Event::Dispatcher& dispatcher) : dispatcher_(dispatcher) {}
+  ~ContinueQueue();
+
+  /**
+   * Returns the queue for the worker. This must be called on the thread running the dispatcher.
+   * @param dispatcher the dispatcher of the worker.
+   */
+  static std::shared_ptr<ContinueQueue> forDispatcher(Event::Dispatcher& dispatcher);
+
+  /**
+   * Continue the stream on the worker. This can be called from any thread.
+   * @param filter the filter of the stream. This is kept alive until the stream is continued.
+   * @param direction whether to continue the request or the response.
+   */
+  void push(std::shared_ptr<HttpFilter> filter, Direction direction);
+
+  /**
+   * @return the number of times the worker was woken up to drain the queue.
+   */
+  uint64_t wakeups() const { return wakeups_.load(std::memory_order_relaxed); }
+
+  Event::Dispatcher& dispatcher() const { return dispatcher_; }
+
+private:
+  struct Entry {
+    Entry* next_;
+    std::shared_ptr<HttpFilter> filter_;
+    Direction direction_;
+  };
+
+  /**
+   * Runs all the entries pushed so far in the order they were pushed. This runs on the worker.
+   */
+  void drain();
+
+  Event::Dispatcher& dispatcher_;
+  // The most recently pushed entry. nullptr means the queue is empty and no drain is pending.
+  std::atomic<Entry*> head_{nullptr};
+  std::atomic<uint64_t> wakeups_{0};
+};
+
+using ContinueQueueSharedPtr = std::shared_ptr<ContinueQueue>;
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
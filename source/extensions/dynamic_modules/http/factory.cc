@@ -1,3 +1,4 @@
+#include <exception>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -6,10 +7,18 @@
 #include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
 #include "envoy/registry/registry.h"
 #include "envoy/server/filter_config.h"
+#include "envoy/singleton/manager.h"
 
+#include "source/common/init/target_impl.h"
+#include "source/common/protobuf/utility.h"
 #include "source/extensions/dynamic_modules/http/config.pb.h"
 #include "source/extensions/dynamic_modules/http/config.pb.validate.h"
 #include "source/extensions/dynamic_modules/http/filter.h"
+#include "source/extensions/dynamic_modules/http/memory_pressure_watcher.h"
+#include "source/extensions/dynamic_modules/http/module_init_pool.h"
+#include "source/extensions/dynamic_modules/http/module_reloader.h"
+#include "source/extensions/dynamic_modules/http/offload_pool.h"
+#include "source/extensions/filters/http/common/pass_through_filter.h"
 
 namespace Envoy {
 namespace Server {
@@ -17,16 +26,62 @@ namespace Configuration {
 
 using DynamicModuleConfig =
     envoy::extensions::filters::http::dynamic_modules::v3::DynamicModuleConfig;
+using CallbackBudgetConfig = envoy::extensions::filters::http::dynamic_modules::v3::CallbackBudget;
+using Envoy::Extensions::DynamicModules::Http::DynamicModuleHttpFilterStatsSharedPtr;
+using Envoy::Extensions::DynamicModules::Http::generateStats;
+using Envoy::Extensions::DynamicModules::Http::HttpDynamicModuleReloader;
+using Envoy::Extensions::DynamicModules::Http::HttpDynamicModuleSharedPtr;
+using Envoy::Extensions::DynamicModules::Http::HttpFilter;
+using Envoy::Extensions::DynamicModules::Http::MappedConfigFile;
+using Envoy::Extensions::DynamicModules::Http::MemoryPressureWatcher;
+using Envoy::Extensions::DynamicModules::Http::MemoryPressureWatcherSharedPtr;
+using Envoy::Extensions::DynamicModules::Http::ModuleInitPool;
+using Envoy::Extensions::DynamicModules::Http::OffloadPool;
+using Envoy::Extensions::DynamicModules::Http::OffloadPoolSharedPtr;
+
+SINGLETON_MANAGER_REGISTRATION(dynamic_module_init_pool);
+
+/**
+ * The filter used in place of the dynamic module filter when the module failed to initialize with
+ * parallel_init.
+ */
+class InitFailedFilter : public Http::PassThroughDecoderFilter {
+public:
+  Http::FilterHeadersStatus decodeHeaders(Http::RequestHeaderMap&, bool) override {
+    decoder_callbacks_->sendLocalReply(Http::Code::InternalServerError, "", nullptr,
+                                       absl::nullopt, "dynamic_module_init_failed");
+    return Http::FilterHeadersStatus::StopIteration;
+  }
+};
+
+/**
+ * The memory pressure watcher of a filter config with hot_reload, which is replaced with the one of
+ * the new module on each reload. This is only accessed on the main thread.
+ */
+struct ReloadedMemoryPressureWatcher {
+  MemoryPressureWatcherSharedPtr watcher_;
+};
+
+/**
+ * The state of a module loaded with parallel_init, shared by the init target and the filter
+ * factory.
+ */
+struct ParallelInitState {
+  std::unique_ptr<Init::TargetImpl> init_target_;
+  // Set on the main thread before the init target gets ready, so it is only read by the workers
+  // after that. Empty if the module failed to initialize.
+  Http::FilterFactoryCb factory_cb_;
+};
 
 class DynamicModuleFactory : public NamedHttpFilterConfigFactory {
 public:
   absl::StatusOr<Http::FilterFactoryCb>
-  createFilterFactoryFromProto(const Protobuf::Message& proto_config, const std::string&,
-                               FactoryContext& context) override {
+  createFilterFactoryFromProto(const Protobuf::Message& proto_config,
+                               const std::string& stats_prefix, FactoryContext& context) override {
 
     return createFactory(Envoy::MessageUtil::downcastAndValidate<const DynamicModuleConfig&>(
                              proto_config, context.messageValidationVisitor()),
-                         context);
+                         stats_prefix, context);
   }
 
   ProtobufTypes::MessagePtr createEmptyConfigProto() override {
@@ -36,24 +91,252 @@ public:
   std::string name() const override { return "envoy.http.dynamic_modules"; }
 
 private:
-  Http::FilterFactoryCb createFactory(const DynamicModuleConfig& proto_config, FactoryContext&) {
+  static Extensions::DynamicModules::Http::CallbackBudget
+  callbackBudgetFromProto(const DynamicModuleConfig& proto_config) {
+    using CallbackBudget = Extensions::DynamicModules::Http::CallbackBudget;
+    CallbackBudget callback_budget;
+    if (!proto_config.has_callback_budget()) {
+      return callback_budget;
+    }
+    const auto& budget_proto = proto_config.callback_budget();
+    callback_budget.budget_ = std::chrono::nanoseconds(
+        Protobuf::util::TimeUtil::DurationToNanoseconds(budget_proto.budget()));
+    if (budget_proto.has_cooldown()) {
+      callback_budget.cooldown_ = std::chrono::nanoseconds(
+          Protobuf::util::TimeUtil::DurationToNanoseconds(budget_proto.cooldown()));
+    }
+    switch (budget_proto.overrun_policy()) {
+    case CallbackBudgetConfig::FAIL_OPEN:
+      callback_budget.overrun_policy_ = CallbackBudget::OverrunPolicy::FailOpen;
+      break;
+    case CallbackBudgetConfig::FAIL_CLOSED:
+      callback_budget.overrun_policy_ = CallbackBudget::OverrunPolicy::FailClosed;
+      break;
+    default:
+      callback_budget.overrun_policy_ = CallbackBudget::OverrunPolicy::CountOnly;
+      break;
+    }
+    return callback_budget;
+  }
+
+  static Extensions::DynamicModules::LoadMode
+  loadModeFromProto(const DynamicModuleConfig& proto_config) {
+    Extensions::DynamicModules::LoadMode load_mode;
+    load_mode.eager_bind_ = proto_config.load_mode().eager_bind();
+    load_mode.prefault_ = proto_config.load_mode().prefault();
+    load_mode.mlock_ = proto_config.load_mode().mlock();
+    return load_mode;
+  }
+
+  /**
+   * @return the offload pool shared by the filter configs of the module with the same options, or
+   * nullptr if it is not configured.
+   */
+  static OffloadPoolSharedPtr
+  offloadPoolFromProto(const DynamicModuleConfig& proto_config,
+                       ServerFactoryContext& server_context,
+                       const HttpDynamicModuleSharedPtr& http_dynamic_module) {
+    if (!proto_config.has_offload_pool()) {
+      return nullptr;
+    }
+    const auto& pool_proto = proto_config.offload_pool();
+    const uint32_t max_queue_depth = pool_proto.max_queue_depth() > 0
+                                         ? pool_proto.max_queue_depth()
+                                         : OffloadPool::DefaultMaxQueueDepth;
+    return OffloadPool::getOrCreate(http_dynamic_module->dynamic_module_,
+                                    server_context.api().threadFactory(),
+                                    server_context.mainThreadDispatcher(), pool_proto.threads(),
+                                    max_queue_depth);
+  }
+
+  /**
+   * @return the watcher forwarding the memory pressure to the module, or nullptr if it is not
+   * configured or the module doesn't export envoy_dynamic_module_on_memory_pressure.
+   */
+  static MemoryPressureWatcherSharedPtr
+  memoryPressureWatcherFromProto(const DynamicModuleConfig& proto_config,
+                                 ServerFactoryContext& server_context,
+                                 const HttpDynamicModuleSharedPtr& http_dynamic_module) {
+    if (!proto_config.has_memory_pressure()) {
+      return nullptr;
+    }
+    const auto& memory_pressure_proto = proto_config.memory_pressure();
+    const std::string overload_action = memory_pressure_proto.overload_action().empty()
+                                            ? MemoryPressureWatcher::DefaultOverloadAction
+                                            : memory_pressure_proto.overload_action();
+    std::chrono::milliseconds poll_interval = std::chrono::seconds(1);
+    if (memory_pressure_proto.has_poll_interval()) {
+      poll_interval = std::chrono::milliseconds(Protobuf::util::TimeUtil::DurationToMilliseconds(
+          memory_pressure_proto.poll_interval()));
+    }
+    return MemoryPressureWatcher::getOrCreate(
+        http_dynamic_module->dynamic_module_, server_context.mainThreadDispatcher(),
+        server_context.overloadManager(), overload_action, poll_interval);
+  }
+
+  /**
+   * @return the filter config passed to the module as is, whichever form it is given in.
+   */
+  static const std::string& filterConfigFromProto(const DynamicModuleConfig& proto_config) {
+    switch (proto_config.filter_config_specifier_case()) {
+    case DynamicModuleConfig::kFilterConfigBytes:
+      return proto_config.filter_config_bytes();
+    case DynamicModuleConfig::kTypedFilterConfig:
+      return proto_config.typed_filter_config().value();
+    default:
+      return proto_config.filter_config();
+    }
+  }
+
+  /**
+   * Loads and initializes the module in the config. This throws EnvoyException on failure.
+   */
+  static HttpDynamicModuleSharedPtr loadModule(const DynamicModuleConfig& proto_config) {
     const auto dynamic_module = Extensions::DynamicModules::newDynamicModule(
-        proto_config.file_path(), proto_config.do_not_dlclose());
+        proto_config.file_path(), proto_config.do_not_dlclose(), loadModeFromProto(proto_config));
     if (!dynamic_module.ok()) {
       throw EnvoyException("Failed to load dynamic module: " +
                            std::string(dynamic_module.status().message()));
     }
-    auto http_dynamic_module =
-        std::make_shared<Envoy::Extensions::DynamicModules::Http::HttpDynamicModule>(
-            proto_config.name(), proto_config.filter_config(), dynamic_module.value());
+    if (proto_config.filter_config_specifier_case() == DynamicModuleConfig::kFilterConfigFile) {
+      const auto config_file = MappedConfigFile::open(proto_config.filter_config_file());
+      if (!config_file.ok()) {
+        throw EnvoyException(std::string(config_file.status().message()));
+      }
+      return Extensions::DynamicModules::Http::getOrCreateHttpDynamicModule(
+          proto_config.name(), config_file.value(), dynamic_module.value(),
+          callbackBudgetFromProto(proto_config));
+    }
+    return Extensions::DynamicModules::Http::getOrCreateHttpDynamicModule(
+        proto_config.name(), filterConfigFromProto(proto_config), dynamic_module.value(),
+        callbackBudgetFromProto(proto_config));
+  }
+
+  Http::FilterFactoryCb createFactory(const DynamicModuleConfig& proto_config,
+                                      const std::string& stats_prefix, FactoryContext& context) {
+    const DynamicModuleHttpFilterStatsSharedPtr stats =
+        generateStats(stats_prefix + "dynamic_modules.", context.scope());
+    if (proto_config.parallel_init()) {
+      return createFactoryWithParallelInit(proto_config, context.serverFactoryContext(),
+                                           context.initManager(), stats);
+    }
+    return createFactoryFromModule(proto_config, context.serverFactoryContext(),
+                                   loadModule(proto_config), stats);
+  }
+
+  static Http::FilterFactoryCb
+  createFactoryFromModule(const DynamicModuleConfig& proto_config,
+                          ServerFactoryContext& server_context,
+                          HttpDynamicModuleSharedPtr http_dynamic_module,
+                          DynamicModuleHttpFilterStatsSharedPtr stats) {
+    const OffloadPoolSharedPtr offload_pool =
+        offloadPoolFromProto(proto_config, server_context, http_dynamic_module);
+    // Held by the filter factory so that the module is watched as long as the config is alive.
+    const MemoryPressureWatcherSharedPtr memory_pressure_watcher =
+        memoryPressureWatcherFromProto(proto_config, server_context, http_dynamic_module);
+    Upstream::ClusterManager& cluster_manager = server_context.clusterManager();
+    if (!proto_config.hot_reload()) {
+      return [http_dynamic_module, offload_pool, memory_pressure_watcher, &cluster_manager,
+              stats](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+        auto filter = std::make_shared<HttpFilter>(http_dynamic_module, offload_pool,
+                                                   &cluster_manager, stats);
+        callbacks.addStreamDecoderFilter(filter);
+        callbacks.addStreamEncoderFilter(filter);
+      };
+    }
 
-    return [http_dynamic_module](Http::FilterChainFactoryCallbacks& callbacks) -> void {
-      auto filter = std::make_shared<Envoy::Extensions::DynamicModules::Http::HttpFilter>(
-          http_dynamic_module);
+    const auto name = proto_config.name();
+    const std::string filter_config = filterConfigFromProto(proto_config);
+    // The reloaded module reuses the mapping of the config file.
+    const auto config_file = http_dynamic_module->config_file_;
+    const auto callback_budget = callbackBudgetFromProto(proto_config);
+    auto reloaded_watcher = std::make_shared<ReloadedMemoryPressureWatcher>(
+        ReloadedMemoryPressureWatcher{memory_pressure_watcher});
+    auto reloader = std::make_shared<HttpDynamicModuleReloader>(
+        http_dynamic_module, proto_config.file_path(), proto_config.do_not_dlclose(),
+        loadModeFromProto(proto_config),
+        [name, filter_config, config_file,
+         callback_budget](Extensions::DynamicModules::DynamicModuleSharedPtr reloaded) {
+          if (config_file != nullptr) {
+            return Extensions::DynamicModules::Http::getOrCreateHttpDynamicModule(
+                name, config_file, reloaded, callback_budget);
+          }
+          return Extensions::DynamicModules::Http::getOrCreateHttpDynamicModule(
+              name, filter_config, reloaded, callback_budget);
+        },
+        server_context.threadLocal(), server_context.mainThreadDispatcher(),
+        // The watcher moves to the new module, so that the module serving the new streams is the
+        // one notified, and the old one is unloaded once its streams finish.
+        [reloaded_watcher, proto_config,
+         &server_context](const HttpDynamicModuleSharedPtr& reloaded) {
+          reloaded_watcher->watcher_ =
+              memoryPressureWatcherFromProto(proto_config, server_context, reloaded);
+        });
+    return [reloader, offload_pool, reloaded_watcher, &cluster_manager,
+            stats](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+      auto filter = std::make_shared<HttpFilter>(reloader->current(), offload_pool,
+                                                 &cluster_manager, stats);
       callbacks.addStreamDecoderFilter(filter);
       callbacks.addStreamEncoderFilter(filter);
     };
   }
+
+  /**
+   * Loads the module on the ModuleInitPool while the listener is warming, and completes the filter
+   * factory on the main thread once the module is initialized.
+   */
+  static Http::FilterFactoryCb
+  createFactoryWithParallelInit(const DynamicModuleConfig& proto_config,
+                                ServerFactoryContext& server_context, Init::Manager& init_manager,
+                                DynamicModuleHttpFilterStatsSharedPtr stats) {
+    auto pool = server_context.singletonManager().getTyped<ModuleInitPool>(
+        SINGLETON_MANAGER_REGISTERED_NAME(dynamic_module_init_pool), [&server_context] {
+          return std::make_shared<ModuleInitPool>(server_context.api().threadFactory(),
+                                                  ModuleInitPool::defaultConcurrency());
+        });
+
+    auto state = std::make_shared<ParallelInitState>();
+    std::weak_ptr<ParallelInitState> weak_state = state;
+    state->init_target_ = std::make_unique<Init::TargetImpl>(
+        fmt::format("dynamic_module {}", proto_config.name()),
+        [pool, weak_state, proto_config, &server_context, stats]() {
+          pool->post([weak_state, proto_config, &server_context, stats]() {
+            HttpDynamicModuleSharedPtr module;
+            std::string error;
+            try {
+              module = loadModule(proto_config);
+            } catch (const std::exception& e) {
+              // Not only EnvoyException, as an exception escaping the thread terminates Envoy.
+              error = e.what();
+            }
+            server_context.mainThreadDispatcher().post(
+                [weak_state, proto_config, &server_context, stats, module, error]() {
+                  std::shared_ptr<ParallelInitState> state = weak_state.lock();
+                  if (state == nullptr) {
+                    // The filter config was removed while loading.
+                    return;
+                  }
+                  if (module != nullptr) {
+                    state->factory_cb_ =
+                        createFactoryFromModule(proto_config, server_context, module, stats);
+                  } else {
+                    ENVOY_LOG_MISC(error, "[{}] failed to initialize dynamic module: {}",
+                                   proto_config.name(), error);
+                  }
+                  state->init_target_->ready();
+                });
+          });
+        });
+    init_manager.add(*state->init_target_);
+
+    return [state, pool](Http::FilterChainFactoryCallbacks& callbacks) -> void {
+      if (state->factory_cb_) {
+        state->factory_cb_(callbacks);
+        return;
+      }
+      callbacks.addStreamDecoderFilter(std::make_shared<InitFailedFilter>());
+    };
+  }
 };
 
 /**
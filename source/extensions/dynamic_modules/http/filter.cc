@@ -5,6 +5,9 @@
 #include "envoy/server/filter_config.h"
 #include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
 
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+
 namespace Envoy {
 namespace Extensions {
 namespace DynamicModules {
@@ -13,16 +16,29 @@ namespace Http {
 #define STATIC_CAST_AS_VOID(x) static_cast<void*>(x)
 #define THIS_AS_VOID STATIC_CAST_AS_VOID(this)
 
-HttpFilter::HttpFilter(HttpDynamicModuleSharedPtr dynamic_module)
-    : dynamic_module_(dynamic_module) {}
+DynamicModuleHttpFilterStatsSharedPtr generateStats(const std::string& prefix,
+                                                    Stats::Scope& scope) {
+  return std::make_shared<DynamicModuleHttpFilterStats>(DynamicModuleHttpFilterStats{
+      ALL_DYNAMIC_MODULE_HTTP_FILTER_STATS(POOL_COUNTER_PREFIX(scope, prefix))});
+}
+
+HttpFilter::HttpFilter(HttpDynamicModuleSharedPtr dynamic_module,
+                       OffloadPoolSharedPtr offload_pool, Upstream::ClusterManager* cluster_manager,
+                       DynamicModuleHttpFilterStatsSharedPtr stats)
+    : dynamic_module_(dynamic_module), offload_pool_(std::move(offload_pool)),
+      cluster_manager_(cluster_manager), stats_(std::move(stats)) {}
 
 HttpFilter::~HttpFilter() { this->destoryHttpFilterInstance(); }
 
 void HttpFilter::ensureHttpFilterInstance() {
   ENVOY_LOG_MISC(info, "[{}] -> envoy_dynamic_module_on_http_filter_instance_init_ ({}, {})",
                  dynamic_module_->name_, THIS_AS_VOID, dynamic_module_->http_filter_);
-  http_filter_instance_ = dynamic_module_->envoy_dynamic_module_on_http_filter_instance_init_(
-      THIS_AS_VOID, dynamic_module_->http_filter_);
+  {
+    ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                              "envoy_dynamic_module_on_http_filter_instance_init");
+    http_filter_instance_ = dynamic_module_->envoy_dynamic_module_on_http_filter_instance_init_(
+        THIS_AS_VOID, dynamic_module_->http_filter_);
+  }
   ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_instance_init_: {}",
                  dynamic_module_->name_, http_filter_instance_);
 }
@@ -32,20 +48,150 @@ void HttpFilter::onDestroy() { this->destoryHttpFilterInstance(); };
 void HttpFilter::destoryHttpFilterInstance() {
   this->encoder_callbacks_ = nullptr;
   this->decoder_callbacks_ = nullptr;
+  if (stream_handle_ != 0) {
+    StreamHandleTable::get().release(stream_handle_);
+    stream_handle_ = 0;
+  }
+  timers_.clear();
+  callouts_.clear();
   ASSERT(dynamic_module_);
   if (http_filter_instance_) {
     ENVOY_LOG_MISC(info, "[{}] -> envoy_dynamic_module_on_http_filter_instance_destroy_ ({})",
                    dynamic_module_->name_, http_filter_instance_);
-    dynamic_module_->envoy_dynamic_module_on_http_filter_instance_destroy_(http_filter_instance_);
+    {
+      ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                                "envoy_dynamic_module_on_http_filter_instance_destroy");
+      dynamic_module_->envoy_dynamic_module_on_http_filter_instance_destroy_(http_filter_instance_);
+    }
     ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_instance_destroy_",
                    dynamic_module_->name_);
     http_filter_instance_ = nullptr;
   }
 }
 
+void HttpFilter::onContinue(ContinueQueue::Direction direction) {
+  if (in_continue_) {
+    return;
+  }
+  if (direction == ContinueQueue::Direction::Request) {
+    if (decoder_callbacks_) {
+      decoder_callbacks_->continueDecoding();
+      in_continue_ = true;
+    }
+  } else if (encoder_callbacks_) {
+    encoder_callbacks_->continueEncoding();
+    in_continue_ = true;
+  }
+}
+
+uint64_t HttpFilter::streamHandle() {
+  if (stream_handle_ == 0) {
+    stream_handle_ = StreamHandleTable::get().acquire(weak_from_this());
+  }
+  return stream_handle_;
+}
+
+uint32_t HttpFilter::workerIndex() const {
+  if (decoder_callbacks_ == nullptr) {
+    return 0;
+  }
+  // The worker dispatchers are named "worker_<index>" by the server.
+  std::string_view name = decoder_callbacks_->dispatcher().name();
+  uint32_t index = 0;
+  if (!absl::ConsumePrefix(&name, "worker_") || !absl::SimpleAtoi(name, &index)) {
+    return 0;
+  }
+  return index;
+}
+
+bool HttpFilter::offload(envoy_dynamic_module_type_OffloadWork work,
+                         envoy_dynamic_module_type_OffloadDone done, void* context) {
+  if (offload_pool_ == nullptr || decoder_callbacks_ == nullptr) {
+    return false;
+  }
+  Event::Dispatcher& dispatcher = decoder_callbacks_->dispatcher();
+  std::weak_ptr<HttpFilter> weak_filter = weak_from_this();
+  // The module is held until the done function returns, since the stream may go away before that.
+  return offload_pool_->tryPost(
+      [&dispatcher, weak_filter, module = dynamic_module_, stats = stats_, work, done, context]() {
+        work(context);
+        dispatcher.post([weak_filter, module, stats, done, context]() {
+          std::shared_ptr<HttpFilter> filter = weak_filter.lock();
+          void* http_filter_instance = filter != nullptr ? filter->http_filter_instance_ : nullptr;
+          ScopedCallbackTimer timer(*module, stats.get(), "envoy_dynamic_module_type_OffloadDone");
+          done(http_filter_instance, context);
+        });
+      },
+      // The pool is only destroyed once this filter has released it, so the stream is gone. This
+      // runs on the main thread destroying the pool, which may be at the shutdown after the worker
+      // dispatcher is gone, so the context is released right here instead of posting to it.
+      [module = dynamic_module_, stats = stats_, done, context]() {
+        ScopedCallbackTimer timer(*module, stats.get(), "envoy_dynamic_module_type_OffloadDone");
+        done(nullptr, context);
+      });
+}
+
+Event::Timer* HttpFilter::createTimer(envoy_dynamic_module_type_TimerCallback callback,
+                                      void* context) {
+  if (decoder_callbacks_ == nullptr) {
+    return nullptr;
+  }
+  // The timer never outlives this filter, so it is fine to capture this.
+  timers_.push_back(decoder_callbacks_->dispatcher().createTimer([this, callback, context]() {
+    ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                              "envoy_dynamic_module_type_TimerCallback");
+    callback(http_filter_instance_, context);
+  }));
+  return timers_.back().get();
+}
+
+bool HttpFilter::sendCallout(std::string_view cluster_name, RequestMessagePtr&& message,
+                             std::chrono::milliseconds timeout,
+                             envoy_dynamic_module_type_HttpCalloutDone done, void* context) {
+  if (cluster_manager_ == nullptr) {
+    return false;
+  }
+  Upstream::ThreadLocalCluster* cluster = cluster_manager_->getThreadLocalCluster(cluster_name);
+  if (cluster == nullptr) {
+    ENVOY_LOG_MISC(debug, "[{}] callout cluster not found: {}", dynamic_module_->name_,
+                   cluster_name);
+    return false;
+  }
+  auto options = AsyncClient::RequestOptions();
+  if (timeout.count() > 0) {
+    options.setTimeout(timeout);
+  }
+  auto callout = std::make_unique<HttpCallout>(*this, done, context);
+  HttpCallout* callout_ptr = callout.get();
+  callouts_.emplace(callout_ptr, std::move(callout));
+  callout_ptr->send(*cluster, std::move(message), options);
+  return true;
+}
+
+FilterHeadersStatus HttpFilter::onModuleDegraded() {
+  bypassed_ = true;
+  if (dynamic_module_->callback_budget_.overrun_policy_ ==
+      CallbackBudget::OverrunPolicy::FailClosed) {
+    ENVOY_LOG_MISC(debug, "[{}] module is degraded, rejecting the stream", dynamic_module_->name_);
+    if (decoder_callbacks_) {
+      decoder_callbacks_->sendLocalReply(Http::Code::ServiceUnavailable, "", nullptr,
+                                         absl::nullopt, "dynamic_module_degraded");
+    }
+    return FilterHeadersStatus::StopIteration;
+  }
+  ENVOY_LOG_MISC(debug, "[{}] module is degraded, bypassing the stream", dynamic_module_->name_);
+  return FilterHeadersStatus::Continue;
+}
+
 FilterHeadersStatus HttpFilter::decodeHeaders(RequestHeaderMap& headers, bool end_of_stream) {
   ASSERT(dynamic_module_);
+  if (bypassed_) {
+    return FilterHeadersStatus::Continue;
+  }
   if (!http_filter_instance_) {
+    if (dynamic_module_->isDegraded()) {
+      return onModuleDegraded();
+    }
     this->ensureHttpFilterInstance();
     if (!http_filter_instance_) {
       return FilterHeadersStatus::StopIteration;
@@ -55,9 +201,13 @@ FilterHeadersStatus HttpFilter::decodeHeaders(RequestHeaderMap& headers, bool en
   ENVOY_LOG_MISC(
       info, "[{}] -> envoy_dynamic_module_on_http_filter_instance_request_headers_ ({}, {}, {})",
       dynamic_module_->name_, http_filter_instance_, STATIC_CAST_AS_VOID(&headers), end_of_stream);
-  const envoy_dynamic_module_type_EventHttpRequestHeadersStatus result =
-      dynamic_module_->envoy_dynamic_module_on_http_filter_instance_request_headers_(
-          http_filter_instance_, STATIC_CAST_AS_VOID(&headers), end_of_stream);
+  envoy_dynamic_module_type_EventHttpRequestHeadersStatus result;
+  {
+    ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                              "envoy_dynamic_module_on_http_filter_instance_request_headers");
+    result = dynamic_module_->envoy_dynamic_module_on_http_filter_instance_request_headers_(
+        http_filter_instance_, STATIC_CAST_AS_VOID(&headers), end_of_stream);
+  }
   ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_instance_request_headers_: {}",
                  dynamic_module_->name_, result);
   this->in_continue_ = result == envoy_dynamic_module_type_EventHttpRequestHeadersStatusContinue;
@@ -66,13 +216,20 @@ FilterHeadersStatus HttpFilter::decodeHeaders(RequestHeaderMap& headers, bool en
 
 FilterDataStatus HttpFilter::decodeData(Buffer::Instance& buffer, bool end_of_stream) {
   ASSERT(dynamic_module_);
+  if (bypassed_) {
+    return FilterDataStatus::Continue;
+  }
   ASSERT(http_filter_instance_);
   ENVOY_LOG_MISC(
       info, "[{}] -> envoy_dynamic_module_on_http_filter_instance_request_body_ ({}, {}, {})",
       dynamic_module_->name_, http_filter_instance_, STATIC_CAST_AS_VOID(&buffer), end_of_stream);
-  const envoy_dynamic_module_type_EventHttpRequestBodyStatus result =
-      dynamic_module_->envoy_dynamic_module_on_http_filter_instance_request_body_(
-          http_filter_instance_, STATIC_CAST_AS_VOID(&buffer), end_of_stream);
+  envoy_dynamic_module_type_EventHttpRequestBodyStatus result;
+  {
+    ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                              "envoy_dynamic_module_on_http_filter_instance_request_body");
+    result = dynamic_module_->envoy_dynamic_module_on_http_filter_instance_request_body_(
+        http_filter_instance_, STATIC_CAST_AS_VOID(&buffer), end_of_stream);
+  }
   ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_instance_request_body_: {}",
                  dynamic_module_->name_, result);
   this->in_continue_ = result == envoy_dynamic_module_type_EventHttpRequestBodyStatusContinue;
@@ -81,13 +238,20 @@ FilterDataStatus HttpFilter::decodeData(Buffer::Instance& buffer, bool end_of_st
 
 FilterHeadersStatus HttpFilter::encodeHeaders(ResponseHeaderMap& headers, bool end_of_stream) {
   ASSERT(dynamic_module_);
+  if (bypassed_) {
+    return FilterHeadersStatus::Continue;
+  }
   ASSERT(http_filter_instance_);
   ENVOY_LOG_MISC(
       info, "[{}] -> envoy_dynamic_module_on_http_filter_instance_response_headers_ ({}, {}, {})",
       dynamic_module_->name_, http_filter_instance_, STATIC_CAST_AS_VOID(&headers), end_of_stream);
-  const envoy_dynamic_module_type_EventHttpResponseHeadersStatus result =
-      dynamic_module_->envoy_dynamic_module_on_http_filter_instance_response_headers_(
-          http_filter_instance_, STATIC_CAST_AS_VOID(&headers), end_of_stream);
+  envoy_dynamic_module_type_EventHttpResponseHeadersStatus result;
+  {
+    ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                              "envoy_dynamic_module_on_http_filter_instance_response_headers");
+    result = dynamic_module_->envoy_dynamic_module_on_http_filter_instance_response_headers_(
+        http_filter_instance_, STATIC_CAST_AS_VOID(&headers), end_of_stream);
+  }
   ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_instance_response_headers_: {}",
                  dynamic_module_->name_, result);
   this->in_continue_ = result == envoy_dynamic_module_type_EventHttpResponseHeadersStatusContinue;
@@ -96,13 +260,20 @@ FilterHeadersStatus HttpFilter::encodeHeaders(ResponseHeaderMap& headers, bool e
 
 FilterDataStatus HttpFilter::encodeData(Buffer::Instance& buffer, bool end_of_stream) {
   ASSERT(dynamic_module_);
+  if (bypassed_) {
+    return FilterDataStatus::Continue;
+  }
   ASSERT(http_filter_instance_);
   ENVOY_LOG_MISC(
       info, "[{}] -> envoy_dynamic_module_on_http_filter_instance_response_body_ ({}, {}, {})",
       dynamic_module_->name_, http_filter_instance_, STATIC_CAST_AS_VOID(&buffer), end_of_stream);
-  const envoy_dynamic_module_type_EventHttpResponseBodyStatus result =
-      dynamic_module_->envoy_dynamic_module_on_http_filter_instance_response_body_(
-          http_filter_instance_, STATIC_CAST_AS_VOID(&buffer), end_of_stream);
+  envoy_dynamic_module_type_EventHttpResponseBodyStatus result;
+  {
+    ScopedCallbackTimer timer(*dynamic_module_, stats_.get(),
+                              "envoy_dynamic_module_on_http_filter_instance_response_body");
+    result = dynamic_module_->envoy_dynamic_module_on_http_filter_instance_response_body_(
+        http_filter_instance_, STATIC_CAST_AS_VOID(&buffer), end_of_stream);
+  }
   ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_instance_response_body_: {}",
                  dynamic_module_->name_, result);
   this->in_continue_ = result == envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue;
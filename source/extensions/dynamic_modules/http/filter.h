@@ -1,12 +1,27 @@
 
 #pragma once
 
+#include <chrono>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "envoy/event/timer.h"
+#include "envoy/stats/scope.h"
+#include "envoy/stats/stats_macros.h"
+#include "envoy/upstream/cluster_manager.h"
 
 #include "source/extensions/filters/http/common/pass_through_filter.h"
 
+#include "absl/container/flat_hash_map.h"
+
 #include "source/extensions/dynamic_modules/http/config.pb.h"
+#include "source/extensions/dynamic_modules/http/continue_queue.h"
+#include "source/extensions/dynamic_modules/http/http_callout.h"
+#include "source/extensions/dynamic_modules/http/stream_handle_table.h"
 #include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
+#include "source/extensions/dynamic_modules/http/offload_pool.h"
 
 namespace Envoy {
 namespace Extensions {
@@ -15,12 +30,63 @@ namespace Http {
 
 using namespace Envoy::Http;
 
+/**
+ * All the stats of the dynamic module filter. @see stats_macros.h
+ */
+#define ALL_DYNAMIC_MODULE_HTTP_FILTER_STATS(COUNTER) COUNTER(callback_budget_overrun)
+
+/**
+ * The stats of a filter config, shared by its filters.
+ */
+struct DynamicModuleHttpFilterStats {
+  ALL_DYNAMIC_MODULE_HTTP_FILTER_STATS(GENERATE_COUNTER_STRUCT)
+};
+using DynamicModuleHttpFilterStatsSharedPtr = std::shared_ptr<DynamicModuleHttpFilterStats>;
+
+/**
+ * @return the stats of a filter config in the scope, with the prefix of the filter config.
+ */
+DynamicModuleHttpFilterStatsSharedPtr generateStats(const std::string& prefix, Stats::Scope& scope);
+
+/**
+ * Measures the elapsed time of a single event hook call while in scope, and reports it to the
+ * module on destruction, counting an overrun in the stats if any. The clock is not read at all
+ * when the budget is disabled.
+ */
+class ScopedCallbackTimer {
+public:
+  ScopedCallbackTimer(HttpDynamicModule& module, DynamicModuleHttpFilterStats* stats,
+                      const std::string_view event_hook)
+      : module_(module), stats_(stats), event_hook_(event_hook) {
+    if (module_.callbackBudgetEnabled()) {
+      start_ = std::chrono::steady_clock::now();
+    }
+  }
+
+  ~ScopedCallbackTimer() {
+    if (start_.has_value() &&
+        module_.onCallbackCompleted(event_hook_,
+                                    std::chrono::steady_clock::now() - start_.value()) &&
+        stats_ != nullptr) {
+      stats_->callback_budget_overrun_.inc();
+    }
+  }
+
+private:
+  HttpDynamicModule& module_;
+  DynamicModuleHttpFilterStats* const stats_;
+  const std::string_view event_hook_;
+  std::optional<std::chrono::steady_clock::time_point> start_;
+};
+
 /**
  * A filter that uses a dynamic module and corresponds to a single filter instance.
  */
 class HttpFilter : public Http::StreamFilter, public std::enable_shared_from_this<HttpFilter> {
 public:
-  HttpFilter(HttpDynamicModuleSharedPtr);
+  HttpFilter(HttpDynamicModuleSharedPtr, OffloadPoolSharedPtr offload_pool = nullptr,
+             Upstream::ClusterManager* cluster_manager = nullptr,
+             DynamicModuleHttpFilterStatsSharedPtr stats = nullptr);
   ~HttpFilter() override;
 
   /**
@@ -37,6 +103,99 @@ public:
    */
   void destoryHttpFilterInstance();
 
+  /**
+   * Continue the request or the response on the worker thread as requested by the module. This is
+   * called by the continue queue, and is a no-op once the stream is destroyed.
+   * @param direction whether to continue the request or the response.
+   */
+  void onContinue(ContinueQueue::Direction direction);
+
+  /**
+   * Returns the handle of this stream for the module to refer to it from any thread, allocating it
+   * on the first call. This must be called on the worker thread. The handle is invalidated when the
+   * in-module filter instance is destroyed.
+   * @return the handle, or 0 if it cannot be allocated.
+   */
+  uint64_t streamHandle();
+
+  /**
+   * @return the index of the worker running this stream, parsed from the name of its dispatcher, or
+   * 0 if the stream doesn't run on a worker, e.g. in tests.
+   */
+  uint32_t workerIndex() const;
+
+  /**
+   * Runs the work of the module on the offload pool, and then the done function on the worker
+   * thread. This must be called on the worker thread.
+   * @param work the work function of the module.
+   * @param done the done function of the module.
+   * @param context the context passed to both functions.
+   * @return false if the offload pool is not configured or is full.
+   */
+  bool offload(envoy_dynamic_module_type_OffloadWork work,
+               envoy_dynamic_module_type_OffloadDone done, void* context);
+
+  /**
+   * Creates a disabled timer on the dispatcher of the worker which calls back into the module. The
+   * timer is owned by this filter and destroyed with the in-module filter instance.
+   * @param callback the callback of the module.
+   * @param context the context passed to the callback.
+   * @return the timer, or nullptr if the filter has no dispatcher.
+   */
+  Event::Timer* createTimer(envoy_dynamic_module_type_TimerCallback callback, void* context);
+
+  /**
+   * Sends a request to the upstream cluster on behalf of the module. The callout is owned by this
+   * filter and cancelled with the in-module filter instance. This must be called on the worker
+   * thread.
+   * @param cluster_name the name of the cluster.
+   * @param message the request.
+   * @param timeout the timeout of the request, or zero for no timeout.
+   * @param done the done function of the module.
+   * @param context the context passed to the done function.
+   * @return false if the cluster doesn't exist.
+   */
+  bool sendCallout(std::string_view cluster_name, RequestMessagePtr&& message,
+                   std::chrono::milliseconds timeout,
+                   envoy_dynamic_module_type_HttpCalloutDone done, void* context);
+
+  /**
+   * @return the key/value store shared by the streams of the module on all the workers.
+   */
+  SharedDataStore& sharedData() { return dynamic_module_->shared_data_; }
+
+  /**
+   * @return the dynamic module of this filter.
+   */
+  const HttpDynamicModuleSharedPtr& dynamicModule() const { return dynamic_module_; }
+
+  /**
+   * @return the stats of the filter config, or nullptr if not configured.
+   */
+  const DynamicModuleHttpFilterStatsSharedPtr& stats() const { return stats_; }
+
+  /**
+   * @return the monotonic time of the worker. This must be called after the decoder callbacks are
+   * set.
+   */
+  MonotonicTime now() const {
+    return decoder_callbacks_->dispatcher().timeSource().monotonicTime();
+  }
+
+  /**
+   * Removes the completed callout from this filter. This is called by the callout itself right
+   * before it calls the module, which may destroy this filter instance.
+   * @param callout the callout.
+   * @return the callout, which the caller owns from now on.
+   */
+  HttpCalloutPtr releaseCallout(HttpCallout* callout) {
+    auto it = callouts_.find(callout);
+    ASSERT(it != callouts_.end());
+    HttpCalloutPtr released = std::move(it->second);
+    callouts_.erase(it);
+    return released;
+  }
+
   // N.B. The event hooks inlined here are not supported by the dynamic modules for now.
 
   // ---------- Http::StreamFilterBase ------------
@@ -83,6 +242,7 @@ public:
 
   void setDecoderFilterCallbacks(StreamDecoderFilterCallbacks& callbacks) override {
     decoder_callbacks_ = &callbacks;
+    continue_queue_ = ContinueQueue::forDispatcher(callbacks.dispatcher());
   }
 
   void decodeComplete() override{};
@@ -140,8 +300,36 @@ public:
   // calling coninueDecoding() or continueEncoding() multiple times.
   bool in_continue_ = false;
 
+  // The queue of the worker to continue this stream from any thread. This is set before the module
+  // sees the stream and never changes afterwards, so the module threads can read it without a lock.
+  ContinueQueueSharedPtr continue_queue_;
+
+  // The handle given to the module, or 0 if the module has not asked for it.
+  uint64_t stream_handle_ = 0;
+
+  // The timers created by the module. They are cancelled when the in-module filter instance is
+  // destroyed.
+  std::vector<Event::TimerPtr> timers_;
+
+  // The callouts in flight sent by the module. They are cancelled when the in-module filter
+  // instance is destroyed.
+  absl::flat_hash_map<HttpCallout*, HttpCalloutPtr> callouts_;
+
+  // If the module was degraded when this stream started. In that case, the module is not called
+  // at all for this stream.
+  bool bypassed_ = false;
+
 private:
+  /**
+   * Handle a new stream while the module is degraded according to the overrun policy.
+   */
+  FilterHeadersStatus onModuleDegraded();
+
   const HttpDynamicModuleSharedPtr dynamic_module_ = nullptr;
+  const OffloadPoolSharedPtr offload_pool_;
+  Upstream::ClusterManager* const cluster_manager_;
+  // The stats of the filter config, or nullptr in the tests which don't check them.
+  const DynamicModuleHttpFilterStatsSharedPtr stats_;
 };
 
 } // namespace Http
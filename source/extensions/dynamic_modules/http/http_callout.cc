@@ -0,0 +1,58 @@
+#include "source/extensions/dynamic_modules/http/http_callout.h"
+
+#include "source/common/common/logger.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+HttpCallout::~HttpCallout() {
+  if (request_ != nullptr) {
+    request_->cancel();
+  }
+}
+
+void HttpCallout::send(Upstream::ThreadLocalCluster& cluster,
+                       Envoy::Http::RequestMessagePtr&& message,
+                       const Envoy::Http::AsyncClient::RequestOptions& options) {
+  // On an immediate failure, onFailure() has already destroyed this when send() returns nullptr.
+  Envoy::Http::AsyncClient::Request* request =
+      cluster.httpAsyncClient().send(std::move(message), *this, options);
+  if (request != nullptr) {
+    request_ = request;
+  }
+}
+
+void HttpCallout::onSuccess(const Envoy::Http::AsyncClient::Request&,
+                            Envoy::Http::ResponseMessagePtr&& response) {
+  request_ = nullptr;
+  complete(response.get());
+}
+
+void HttpCallout::onFailure(const Envoy::Http::AsyncClient::Request&,
+                            Envoy::Http::AsyncClient::FailureReason reason) {
+  ENVOY_LOG_MISC(debug, "http callout failed: {}", static_cast<int>(reason));
+  request_ = nullptr;
+  complete(nullptr);
+}
+
+void HttpCallout::complete(Envoy::Http::ResponseMessage* response) {
+  // The module may send a local reply from the done function, which can destroy the filter
+  // instance along with its callouts synchronously. So this takes itself out of the filter first,
+  // and doesn't touch the filter after calling the module. The module and the stats are held here
+  // for the same reason, since the timer reports to them after the done function returns.
+  HttpCalloutPtr self = filter_.releaseCallout(this);
+  const HttpDynamicModuleSharedPtr module = filter_.dynamicModule();
+  const DynamicModuleHttpFilterStatsSharedPtr stats = filter_.stats();
+  ScopedCallbackTimer timer(*module, stats.get(), "envoy_dynamic_module_type_HttpCalloutDone");
+  done_(filter_.http_filter_instance_, context_,
+        response != nullptr ? static_cast<void*>(&response->headers()) : nullptr,
+        response != nullptr ? static_cast<void*>(&response->body()) : nullptr);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
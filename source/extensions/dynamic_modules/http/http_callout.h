@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+
+#include "envoy/http/async_client.h"
+#include "envoy/upstream/thread_local_cluster.h"
+
+#include "source/extensions/dynamic_modules/abi/abi.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class HttpFilter;
+
+/**
+ * A request sent by the module to an upstream cluster through the AsyncClient of the cluster, so
+ * that it goes through the connection pools, retries and stats of Envoy. This is owned by the
+ * filter which sent it, and lives on the worker thread of the stream.
+ */
+class HttpCallout : public Envoy::Http::AsyncClient::Callbacks {
+public:
+  HttpCallout(HttpFilter& filter, envoy_dynamic_module_type_HttpCalloutDone done, void* context)
+      : filter_(filter), done_(done), context_(context) {}
+
+  /**
+   * Cancels the request if it is still in flight, without calling the done function.
+   */
+  ~HttpCallout() override;
+
+  /**
+   * Sends the request. The done function may be called and this may be destroyed before this
+   * returns if the request fails immediately.
+   * @param cluster the cluster to send the request to.
+   * @param message the request.
+   * @param options the options of the request.
+   */
+  void send(Upstream::ThreadLocalCluster& cluster, Envoy::Http::RequestMessagePtr&& message,
+            const Envoy::Http::AsyncClient::RequestOptions& options);
+
+  // Http::AsyncClient::Callbacks
+  void onSuccess(const Envoy::Http::AsyncClient::Request&,
+                 Envoy::Http::ResponseMessagePtr&& response) override;
+  void onFailure(const Envoy::Http::AsyncClient::Request&,
+                 Envoy::Http::AsyncClient::FailureReason reason) override;
+  void onBeforeFinalizeUpstreamSpan(Tracing::Span&,
+                                    const Envoy::Http::ResponseHeaderMap*) override {}
+
+private:
+  /**
+   * Removes this from the filter, and calls the done function of the module. This must be the last
+   * thing done by the callbacks since it destroys this.
+   * @param response the response, or nullptr on failure.
+   */
+  void complete(Envoy::Http::ResponseMessage* response);
+
+  HttpFilter& filter_;
+  const envoy_dynamic_module_type_HttpCalloutDone done_;
+  void* const context_;
+  Envoy::Http::AsyncClient::Request* request_ = nullptr;
+};
+
+using HttpCalloutPtr = std::unique_ptr<HttpCallout>;
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
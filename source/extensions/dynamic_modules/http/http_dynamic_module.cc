@@ -1,5 +1,7 @@
+#include <algorithm>
 #include <filesystem>
 #include <string>
+#include <vector>
 
 #include "http_dynamic_module.h"
 #include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
@@ -7,8 +9,13 @@
 #include <dlfcn.h>
 
 #include "source/common/common/assert.h"
+#include "source/common/common/macros.h"
 #include "envoy/common/exception.h"
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/synchronization/mutex.h"
+
 namespace Envoy {
 namespace Extensions {
 namespace DynamicModules {
@@ -28,8 +35,57 @@ HttpDynamicModule::~HttpDynamicModule() {
     }                                                                                              \
   } while (0)
 
+void HttpDynamicModule::resolveEventHooksFromVtable(
+    const envoy_dynamic_module_type_HttpVtable* vtable) {
+  if (vtable == nullptr) {
+    throw EnvoyException(
+        fmt::format("envoy_dynamic_module_get_http_vtable in {} returned nullptr", name_));
+  }
+  if (vtable->version < 1 || vtable->version > ENVOY_DYNAMIC_MODULE_HTTP_VTABLE_VERSION) {
+    throw EnvoyException(fmt::format("unsupported http vtable version in {}: {} (supported: 1-{})",
+                                     name_, vtable->version,
+                                     ENVOY_DYNAMIC_MODULE_HTTP_VTABLE_VERSION));
+  }
+  // No capability is defined in version 1, so a nonzero value means the module was built against a
+  // different header.
+  if (vtable->version == 1 && vtable->capabilities != 0) {
+    throw EnvoyException(fmt::format("http vtable version 1 in {} has nonzero capabilities: {}",
+                                     name_, vtable->capabilities));
+  }
+  if (vtable->on_http_filter_init == nullptr || vtable->on_http_filter_destroy == nullptr ||
+      vtable->on_http_filter_instance_init == nullptr ||
+      vtable->on_http_filter_instance_request_headers == nullptr ||
+      vtable->on_http_filter_instance_request_body == nullptr ||
+      vtable->on_http_filter_instance_response_headers == nullptr ||
+      vtable->on_http_filter_instance_response_body == nullptr ||
+      vtable->on_http_filter_instance_destroy == nullptr) {
+    throw EnvoyException(fmt::format("http vtable in {} has a null event hook", name_));
+  }
+  capabilities_ = vtable->capabilities;
+  envoy_dynamic_module_on_http_filter_init_ = vtable->on_http_filter_init;
+  envoy_dynamic_module_on_http_filter_destroy_ = vtable->on_http_filter_destroy;
+  envoy_dynamic_module_on_http_filter_instance_init_ = vtable->on_http_filter_instance_init;
+  envoy_dynamic_module_on_http_filter_instance_request_headers_ =
+      vtable->on_http_filter_instance_request_headers;
+  envoy_dynamic_module_on_http_filter_instance_request_body_ =
+      vtable->on_http_filter_instance_request_body;
+  envoy_dynamic_module_on_http_filter_instance_response_headers_ =
+      vtable->on_http_filter_instance_response_headers;
+  envoy_dynamic_module_on_http_filter_instance_response_body_ =
+      vtable->on_http_filter_instance_response_body;
+  envoy_dynamic_module_on_http_filter_instance_destroy_ = vtable->on_http_filter_instance_destroy;
+  has_vtable_ = true;
+}
+
 void HttpDynamicModule::initHttpFilter(const std::string_view config) {
-  RESOLVE_SYMBOL_OR_THROW(envoy_dynamic_module_on_http_filter_init);
+  const auto get_http_vtable =
+      dynamic_module_->getFunctionPointer<decltype(&envoy_dynamic_module_get_http_vtable)>(
+          "envoy_dynamic_module_get_http_vtable");
+  if (get_http_vtable != nullptr) {
+    resolveEventHooksFromVtable(get_http_vtable());
+  } else {
+    RESOLVE_SYMBOL_OR_THROW(envoy_dynamic_module_on_http_filter_init);
+  }
   ENVOY_LOG_MISC(info, "[{}] -> envoy_dynamic_module_on_http_filter_init ({}, {})", name_,
                  const_cast<char*>(config.data()), config.size());
   http_filter_ =
@@ -38,6 +94,9 @@ void HttpDynamicModule::initHttpFilter(const std::string_view config) {
     throw EnvoyException(fmt::format("http filter init in {} failed", name_));
   }
   ENVOY_LOG_MISC(info, "[{}] <- envoy_dynamic_module_on_http_filter_init: {}", name_, http_filter_);
+  if (has_vtable_) {
+    return;
+  }
   RESOLVE_SYMBOL_OR_THROW(envoy_dynamic_module_on_http_filter_destroy);
   RESOLVE_SYMBOL_OR_THROW(envoy_dynamic_module_on_http_filter_instance_init);
   RESOLVE_SYMBOL_OR_THROW(envoy_dynamic_module_on_http_filter_instance_request_headers);
@@ -49,6 +108,191 @@ void HttpDynamicModule::initHttpFilter(const std::string_view config) {
 
 #undef RESOLVE_SYMBOL_OR_THROW
 
+bool HttpDynamicModule::onCallbackCompleted(const std::string_view event_hook,
+                                            const std::chrono::steady_clock::duration elapsed) {
+  if (elapsed <= callback_budget_.budget_) {
+    return false;
+  }
+  ENVOY_LOG_MISC(warn, "[{}] {} exceeded the budget: took {}ns, budget {}ns", name_, event_hook,
+                 std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+                 callback_budget_.budget_.count());
+  if (callback_budget_.overrun_policy_ == CallbackBudget::OverrunPolicy::CountOnly) {
+    return true;
+  }
+  const auto degraded_until = std::chrono::steady_clock::now() + callback_budget_.cooldown_;
+  degraded_until_ns_.store(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(degraded_until.time_since_epoch())
+          .count(),
+      std::memory_order_relaxed);
+  return true;
+}
+
+bool HttpDynamicModule::isDegraded() const {
+  const int64_t degraded_until_ns = degraded_until_ns_.load(std::memory_order_relaxed);
+  if (degraded_until_ns == 0) {
+    // Fast path to avoid reading the clock for modules that never exceeded the budget.
+    return false;
+  }
+  const int64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now().time_since_epoch())
+                             .count();
+  return now_ns < degraded_until_ns;
+}
+
+namespace {
+
+/**
+ * Identifies the HttpDynamicModules created for a filter config. Only the hash of the config is in
+ * the key, so that the key doesn't hold a copy of a config that can be large, and the config itself
+ * is only compared on a hash hit.
+ */
+struct HttpDynamicModuleKey {
+  FileIdentity file_identity_;
+  std::string name_;
+  size_t config_hash_;
+  // The mapping is identified by its address instead of copying the contents.
+  const MappedConfigFile* config_file_;
+  int64_t budget_ns_;
+  int overrun_policy_;
+  int64_t cooldown_ns_;
+
+  bool operator==(const HttpDynamicModuleKey& other) const {
+    return file_identity_ == other.file_identity_ && name_ == other.name_ &&
+           config_hash_ == other.config_hash_ && config_file_ == other.config_file_ &&
+           budget_ns_ == other.budget_ns_ && overrun_policy_ == other.overrun_policy_ &&
+           cooldown_ns_ == other.cooldown_ns_;
+  }
+
+  template <typename H> friend H AbslHashValue(H h, const HttpDynamicModuleKey& key) {
+    return H::combine(std::move(h), key.file_identity_, key.name_, key.config_hash_,
+                      key.config_file_, key.budget_ns_, key.overrun_policy_, key.cooldown_ns_);
+  }
+};
+
+/**
+ * Process-wide table of the HttpDynamicModules. This holds weak references so that a module is
+ * destroyed when the last filter chain using it goes away.
+ */
+class HttpDynamicModuleTable {
+public:
+  static HttpDynamicModuleTable& get() { MUTABLE_CONSTRUCT_ON_FIRST_USE(HttpDynamicModuleTable); }
+
+  HttpDynamicModuleSharedPtr find(const HttpDynamicModuleKey& key, const std::string_view config) {
+    absl::MutexLock lock(&mutex_);
+    auto it = modules_.find(key);
+    if (it == modules_.end()) {
+      return nullptr;
+    }
+    for (const Entry& entry : it->second) {
+      if (entry.config_ == config) {
+        return entry.module_.lock();
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * Returns the lock to be held while creating the module for the key, so that concurrent filter
+   * configs, e.g. from the parallel initialization, call envoy_dynamic_module_on_http_filter_init
+   * only once for the same config.
+   */
+  std::shared_ptr<absl::Mutex> createLock(const HttpDynamicModuleKey& key) {
+    absl::MutexLock lock(&mutex_);
+    absl::erase_if(create_locks_, [](const auto& entry) { return entry.second.expired(); });
+    std::shared_ptr<absl::Mutex> create_lock = create_locks_[key].lock();
+    if (create_lock == nullptr) {
+      create_lock = std::make_shared<absl::Mutex>();
+      create_locks_[key] = create_lock;
+    }
+    return create_lock;
+  }
+
+  /**
+   * Inserts the module created under the lock for the key. The expired entries are swept first, so
+   * there is at most one entry for the same config.
+   */
+  void insert(const HttpDynamicModuleKey& key, const std::string_view config,
+              const HttpDynamicModuleSharedPtr& module) {
+    absl::MutexLock lock(&mutex_);
+    for (auto& [_, entries] : modules_) {
+      entries.erase(std::remove_if(entries.begin(), entries.end(),
+                                   [](const Entry& entry) { return entry.module_.expired(); }),
+                    entries.end());
+    }
+    absl::erase_if(modules_, [](const auto& entry) { return entry.second.empty(); });
+    modules_[key].push_back(Entry{std::string(config), module});
+  }
+
+private:
+  struct Entry {
+    // The config as given, since the module might modify the buffer passed to
+    // envoy_dynamic_module_on_http_filter_init.
+    std::string config_;
+    std::weak_ptr<HttpDynamicModule> module_;
+  };
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<HttpDynamicModuleKey, std::vector<Entry>> modules_ ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<HttpDynamicModuleKey, std::weak_ptr<absl::Mutex>>
+      create_locks_ ABSL_GUARDED_BY(mutex_);
+};
+
+/**
+ * Returns the module in the table for the config, or creates one with the function. The module is
+ * not shared if the object file couldn't be identified.
+ */
+template <typename CreateFn>
+HttpDynamicModuleSharedPtr
+getOrCreate(const std::string_view name, const std::string_view config,
+            const MappedConfigFile* config_file,
+            const Extensions::DynamicModules::DynamicModule& dynamic_module,
+            const CallbackBudget& callback_budget, CreateFn create) {
+  if (!dynamic_module.file_identity_.has_value()) {
+    return create();
+  }
+  const HttpDynamicModuleKey key{dynamic_module.file_identity_.value(),
+                                 std::string(name),
+                                 absl::Hash<std::string_view>{}(config),
+                                 config_file,
+                                 callback_budget.budget_.count(),
+                                 static_cast<int>(callback_budget.overrun_policy_),
+                                 callback_budget.cooldown_.count()};
+  HttpDynamicModuleTable& table = HttpDynamicModuleTable::get();
+  // envoy_dynamic_module_on_http_filter_init might take long, so this only blocks the other
+  // threads creating the module for the same key, which then share the one created here.
+  const std::shared_ptr<absl::Mutex> create_lock = table.createLock(key);
+  absl::MutexLock lock(create_lock.get());
+  if (HttpDynamicModuleSharedPtr existing = table.find(key, config); existing != nullptr) {
+    ENVOY_LOG_MISC(debug, "[{}] sharing the http filter for the identical config", name);
+    return existing;
+  }
+  // The module might modify the config passed to envoy_dynamic_module_on_http_filter_init in place.
+  const std::string original_config(config);
+  HttpDynamicModuleSharedPtr module = create();
+  table.insert(key, original_config, module);
+  return module;
+}
+
+} // namespace
+
+HttpDynamicModuleSharedPtr
+getOrCreateHttpDynamicModule(const std::string_view name, const std::string_view config,
+                             Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module,
+                             const CallbackBudget& callback_budget) {
+  return getOrCreate(name, config, nullptr, *dynamic_module, callback_budget, [&]() {
+    return std::make_shared<HttpDynamicModule>(name, config, dynamic_module, callback_budget);
+  });
+}
+
+HttpDynamicModuleSharedPtr
+getOrCreateHttpDynamicModule(const std::string_view name, MappedConfigFileSharedPtr config_file,
+                             Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module,
+                             const CallbackBudget& callback_budget) {
+  return getOrCreate(name, "", config_file.get(), *dynamic_module, callback_budget, [&]() {
+    return std::make_shared<HttpDynamicModule>(name, config_file, dynamic_module, callback_budget);
+  });
+}
+
 } // namespace Http
 } // namespace DynamicModules
 } // namespace Extensions
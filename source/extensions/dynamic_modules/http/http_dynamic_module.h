@@ -1,6 +1,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <cstddef>
 #include <optional>
 #include <string>
@@ -9,6 +11,8 @@
 #include "envoy/server/filter_config.h"
 
 #include "source/extensions/dynamic_modules/http/config.pb.h"
+#include "source/extensions/dynamic_modules/http/mapped_config_file.h"
+#include "source/extensions/dynamic_modules/http/shared_data_store.h"
 #include "source/extensions/dynamic_modules/dynamic_modules.h"
 #include "source/extensions/dynamic_modules/abi/abi.h"
 
@@ -17,6 +21,20 @@ namespace Extensions {
 namespace DynamicModules {
 namespace Http {
 
+/**
+ * The time budget for a single event hook call into the module. This corresponds to the
+ * CallbackBudget message in config.proto.
+ */
+struct CallbackBudget {
+  enum class OverrunPolicy { CountOnly, FailOpen, FailClosed };
+
+  // The maximum elapsed time of a single event hook call. Zero disables the measurement.
+  std::chrono::nanoseconds budget_{0};
+  OverrunPolicy overrun_policy_ = OverrunPolicy::CountOnly;
+  // How long the module stays degraded after the last overrun.
+  std::chrono::nanoseconds cooldown_ = std::chrono::seconds(10);
+};
+
 /**
  * A class to create http filter instances based on a dynamic module. This will be owned by multiple
  * filter instances.
@@ -27,13 +45,32 @@ public:
    * Create a new module.
    * @param name the name of the module for debugging and logging purposes.
    * @param dynamic_module the dynamic module to load.
+   * @param callback_budget the time budget for the event hooks of the module.
    */
   HttpDynamicModule(const std::string_view name, const std::string_view config,
-                    Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module)
-      : name_(name), dynamic_module_(dynamic_module) {
+                    Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module,
+                    const CallbackBudget& callback_budget = {})
+      : name_(name), dynamic_module_(dynamic_module), callback_budget_(callback_budget) {
     initHttpFilter(config);
   };
 
+  /**
+   * Create a new module with the configuration mapped from a file. Unlike the configuration passed
+   * as a string, the contents stay valid and read-only until the module is destroyed, so the module
+   * can refer to them without copying.
+   * @param name the name of the module for debugging and logging purposes.
+   * @param config_file the mapped configuration file for the module.
+   * @param dynamic_module the dynamic module to load.
+   * @param callback_budget the time budget for the event hooks of the module.
+   */
+  HttpDynamicModule(const std::string_view name, MappedConfigFileSharedPtr config_file,
+                    Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module,
+                    const CallbackBudget& callback_budget = {})
+      : name_(name), dynamic_module_(dynamic_module), callback_budget_(callback_budget),
+        config_file_(std::move(config_file)) {
+    initHttpFilter(config_file_->contents());
+  };
+
   ~HttpDynamicModule();
 
   /**
@@ -42,14 +79,41 @@ public:
    */
   void initHttpFilter(const std::string_view config);
 
-  // The event hooks for the module.
+  /**
+   * @return true if the event hooks were resolved from envoy_dynamic_module_get_http_vtable.
+   */
+  bool hasVtable() const { return has_vtable_; }
 
-  decltype(&envoy_dynamic_module_on_program_init) envoy_dynamic_module_on_program_init_ = nullptr;
-  decltype(&envoy_dynamic_module_on_http_filter_init) envoy_dynamic_module_on_http_filter_init_ =
-      nullptr;
-  decltype(&envoy_dynamic_module_on_http_filter_destroy)
-      envoy_dynamic_module_on_http_filter_destroy_ = nullptr;
-  decltype(&envoy_dynamic_module_on_http_filter_instance_init)
+  /**
+   * @return true if the elapsed time of the event hooks should be measured.
+   */
+  bool callbackBudgetEnabled() const { return callback_budget_.budget_.count() > 0; }
+
+  /**
+   * Called by the filter instances after an event hook returns when the budget is enabled. This
+   * marks the module degraded on an overrun depending on the overrun policy. This can be called
+   * from any worker thread.
+   * @param event_hook the name of the event hook for logging.
+   * @param elapsed the elapsed time of the event hook call.
+   * @return true if the call exceeded the budget, which the caller counts in the stats of its
+   * filter config.
+   */
+  bool onCallbackCompleted(const std::string_view event_hook,
+                           const std::chrono::steady_clock::duration elapsed);
+
+  /**
+   * @return true if the module exceeded the budget and the cooldown has not passed yet. This is
+   * always false with OverrunPolicy::CountOnly.
+   */
+  bool isDegraded() const;
+
+  // The event hooks for the module. They are resolved either from the table returned by
+  // envoy_dynamic_module_get_http_vtable or by looking up each symbol.
+  //
+  // The per-stream hooks come first and are aligned to a cache line so that the hot path only
+  // touches a single line.
+
+  alignas(64) decltype(&envoy_dynamic_module_on_http_filter_instance_init)
       envoy_dynamic_module_on_http_filter_instance_init_ = nullptr;
   decltype(&envoy_dynamic_module_on_http_filter_instance_request_headers)
       envoy_dynamic_module_on_http_filter_instance_request_headers_ = nullptr;
@@ -61,6 +125,14 @@ public:
       envoy_dynamic_module_on_http_filter_instance_response_body_ = nullptr;
   decltype(&envoy_dynamic_module_on_http_filter_instance_destroy)
       envoy_dynamic_module_on_http_filter_instance_destroy_ = nullptr;
+  decltype(&envoy_dynamic_module_on_http_filter_init) envoy_dynamic_module_on_http_filter_init_ =
+      nullptr;
+  decltype(&envoy_dynamic_module_on_http_filter_destroy)
+      envoy_dynamic_module_on_http_filter_destroy_ = nullptr;
+
+  // The capabilities declared in the vtable. Always zero when the module doesn't export
+  // envoy_dynamic_module_get_http_vtable.
+  size_t capabilities_ = 0;
 
   // The in-module http filter for the module.
   void* http_filter_ = nullptr;
@@ -70,10 +142,62 @@ public:
 
   // The handle for the module.
   Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module_;
+
+  // The time budget for the event hooks passed in the constructor.
+  const CallbackBudget callback_budget_;
+
+  // The mapped configuration file if the module is configured with it, otherwise nullptr.
+  const MappedConfigFileSharedPtr config_file_;
+
+  // The key/value store shared by the streams of the module on all the workers. The store lives as
+  // long as this object, so it is shared by the filter configs with the identical configuration,
+  // and a module swapped in by the hot reload starts with an empty one.
+  SharedDataStore shared_data_;
+
+private:
+  /**
+   * Resolve the event hooks from the table returned by envoy_dynamic_module_get_http_vtable.
+   * @param vtable the table returned by the module.
+   */
+  void resolveEventHooksFromVtable(const envoy_dynamic_module_type_HttpVtable* vtable);
+
+  bool has_vtable_ = false;
+  // The steady clock time in nanoseconds until which the module is degraded. Zero means that the
+  // module has never exceeded the budget.
+  std::atomic<int64_t> degraded_until_ns_{0};
 };
 
 using HttpDynamicModuleSharedPtr = std::shared_ptr<HttpDynamicModule>;
 
+/**
+ * Returns the HttpDynamicModule for the module and the config. If one was already created for the
+ * same module, name, config and callback budget and is still referenced, it is shared instead of
+ * creating a new one, so that envoy_dynamic_module_on_http_filter_init is called only once for
+ * identical filter configs used across filter chains. This can be called from any thread, and the
+ * concurrent calls for the same config create the module only once.
+ * @param name the name of the module for debugging and logging purposes.
+ * @param config the configuration for the module.
+ * @param dynamic_module the loaded dynamic module.
+ * @param callback_budget the time budget for the event hooks of the module.
+ */
+HttpDynamicModuleSharedPtr
+getOrCreateHttpDynamicModule(const std::string_view name, const std::string_view config,
+                             Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module,
+                             const CallbackBudget& callback_budget = {});
+
+/**
+ * Same as above, but for the configuration mapped from a file. Modules using the same mapping are
+ * shared.
+ * @param name the name of the module for debugging and logging purposes.
+ * @param config_file the mapped configuration file for the module.
+ * @param dynamic_module the loaded dynamic module.
+ * @param callback_budget the time budget for the event hooks of the module.
+ */
+HttpDynamicModuleSharedPtr
+getOrCreateHttpDynamicModule(const std::string_view name, MappedConfigFileSharedPtr config_file,
+                             Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module,
+                             const CallbackBudget& callback_budget = {});
+
 } // namespace Http
 } // namespace DynamicModules
 } // namespace Extensions
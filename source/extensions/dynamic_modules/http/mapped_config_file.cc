@@ -0,0 +1,100 @@
+#include "source/extensions/dynamic_modules/http/mapped_config_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <string>
+
+#include "source/common/common/macros.h"
+#include "source/extensions/dynamic_modules/file_identity.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+namespace {
+
+/**
+ * Process-wide table of the mapped files. This holds weak references so that a file is unmapped
+ * when the last module using it goes away.
+ */
+class MappedConfigFileTable {
+public:
+  static MappedConfigFileTable& get() { MUTABLE_CONSTRUCT_ON_FIRST_USE(MappedConfigFileTable); }
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<FileIdentity, std::weak_ptr<const MappedConfigFile>>
+      files_ ABSL_GUARDED_BY(mutex_);
+};
+
+} // namespace
+
+MappedConfigFile::~MappedConfigFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+absl::StatusOr<MappedConfigFileSharedPtr> MappedConfigFile::open(std::string_view path) {
+  std::error_code ec;
+  const std::filesystem::path canonical = std::filesystem::canonical(path, ec);
+  if (ec) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Failed to resolve filter config file: ", path, " : ", ec.message()));
+  }
+  const int fd = ::open(canonical.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Failed to open filter config file: ", path, " : ", strerror(errno)));
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    const int error = errno;
+    ::close(fd);
+    return absl::InvalidArgumentError(
+        absl::StrCat("Failed to stat filter config file: ", path, " : ", strerror(error)));
+  }
+  const FileIdentity id = FileIdentity::fromStat(canonical.string(), st);
+
+  MappedConfigFileTable& table = MappedConfigFileTable::get();
+  absl::MutexLock lock(&table.mutex_);
+  if (auto it = table.files_.find(id); it != table.files_.end()) {
+    if (MappedConfigFileSharedPtr existing = it->second.lock(); existing != nullptr) {
+      ::close(fd);
+      return existing;
+    }
+  }
+
+  void* data = nullptr;
+  if (st.st_size > 0) {
+    data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      const int error = errno;
+      ::close(fd);
+      return absl::InvalidArgumentError(
+          absl::StrCat("Failed to mmap filter config file: ", path, " : ", strerror(error)));
+    }
+  }
+  // The mapping stays valid after closing the file descriptor.
+  ::close(fd);
+
+  auto mapped = std::make_shared<const MappedConfigFile>(data, st.st_size);
+  absl::erase_if(table.files_, [](const auto& entry) { return entry.second.expired(); });
+  table.files_[id] = mapped;
+  return mapped;
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
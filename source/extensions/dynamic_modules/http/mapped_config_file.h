@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "absl/status/statusor.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class MappedConfigFile;
+using MappedConfigFileSharedPtr = std::shared_ptr<const MappedConfigFile>;
+
+/**
+ * A config file mapped read-only into memory, so that a large config can be passed to the module
+ * without copying it. The mapping is valid until the object is destroyed.
+ */
+class MappedConfigFile {
+public:
+  MappedConfigFile(void* data, size_t size) : data_(data), size_(size) {}
+  ~MappedConfigFile();
+
+  /**
+   * Maps the file, or returns the existing mapping if the same file is still mapped in the process
+   * and has not changed since then. The file is identified by its canonical path, inode, size and
+   * modification time. This can be called from any thread.
+   * @param path the path to the file.
+   */
+  static absl::StatusOr<MappedConfigFileSharedPtr> open(std::string_view path);
+
+  /**
+   * @return the contents of the file.
+   */
+  std::string_view contents() const {
+    return std::string_view(static_cast<const char*>(data_), size_);
+  }
+
+private:
+  // nullptr for an empty file, which cannot be mapped.
+  void* const data_;
+  const size_t size_;
+};
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
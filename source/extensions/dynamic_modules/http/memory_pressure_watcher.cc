@@ -0,0 +1,88 @@
+#include "source/extensions/dynamic_modules/http/memory_pressure_watcher.h"
+
+#include "envoy/server/overload/thread_local_overload_state.h"
+
+#include "source/common/common/logger.h"
+#include "source/common/common/macros.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+namespace {
+
+/**
+ * Process-wide table of the watchers by module. This is only accessed on the main thread. The
+ * watcher holds the module, so the address is not reused by another module while it is alive.
+ */
+class MemoryPressureWatcherTable {
+public:
+  static MemoryPressureWatcherTable& get() {
+    MUTABLE_CONSTRUCT_ON_FIRST_USE(MemoryPressureWatcherTable);
+  }
+
+  absl::flat_hash_map<const Extensions::DynamicModules::DynamicModule*,
+                      std::weak_ptr<MemoryPressureWatcher>>
+      watchers_;
+};
+
+} // namespace
+
+MemoryPressureWatcher::MemoryPressureWatcher(Event::Dispatcher& main_thread_dispatcher,
+                                             Server::OverloadManager& overload_manager,
+                                             std::string overload_action,
+                                             std::chrono::milliseconds poll_interval,
+                                             OnMemoryPressure on_memory_pressure)
+    : overload_manager_(overload_manager), overload_action_(std::move(overload_action)),
+      poll_interval_(poll_interval), on_memory_pressure_(on_memory_pressure) {
+  timer_ = main_thread_dispatcher.createTimer([this]() {
+    poll();
+    timer_->enableTimer(poll_interval_);
+  });
+  timer_->enableTimer(poll_interval_);
+}
+
+MemoryPressureWatcherSharedPtr MemoryPressureWatcher::getOrCreate(
+    const Extensions::DynamicModules::DynamicModuleSharedPtr& dynamic_module,
+    Event::Dispatcher& main_thread_dispatcher, Server::OverloadManager& overload_manager,
+    const std::string& overload_action, std::chrono::milliseconds poll_interval) {
+  const auto on_memory_pressure = dynamic_module->getFunctionPointer<OnMemoryPressure>(
+      "envoy_dynamic_module_on_memory_pressure");
+  if (on_memory_pressure == nullptr) {
+    return nullptr;
+  }
+  auto& watchers = MemoryPressureWatcherTable::get().watchers_;
+  if (auto it = watchers.find(dynamic_module.get()); it != watchers.end()) {
+    if (MemoryPressureWatcherSharedPtr existing = it->second.lock(); existing != nullptr) {
+      return existing;
+    }
+  }
+  auto watcher = std::make_shared<MemoryPressureWatcher>(
+      main_thread_dispatcher, overload_manager, overload_action, poll_interval, on_memory_pressure);
+  watcher->dynamic_module_ = dynamic_module;
+  absl::erase_if(watchers, [](const auto& entry) { return entry.second.expired(); });
+  watchers[dynamic_module.get()] = watcher;
+  return watcher;
+}
+
+void MemoryPressureWatcher::poll() {
+  const double pressure = overload_manager_.getThreadLocalOverloadState()
+                              .getState(overload_action_)
+                              .value()
+                              .value();
+  if (pressure == pressure_) {
+    return;
+  }
+  ENVOY_LOG_MISC(debug, "{} changed from {} to {}, notifying the module", overload_action_,
+                 pressure_, pressure);
+  pressure_ = pressure;
+  on_memory_pressure_(pressure);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
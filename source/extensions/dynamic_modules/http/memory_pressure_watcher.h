@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/event/timer.h"
+#include "envoy/server/overload/overload_manager.h"
+
+#include "source/extensions/dynamic_modules/abi/abi.h"
+#include "source/extensions/dynamic_modules/dynamic_modules.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class MemoryPressureWatcher;
+using MemoryPressureWatcherSharedPtr = std::shared_ptr<MemoryPressureWatcher>;
+
+/**
+ * Forwards the state of an overload action, e.g. envoy.overload_actions.shrink_heap, to
+ * envoy_dynamic_module_on_memory_pressure of a module, so that a module with its own garbage
+ * collected heap can shrink it while Envoy is under memory pressure. The action is polled on the
+ * main thread, and the module is only notified when the state changes.
+ *
+ * This must be created and destroyed on the main thread.
+ */
+class MemoryPressureWatcher {
+public:
+  using OnMemoryPressure = decltype(&envoy_dynamic_module_on_memory_pressure);
+
+  /**
+   * @param main_thread_dispatcher the dispatcher to poll the action on.
+   * @param overload_manager the overload manager of the server.
+   * @param overload_action the name of the overload action to forward.
+   * @param poll_interval how often the action is polled.
+   * @param on_memory_pressure the event hook of the module.
+   */
+  MemoryPressureWatcher(Event::Dispatcher& main_thread_dispatcher,
+                        Server::OverloadManager& overload_manager, std::string overload_action,
+                        std::chrono::milliseconds poll_interval,
+                        OnMemoryPressure on_memory_pressure);
+
+  /**
+   * Returns the watcher for the module, or creates one if the module has none. A module used by
+   * multiple filter configs is watched once with the options of the first one, so that it is not
+   * notified of the same change more than once.
+   * @param dynamic_module the loaded dynamic module.
+   * @param main_thread_dispatcher the dispatcher to poll the action on.
+   * @param overload_manager the overload manager of the server.
+   * @param overload_action the name of the overload action to forward.
+   * @param poll_interval how often the action is polled.
+   * @return the watcher, or nullptr if the module doesn't export
+   * envoy_dynamic_module_on_memory_pressure.
+   */
+  static MemoryPressureWatcherSharedPtr
+  getOrCreate(const Extensions::DynamicModules::DynamicModuleSharedPtr& dynamic_module,
+              Event::Dispatcher& main_thread_dispatcher, Server::OverloadManager& overload_manager,
+              const std::string& overload_action, std::chrono::milliseconds poll_interval);
+
+  /**
+   * Reads the state of the action and notifies the module if it changed. This is called by the
+   * timer, and made public for testing purposes.
+   */
+  void poll();
+
+  /**
+   * @return the pressure last passed to the module.
+   */
+  double pressure() const { return pressure_; }
+
+  /**
+   * The default action to forward, which Envoy itself releases the free memory of the heap on.
+   */
+  static constexpr char DefaultOverloadAction[] = "envoy.overload_actions.shrink_heap";
+
+private:
+  // Keeps the module loaded while it is notified. Not set when created directly, e.g. in tests.
+  Extensions::DynamicModules::DynamicModuleSharedPtr dynamic_module_;
+  Server::OverloadManager& overload_manager_;
+  const std::string overload_action_;
+  const std::chrono::milliseconds poll_interval_;
+  const OnMemoryPressure on_memory_pressure_;
+  double pressure_ = 0;
+  Event::TimerPtr timer_;
+};
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
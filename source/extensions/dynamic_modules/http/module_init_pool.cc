@@ -0,0 +1,33 @@
+#include "source/extensions/dynamic_modules/http/module_init_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+#include "source/common/common/assert.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+ModuleInitPool::ModuleInitPool(Thread::ThreadFactory& thread_factory, uint32_t concurrency)
+    : pool_(thread_factory, concurrency, std::numeric_limits<uint32_t>::max(), "dm_init") {}
+
+void ModuleInitPool::post(std::function<void()> work) {
+  // The queue is unbounded in practice, as there is at most one work per filter config.
+  const bool posted = pool_.tryPost(std::move(work), []() {});
+  ASSERT(posted);
+}
+
+uint32_t ModuleInitPool::defaultConcurrency() {
+  // Loading is mostly bound by the module's own initialization, e.g. starting the Go runtime, so
+  // there is no point in having more threads than the cores. It is also capped as the number of
+  // distinct modules is usually small.
+  return std::clamp(std::thread::hardware_concurrency(), 1u, 8u);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+
+#include "envoy/singleton/instance.h"
+#include "envoy/thread/thread.h"
+
+#include "source/extensions/dynamic_modules/http/offload_pool.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+/**
+ * A bounded pool of threads to load and initialize modules concurrently during config load, so
+ * that the listener startup is bounded by the slowest module rather than the sum of all of them.
+ * This is shared by all the filter configs through the singleton manager. The threads are run by
+ * an OffloadPool whose queue is never full.
+ */
+class ModuleInitPool : public Singleton::Instance {
+public:
+  /**
+   * @param thread_factory the factory to create the threads.
+   * @param concurrency the number of threads.
+   */
+  ModuleInitPool(Thread::ThreadFactory& thread_factory, uint32_t concurrency);
+
+  /**
+   * Run the work on one of the threads. This can be called from any thread. The work not started
+   * yet is dropped when the pool is destroyed, which waits for the running one to finish.
+   * @param work the work to run.
+   */
+  void post(std::function<void()> work);
+
+  /**
+   * @return the default number of threads based on the number of the cores.
+   */
+  static uint32_t defaultConcurrency();
+
+private:
+  OffloadPool pool_;
+};
+
+using ModuleInitPoolSharedPtr = std::shared_ptr<ModuleInitPool>;
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
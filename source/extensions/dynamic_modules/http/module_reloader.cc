@@ -0,0 +1,76 @@
+#include "source/extensions/dynamic_modules/http/module_reloader.h"
+
+#include <exception>
+
+#include "envoy/common/exception.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+HttpDynamicModuleReloader::HttpDynamicModuleReloader(HttpDynamicModuleSharedPtr initial,
+                                                     const std::string& file_path,
+                                                     bool do_not_close,
+                                                     const LoadMode& load_mode,
+                                                     HttpDynamicModuleBuilder builder,
+                                                     ThreadLocal::SlotAllocator& tls,
+                                                     Event::Dispatcher& main_thread_dispatcher,
+                                                     HttpDynamicModuleReloadedCb on_reloaded)
+    : file_path_(file_path), do_not_close_(do_not_close), load_mode_(load_mode),
+      builder_(std::move(builder)), on_reloaded_(std::move(on_reloaded)),
+      main_thread_module_(initial),
+      slot_(ThreadLocal::TypedSlot<ThreadLocalModule>::makeUnique(tls)),
+      watcher_(main_thread_dispatcher.createFilesystemWatcher()) {
+  slot_->set(
+      [initial](Event::Dispatcher&) { return std::make_shared<ThreadLocalModule>(initial); });
+
+  // Only renames into the path are watched, e.g. `mv -T` of a new symlink. Writing to the object
+  // file in place would be observed half-written, and it also breaks the already loaded object.
+  THROW_IF_NOT_OK(watcher_->addWatch(file_path_, Filesystem::Watcher::Events::MovedTo,
+                                     [this](uint32_t) {
+                                       reload();
+                                       return absl::OkStatus();
+                                     }));
+}
+
+void HttpDynamicModuleReloader::reload() {
+  const auto dynamic_module =
+      Extensions::DynamicModules::newDynamicModule(file_path_, do_not_close_, load_mode_);
+  if (!dynamic_module.ok()) {
+    ENVOY_LOG_MISC(warn, "[{}] failed to reload dynamic module: {}", main_thread_module_->name_,
+                   dynamic_module.status().message());
+    return;
+  }
+  if (dynamic_module.value() == main_thread_module_->dynamic_module_) {
+    // The object file is the same as the current one.
+    return;
+  }
+
+  HttpDynamicModuleSharedPtr next;
+  try {
+    next = builder_(dynamic_module.value());
+  } catch (const std::exception& e) {
+    // Not only EnvoyException, as this runs on the main thread from the file watcher.
+    ENVOY_LOG_MISC(warn, "[{}] failed to initialize the reloaded dynamic module: {}",
+                   main_thread_module_->name_, e.what());
+    return;
+  }
+
+  ENVOY_LOG_MISC(info, "[{}] reloaded dynamic module from {}", next->name_, file_path_);
+  main_thread_module_ = next;
+  generation_++;
+  slot_->runOnAllThreads([next](OptRef<ThreadLocalModule> tls_module) {
+    if (tls_module.has_value()) {
+      tls_module->module_ = next;
+    }
+  });
+  if (on_reloaded_) {
+    on_reloaded_(next);
+  }
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
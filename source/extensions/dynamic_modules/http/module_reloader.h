@@ -0,0 +1,102 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/filesystem/watcher.h"
+#include "envoy/thread_local/thread_local.h"
+
+#include "source/extensions/dynamic_modules/dynamic_modules.h"
+#include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+/**
+ * Creates a HttpDynamicModule from the newly loaded object file. This may throw an exception.
+ */
+using HttpDynamicModuleBuilder =
+    std::function<HttpDynamicModuleSharedPtr(Extensions::DynamicModules::DynamicModuleSharedPtr)>;
+
+/**
+ * Called on the main thread with the module swapped in by a reload.
+ */
+using HttpDynamicModuleReloadedCb = std::function<void(const HttpDynamicModuleSharedPtr&)>;
+
+/**
+ * Swaps the module used by new streams when the object file changes, without reloading the
+ * filter chain. Each worker holds the latest module in a thread local slot, so picking it up for a
+ * new stream doesn't take any lock. The in-flight streams keep the shared reference to the module
+ * they started with, and the old object file is unloaded once all of them finish.
+ *
+ * Since the dynamic loader reuses an already loaded object of the same name, a new version must be
+ * deployed as a new file, e.g. by re-pointing a symlink configured as the file_path.
+ *
+ * This must be created and destroyed on the main thread.
+ */
+class HttpDynamicModuleReloader {
+public:
+  /**
+   * @param initial the module loaded on the config load.
+   * @param file_path the path to the object file in the config.
+   * @param do_not_close whether the newly loaded object files must not be closed.
+   * @param load_mode how the newly loaded object files are loaded.
+   * @param builder creates a HttpDynamicModule for the newly loaded object file.
+   * @param tls the thread local slot allocator.
+   * @param main_thread_dispatcher the dispatcher to watch the object file on.
+   * @param on_reloaded called after each swap, e.g. to move the per-module state of the filter
+   * config to the new module. Optional.
+   */
+  HttpDynamicModuleReloader(HttpDynamicModuleSharedPtr initial, const std::string& file_path,
+                            bool do_not_close,
+                            const Extensions::DynamicModules::LoadMode& load_mode,
+                            HttpDynamicModuleBuilder builder,
+                            ThreadLocal::SlotAllocator& tls,
+                            Event::Dispatcher& main_thread_dispatcher,
+                            HttpDynamicModuleReloadedCb on_reloaded = nullptr);
+
+  /**
+   * @return the module to be used by a new stream on the current worker thread.
+   */
+  HttpDynamicModuleSharedPtr current() const { return (*slot_)->module_; }
+
+  /**
+   * Loads the object file at the configured path, and routes new streams to it if it is different
+   * from the current one. Failures are logged and the current module is kept. This is called by
+   * the file watcher, and made public for testing purposes.
+   */
+  void reload();
+
+  /**
+   * @return the number of times the module was swapped.
+   */
+  uint64_t generation() const { return generation_; }
+
+private:
+  struct ThreadLocalModule : public ThreadLocal::ThreadLocalObject {
+    ThreadLocalModule(HttpDynamicModuleSharedPtr module) : module_(std::move(module)) {}
+    HttpDynamicModuleSharedPtr module_;
+  };
+
+  const std::string file_path_;
+  const bool do_not_close_;
+  const Extensions::DynamicModules::LoadMode load_mode_;
+  const HttpDynamicModuleBuilder builder_;
+  const HttpDynamicModuleReloadedCb on_reloaded_;
+  // The latest module only accessed on the main thread.
+  HttpDynamicModuleSharedPtr main_thread_module_;
+  uint64_t generation_ = 0;
+  ThreadLocal::TypedSlotPtr<ThreadLocalModule> slot_;
+  Filesystem::WatcherPtr watcher_;
+};
+
+using HttpDynamicModuleReloaderSharedPtr = std::shared_ptr<HttpDynamicModuleReloader>;
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,123 @@
+#include "source/extensions/dynamic_modules/http/offload_pool.h"
+
+#include <algorithm>
+#include <tuple>
+
+#include "source/common/common/macros.h"
+
+#include "absl/container/flat_hash_map.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+namespace {
+
+/**
+ * Process-wide table of the pools by module and options. This is only accessed on the main thread.
+ */
+class OffloadPoolTable {
+public:
+  static OffloadPoolTable& get() { MUTABLE_CONSTRUCT_ON_FIRST_USE(OffloadPoolTable); }
+
+  // The object file of the module, the number of threads and the maximum queue depth.
+  using Key = std::tuple<Extensions::DynamicModules::FileIdentity, uint32_t, uint32_t>;
+
+  absl::flat_hash_map<Key, std::weak_ptr<OffloadPool>> pools_;
+};
+
+} // namespace
+
+OffloadPool::OffloadPool(Thread::ThreadFactory& thread_factory, uint32_t concurrency,
+                         uint32_t max_queue_depth, const std::string& thread_name)
+    : max_queue_depth_(max_queue_depth) {
+  Thread::Options options;
+  options.name_ = thread_name;
+  for (uint32_t i = 0; i < std::max(concurrency, 1u); i++) {
+    threads_.push_back(thread_factory.createThread([this]() { workerLoop(); }, options));
+  }
+}
+
+OffloadPoolSharedPtr OffloadPool::create(Thread::ThreadFactory& thread_factory,
+                                         Event::Dispatcher& main_thread_dispatcher,
+                                         uint32_t concurrency, uint32_t max_queue_depth) {
+  return OffloadPoolSharedPtr(
+      new OffloadPool(thread_factory, concurrency, max_queue_depth),
+      [&main_thread_dispatcher](OffloadPool* pool) {
+        if (main_thread_dispatcher.isThreadSafe()) {
+          delete pool;
+          return;
+        }
+        main_thread_dispatcher.post([pool]() { delete pool; });
+      });
+}
+
+OffloadPoolSharedPtr
+OffloadPool::getOrCreate(const Extensions::DynamicModules::DynamicModuleSharedPtr& dynamic_module,
+                         Thread::ThreadFactory& thread_factory,
+                         Event::Dispatcher& main_thread_dispatcher, uint32_t concurrency,
+                         uint32_t max_queue_depth) {
+  if (!dynamic_module->file_identity_.has_value()) {
+    return create(thread_factory, main_thread_dispatcher, concurrency, max_queue_depth);
+  }
+  auto& pools = OffloadPoolTable::get().pools_;
+  const OffloadPoolTable::Key key{dynamic_module->file_identity_.value(), concurrency,
+                                  max_queue_depth};
+  if (auto it = pools.find(key); it != pools.end()) {
+    if (OffloadPoolSharedPtr existing = it->second.lock(); existing != nullptr) {
+      return existing;
+    }
+  }
+  OffloadPoolSharedPtr pool =
+      create(thread_factory, main_thread_dispatcher, concurrency, max_queue_depth);
+  absl::erase_if(pools, [](const auto& entry) { return entry.second.expired(); });
+  pools[key] = pool;
+  return pool;
+}
+
+OffloadPool::~OffloadPool() {
+  std::deque<Item> cancelled;
+  {
+    absl::MutexLock lock(&mutex_);
+    shutdown_ = true;
+    cancelled.swap(queue_);
+  }
+  // The accepted work is completed without running it, so that the modules can release it.
+  for (auto& item : cancelled) {
+    item.cancel_();
+  }
+  for (auto& thread : threads_) {
+    thread->join();
+  }
+}
+
+bool OffloadPool::tryPost(std::function<void()> work, std::function<void()> cancel) {
+  absl::MutexLock lock(&mutex_);
+  if (shutdown_ || queue_.size() >= max_queue_depth_) {
+    return false;
+  }
+  queue_.push_back(Item{std::move(work), std::move(cancel)});
+  return true;
+}
+
+void OffloadPool::workerLoop() {
+  while (true) {
+    std::function<void()> work;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &OffloadPool::hasWorkOrShutdown));
+      if (shutdown_) {
+        return;
+      }
+      work = std::move(queue_.front().work_);
+      queue_.pop_front();
+    }
+    work();
+  }
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "envoy/event/dispatcher.h"
+#include "envoy/thread/thread.h"
+
+#include "source/extensions/dynamic_modules/dynamic_modules.h"
+
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class OffloadPool;
+using OffloadPoolSharedPtr = std::shared_ptr<OffloadPool>;
+
+/**
+ * A bounded pool of threads for the modules to offload CPU heavy work off the Envoy workers, so
+ * that a single expensive request doesn't delay every other connection on the same worker. The
+ * filter configs of the same module with the same pool options share a single pool.
+ */
+class OffloadPool {
+public:
+  /**
+   * Creates a pool which is always destroyed on the main thread. The filters hold the pool along
+   * with the filter config, so the last reference might be released on a worker thread, which must
+   * not be blocked by joining the threads of the pool.
+   * @param thread_factory the factory to create the threads.
+   * @param main_thread_dispatcher the dispatcher of the main thread.
+   * @param concurrency the number of threads.
+   * @param max_queue_depth the maximum number of works waiting for a thread.
+   */
+  static OffloadPoolSharedPtr create(Thread::ThreadFactory& thread_factory,
+                                     Event::Dispatcher& main_thread_dispatcher,
+                                     uint32_t concurrency, uint32_t max_queue_depth);
+
+  /**
+   * Returns the pool of the module with the same options, or creates one if there is none, so that
+   * the filter configs of a module don't spawn the threads each. The pool is keyed by the identity
+   * of the object file and doesn't hold the module, so that a hot reloaded module is still unloaded
+   * once its streams finish. This must be called on the main thread.
+   * @param dynamic_module the loaded dynamic module. The pool is not shared if the object file
+   * couldn't be identified.
+   * @param thread_factory the factory to create the threads.
+   * @param main_thread_dispatcher the dispatcher of the main thread.
+   * @param concurrency the number of threads.
+   * @param max_queue_depth the maximum number of works waiting for a thread.
+   */
+  static OffloadPoolSharedPtr
+  getOrCreate(const Extensions::DynamicModules::DynamicModuleSharedPtr& dynamic_module,
+              Thread::ThreadFactory& thread_factory, Event::Dispatcher& main_thread_dispatcher,
+              uint32_t concurrency, uint32_t max_queue_depth);
+
+  /**
+   * @param thread_factory the factory to create the threads.
+   * @param concurrency the number of threads.
+   * @param max_queue_depth the maximum number of works waiting for a thread.
+   * @param thread_name the name of the threads.
+   */
+  OffloadPool(Thread::ThreadFactory& thread_factory, uint32_t concurrency,
+              uint32_t max_queue_depth, const std::string& thread_name = "dm_offload");
+
+  /**
+   * Cancels the work not started yet, and waits for the running one to finish.
+   */
+  ~OffloadPool();
+
+  /**
+   * Run the work on one of the threads unless the queue is full. This can be called from any
+   * thread.
+   * @param work the work to run.
+   * @param cancel called instead of the work if the pool is destroyed before the work starts, on
+   * the thread destroying the pool.
+   * @return false if the queue is full, in which case neither is called.
+   */
+  bool tryPost(std::function<void()> work, std::function<void()> cancel);
+
+  static constexpr uint32_t DefaultMaxQueueDepth = 1024;
+
+private:
+  void workerLoop();
+  bool hasWorkOrShutdown() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return shutdown_ || !queue_.empty();
+  }
+
+  struct Item {
+    std::function<void()> work_;
+    std::function<void()> cancel_;
+  };
+
+  const uint32_t max_queue_depth_;
+  absl::Mutex mutex_;
+  std::deque<Item> queue_ ABSL_GUARDED_BY(mutex_);
+  bool shutdown_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<Thread::ThreadPtr> threads_;
+};
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
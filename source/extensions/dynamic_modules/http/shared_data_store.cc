@@ -0,0 +1,153 @@
+#include "source/extensions/dynamic_modules/http/shared_data_store.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <thread>
+
+#include "absl/hash/hash.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+namespace {
+
+constexpr std::chrono::seconds SweepInterval{1};
+
+// The counters are stored in the host byte order, as the module runs in the same process.
+int64_t decodeCounter(const std::string& value) {
+  int64_t counter;
+  std::memcpy(&counter, value.data(), sizeof(counter));
+  return counter;
+}
+
+void encodeCounter(int64_t counter, std::string& value) {
+  value.assign(reinterpret_cast<const char*>(&counter), sizeof(counter));
+}
+
+} // namespace
+
+SharedDataStore::SharedDataStore(uint32_t shards)
+    : shard_mask_(std::bit_ceil(std::max(shards, 1u)) - 1) {
+  for (uint64_t i = 0; i <= shard_mask_; i++) {
+    shards_.push_back(std::make_unique<Shard>());
+  }
+}
+
+uint32_t SharedDataStore::defaultShards() {
+  // A few shards per core keeps the chance of two workers hitting the same shard low.
+  return std::clamp(std::thread::hardware_concurrency() * 4, 16u, 1024u);
+}
+
+SharedDataStore::Shard& SharedDataStore::shardFor(std::string_view key) {
+  return *shards_[absl::HashOf(key) & shard_mask_];
+}
+
+SharedDataStore::Entry* SharedDataStore::findLive(Shard& shard, std::string_view key,
+                                                  MonotonicTime now) {
+  auto it = shard.entries_.find(key);
+  if (it == shard.entries_.end()) {
+    return nullptr;
+  }
+  if (it->second.expired(now)) {
+    shard.entries_.erase(it);
+    return nullptr;
+  }
+  return &it->second;
+}
+
+void SharedDataStore::maybeSweep(Shard& shard, MonotonicTime now) {
+  if (now < shard.next_sweep_) {
+    return;
+  }
+  shard.next_sweep_ = now + SweepInterval;
+  absl::erase_if(shard.entries_, [now](const auto& entry) { return entry.second.expired(now); });
+}
+
+std::optional<SharedDataStore::GetResult> SharedDataStore::get(std::string_view key,
+                                                               MonotonicTime now) {
+  Shard& shard = shardFor(key);
+  absl::MutexLock lock(&shard.mutex_);
+  const Entry* entry = findLive(shard, key, now);
+  if (entry == nullptr) {
+    return std::nullopt;
+  }
+  return GetResult{entry->value_, entry->version_};
+}
+
+uint64_t SharedDataStore::set(std::string_view key, std::string_view value,
+                              uint64_t expected_version, std::chrono::milliseconds ttl,
+                              MonotonicTime now) {
+  // Copy the value before taking the lock.
+  auto new_value = std::make_shared<std::string>(value);
+  std::optional<MonotonicTime> expires_at;
+  if (ttl.count() > 0) {
+    expires_at = now + ttl;
+  }
+
+  Shard& shard = shardFor(key);
+  absl::MutexLock lock(&shard.mutex_);
+  maybeSweep(shard, now);
+  Entry* entry = findLive(shard, key, now);
+  const uint64_t current_version = entry != nullptr ? entry->version_ : 0;
+  if (expected_version != AnyVersion && expected_version != current_version) {
+    return 0;
+  }
+  const uint64_t version = shard.next_version_++;
+  if (entry != nullptr) {
+    *entry = Entry{std::move(new_value), version, expires_at};
+  } else {
+    shard.entries_.emplace(key, Entry{std::move(new_value), version, expires_at});
+  }
+  return version;
+}
+
+std::optional<int64_t> SharedDataStore::increment(std::string_view key, int64_t delta,
+                                                  std::chrono::milliseconds ttl,
+                                                  MonotonicTime now) {
+  Shard& shard = shardFor(key);
+  absl::MutexLock lock(&shard.mutex_);
+  maybeSweep(shard, now);
+  Entry* entry = findLive(shard, key, now);
+  if (entry == nullptr) {
+    std::optional<MonotonicTime> expires_at;
+    if (ttl.count() > 0) {
+      expires_at = now + ttl;
+    }
+    auto value = std::make_shared<std::string>();
+    encodeCounter(delta, *value);
+    shard.entries_.emplace(key, Entry{std::move(value), shard.next_version_++, expires_at});
+    return delta;
+  }
+  if (entry->value_->size() != sizeof(int64_t)) {
+    return std::nullopt;
+  }
+  int64_t counter;
+  if (__builtin_add_overflow(decodeCounter(*entry->value_), delta, &counter)) {
+    return std::nullopt;
+  }
+  // A reader can only take a new reference under the lock, so the value is updated in place unless
+  // a reader still holds the previous one, which must stay unchanged.
+  if (entry->value_.use_count() != 1) {
+    entry->value_ = std::make_shared<std::string>();
+  }
+  encodeCounter(counter, *entry->value_);
+  entry->version_ = shard.next_version_++;
+  return counter;
+}
+
+size_t SharedDataStore::size() {
+  size_t size = 0;
+  for (auto& shard : shards_) {
+    absl::MutexLock lock(&shard->mutex_);
+    size += shard->entries_.size();
+  }
+  return size;
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
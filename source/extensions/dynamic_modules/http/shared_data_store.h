@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "envoy/common/time.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+/**
+ * A key/value store shared by all the workers for the module to keep e.g. rate limit counters and
+ * caches, without a process-wide lock of its own. The keys are spread over shards each with its
+ * own lock, so the contention on unrelated keys scales with the number of shards rather than
+ * serializing all the workers.
+ *
+ * Values are immutable once written, and a read returns a shared reference to the value, so it
+ * stays valid however long the reader holds it, even if the key is overwritten or expires.
+ *
+ * Every method takes the current monotonic time to expire the entries, so that the store doesn't
+ * depend on a particular time source.
+ */
+class SharedDataStore {
+public:
+  using Value = std::shared_ptr<const std::string>;
+
+  // Passed as the expected version to set() to overwrite the value regardless of its version.
+  static constexpr uint64_t AnyVersion = UINT64_MAX;
+
+  /**
+   * @param shards the number of shards. This is rounded up to a power of two.
+   */
+  explicit SharedDataStore(uint32_t shards = defaultShards());
+
+  struct GetResult {
+    Value value_;
+    uint64_t version_;
+  };
+
+  /**
+   * @param key the key.
+   * @param now the current time.
+   * @return the value and its version, or nullopt if the key doesn't exist or has expired.
+   */
+  std::optional<GetResult> get(std::string_view key, MonotonicTime now);
+
+  /**
+   * Sets the value if the current version of the key matches the expected one.
+   * @param key the key.
+   * @param value the new value.
+   * @param expected_version the version returned by get(), 0 if the key must not exist, or
+   * AnyVersion to set the value unconditionally.
+   * @param ttl the time until the entry expires, or zero to never expire.
+   * @param now the current time.
+   * @return the new version, or 0 if the version didn't match.
+   */
+  uint64_t set(std::string_view key, std::string_view value, uint64_t expected_version,
+               std::chrono::milliseconds ttl, MonotonicTime now);
+
+  /**
+   * Adds delta to the counter stored as an 8 byte integer in the host byte order, creating it with
+   * zero if the key doesn't exist or has expired. The ttl only applies when the counter is created,
+   * so the counter resets at a fixed interval, e.g. for a fixed window rate limit.
+   * @param key the key.
+   * @param delta the value to add.
+   * @param ttl the time until the newly created counter expires, or zero to never expire.
+   * @param now the current time.
+   * @return the new value, or nullopt if the existing value is not a counter or the sum overflows,
+   * in which case the counter is left unchanged.
+   */
+  std::optional<int64_t> increment(std::string_view key, int64_t delta,
+                                   std::chrono::milliseconds ttl, MonotonicTime now);
+
+  /**
+   * @return the number of the entries including the expired ones not swept yet.
+   */
+  size_t size();
+
+  static uint32_t defaultShards();
+
+private:
+  struct Entry {
+    // Only mutated in place while no reader holds a reference to it.
+    std::shared_ptr<std::string> value_;
+    uint64_t version_;
+    std::optional<MonotonicTime> expires_at_;
+
+    bool expired(MonotonicTime now) const { return expires_at_.has_value() && *expires_at_ <= now; }
+  };
+
+  struct Shard {
+    absl::Mutex mutex_;
+    absl::flat_hash_map<std::string, Entry> entries_ ABSL_GUARDED_BY(mutex_);
+    // Unique in the shard across all the keys, so a version is never reused after a key expires.
+    uint64_t next_version_ ABSL_GUARDED_BY(mutex_) = 1;
+    MonotonicTime next_sweep_ ABSL_GUARDED_BY(mutex_);
+  };
+
+  Shard& shardFor(std::string_view key);
+
+  /**
+   * Returns the live entry for the key, erasing it if it has expired.
+   */
+  static Entry* findLive(Shard& shard, std::string_view key, MonotonicTime now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex_);
+
+  /**
+   * Drops the expired entries of the shard once in a while, so that the keys never read again
+   * don't accumulate.
+   */
+  static void maybeSweep(Shard& shard, MonotonicTime now)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard.mutex_);
+
+  const uint64_t shard_mask_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
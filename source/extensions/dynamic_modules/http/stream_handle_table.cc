@@ -0,0 +1,91 @@
+#include "source/extensions/dynamic_modules/http/stream_handle_table.h"
+
+#include "source/common/common/macros.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+namespace {
+
+uint32_t handleIndex(uint64_t handle) { return static_cast<uint32_t>(handle); }
+uint32_t handleGeneration(uint64_t handle) { return static_cast<uint32_t>(handle >> 32); }
+
+} // namespace
+
+StreamHandleTable& StreamHandleTable::get() { MUTABLE_CONSTRUCT_ON_FIRST_USE(StreamHandleTable); }
+
+StreamHandleTable::Slot* StreamHandleTable::slot(uint32_t index) const {
+  const uint32_t chunk = index / ChunkSize;
+  if (chunk >= MaxChunks) {
+    return nullptr;
+  }
+  Slot* slots = chunks_[chunk].load(std::memory_order_acquire);
+  return slots == nullptr ? nullptr : &slots[index % ChunkSize];
+}
+
+uint64_t StreamHandleTable::acquire(std::weak_ptr<HttpFilter> filter) {
+  uint32_t index;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!free_.empty()) {
+      index = free_.back();
+      free_.pop_back();
+    } else {
+      if (allocated_ == ChunkSize * MaxChunks) {
+        return 0;
+      }
+      index = allocated_++;
+      if (index % ChunkSize == 0) {
+        chunks_[index / ChunkSize].store(new Slot[ChunkSize], std::memory_order_release);
+      }
+    }
+  }
+  Slot* s = slot(index);
+  absl::MutexLock lock(&s->mutex_);
+  s->filter_ = std::move(filter);
+  const uint32_t generation = s->generation_.load(std::memory_order_relaxed) + 1;
+  s->generation_.store(generation, std::memory_order_release);
+  return (static_cast<uint64_t>(generation) << 32) | index;
+}
+
+void StreamHandleTable::release(uint64_t handle) {
+  Slot* s = slot(handleIndex(handle));
+  if (s == nullptr) {
+    return;
+  }
+  {
+    absl::MutexLock lock(&s->mutex_);
+    if (s->generation_.load(std::memory_order_relaxed) != handleGeneration(handle)) {
+      return;
+    }
+    s->generation_.store(handleGeneration(handle) + 1, std::memory_order_release);
+    s->filter_.reset();
+  }
+  absl::MutexLock lock(&mutex_);
+  free_.push_back(handleIndex(handle));
+}
+
+std::shared_ptr<HttpFilter> StreamHandleTable::lookup(uint64_t handle) {
+  const uint32_t generation = handleGeneration(handle);
+  Slot* s = slot(handleIndex(handle));
+  // The generation of a live stream is always odd, so this also rejects 0 and the handles with
+  // garbage in the upper bits without taking the lock.
+  if (s == nullptr || (generation & 1) == 0 ||
+      s->generation_.load(std::memory_order_acquire) != generation) {
+    return nullptr;
+  }
+  // The lock only guards against the stream going away between the check and copying the
+  // reference, so it is contended only by the worker releasing this very slot.
+  absl::MutexLock lock(&s->mutex_);
+  if (s->generation_.load(std::memory_order_relaxed) != generation) {
+    return nullptr;
+  }
+  return s->filter_.lock();
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class HttpFilter;
+
+/**
+ * Process-wide table of the stream handles given to the modules, so that they can refer to a
+ * stream from their own threads without holding a pointer to the filter. A handle is the index of
+ * a slot in the lower 32 bits and the generation of the slot in the upper 32 bits. The generation
+ * is bumped when the stream goes away, so a handle outliving its stream is rejected by comparing
+ * a single atomic, and a reused slot is never mistaken for the old stream.
+ *
+ * The slots are allocated in chunks which are never freed nor moved, so a slot can be read from
+ * any thread without holding the table lock.
+ */
+class StreamHandleTable {
+public:
+  static StreamHandleTable& get();
+
+  /**
+   * Allocates a handle for the stream. This is called on the worker thread of the stream.
+   * @param filter the filter of the stream.
+   * @return the handle, or 0 if the table is full.
+   */
+  uint64_t acquire(std::weak_ptr<HttpFilter> filter);
+
+  /**
+   * Invalidates the handle, after which lookup() returns nullptr for it. This is called on the
+   * worker thread of the stream.
+   * @param handle the handle returned by acquire().
+   */
+  void release(uint64_t handle);
+
+  /**
+   * Returns the filter of the stream if the handle is still valid. This can be called from any
+   * thread.
+   * @param handle the handle returned by acquire().
+   */
+  std::shared_ptr<HttpFilter> lookup(uint64_t handle);
+
+  static constexpr uint32_t ChunkSize = 4096;
+  static constexpr uint32_t MaxChunks = 4096;
+
+private:
+  struct Slot {
+    // Odd while the slot is in use. This makes 0 an invalid handle as well.
+    std::atomic<uint32_t> generation_{0};
+    absl::Mutex mutex_;
+    std::weak_ptr<HttpFilter> filter_ ABSL_GUARDED_BY(mutex_);
+  };
+
+  Slot* slot(uint32_t index) const;
+
+  std::array<std::atomic<Slot*>, MaxChunks> chunks_{};
+  absl::Mutex mutex_;
+  uint32_t allocated_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<uint32_t> free_ ABSL_GUARDED_BY(mutex_);
+};
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
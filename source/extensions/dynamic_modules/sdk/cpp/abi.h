@@ -0,0 +1,903 @@
+#ifndef ENVOY_DYNAMIC_MODULE_ABI_
+#define ENVOY_DYNAMIC_MODULE_ABI_
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+extern "C" {
+#else
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+// -----------------------------------------------------------------------------
+// ----------------------------------- Types -----------------------------------
+// -----------------------------------------------------------------------------
+
+// These two macros are used to indicate the ownership of the memory for the types suffixed by
+// `Ptr`.
+#define OWNED_BY_ENVOY  // Indicates that the memory is owned by Envoy.
+#define OWNED_BY_MODULE // Indicates that the memory is owned by the module.
+
+#ifdef __cplusplus
+typedef void* envoy_dynamic_module_raw_pointer;
+#else
+// Use uintptr_t to represent a raw pointer in C for simplicity in Go bindings.
+typedef uintptr_t envoy_dynamic_module_raw_pointer;
+#endif
+
+// envoy_dynamic_module_type_HttpFilterConfigPtr is a pointer to the configuration passed to
+// the
+// envoy_dynamic_module_on_http_filter_init function. Envoy owns the memory of the
+// configuration and the module is not supposed to take ownership of it.
+//
+// The memory is only valid during envoy_dynamic_module_on_http_filter_init, except when the
+// configuration is given by filter_config_file. In that case, it is a read-only mapping of the file
+// that stays valid until envoy_dynamic_module_on_http_filter_destroy, so the module can refer to it
+// without copying, but must not write to it.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpFilterConfigPtr
+    OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_HttpFilterConfigSize is the size of the configuration passed to
+// the
+// envoy_dynamic_module_on_http_filter_init function.
+typedef size_t envoy_dynamic_module_type_HttpFilterConfigSize;
+
+// envoy_dynamic_module_type_HttpFilterPtr is a pointer to in-module singleton context
+// corresponding to the module. This is passed to
+// envoy_dynamic_module_on_http_filter_instance_init.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpFilterPtr OWNED_BY_MODULE;
+
+// envoy_dynamic_module_type_EnvoyFilterInstancePtr is a pointer to the
+// DynamicModule::HttpFilter instance. Modules are not supposed to manipulate this pointer.
+//
+// This is passed to envoy_dynamic_module_on_http_filter_instance_init, and the context can
+// store this pointer to access the filter instance. However, this becomes invalid after the
+// envoy_dynamic_module_on_http_filter_instance_destroy is called.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_EnvoyFilterInstancePtr
+    OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_HttpFilterInstancePtr is a pointer to in-module context
+// corresponding to a single DynamicModule::HttpFilter instance. It is always passed to the module's
+// event hooks.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpFilterInstancePtr
+    OWNED_BY_MODULE;
+
+// envoy_dynamic_module_type_HttpRequestHeadersMapPtr is a pointer to the header map instance.
+// This is passed to the envoy_dynamic_module_on_http_filter_instance_request_headers event
+// hook. Modules are not supposed to manipulate this pointer.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpRequestHeadersMapPtr
+    OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_EventHttpRequestHeadersStatus is the return value of the
+// envoy_dynamic_module_on_http_filter_instance_request_headers event. It should be one of
+// the values defined in the FilterHeadersStatus enum.
+typedef size_t envoy_dynamic_module_type_EventHttpRequestHeadersStatus;
+
+// envoy_dynamic_module_type_HttpResponseHeaderMapPtr is a pointer to the header map instance.
+// This is passed to the envoy_dynamic_module_on_http_filter_instance_response_headers event
+// hook. Modules are not supposed to manipulate this pointer.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpResponseHeaderMapPtr
+    OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_EventHttpResponseHeadersStatus is the return value of the
+// envoy_dynamic_module_on_http_filter_instance_response_headers event. It should be one of
+// the values defined in the FilterHeadersStatus enum.
+typedef size_t envoy_dynamic_module_type_EventHttpResponseHeadersStatus;
+
+// envoy_dynamic_module_type_HttpRequestBodyBufferPtr is a pointer to the body buffer instance
+// passed via envoy_dynamic_module_on_http_filter_instance_request_body event hook.
+// Modules are not supposed to manipulate this pointer directly.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpRequestBodyBufferPtr
+    OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_EventHttpRequestBodyStatus is the return value of the
+// envoy_dynamic_module_on_http_filter_instance_request_body event. It should be one of the
+// values defined in the FilterDataStatus enum.
+typedef size_t envoy_dynamic_module_type_EventHttpRequestBodyStatus;
+
+// envoy_dynamic_module_type_HttpResponseBodyBufferPtr is a pointer to the body buffer instance
+// passed via envoy_dynamic_module_on_http_filter_instance_response_body event hook.
+// Modules are not supposed to manipulate this pointer directly.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_HttpResponseBodyBufferPtr
+    OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_EventHttpResponseBodyStatus is the return value of the
+// envoy_dynamic_module_on_http_filter_instance_response_body event. It should be one of the
+// values defined in the FilterDataStatus enum.
+typedef size_t envoy_dynamic_module_type_EventHttpResponseBodyStatus;
+
+// envoy_dynamic_module_type_EndOfStream is a boolean value indicating whether the stream has
+// reached the end. The value should be 0 if the stream has not reached the end, and 1 if the stream
+// has reached the end.
+typedef size_t envoy_dynamic_module_type_EndOfStream;
+
+// envoy_dynamic_module_type_InModuleBufferPtr is a pointer to a buffer that is managed by the
+// module.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_InModuleBufferPtr
+    OWNED_BY_MODULE;
+
+// envoy_dynamic_module_type_InModuleBufferLength is the length of the buffer.
+typedef size_t envoy_dynamic_module_type_InModuleBufferLength;
+
+// envoy_dynamic_module_type_DataSlicePtr is a pointer to a buffer that is managed by Envoy.
+// This is used to pass buffer slices to the module.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_DataSlicePtr OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_DataSlicePtrResult is a pointer to a
+// envoy_dynamic_module_type_DataSlicePtr that is managed by the module.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_DataSlicePtrResult
+    OWNED_BY_MODULE;
+
+// envoy_dynamic_module_type_DataSliceLength is the length of the buffer slice.
+typedef size_t envoy_dynamic_module_type_DataSliceLength;
+
+// envoy_dynamic_module_type_DataSliceLengthResult is a pointer to a
+// envoy_dynamic_module_type_DataSliceLength that is managed by the module.
+typedef size_t envoy_dynamic_module_type_DataSliceLengthResult;
+
+// envoy_dynamic_module_type_DataSlice is a view of a slice of a body buffer owned by Envoy.
+//
+// This matches the memory representation of `struct { data *byte; length int }` in Go and
+// `(*const u8, usize)` in Rust.
+typedef struct {
+  envoy_dynamic_module_type_DataSlicePtr data;
+  envoy_dynamic_module_type_DataSliceLength length;
+} envoy_dynamic_module_type_DataSlice;
+
+// envoy_dynamic_module_type_DataSliceVectorPtr is a pointer to an array of
+// envoy_dynamic_module_type_DataSlice allocated by the module, which Envoy fills with the slices
+// of a body buffer.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_DataSliceVectorPtr
+    OWNED_BY_MODULE;
+
+// envoy_dynamic_module_type_InModuleHeader is a struct that contains representation of a
+// header. This is used to pass headers to Envoy from modules.
+//
+// This matches the memory representation of `[2]string` in Go and `(&str, &str)` in Rust.
+typedef struct {
+  envoy_dynamic_module_type_InModuleBufferPtr header_key;
+  envoy_dynamic_module_type_InModuleBufferLength header_key_length;
+  envoy_dynamic_module_type_InModuleBufferPtr header_value;
+  envoy_dynamic_module_type_InModuleBufferLength header_value_length;
+} envoy_dynamic_module_type_InModuleHeader;
+
+// envoy_dynamic_module_type_InModuleBufferVectorPtr is a pointer to a vector of
+// envoy_dynamic_module_type_InModuleHeader. This is currently only used for sending local
+// responses.
+//
+// This combined with envoy_dynamic_module_type_InModuleHeadersSize can be used to
+// pass the data `[][2]string` in Go and `vec<(&str, &str)>` in Rust.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_InModuleHeadersPtr;
+OWNED_BY_MODULE;
+
+// envoy_dynamic_module_type_InModuleHeadersSize is the size of the vector of buffers.
+typedef size_t envoy_dynamic_module_type_InModuleHeadersSize;
+
+// envoy_dynamic_module_type_LogResult is the result of a log operation
+typedef size_t envoy_dynamic_module_type_LogResult;
+
+// envoy_dynamic_module_type_StreamHandle is a handle to a stream which can be used from any thread,
+// unlike envoy_dynamic_module_type_EnvoyFilterInstancePtr. The handle becomes invalid when the
+// stream is destroyed, and using it afterwards is safe and has no effect. 0 is never a valid
+// handle.
+typedef uint64_t envoy_dynamic_module_type_StreamHandle;
+
+// envoy_dynamic_module_type_OffloadWork is a function of the module run on a thread of the
+// offload pool with the context passed to envoy_dynamic_module_http_offload.
+typedef void (*envoy_dynamic_module_type_OffloadWork)(envoy_dynamic_module_raw_pointer context);
+
+// envoy_dynamic_module_type_OffloadDone is a function of the module called on the worker thread
+// of the stream after envoy_dynamic_module_type_OffloadWork returns, with the same context.
+// http_filter_instance_ptr is nullptr if the stream was destroyed in the meantime, in which case
+// the module should only release the context.
+typedef void (*envoy_dynamic_module_type_OffloadDone)(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_raw_pointer context);
+
+// envoy_dynamic_module_type_TimerPtr is a pointer to a timer created by
+// envoy_dynamic_module_http_create_timer. The timer is owned by the stream, and the pointer must
+// not be used after envoy_dynamic_module_on_http_filter_instance_destroy is called.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_TimerPtr OWNED_BY_ENVOY;
+
+// envoy_dynamic_module_type_TimerCallback is a function of the module called on the worker thread
+// when a timer fires, with the context passed to envoy_dynamic_module_http_create_timer.
+typedef void (*envoy_dynamic_module_type_TimerCallback)(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_raw_pointer context);
+
+// envoy_dynamic_module_type_HttpCalloutDone is a function of the module called on the worker thread
+// when the response to envoy_dynamic_module_http_send_callout is received, with the context passed
+// to it.
+//
+// response_headers and response_body can be read with the functions for the response headers and
+// the response body buffer, and are only valid until this returns. Both are 0 if the request
+// failed, e.g. on a connection failure or a timeout.
+typedef void (*envoy_dynamic_module_type_HttpCalloutDone)(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_raw_pointer context,
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers,
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr response_body);
+
+// envoy_dynamic_module_type_SharedDataValuePtr is a reference to a value read from the shared data
+// store by envoy_dynamic_module_http_shared_data_get. The value stays valid and unchanged until
+// the reference is released with envoy_dynamic_module_http_shared_data_release, even if the key is
+// overwritten or expires in the meantime. This can be released from any thread.
+typedef envoy_dynamic_module_raw_pointer envoy_dynamic_module_type_SharedDataValuePtr
+    OWNED_BY_ENVOY;
+
+// -----------------------------------------------------------------------------
+// ----------------------------------- Enums -----------------------------------
+// -----------------------------------------------------------------------------
+
+// ENVOY_DYNAMIC_MODULE_HEADER_STATUS_CONTINUE indicates that the module has finished
+// processing the headers and Envoy should continue processing the request body or response body.
+#define ENVOY_DYNAMIC_MODULE_HEADER_STATUS_CONTINUE 0
+// ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ITERATION indicates that Envoy shouldn't continue
+// from processing the headers and should stop iteration. In other words, event_http_request_body
+// and event_http_response_body will be called while not sending headers to the upstream. The header
+// processing can be resumed by either calling continue_request/continue_response, or returns
+// continue status in the event_http_request_body or event_http_response_body.
+#define ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ITERATION 1
+// ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ALL_ITERATION_AND_BUFFER indicates
+// that Envoy should stop all iteration and continue to buffer the request/response body
+// until the limit is reached. When the limit is reached, Envoy will stop buffering and returns 500
+// to the client. This means that event_http_request_body and event_http_response_body will not be
+// called.
+//
+// The header processing can be resumed by either calling continue_request/continue_response, or
+// returns continue status in the event_http_request_body or event_http_response_body.
+#define ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ALL_ITERATION_AND_BUFFER 3
+
+static const envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+    envoy_dynamic_module_type_EventHttpRequestHeadersStatusContinue =
+        ENVOY_DYNAMIC_MODULE_HEADER_STATUS_CONTINUE;
+static const envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+    envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopIteration =
+        ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ITERATION;
+static const envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+    envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopAllIterationAndBuffer =
+        ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ALL_ITERATION_AND_BUFFER;
+
+static const envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+    envoy_dynamic_module_type_EventHttpResponseHeadersStatusContinue =
+        ENVOY_DYNAMIC_MODULE_HEADER_STATUS_CONTINUE;
+static const envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+    envoy_dynamic_module_type_EventHttpResponseHeadersStatusStopIteration =
+        ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ITERATION;
+static const envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+    envoy_dynamic_module_type_EventHttpResponseHeadersStatusStopAllIterationAndBuffer =
+        ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ALL_ITERATION_AND_BUFFER;
+
+// ENVOY_DYNAMIC_MODULE_BODY_STATUS_CONTINUE indicates that the module has finished
+// processing the body frame and Envoy should continue processing the request or response.
+//
+// This resumes the header processing if it was stopped in the event_http_request_headers or
+// event_http_response_headers.
+#define ENVOY_DYNAMIC_MODULE_BODY_STATUS_CONTINUE 0
+
+// ENVOY_DYNAMIC_MODULE_BODY_STATUS_STOP_ITERATION indicates that Envoy shouldn't continue
+// from processing the body frame and should stop iteration, but continue buffering the body until
+// the limit is reached. When the limit is reached, Envoy will stop buffering and returns 500 to the
+// client.
+//
+// This stops sending body data to the upstream, so if the module wants to continue sending body
+// data, it should call continue_request or continue_response or return continue status in the
+// subsequent event_http_request_body or event_http_response_body.
+#define ENVOY_DYNAMIC_MODULE_BODY_STATUS_STOP_ITERATION_AND_BUFFER 1
+
+static const envoy_dynamic_module_type_EventHttpRequestBodyStatus
+    envoy_dynamic_module_type_EventHttpRequestBodyStatusContinue =
+        ENVOY_DYNAMIC_MODULE_BODY_STATUS_CONTINUE;
+static const envoy_dynamic_module_type_EventHttpRequestBodyStatus
+    envoy_dynamic_module_type_EventHttpRequestBodyStatusStopIterationAndBuffer =
+        ENVOY_DYNAMIC_MODULE_BODY_STATUS_STOP_ITERATION_AND_BUFFER;
+
+static const envoy_dynamic_module_type_EventHttpResponseBodyStatus
+    envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue =
+        ENVOY_DYNAMIC_MODULE_BODY_STATUS_CONTINUE;
+static const envoy_dynamic_module_type_EventHttpResponseBodyStatus
+    envoy_dynamic_module_type_EventHttpResponseBodyStatusStopIterationAndBuffer =
+        ENVOY_DYNAMIC_MODULE_BODY_STATUS_STOP_ITERATION_AND_BUFFER;
+
+#define ENVOY_DYNAMIC_MODULE_LOG_SUCCESS 0
+#define ENVOY_DYNAMIC_MODULE_LOG_INVALID_MEM 1
+#define ENVOY_DYNAMIC_MODULE_LOG_UNKNOWN_LVL 2
+
+static const envoy_dynamic_module_type_LogResult
+    envoy_dynamic_module_type_LogResultSuccess =
+        ENVOY_DYNAMIC_MODULE_LOG_SUCCESS;
+static const envoy_dynamic_module_type_LogResult
+    envoy_dynamic_module_type_LogResultInvalidMem =
+        ENVOY_DYNAMIC_MODULE_LOG_INVALID_MEM;
+static const envoy_dynamic_module_type_LogResult
+    envoy_dynamic_module_type_LogResultUnknownLevel =
+        ENVOY_DYNAMIC_MODULE_LOG_UNKNOWN_LVL;
+
+// envoy_dyno_module_type_LogLevel map to spdlog levels, but not explicitly.
+// See https://internal.dunescience.org/doxygen/common_8h.html#a57ad66f77dc01b41a51f7e884dd460dd
+//
+// the ugly _LVL is because DEBUG is already defined
+enum envoy_dynamic_module_type_LogLevel {
+    TRACE_LVL,
+    DEBUG_LVL,
+    INFO_LVL,
+    WARN_LVL,
+    ERROR_LVL,
+    CRITICAL_LVL
+};
+
+
+// -----------------------------------------------------------------------------
+// ------------------------------- Event Hooks ---------------------------------
+// -----------------------------------------------------------------------------
+//
+// Event hooks are functions that are called by Envoy to notify the module of events.
+// The module must implement and export these functions in the dynamic module.
+
+// envoy_dynamic_module_on_program_init is called by the main thread when the module is
+// loaded exactly once per shared object file. The function returns 0 on success and non-zero on
+// failure.
+//
+// With parallel_init in the filter config, this and envoy_dynamic_module_on_http_filter_init are
+// called by one of the loader threads instead. This function is still called once per shared
+// object file, but envoy_dynamic_module_on_http_filter_init might be called concurrently for
+// different filter configs.
+size_t envoy_dynamic_module_on_program_init();
+
+// envoy_dynamic_module_on_http_filter_init is called by the main thread when the http
+// filter is loaded. The function returns
+// envoy_dynamic_module_type_HttpFilterPtr which is a pointer to the in-module singleton
+// context per http filter configuration. The lifetime of the returned pointer should be managed by
+// the dynamic module. Returning nullptr indicates a failure to initialize the module.
+envoy_dynamic_module_type_HttpFilterPtr envoy_dynamic_module_on_http_filter_init(
+    envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+    envoy_dynamic_module_type_HttpFilterConfigSize config_size);
+
+// envoy_dynamic_module_on_http_filter_destroy is called exactly once when the http
+// filter is unloaded. The function should clean up the resources allocated by the f
+void envoy_dynamic_module_on_http_filter_destroy(
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr);
+
+// envoy_dynamic_module_on_http_filter_instance_init is called by any worker thread when a
+// new stream is created. That means that the function should be thread-safe.
+//
+// The function returns a pointer to a new instance of the context or nullptr on failure.
+// The lifetime of the returned pointer should be managed by the dynamic module.
+envoy_dynamic_module_type_HttpFilterInstancePtr envoy_dynamic_module_on_http_filter_instance_init(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr);
+
+// envoy_dynamic_module_on_http_filter_instance_request_headers is called when request
+// headers are received.
+envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_request_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream);
+
+// envoy_dynamic_module_on_http_filter_instance_request_body is called when request body
+// data is received. buffer only contains the data for the current event.
+envoy_dynamic_module_type_EventHttpRequestBodyStatus
+envoy_dynamic_module_on_http_filter_instance_request_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream);
+
+// envoy_dynamic_module_on_http_filter_instance_response_headers is called when response
+// headers are received.
+envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_response_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_map_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream);
+
+// envoy_dynamic_module_on_http_filter_instance_response_body is called when response body
+// data is received. buffer only contains the data for the current event.
+envoy_dynamic_module_type_EventHttpResponseBodyStatus
+envoy_dynamic_module_on_http_filter_instance_response_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream);
+
+// envoy_dynamic_module_on_http_filter_instance_destroy is called when the stream is
+// destroyed.
+void envoy_dynamic_module_on_http_filter_instance_destroy(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr);
+
+// ENVOY_DYNAMIC_MODULE_HTTP_VTABLE_VERSION is the version of envoy_dynamic_module_type_HttpVtable
+// defined in this header. This is incremented when fields are appended to the struct, and Envoy
+// only reads the fields that exist in the version reported by the module.
+#define ENVOY_DYNAMIC_MODULE_HTTP_VTABLE_VERSION 1
+
+// envoy_dynamic_module_type_HttpVtable is the table of the http filter event hooks returned by
+// envoy_dynamic_module_get_http_vtable. Each field has the same signature and semantics as the
+// event hook of the same name above. All the fields are required.
+//
+// capabilities is a bit set reserved for optional event hooks appended in later versions, so that
+// the module can declare which of them it implements without exporting more symbols. It must be
+// zero in version 1, otherwise Envoy rejects the table.
+typedef struct {
+  size_t version;
+  size_t capabilities;
+  envoy_dynamic_module_type_HttpFilterPtr (*on_http_filter_init)(
+      envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+      envoy_dynamic_module_type_HttpFilterConfigSize config_size);
+  void (*on_http_filter_destroy)(envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr);
+  envoy_dynamic_module_type_HttpFilterInstancePtr (*on_http_filter_instance_init)(
+      envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+      envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr);
+  envoy_dynamic_module_type_EventHttpRequestHeadersStatus (
+      *on_http_filter_instance_request_headers)(
+      envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+      envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+      envoy_dynamic_module_type_EndOfStream end_of_stream);
+  envoy_dynamic_module_type_EventHttpRequestBodyStatus (*on_http_filter_instance_request_body)(
+      envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+      envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+      envoy_dynamic_module_type_EndOfStream end_of_stream);
+  envoy_dynamic_module_type_EventHttpResponseHeadersStatus (
+      *on_http_filter_instance_response_headers)(
+      envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+      envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_map_ptr,
+      envoy_dynamic_module_type_EndOfStream end_of_stream);
+  envoy_dynamic_module_type_EventHttpResponseBodyStatus (*on_http_filter_instance_response_body)(
+      envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+      envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+      envoy_dynamic_module_type_EndOfStream end_of_stream);
+  void (*on_http_filter_instance_destroy)(
+      envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr);
+} envoy_dynamic_module_type_HttpVtable;
+
+// envoy_dynamic_module_get_http_vtable is optionally exported by the module instead of the
+// individual http filter event hooks above. This is called by the main thread once per http filter
+// configuration right after envoy_dynamic_module_on_program_init, so that Envoy resolves all the
+// event hooks with a single symbol lookup. The returned table is owned by the module and must stay
+// valid until the module is unloaded. Returning nullptr indicates a failure.
+const envoy_dynamic_module_type_HttpVtable* envoy_dynamic_module_get_http_vtable();
+
+// envoy_dynamic_module_on_memory_pressure is optionally exported by the module to be notified of
+// the memory pressure of Envoy, so that a module with its own garbage collected heap, e.g. Go, can
+// shrink it along with Envoy instead of growing until its next collection. This is only called
+// when memory_pressure is set in the filter config, once per shared object file.
+//
+// pressure is the state of the configured overload action from 0 (inactive) to 1 (saturated).
+// This is called by the main thread each time the state changes, including back to 0, at most
+// once per poll interval.
+void envoy_dynamic_module_on_memory_pressure(double pressure);
+
+#undef OWNED_BY_ENVOY
+#undef OWNED_BY_MODULE
+
+// ---------------------------------------------------------------------------------
+// ----------------------------------- Envoy API -----------------------------------
+// ---------------------------------------------------------------------------------
+//
+// The following functions are called by the module to interact with Envoy.
+//
+// Note that pointers owned by Envoy should be made sure valid by following the caveat in the
+// comments.
+
+// ---------------- Header API ----------------
+
+// envoy_dynamic_module_get_request_header is called by the module to get the value for a
+// request header key. headers is the one passed to the
+// envoy_dynamic_module_on_http_filter_instance_request_headers. key is the header key to
+// look up. result_buffer_ptr and result_buffer_length_ptr are direct references to the buffer and
+// length of the value. The function returns the number of values found. If the key is not found,
+// this function returns nullptr and 0.
+//
+// Basically, this acts as a fast zero-copy lookup for a single header value, which is almost always
+// guaranteed to be true. In case of multiple values, the module can access n-th value by calling
+// envoy_dynamic_module_http_get_request_header_value_nth following this function.
+size_t envoy_dynamic_module_http_get_request_header_value(
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr headers,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr);
+
+// envoy_dynamic_module_http_get_request_header_value_nth is almost the same as
+// envoy_dynamic_module_http_get_request_header_value, but it allows the module to access n-th
+// value of the header. The function returns the number of values found. If nth is out of
+// bounds, this function returns nullptr and 0.
+void envoy_dynamic_module_http_get_request_header_value_nth(
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr headers,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr, size_t nth);
+
+// envoy_dynamic_module_http_get_response_header_value is called by the module to get the value
+// for a response header key. headers is the one passed to the
+// envoy_dynamic_module_on_http_filter_instance_response_headers. key is the header key to
+// look up. result_buffer_ptr and result_buffer_length_ptr are direct references to the buffer and
+// length of the value. The function returns the number of values found. If the key is not found,
+// this function returns nullptr and 0.
+//
+// Basically, this acts as a fast zero-copy lookup for a single header value, which is almost always
+// guaranteed to be true. In case of multiple values, the module can access n-th value by calling
+// envoy_dynamic_module_http_get_response_header_value_nth following this function.
+size_t envoy_dynamic_module_http_get_response_header_value(
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr headers,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr);
+
+// envoy_dynamic_module_http_get_response_header_value_nth is almost the same as
+// envoy_dynamic_module_http_get_response_header_value, but it allows the module to access n-th
+// value of the header. The function returns the number of values found. If nth is out of
+// bounds, this function returns nullptr and 0.
+void envoy_dynamic_module_http_get_response_header_value_nth(
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr headers,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr, size_t nth);
+
+// envoy_dynamic_module_http_set_request_header is called by the module to set the value
+// for a request header key. headers is the one passed to the
+// envoy_dynamic_module_on_http_filter_instance_request_headers. If the key is not found,
+// this function should add a new header with the key and value. If the key is found, this function
+// should replace the value with the new one. If the value is empty, this function should remove the
+// key. If there are multiple headers with the same key, this function removes all of them and adds
+// a new one.
+void envoy_dynamic_module_http_set_request_header(
+    envoy_dynamic_module_type_HttpRequestHeadersMapPtr headers,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_InModuleBufferPtr value,
+    envoy_dynamic_module_type_InModuleBufferLength value_length);
+
+// envoy_dynamic_module_http_set_response_header is called by the module to set the value
+// for a response header key. headers is the one passed to the
+// envoy_dynamic_module_on_http_filter_instance_response_headers.
+// If the key is not found, this function should add a new header with the key and value. If the key
+// is found, this function should replace the value with the new one. If the value is empty, this
+// function should remove the key. If there are multiple headers with the same key, this function
+// removes all of them and adds a new one.
+void envoy_dynamic_module_http_set_response_header(
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr headers,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_InModuleBufferPtr value,
+    envoy_dynamic_module_type_InModuleBufferLength value_length);
+
+// ---------------- Buffer API ----------------
+
+// envoy_dynamic_module_http_get_request_body_buffer is called by the module to get the entire
+// request body buffer. The function returns the buffer if available, otherwise nullptr.
+envoy_dynamic_module_type_HttpRequestBodyBufferPtr
+envoy_dynamic_module_http_get_request_body_buffer(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr);
+
+// envoy_dynamic_module_http_get_response_body_buffer is called by the module to get the entire
+// response body buffer. The function returns the buffer if available, otherwise nullptr.
+envoy_dynamic_module_type_HttpResponseBodyBufferPtr
+envoy_dynamic_module_http_get_response_body_buffer(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr);
+
+// envoy_dynamic_module_http_get_request_body_buffer_length is called by the module to get the
+// length (number of bytes) of the request body buffer. The function returns the length of the
+// buffer.
+size_t envoy_dynamic_module_http_get_request_body_buffer_length(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer);
+
+// envoy_dynamic_module_http_get_request_body_buffer_slices_count is called by the module to
+// get the number of slices in the request body buffer. The function returns the number of
+// slices.
+size_t envoy_dynamic_module_http_get_request_body_buffer_slices_count(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer);
+
+// envoy_dynamic_module_http_get_request_body_buffer_slice is called by the module to get the
+// n-th slice of the request body buffer. The function returns the buffer and length of the
+// slice. If nth is out of bounds, this function returns nullptr and 0.
+void envoy_dynamic_module_http_get_request_body_buffer_slice(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer, size_t nth,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr);
+
+// envoy_dynamic_module_http_get_request_body_buffer_slices is called by the module to get all the
+// slices of the request body buffer at once, instead of calling
+// envoy_dynamic_module_http_get_request_body_buffer_slice for each of them. The slices are written
+// to result_slices up to result_slices_capacity. The function returns the total number of slices,
+// so the module can call it again with a larger array if that exceeds the capacity.
+//
+// The slices are valid until the buffer is modified or the event hook returns.
+size_t envoy_dynamic_module_http_get_request_body_buffer_slices(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_DataSliceVectorPtr result_slices, size_t result_slices_capacity);
+
+// envoy_dynamic_module_http_copy_out_request_body_buffer is called by the module to copy
+// `length` bytes from the request body buffer starting from `offset` to the `result_buffer_ptr`.
+void envoy_dynamic_module_http_copy_out_request_body_buffer(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer, size_t offset, size_t length,
+    envoy_dynamic_module_type_InModuleBufferPtr result_buffer_ptr);
+
+// envoy_dynamic_module_http_append_request_body_buffer is called by the module to append
+// data to the request body buffer. The function appends data to the end of the buffer.
+//
+// After calling this function, the previously returned slices may be invalidated.
+void envoy_dynamic_module_http_append_request_body_buffer(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_InModuleBufferPtr data,
+    envoy_dynamic_module_type_InModuleBufferLength data_length);
+
+// envoy_dynamic_module_http_prepend_request_body_buffer is called by the module to prepend
+// data to the request body buffer. The function prepends data to the beginning of the buffer.
+//
+// After calling this function, the previously returned slices may be invalidated.
+void envoy_dynamic_module_http_prepend_request_body_buffer(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_InModuleBufferPtr data,
+    envoy_dynamic_module_type_InModuleBufferLength data_length);
+
+// envoy_dynamic_module_http_drain_request_body_buffer is called by the module to drain
+// data from the request body buffer. The function drains length bytes from the beginning of the
+// buffer.
+//
+// After calling this function, the previously returned slices may be invalidated.
+void envoy_dynamic_module_http_drain_request_body_buffer(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer, size_t length);
+
+// envoy_dynamic_module_http_get_response_body_buffer_length is called by the module to get the
+// length (number of bytes) of the response body buffer. The function returns the length of the
+// buffer.
+size_t envoy_dynamic_module_http_get_response_body_buffer_length(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer);
+
+// envoy_dynamic_module_http_get_response_body_buffer_slices_count is called by the module to
+// get the number of slices in the response body buffer. The function returns the number of
+// slices.
+size_t envoy_dynamic_module_http_get_response_body_buffer_slices_count(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer);
+
+// envoy_dynamic_module_http_get_response_body_buffer_slice is called by the module to get the
+// n-th slice of the response body buffer. The function returns the buffer and length of the
+// slice. If nth is out of bounds, this function returns nullptr and 0.
+void envoy_dynamic_module_http_get_response_body_buffer_slice(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer, size_t nth,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr);
+
+// envoy_dynamic_module_http_get_response_body_buffer_slices is called by the module to get all the
+// slices of the response body buffer at once, instead of calling
+// envoy_dynamic_module_http_get_response_body_buffer_slice for each of them. The slices are written
+// to result_slices up to result_slices_capacity. The function returns the total number of slices,
+// so the module can call it again with a larger array if that exceeds the capacity.
+//
+// The slices are valid until the buffer is modified or the event hook returns.
+size_t envoy_dynamic_module_http_get_response_body_buffer_slices(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_DataSliceVectorPtr result_slices, size_t result_slices_capacity);
+
+// envoy_dynamic_module_http_copy_out_response_body_buffer is called by the module to copy
+// `length` bytes from the response body buffer starting from `offset` to the `result_buffer_ptr`.
+void envoy_dynamic_module_http_copy_out_response_body_buffer(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer, size_t offset, size_t length,
+    envoy_dynamic_module_type_InModuleBufferPtr result_buffer_ptr);
+
+// envoy_dynamic_module_http_append_response_body_buffer is called by the module to append
+// data to the response body buffer. The function appends data to the end of the buffer.
+//
+// After calling this function, the previously returned slices may be invalidated.
+void envoy_dynamic_module_http_append_response_body_buffer(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_InModuleBufferPtr data,
+    envoy_dynamic_module_type_InModuleBufferLength data_length);
+
+// envoy_dynamic_module_http_prepend_response_body_buffer is called by the module to
+// prepend data to the response body buffer. The function prepends data to the beginning of the
+// buffer.
+//
+// After calling this function, the previously returned slices may be invalidated.
+void envoy_dynamic_module_http_prepend_response_body_buffer(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_InModuleBufferPtr data,
+    envoy_dynamic_module_type_InModuleBufferLength data_length);
+
+// envoy_dynamic_module_http_drain_response_body_buffer is called by the module to drain
+// data from the response body buffer. The function drains length bytes from the beginning of the
+// buffer.
+//
+// After calling this function, the previously returned slices may be invalidated.
+void envoy_dynamic_module_http_drain_response_body_buffer(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer, size_t length);
+
+// envoy_dynamic_module_http_continue_request is called by the module to continue processing
+// the request. This function is used when the module returned non Continue status in the events.
+//
+// This can be called from any thread. The request is continued later on the worker thread of the
+// stream, and the calls made for the streams on the same worker before it gets to them are
+// processed together in a single wake up of the worker.
+void envoy_dynamic_module_http_continue_request(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr);
+
+// envoy_dynamic_module_http_continue_response is called by the module to continue processing
+// the response. This function is used when the module returned non Continue status in the events.
+//
+// This can be called from any thread. The response is continued later on the worker thread of the
+// stream, and the calls made for the streams on the same worker before it gets to them are
+// processed together in a single wake up of the worker.
+void envoy_dynamic_module_http_continue_response(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr);
+
+// envoy_dynamic_module_http_get_stream_handle is called by the module to get the handle of the
+// stream, which can be passed to the module's own threads to continue the stream from there. This
+// must be called on the worker thread during one of the event hooks of the stream. Calling it again
+// for the same stream returns the same handle. Returns 0 if no more handles can be allocated.
+envoy_dynamic_module_type_StreamHandle envoy_dynamic_module_http_get_stream_handle(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr);
+
+// envoy_dynamic_module_http_get_worker_index is called by the module to get the index of the
+// worker thread running the stream, starting from 0. The module can use this to keep its own
+// per-worker state, e.g. to pick the queue of its thread pool so that the work of the streams on
+// the same worker is handled together. Returns 0 if the stream doesn't run on a worker thread.
+uint32_t envoy_dynamic_module_http_get_worker_index(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr);
+
+// envoy_dynamic_module_http_continue_request_by_handle is the same as
+// envoy_dynamic_module_http_continue_request, but takes the handle of the stream. This can be
+// called from any thread at any time, even after the stream is destroyed.
+//
+// Returns 1 if the request will be continued, or 0 if the stream is already destroyed. Note that
+// the stream may still be destroyed before the worker thread gets to continue it.
+size_t envoy_dynamic_module_http_continue_request_by_handle(
+    envoy_dynamic_module_type_StreamHandle stream_handle);
+
+// envoy_dynamic_module_http_continue_response_by_handle is the same as
+// envoy_dynamic_module_http_continue_request_by_handle, but continues the response.
+size_t envoy_dynamic_module_http_continue_response_by_handle(
+    envoy_dynamic_module_type_StreamHandle stream_handle);
+
+// envoy_dynamic_module_http_offload is called by the module to run CPU heavy work, e.g. parsing a
+// large body, on the offload pool of the module instead of the worker thread. The work function is
+// called on one of the threads of the pool, and then the done function is called on the worker
+// thread of the stream. Both are called exactly once if this returns 1, except that the work
+// function is skipped when the pool is shut down before it starts, e.g. the filter config is
+// removed. That only happens after the stream is destroyed, so the done function is still called
+// with a nullptr http_filter_instance_ptr to release the context, on the main thread instead.
+//
+// The module should return a StopIteration status from the event hook, and continue the stream
+// with envoy_dynamic_module_http_continue_request or envoy_dynamic_module_http_continue_response
+// in the done function. This must be called on the worker thread during one of the event hooks.
+//
+// Returns 0 if the offload pool is not configured or its queue is full, in which case neither
+// function is called and the module should do the work inline.
+size_t envoy_dynamic_module_http_offload(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_OffloadWork work, envoy_dynamic_module_type_OffloadDone done,
+    envoy_dynamic_module_raw_pointer context);
+
+// envoy_dynamic_module_http_create_timer is called by the module to create a timer on the worker
+// thread of the stream. The timer is created disabled. The callback is called on the worker thread
+// each time the timer fires, so the module can wait without a thread of its own, e.g. to continue
+// the stream after a delay.
+//
+// The timers of a stream are cancelled and freed right before
+// envoy_dynamic_module_on_http_filter_instance_destroy is called, so the callback is never called
+// after that. This must be called on the worker thread during one of the event hooks.
+envoy_dynamic_module_type_TimerPtr envoy_dynamic_module_http_create_timer(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_TimerCallback callback, envoy_dynamic_module_raw_pointer context);
+
+// envoy_dynamic_module_http_enable_timer is called by the module to arm the timer to fire once
+// after timeout_milliseconds. Enabling an already enabled timer resets the timeout. This must be
+// called on the worker thread.
+void envoy_dynamic_module_http_enable_timer(envoy_dynamic_module_type_TimerPtr timer,
+                                            uint64_t timeout_milliseconds);
+
+// envoy_dynamic_module_http_disable_timer is called by the module to cancel the timer if it is
+// enabled. The timer can be enabled again. This must be called on the worker thread.
+void envoy_dynamic_module_http_disable_timer(envoy_dynamic_module_type_TimerPtr timer);
+
+// envoy_dynamic_module_http_send_callout is called by the module to send an HTTP request to the
+// upstream cluster named cluster_name, e.g. for an auth or quota lookup, through the connection
+// pools of Envoy. The headers must contain :method, :path and :authority. The done function is
+// called on the worker thread with the response.
+//
+// The request times out after timeout_milliseconds, or never if it is 0. The callouts in flight are
+// cancelled right before envoy_dynamic_module_on_http_filter_instance_destroy is called, and the
+// done function is not called for them, so the module should release their contexts there. This
+// must be called on the worker thread during one of the event hooks.
+//
+// Returns 1 if the request is sent, in which case the done function is called exactly once unless
+// the request is cancelled, possibly before this returns. Returns 0 if the cluster doesn't exist.
+size_t envoy_dynamic_module_http_send_callout(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr cluster_name,
+    envoy_dynamic_module_type_InModuleBufferLength cluster_name_length,
+    envoy_dynamic_module_type_InModuleHeadersPtr headers_vector,
+    envoy_dynamic_module_type_InModuleHeadersSize headers_vector_size,
+    envoy_dynamic_module_type_InModuleBufferPtr body_ptr,
+    envoy_dynamic_module_type_InModuleBufferLength body_length, uint64_t timeout_milliseconds,
+    envoy_dynamic_module_type_HttpCalloutDone done, envoy_dynamic_module_raw_pointer context);
+
+// ---------------- Shared Data API ----------------
+//
+// The shared data store is a key/value store shared by the streams of the module on all the
+// workers, e.g. for rate limit counters or caches. The filter configs of the module with the
+// identical configuration share one store, the other filter configs have their own, and a module
+// swapped in by the hot reload starts with an empty one. These functions must be called on
+// the worker thread during one of the event hooks, as the expiry is based on the time of the
+// worker.
+
+// envoy_dynamic_module_http_shared_data_get is called by the module to read the value of the key.
+// The value is returned in result_buffer_ptr and result_buffer_length_ptr, and its version in
+// version. The returned reference must be released with
+// envoy_dynamic_module_http_shared_data_release.
+//
+// Returns 0 if the key doesn't exist or has expired.
+envoy_dynamic_module_type_SharedDataValuePtr envoy_dynamic_module_http_shared_data_get(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_DataSlicePtrResult result_buffer_ptr,
+    envoy_dynamic_module_type_DataSliceLengthResult result_buffer_length_ptr, uint64_t* version);
+
+// envoy_dynamic_module_http_shared_data_release is called by the module to release the reference
+// returned by envoy_dynamic_module_http_shared_data_get.
+void envoy_dynamic_module_http_shared_data_release(
+    envoy_dynamic_module_type_SharedDataValuePtr value);
+
+// envoy_dynamic_module_http_shared_data_set is called by the module to set the value of the key
+// if its current version is expected_version, i.e. a compare-and-swap. expected_version is the
+// version returned by envoy_dynamic_module_http_shared_data_get, 0 if the key must not exist, or
+// UINT64_MAX to set the value regardless of the current one. The entry expires after
+// ttl_milliseconds, or never if it is 0.
+//
+// Returns the new version of the key, or 0 if the version didn't match.
+uint64_t envoy_dynamic_module_http_shared_data_set(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length,
+    envoy_dynamic_module_type_InModuleBufferPtr value,
+    envoy_dynamic_module_type_InModuleBufferLength value_length, uint64_t expected_version,
+    uint64_t ttl_milliseconds);
+
+// envoy_dynamic_module_http_shared_data_increment is called by the module to atomically add delta
+// to the counter of the key, and the new value is returned in result. The counter is stored as an
+// 8 byte integer in the host byte order, and is created with 0 if the key doesn't exist or has
+// expired. ttl_milliseconds only applies when the counter is created, so the counter resets at a
+// fixed interval, e.g. for a fixed window rate limit. 0 means it never expires.
+//
+// Returns 1 on success, or 0 if the existing value of the key is not an 8 byte counter or the sum
+// overflows, in which case the counter is left unchanged.
+size_t envoy_dynamic_module_http_shared_data_increment(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_InModuleBufferPtr key,
+    envoy_dynamic_module_type_InModuleBufferLength key_length, int64_t delta,
+    uint64_t ttl_milliseconds, int64_t* result);
+
+// ---------------- Miscellaneous API ----------------
+
+// envoy_dynamic_module_http_send_response is called by the module to send a response to the
+// client. headers_vector is a vector of headers to send. status_code is the status code to send.
+// body is the body to send. body_length is the length of the body.
+void envoy_dynamic_module_http_send_response(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    uint32_t status_code, envoy_dynamic_module_type_InModuleHeadersPtr headers_vector,
+    envoy_dynamic_module_type_InModuleHeadersSize headers_vector_size,
+    envoy_dynamic_module_type_InModuleBufferPtr body,
+    envoy_dynamic_module_type_InModuleBufferLength body_length);
+
+
+// envoy_dynamic_module_log permits logging to Envoy's built-in fine-grained log stack. it requires
+// that you provide filename, file line, and function name.
+envoy_dynamic_module_type_LogResult envoy_dynamic_module_log(
+    envoy_dynamic_module_type_InModuleBufferPtr file_name_str,
+    envoy_dynamic_module_type_InModuleBufferLength file_name_str_length,
+    int file_line,
+    envoy_dynamic_module_type_InModuleBufferPtr func_name_str,
+    envoy_dynamic_module_type_InModuleBufferLength func_name_str_length,
+    enum envoy_dynamic_module_type_LogLevel level,
+    envoy_dynamic_module_type_InModuleBufferPtr log_line_str,
+    envoy_dynamic_module_type_InModuleBufferLength log_line_str_length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENVOY_DYNAMIC_MODULE_ABI_
@@ -0,0 +1,771 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include "abi.h"
+
+namespace envoy_dynamic_modules {
+
+/**
+ * The status returned by HttpFilterInstance::onRequestHeaders. See the corresponding
+ * ENVOY_DYNAMIC_MODULE_HEADER_STATUS_* in abi.h for the semantics.
+ */
+enum class RequestHeadersStatus : envoy_dynamic_module_type_EventHttpRequestHeadersStatus {
+  Continue = ENVOY_DYNAMIC_MODULE_HEADER_STATUS_CONTINUE,
+  StopIteration = ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ITERATION,
+  StopAllIterationAndBuffer = ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ALL_ITERATION_AND_BUFFER,
+};
+
+/**
+ * The status returned by HttpFilterInstance::onResponseHeaders.
+ */
+enum class ResponseHeadersStatus : envoy_dynamic_module_type_EventHttpResponseHeadersStatus {
+  Continue = ENVOY_DYNAMIC_MODULE_HEADER_STATUS_CONTINUE,
+  StopIteration = ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ITERATION,
+  StopAllIterationAndBuffer = ENVOY_DYNAMIC_MODULE_HEADER_STATUS_STOP_ALL_ITERATION_AND_BUFFER,
+};
+
+/**
+ * The status returned by HttpFilterInstance::onRequestBody. See the corresponding
+ * ENVOY_DYNAMIC_MODULE_BODY_STATUS_* in abi.h for the semantics.
+ */
+enum class RequestBodyStatus : envoy_dynamic_module_type_EventHttpRequestBodyStatus {
+  Continue = ENVOY_DYNAMIC_MODULE_BODY_STATUS_CONTINUE,
+  StopIterationAndBuffer = ENVOY_DYNAMIC_MODULE_BODY_STATUS_STOP_ITERATION_AND_BUFFER,
+};
+
+/**
+ * The status returned by HttpFilterInstance::onResponseBody.
+ */
+enum class ResponseBodyStatus : envoy_dynamic_module_type_EventHttpResponseBodyStatus {
+  Continue = ENVOY_DYNAMIC_MODULE_BODY_STATUS_CONTINUE,
+  StopIterationAndBuffer = ENVOY_DYNAMIC_MODULE_BODY_STATUS_STOP_ITERATION_AND_BUFFER,
+};
+
+namespace detail {
+
+// The ABI takes the buffers of the module as non-const raw pointers even though it only reads them.
+inline void* toRaw(std::string_view view) { return const_cast<char*>(view.data()); }
+
+// envoy_dynamic_module_type_DataSliceLengthResult is an integer type in abi.h, so the pointer to
+// the length has to be passed as one.
+inline envoy_dynamic_module_type_DataSliceLengthResult toLengthResult(size_t* length) {
+  return reinterpret_cast<envoy_dynamic_module_type_DataSliceLengthResult>(length);
+}
+
+inline std::string_view toView(void* data, size_t length) {
+  return data == nullptr ? std::string_view() : std::string_view(static_cast<char*>(data), length);
+}
+
+using GetHeaderValue = size_t (*)(void*, void*, size_t,
+                                  envoy_dynamic_module_type_DataSlicePtrResult,
+                                  envoy_dynamic_module_type_DataSliceLengthResult);
+using GetHeaderValueNth = void (*)(void*, void*, size_t,
+                                   envoy_dynamic_module_type_DataSlicePtrResult,
+                                   envoy_dynamic_module_type_DataSliceLengthResult, size_t);
+using SetHeader = void (*)(void*, void*, size_t, void*, size_t);
+
+/**
+ * The values of a header key, fetched one by one as the range is iterated. The first value comes
+ * with the count, so the common case of a single value is one call into Envoy.
+ */
+template <GetHeaderValue Get, GetHeaderValueNth GetNth> class HeaderValues {
+public:
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view*;
+    using reference = std::string_view;
+
+    std::string_view operator*() const { return values_->at(index_); }
+    iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator copy = *this;
+      ++index_;
+      return copy;
+    }
+    bool operator==(const iterator& other) const { return index_ == other.index_; }
+    bool operator!=(const iterator& other) const { return index_ != other.index_; }
+
+  private:
+    friend class HeaderValues;
+    iterator(const HeaderValues* values, size_t index) : values_(values), index_(index) {}
+
+    const HeaderValues* values_;
+    size_t index_;
+  };
+
+  HeaderValues(void* headers, std::string_view key) : headers_(headers), key_(key) {
+    void* data = nullptr;
+    size_t length = 0;
+    count_ = Get(headers_, toRaw(key_), key_.size(), &data, toLengthResult(&length));
+    first_ = toView(data, length);
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, count_); }
+
+  /**
+   * @param index the index of the value, which must be less than size().
+   * @return the value borrowed from Envoy, valid until the headers are modified.
+   */
+  std::string_view at(size_t index) const {
+    if (index == 0) {
+      return first_;
+    }
+    void* data = nullptr;
+    size_t length = 0;
+    GetNth(headers_, toRaw(key_), key_.size(), &data, toLengthResult(&length), index);
+    return toView(data, length);
+  }
+
+private:
+  void* headers_;
+  std::string_view key_;
+  size_t count_;
+  std::string_view first_;
+};
+
+/**
+ * A header map owned by Envoy and borrowed by an event hook. This is neither copyable nor movable
+ * so that it cannot outlive the hook, which is when Envoy frees the map.
+ */
+template <GetHeaderValue Get, GetHeaderValueNth GetNth, SetHeader Set> class Headers {
+public:
+  using Values = HeaderValues<Get, GetNth>;
+
+  explicit Headers(void* raw) : raw_(raw) {}
+  Headers(const Headers&) = delete;
+  Headers& operator=(const Headers&) = delete;
+
+  /**
+   * @param key the header key.
+   * @return the first value of the key, or nullopt if it doesn't exist. The value is borrowed from
+   * Envoy and valid until the headers are modified.
+   */
+  std::optional<std::string_view> get(std::string_view key) const {
+    void* data = nullptr;
+    size_t length = 0;
+    if (Get(raw_, toRaw(key), key.size(), &data, toLengthResult(&length)) == 0) {
+      return std::nullopt;
+    }
+    return toView(data, length);
+  }
+
+  /**
+   * @param key the header key. This must outlive the returned range.
+   * @return the range of all the values of the key.
+   */
+  Values values(std::string_view key) const { return Values(raw_, key); }
+
+  /**
+   * Replaces all the values of the key with the value, or removes the key if the value is empty.
+   */
+  void set(std::string_view key, std::string_view value) const {
+    // Envoy only removes the key for a null value, which an empty view might not have.
+    if (value.empty()) {
+      remove(key);
+      return;
+    }
+    Set(raw_, toRaw(key), key.size(), toRaw(value), value.size());
+  }
+
+  void remove(std::string_view key) const { Set(raw_, toRaw(key), key.size(), nullptr, 0); }
+
+  void* raw() const { return raw_; }
+
+private:
+  void* const raw_;
+};
+
+/**
+ * The function table of the request or the response body buffer.
+ */
+struct BodyBufferFunctions {
+  size_t (*length)(void*);
+  size_t (*slices_count)(void*);
+  void (*slice)(void*, size_t, envoy_dynamic_module_type_DataSlicePtrResult,
+                envoy_dynamic_module_type_DataSliceLengthResult);
+  size_t (*slices)(void*, envoy_dynamic_module_type_DataSliceVectorPtr, size_t);
+  void (*copy_out)(void*, size_t, size_t, void*);
+  void (*append)(void*, void*, size_t);
+  void (*prepend)(void*, void*, size_t);
+  void (*drain)(void*, size_t);
+};
+
+inline constexpr BodyBufferFunctions RequestBodyBufferFunctions = {
+    envoy_dynamic_module_http_get_request_body_buffer_length,
+    envoy_dynamic_module_http_get_request_body_buffer_slices_count,
+    envoy_dynamic_module_http_get_request_body_buffer_slice,
+    envoy_dynamic_module_http_get_request_body_buffer_slices,
+    envoy_dynamic_module_http_copy_out_request_body_buffer,
+    envoy_dynamic_module_http_append_request_body_buffer,
+    envoy_dynamic_module_http_prepend_request_body_buffer,
+    envoy_dynamic_module_http_drain_request_body_buffer,
+};
+
+inline constexpr BodyBufferFunctions ResponseBodyBufferFunctions = {
+    envoy_dynamic_module_http_get_response_body_buffer_length,
+    envoy_dynamic_module_http_get_response_body_buffer_slices_count,
+    envoy_dynamic_module_http_get_response_body_buffer_slice,
+    envoy_dynamic_module_http_get_response_body_buffer_slices,
+    envoy_dynamic_module_http_copy_out_response_body_buffer,
+    envoy_dynamic_module_http_append_response_body_buffer,
+    envoy_dynamic_module_http_prepend_response_body_buffer,
+    envoy_dynamic_module_http_drain_response_body_buffer,
+};
+
+/**
+ * The slices of a body buffer. The first BatchSize slices are fetched with a single call into
+ * Envoy when the range is created, which covers almost all the bodies, and the rest one by one.
+ * Slice is either std::string_view or std::span<std::byte>.
+ */
+template <const BodyBufferFunctions& Functions, class Slice> class BodySlices {
+public:
+  static constexpr size_t BatchSize = 8;
+
+  class iterator {
+  public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = Slice;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Slice*;
+    using reference = Slice;
+
+    Slice operator*() const { return slices_->at(index_); }
+    iterator& operator++() {
+      ++index_;
+      return *this;
+    }
+    iterator operator++(int) {
+      iterator copy = *this;
+      ++index_;
+      return copy;
+    }
+    bool operator==(const iterator& other) const { return index_ == other.index_; }
+    bool operator!=(const iterator& other) const { return index_ != other.index_; }
+
+  private:
+    friend class BodySlices;
+    iterator(const BodySlices* slices, size_t index) : slices_(slices), index_(index) {}
+
+    const BodySlices* slices_;
+    size_t index_;
+  };
+
+  explicit BodySlices(void* buffer) : buffer_(buffer) {
+    count_ = Functions.slices(buffer_, batch_, BatchSize);
+  }
+
+  size_t size() const { return count_; }
+  bool empty() const { return count_ == 0; }
+  iterator begin() const { return iterator(this, 0); }
+  iterator end() const { return iterator(this, count_); }
+
+  /**
+   * @param index the index of the slice, which must be less than size().
+   * @return the slice borrowed from Envoy, valid until the buffer is modified.
+   */
+  Slice at(size_t index) const {
+    if (index < BatchSize) {
+      return toSlice(batch_[index].data, batch_[index].length);
+    }
+    void* data = nullptr;
+    size_t length = 0;
+    Functions.slice(buffer_, index, &data, toLengthResult(&length));
+    return toSlice(data, length);
+  }
+
+private:
+  static Slice toSlice(void* data, size_t length) {
+    if (data == nullptr) {
+      return Slice();
+    }
+    using Element = std::remove_const_t<typename Slice::value_type>;
+    return Slice(static_cast<Element*>(data), length);
+  }
+
+  void* buffer_;
+  size_t count_;
+  envoy_dynamic_module_type_DataSlice batch_[BatchSize];
+};
+
+/**
+ * A body buffer owned by Envoy. Like Headers, this is borrowed by an event hook and cannot be
+ * copied, except for the one returned by EnvoyFilterInstance which is valid until the stream is
+ * destroyed.
+ */
+template <const BodyBufferFunctions& Functions> class BodyBuffer {
+public:
+  using Slices = BodySlices<Functions, std::string_view>;
+#ifdef __cpp_lib_span
+  using Spans = BodySlices<Functions, std::span<std::byte>>;
+#endif
+
+  explicit BodyBuffer(void* raw) : raw_(raw) {}
+  BodyBuffer(const BodyBuffer&) = delete;
+  BodyBuffer& operator=(const BodyBuffer&) = delete;
+
+  /**
+   * @return false if the buffer is not available, e.g. the body hasn't been buffered yet.
+   */
+  explicit operator bool() const { return raw_ != nullptr; }
+
+  size_t length() const { return Functions.length(raw_); }
+  size_t slicesCount() const { return Functions.slices_count(raw_); }
+
+  /**
+   * @return the range of the slices of the buffer as read-only views.
+   */
+  Slices slices() const { return Slices(raw_); }
+
+#ifdef __cpp_lib_span
+  /**
+   * @return the range of the slices of the buffer as writable spans, to modify the body in place.
+   */
+  Spans spans() const { return Spans(raw_); }
+#endif
+
+  /**
+   * Copies the whole buffer into a contiguous string.
+   */
+  std::string copy() const {
+    std::string result;
+    copyInto(result);
+    return result;
+  }
+
+  /**
+   * Copies the whole buffer into the string, reusing its capacity.
+   */
+  void copyInto(std::string& result) const {
+    result.resize(length());
+    if (!result.empty()) {
+      Functions.copy_out(raw_, 0, result.size(), result.data());
+    }
+  }
+
+  void append(std::string_view data) const { Functions.append(raw_, toRaw(data), data.size()); }
+  void prepend(std::string_view data) const { Functions.prepend(raw_, toRaw(data), data.size()); }
+  void drain(size_t length) const { Functions.drain(raw_, length); }
+
+  /**
+   * Replaces the whole buffer with the data.
+   */
+  void replace(std::string_view data) const {
+    drain(length());
+    append(data);
+  }
+
+  void* raw() const { return raw_; }
+
+private:
+  void* const raw_;
+};
+
+} // namespace detail
+
+using RequestHeaders =
+    detail::Headers<envoy_dynamic_module_http_get_request_header_value,
+                    envoy_dynamic_module_http_get_request_header_value_nth,
+                    envoy_dynamic_module_http_set_request_header>;
+using ResponseHeaders =
+    detail::Headers<envoy_dynamic_module_http_get_response_header_value,
+                    envoy_dynamic_module_http_get_response_header_value_nth,
+                    envoy_dynamic_module_http_set_response_header>;
+using RequestBodyBuffer = detail::BodyBuffer<detail::RequestBodyBufferFunctions>;
+using ResponseBodyBuffer = detail::BodyBuffer<detail::ResponseBodyBufferFunctions>;
+
+/**
+ * A header of a local response. This has the same layout as
+ * envoy_dynamic_module_type_InModuleHeader, so a list of them is passed to Envoy as is.
+ */
+struct Header : envoy_dynamic_module_type_InModuleHeader {
+  Header(std::string_view key, std::string_view value)
+      : envoy_dynamic_module_type_InModuleHeader{detail::toRaw(key), key.size(),
+                                                 detail::toRaw(value), value.size()} {}
+};
+static_assert(sizeof(Header) == sizeof(envoy_dynamic_module_type_InModuleHeader));
+
+/**
+ * The handle of a stream, which can be copied to other threads to continue the stream from there.
+ */
+class StreamHandle {
+public:
+  explicit StreamHandle(envoy_dynamic_module_type_StreamHandle raw) : raw_(raw) {}
+
+  /**
+   * @return false if the stream is already destroyed.
+   */
+  bool continueRequest() const {
+    return envoy_dynamic_module_http_continue_request_by_handle(raw_) != 0;
+  }
+  bool continueResponse() const {
+    return envoy_dynamic_module_http_continue_response_by_handle(raw_) != 0;
+  }
+
+  envoy_dynamic_module_type_StreamHandle raw() const { return raw_; }
+
+private:
+  envoy_dynamic_module_type_StreamHandle raw_;
+};
+
+/**
+ * A reference to a value of the shared data store, released when this is destroyed. The value
+ * stays unchanged while this is alive even if the key is overwritten or expires.
+ */
+class SharedDataValue {
+public:
+  SharedDataValue() = default;
+  SharedDataValue(envoy_dynamic_module_type_SharedDataValuePtr raw, std::string_view value,
+                  uint64_t version)
+      : raw_(raw), value_(value), version_(version) {}
+  SharedDataValue(SharedDataValue&& other) noexcept
+      : raw_(std::exchange(other.raw_, nullptr)), value_(other.value_), version_(other.version_) {}
+  SharedDataValue& operator=(SharedDataValue&& other) noexcept {
+    std::swap(raw_, other.raw_);
+    std::swap(value_, other.value_);
+    std::swap(version_, other.version_);
+    return *this;
+  }
+  ~SharedDataValue() {
+    if (raw_ != nullptr) {
+      envoy_dynamic_module_http_shared_data_release(raw_);
+    }
+  }
+
+  explicit operator bool() const { return raw_ != nullptr; }
+  std::string_view value() const { return value_; }
+  uint64_t version() const { return version_; }
+
+private:
+  envoy_dynamic_module_type_SharedDataValuePtr raw_ = nullptr;
+  std::string_view value_;
+  uint64_t version_ = 0;
+};
+
+/**
+ * The Envoy side of a stream, passed to HttpFilter::newInstance. This can be copied and stored in
+ * the instance, and is valid until the instance is destroyed.
+ */
+class EnvoyFilterInstance {
+public:
+  explicit EnvoyFilterInstance(envoy_dynamic_module_type_EnvoyFilterInstancePtr raw) : raw_(raw) {}
+
+  /**
+   * Continues the request after a stop status was returned from one of the event hooks.
+   */
+  void continueRequest() const { envoy_dynamic_module_http_continue_request(raw_); }
+
+  /**
+   * Continues the response after a stop status was returned from one of the event hooks.
+   */
+  void continueResponse() const { envoy_dynamic_module_http_continue_response(raw_); }
+
+  /**
+   * @return the handle of the stream. This must be called during one of the event hooks.
+   */
+  StreamHandle streamHandle() const {
+    return StreamHandle(envoy_dynamic_module_http_get_stream_handle(raw_));
+  }
+
+  /**
+   * @return the index of the worker thread running the stream.
+   */
+  uint32_t workerIndex() const { return envoy_dynamic_module_http_get_worker_index(raw_); }
+
+  /**
+   * @return the whole buffered request body, which is falsy if the body isn't buffered.
+   */
+  RequestBodyBuffer requestBody() const {
+    return RequestBodyBuffer(envoy_dynamic_module_http_get_request_body_buffer(raw_));
+  }
+
+  /**
+   * @return the whole buffered response body, which is falsy if the body isn't buffered.
+   */
+  ResponseBodyBuffer responseBody() const {
+    return ResponseBodyBuffer(envoy_dynamic_module_http_get_response_body_buffer(raw_));
+  }
+
+  /**
+   * Sends a local response to the client.
+   * @param status_code the HTTP status code.
+   * @param headers the response headers.
+   * @param body the response body.
+   */
+  void sendResponse(uint32_t status_code, std::initializer_list<Header> headers,
+                    std::string_view body = {}) const {
+    envoy_dynamic_module_http_send_response(raw_, status_code, const_cast<Header*>(headers.begin()),
+                                            headers.size(), detail::toRaw(body), body.size());
+  }
+
+  /**
+   * @param key the key in the shared data store.
+   * @return the value of the key, which is falsy if the key doesn't exist or has expired.
+   */
+  SharedDataValue sharedDataGet(std::string_view key) const {
+    void* data = nullptr;
+    size_t length = 0;
+    uint64_t version = 0;
+    envoy_dynamic_module_type_SharedDataValuePtr value = envoy_dynamic_module_http_shared_data_get(
+        raw_, detail::toRaw(key), key.size(), &data, detail::toLengthResult(&length), &version);
+    if (value == nullptr) {
+      return SharedDataValue();
+    }
+    return SharedDataValue(value, detail::toView(data, length), version);
+  }
+
+  /**
+   * Sets the value of the key if its version is expected_version. See
+   * envoy_dynamic_module_http_shared_data_set for the versions.
+   * @return the new version of the key, or 0 if the version didn't match.
+   */
+  uint64_t sharedDataSet(std::string_view key, std::string_view value,
+                         uint64_t expected_version = UINT64_MAX,
+                         uint64_t ttl_milliseconds = 0) const {
+    return envoy_dynamic_module_http_shared_data_set(raw_, detail::toRaw(key), key.size(),
+                                                     detail::toRaw(value), value.size(),
+                                                     expected_version, ttl_milliseconds);
+  }
+
+  envoy_dynamic_module_type_EnvoyFilterInstancePtr raw() const { return raw_; }
+
+private:
+  envoy_dynamic_module_type_EnvoyFilterInstancePtr raw_;
+};
+
+/**
+ * The base of the per-stream instance of a filter. Derived is the class deriving from this, which
+ * hides the event hooks it handles with the same signatures:
+ *
+ *   class MyInstance : public HttpFilterInstance<MyInstance> {
+ *   public:
+ *     RequestHeadersStatus onRequestHeaders(RequestHeaders& headers, bool end_of_stream);
+ *   };
+ *
+ * The hooks are called on Derived directly, so they are not virtual and can be inlined. The hooks
+ * that Derived doesn't declare are detected at compile time, and exported as no-ops shared by all
+ * the filters of the module that return Continue without touching the instance. The instance is
+ * deleted by destroy when the stream is destroyed, so its destructor is the destroy hook. Derived
+ * can hide destroy to defer the deletion, e.g. while the instance is calling into Envoy.
+ */
+template <class Derived> class HttpFilterInstance {
+public:
+  RequestHeadersStatus onRequestHeaders(RequestHeaders&, bool) {
+    return RequestHeadersStatus::Continue;
+  }
+  RequestBodyStatus onRequestBody(RequestBodyBuffer&, bool) { return RequestBodyStatus::Continue; }
+  ResponseHeadersStatus onResponseHeaders(ResponseHeaders&, bool) {
+    return ResponseHeadersStatus::Continue;
+  }
+  ResponseBodyStatus onResponseBody(ResponseBodyBuffer&, bool) {
+    return ResponseBodyStatus::Continue;
+  }
+  void destroy() { delete static_cast<Derived*>(this); }
+
+protected:
+  HttpFilterInstance() = default;
+  ~HttpFilterInstance() = default;
+};
+
+/**
+ * The base of a filter, i.e. the per-config singleton. Derived is the class deriving from this,
+ * and Instance is its HttpFilterInstance. The defaults below construct Derived from the config and
+ * Instance from (Derived&, EnvoyFilterInstance), and Derived can hide either of them:
+ *
+ *   static std::unique_ptr<Derived> create(std::string_view config);
+ *   std::unique_ptr<Instance> newInstance(EnvoyFilterInstance envoy_filter_instance);
+ *
+ * Returning nullptr from either fails the filter config or the stream respectively. Note that the
+ * config is only valid during create.
+ */
+template <class Derived, class Instance> class HttpFilter {
+public:
+  using InstanceType = Instance;
+
+  static std::unique_ptr<Derived> create(std::string_view config) {
+    return std::make_unique<Derived>(config);
+  }
+
+  std::unique_ptr<Instance> newInstance(EnvoyFilterInstance envoy_filter_instance) {
+    return std::make_unique<Instance>(static_cast<Derived&>(*this), envoy_filter_instance);
+  }
+
+protected:
+  HttpFilter() = default;
+  ~HttpFilter() = default;
+};
+
+/**
+ * Which event hooks Instance declares instead of inheriting from HttpFilterInstance. An inherited
+ * hook has the member pointer type of the base.
+ */
+template <class Instance> struct HttpFilterInstanceHooks {
+  static_assert(std::is_base_of_v<HttpFilterInstance<Instance>, Instance>,
+                "the instance must derive from HttpFilterInstance<Instance>");
+  using Base = HttpFilterInstance<Instance>;
+
+  static constexpr bool request_headers =
+      !std::is_same_v<decltype(&Instance::onRequestHeaders), decltype(&Base::onRequestHeaders)>;
+  static constexpr bool request_body =
+      !std::is_same_v<decltype(&Instance::onRequestBody), decltype(&Base::onRequestBody)>;
+  static constexpr bool response_headers =
+      !std::is_same_v<decltype(&Instance::onResponseHeaders), decltype(&Base::onResponseHeaders)>;
+  static constexpr bool response_body =
+      !std::is_same_v<decltype(&Instance::onResponseBody), decltype(&Base::onResponseBody)>;
+};
+
+namespace detail {
+
+inline envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+continueRequestHeaders(envoy_dynamic_module_type_HttpFilterInstancePtr,
+                       envoy_dynamic_module_type_HttpRequestHeadersMapPtr,
+                       envoy_dynamic_module_type_EndOfStream) {
+  return envoy_dynamic_module_type_EventHttpRequestHeadersStatusContinue;
+}
+
+inline envoy_dynamic_module_type_EventHttpRequestBodyStatus
+continueRequestBody(envoy_dynamic_module_type_HttpFilterInstancePtr,
+                    envoy_dynamic_module_type_HttpRequestBodyBufferPtr,
+                    envoy_dynamic_module_type_EndOfStream) {
+  return envoy_dynamic_module_type_EventHttpRequestBodyStatusContinue;
+}
+
+inline envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+continueResponseHeaders(envoy_dynamic_module_type_HttpFilterInstancePtr,
+                        envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
+                        envoy_dynamic_module_type_EndOfStream) {
+  return envoy_dynamic_module_type_EventHttpResponseHeadersStatusContinue;
+}
+
+inline envoy_dynamic_module_type_EventHttpResponseBodyStatus
+continueResponseBody(envoy_dynamic_module_type_HttpFilterInstancePtr,
+                     envoy_dynamic_module_type_HttpResponseBodyBufferPtr,
+                     envoy_dynamic_module_type_EndOfStream) {
+  return envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue;
+}
+
+/**
+ * The event hooks of the module exporting Filter, and the vtable returned by
+ * envoy_dynamic_module_get_http_vtable.
+ */
+template <class Filter> struct HttpModule {
+  using Instance = typename decltype(std::declval<Filter&>().newInstance(
+      std::declval<EnvoyFilterInstance>()))::element_type;
+  using Hooks = HttpFilterInstanceHooks<Instance>;
+
+  static envoy_dynamic_module_type_HttpFilterPtr
+  onHttpFilterInit(envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+                   envoy_dynamic_module_type_HttpFilterConfigSize config_size) {
+    return Filter::create(toView(config_ptr, config_size)).release();
+  }
+
+  static void onHttpFilterDestroy(envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {
+    delete static_cast<Filter*>(http_filter_ptr);
+  }
+
+  static envoy_dynamic_module_type_HttpFilterInstancePtr
+  onHttpFilterInstanceInit(
+      envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+      envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {
+    return static_cast<Filter*>(http_filter_ptr)
+        ->newInstance(EnvoyFilterInstance(envoy_filter_instance_ptr))
+        .release();
+  }
+
+  static envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+  onRequestHeaders(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                   envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+                   envoy_dynamic_module_type_EndOfStream end_of_stream) {
+    RequestHeaders headers(request_headers_ptr);
+    return static_cast<envoy_dynamic_module_type_EventHttpRequestHeadersStatus>(
+        static_cast<Instance*>(http_filter_instance_ptr)
+            ->onRequestHeaders(headers, end_of_stream != 0));
+  }
+
+  static envoy_dynamic_module_type_EventHttpRequestBodyStatus
+  onRequestBody(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer_ptr,
+                envoy_dynamic_module_type_EndOfStream end_of_stream) {
+    RequestBodyBuffer buffer(buffer_ptr);
+    return static_cast<envoy_dynamic_module_type_EventHttpRequestBodyStatus>(
+        static_cast<Instance*>(http_filter_instance_ptr)
+            ->onRequestBody(buffer, end_of_stream != 0));
+  }
+
+  static envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+  onResponseHeaders(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_ptr,
+                    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+    ResponseHeaders headers(response_headers_ptr);
+    return static_cast<envoy_dynamic_module_type_EventHttpResponseHeadersStatus>(
+        static_cast<Instance*>(http_filter_instance_ptr)
+            ->onResponseHeaders(headers, end_of_stream != 0));
+  }
+
+  static envoy_dynamic_module_type_EventHttpResponseBodyStatus
+  onResponseBody(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                 envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer_ptr,
+                 envoy_dynamic_module_type_EndOfStream end_of_stream) {
+    ResponseBodyBuffer buffer(buffer_ptr);
+    return static_cast<envoy_dynamic_module_type_EventHttpResponseBodyStatus>(
+        static_cast<Instance*>(http_filter_instance_ptr)
+            ->onResponseBody(buffer, end_of_stream != 0));
+  }
+
+  static void onHttpFilterInstanceDestroy(
+      envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr) {
+    static_cast<Instance*>(http_filter_instance_ptr)->destroy();
+  }
+
+  static constexpr envoy_dynamic_module_type_HttpVtable vtable = {
+      ENVOY_DYNAMIC_MODULE_HTTP_VTABLE_VERSION,
+      0,
+      onHttpFilterInit,
+      onHttpFilterDestroy,
+      onHttpFilterInstanceInit,
+      Hooks::request_headers ? onRequestHeaders : continueRequestHeaders,
+      Hooks::request_body ? onRequestBody : continueRequestBody,
+      Hooks::response_headers ? onResponseHeaders : continueResponseHeaders,
+      Hooks::response_body ? onResponseBody : continueResponseBody,
+      onHttpFilterInstanceDestroy,
+  };
+};
+
+} // namespace detail
+} // namespace envoy_dynamic_modules
+
+/**
+ * Exports FilterType, a class deriving from envoy_dynamic_modules::HttpFilter, as the http filter
+ * of the module. This must be used exactly once in the module, at the global scope.
+ *
+ * The event hooks are exported through envoy_dynamic_module_get_http_vtable rather than as
+ * individual symbols, so they are resolved with a single lookup and calls into the module don't
+ * go through the PLT.
+ */
+#define ENVOY_DYNAMIC_MODULE_HTTP_FILTER(FilterType)                                               \
+  size_t envoy_dynamic_module_on_program_init() { return 0; }                                      \
+  const envoy_dynamic_module_type_HttpVtable* envoy_dynamic_module_get_http_vtable() {             \
+    return &::envoy_dynamic_modules::detail::HttpModule<FilterType>::vtable;                       \
+  }
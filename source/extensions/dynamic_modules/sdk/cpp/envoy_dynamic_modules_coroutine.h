@@ -0,0 +1,846 @@
+#pragma once
+
+#include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <initializer_list>
+#include <new>
+#include <optional>
+#include <string_view>
+#include <utility>
+
+#include "envoy_dynamic_modules.h"
+
+// A coroutine layer over envoy_dynamic_modules.h, which requires C++20. Instead of returning stop
+// statuses from the event hooks and continuing the stream later, a filter is written as one task
+// per direction that awaits the events of the stream:
+//
+//   class MyHandler {
+//   public:
+//     MyHandler(MyFilter& filter, EnvoyFilterInstance envoy_filter_instance);
+//
+//     Task<> onRequest(RequestStream& request) {
+//       co_await request.sleep(std::chrono::milliseconds(100));
+//       request.headers().set("x-delayed", "true");
+//       for (;;) {
+//         auto frame = co_await request.nextFrame();
+//         // ...
+//         if (frame.end_of_stream) {
+//           co_return;
+//         }
+//       }
+//     }
+//   };
+//
+//   class MyFilter : public HttpFilter<MyFilter, CoroutineFilterInstance<MyHandler>> { ... };
+//
+// The tasks run on the worker thread of the stream, and are resumed by the event hooks, the timers
+// and the callouts of the stream without any thread of their own. The coroutine frames are
+// allocated from an arena owned by the stream, and are destroyed when the stream is destroyed,
+// together with the arena, even if the tasks are suspended.
+
+namespace envoy_dynamic_modules {
+
+/**
+ * The allocator of the coroutine frames of a stream. The frames are carved out of the storage
+ * given to the constructor, and then out of chunks allocated as needed, which are all freed when
+ * the arena is destroyed. A freed frame is reused for a later frame of the same size or smaller,
+ * so a task awaiting the same coroutine in a loop doesn't grow the arena.
+ *
+ * A stream makes its arena current while it creates or resumes its task, so the frames of the
+ * coroutines the task calls come from the same arena without taking it as a parameter.
+ */
+class Arena {
+public:
+  static constexpr size_t Alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+  static constexpr size_t ChunkSize = 4096;
+
+  /**
+   * @param storage the initial storage, which must be aligned to Alignment and outlive the arena.
+   * @param size the size of the storage.
+   */
+  Arena(std::byte* storage, size_t size) : cursor_(storage), end_(storage + size) {}
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+  ~Arena() {
+    while (chunks_ != nullptr) {
+      Chunk* next = chunks_->next;
+      ::operator delete(chunks_);
+      chunks_ = next;
+    }
+  }
+
+  void* allocate(size_t size) {
+    size = (size + Alignment - 1) & ~(Alignment - 1);
+    for (Block** block = &free_; *block != nullptr; block = &(*block)->next) {
+      if ((*block)->capacity >= size) {
+        Block* reused = *block;
+        *block = reused->next;
+        return reused + 1;
+      }
+    }
+    const size_t needed = sizeof(Block) + size;
+    if (static_cast<size_t>(end_ - cursor_) < needed) {
+      grow(needed);
+    }
+    Block* block = new (cursor_) Block{this, size, nullptr};
+    cursor_ += needed;
+    return block + 1;
+  }
+
+  /**
+   * Returns the memory returned by allocate or allocateCurrent to where it came from.
+   */
+  static void deallocate(void* ptr) {
+    Block* block = static_cast<Block*>(ptr) - 1;
+    if (block->arena == nullptr) {
+      ::operator delete(block);
+      return;
+    }
+    block->next = block->arena->free_;
+    block->arena->free_ = block;
+  }
+
+  /**
+   * Makes the arena current on this thread for the lifetime of the scope.
+   */
+  class Scope {
+  public:
+    explicit Scope(Arena& arena) : previous_(std::exchange(current_, &arena)) {}
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    ~Scope() { current_ = previous_; }
+
+  private:
+    Arena* const previous_;
+  };
+
+  /**
+   * Allocates from the current arena, or from the heap outside of any Scope.
+   */
+  static void* allocateCurrent(size_t size) {
+    if (current_ != nullptr) {
+      return current_->allocate(size);
+    }
+    Block* block = new (::operator new(sizeof(Block) + size)) Block{nullptr, size, nullptr};
+    return block + 1;
+  }
+
+private:
+  struct alignas(Alignment) Block {
+    Arena* arena;
+    size_t capacity;
+    Block* next;
+  };
+
+  struct alignas(Alignment) Chunk {
+    Chunk* next;
+  };
+
+  void grow(size_t needed) {
+    const size_t size = sizeof(Chunk) + (needed > ChunkSize ? needed : ChunkSize);
+    chunks_ = new (::operator new(size)) Chunk{chunks_};
+    cursor_ = reinterpret_cast<std::byte*>(chunks_ + 1);
+    end_ = reinterpret_cast<std::byte*>(chunks_) + size;
+  }
+
+  static inline thread_local Arena* current_ = nullptr;
+
+  std::byte* cursor_;
+  std::byte* end_;
+  Block* free_ = nullptr;
+  Chunk* chunks_ = nullptr;
+};
+
+template <class T = void> class Task;
+
+namespace detail {
+
+class StreamBase;
+
+class TaskPromiseBase {
+public:
+  // The frames are allocated from the arena of the stream running the task.
+  static void* operator new(size_t size) { return Arena::allocateCurrent(size); }
+  static void operator delete(void* ptr) { Arena::deallocate(ptr); }
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+      std::coroutine_handle<> continuation = handle.promise().continuation_;
+      return continuation ? continuation : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  // Tasks are started by the stream or by the task awaiting them.
+  std::suspend_always initial_suspend() noexcept { return {}; }
+  FinalAwaiter final_suspend() noexcept { return {}; }
+  // Modules are usually built without exceptions, and there is nobody to rethrow them to.
+  void unhandled_exception() noexcept { std::terminate(); }
+
+  // The coroutine awaiting this task, which is resumed when it finishes.
+  std::coroutine_handle<> continuation_;
+};
+
+template <class T> class TaskPromise : public TaskPromiseBase {
+public:
+  Task<T> get_return_object() noexcept;
+  template <class U> void return_value(U&& value) { value_.emplace(std::forward<U>(value)); }
+  T result() { return std::move(*value_); }
+
+private:
+  std::optional<T> value_;
+};
+
+template <> class TaskPromise<void> : public TaskPromiseBase {
+public:
+  Task<void> get_return_object() noexcept;
+  void return_void() noexcept {}
+  void result() noexcept {}
+};
+
+} // namespace detail
+
+/**
+ * A coroutine running on the worker thread of a stream, which returns T. A task starts when it is
+ * awaited by another task, or when it is returned from CoroutineFilterInstance's handler, and its
+ * frame is freed when the Task is destroyed.
+ */
+template <class T> class [[nodiscard]] Task {
+public:
+  using promise_type = detail::TaskPromise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() = default;
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    std::swap(handle_, other.handle_);
+    return *this;
+  }
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  bool done() const { return !handle_ || handle_.done(); }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+    handle_.promise().continuation_ = awaiting;
+    return handle_;
+  }
+  T await_resume() { return handle_.promise().result(); }
+
+private:
+  friend promise_type;
+  friend class detail::StreamBase;
+  explicit Task(Handle handle) : handle_(handle) {}
+
+  Handle handle_;
+};
+
+template <class T> Task<T> detail::TaskPromise<T>::get_return_object() noexcept {
+  return Task<T>(Task<T>::Handle::from_promise(*this));
+}
+
+inline Task<void> detail::TaskPromise<void>::get_return_object() noexcept {
+  return Task<void>(Task<void>::Handle::from_promise(*this));
+}
+
+/**
+ * The response to RequestStream::callout or ResponseStream::callout. Both are falsy if the callout
+ * failed. They are only valid until the next co_await.
+ */
+struct CalloutResponse {
+  ResponseHeaders headers;
+  ResponseBodyBuffer body;
+
+  explicit operator bool() const { return headers.raw() != nullptr; }
+};
+
+/**
+ * A body frame returned by RequestStream::nextFrame or ResponseStream::nextFrame, which is only
+ * valid until the next co_await.
+ */
+template <class BodyBuffer> struct BodyFrame {
+  // The frame, which is falsy if the stream ended without more data.
+  BodyBuffer buffer;
+  // Where the new data starts in buffer. This is non-zero when the data arrived while the task was
+  // awaiting something else, in which case buffer is the body buffered in the meantime and might
+  // start with the data of the frames the task has already seen.
+  size_t offset;
+  // Whether this is the last frame of the stream.
+  bool end_of_stream;
+};
+
+namespace detail {
+
+// The functions of the request or the response direction.
+struct StreamFunctions {
+  void* (*buffered_body)(void*);
+  size_t (*body_length)(void*);
+  void (*continue_stream)(void*);
+};
+
+inline constexpr StreamFunctions RequestStreamFunctions = {
+    envoy_dynamic_module_http_get_request_body_buffer,
+    envoy_dynamic_module_http_get_request_body_buffer_length,
+    envoy_dynamic_module_http_continue_request,
+};
+
+inline constexpr StreamFunctions ResponseStreamFunctions = {
+    envoy_dynamic_module_http_get_response_body_buffer,
+    envoy_dynamic_module_http_get_response_body_buffer_length,
+    envoy_dynamic_module_http_continue_response,
+};
+
+/**
+ * Defers the deletion of a CoroutineFilterInstance while one of its tasks runs. A task can end the
+ * stream, e.g. by sending a local reply, and then Envoy destroys the instance from inside the task,
+ * which would otherwise destroy the running coroutine along with the stream resuming it.
+ */
+class Lifetime {
+public:
+  Lifetime(void* instance, void (*deleter)(void*)) : instance_(instance), deleter_(deleter) {}
+
+  /**
+   * Marks a task of the instance as running for the lifetime of this object, which deletes the
+   * instance on the way out if it was destroyed in the meantime.
+   */
+  class Running {
+  public:
+    explicit Running(Lifetime& lifetime) : lifetime_(lifetime) { lifetime_.running_++; }
+    ~Running() {
+      if (--lifetime_.running_ == 0 && lifetime_.destroyed_) {
+        lifetime_.deleter_(lifetime_.instance_);
+      }
+    }
+    Running(const Running&) = delete;
+    Running& operator=(const Running&) = delete;
+
+  private:
+    Lifetime& lifetime_;
+  };
+
+  // Deletes the instance, or defers it until no task is running.
+  void destroy() {
+    if (running_ > 0) {
+      destroyed_ = true;
+    } else {
+      deleter_(instance_);
+    }
+  }
+
+  // Whether the instance was destroyed while a task was running, in which case nothing but the
+  // destructor of Running may touch it.
+  bool destroyed() const { return destroyed_; }
+
+private:
+  void* const instance_;
+  void (*const deleter_)(void*);
+  size_t running_ = 0;
+  bool destroyed_ = false;
+};
+
+/**
+ * The state of one direction of a stream, and the task handling it. Only one coroutine of the task
+ * is suspended at a time, so the awaiters keep their state here instead of allocating it.
+ *
+ * While the task is suspended on anything but the next frame, the hooks return a stop status, and
+ * Envoy buffers the frames. The direction is continued once the task finishes or awaits the next
+ * frame again.
+ */
+class StreamBase {
+public:
+  StreamBase(const StreamBase&) = delete;
+  StreamBase& operator=(const StreamBase&) = delete;
+
+  EnvoyFilterInstance envoyFilterInstance() const { return envoy_filter_instance_; }
+
+  /**
+   * @return whether Envoy has received the end of the stream in this direction.
+   */
+  bool ended() const { return end_of_stream_; }
+
+  struct SleepAwaiter {
+    bool await_ready() const noexcept { return duration.count() <= 0; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      if (!stream.ensureTimer()) {
+        return false;
+      }
+      stream.suspend(Wait::Async, handle);
+      envoy_dynamic_module_http_enable_timer(stream.timer_, duration.count());
+      return true;
+    }
+    void await_resume() noexcept { stream.waiting_ = Wait::None; }
+
+    StreamBase& stream;
+    std::chrono::milliseconds duration;
+  };
+
+  /**
+   * Suspends the task for the duration, which is returned right away if the duration is not
+   * positive or the stream has no timer, e.g. in a test without the decoder callbacks.
+   */
+  SleepAwaiter sleep(std::chrono::milliseconds duration) { return SleepAwaiter{*this, duration}; }
+
+  struct CalloutAwaiter {
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+      stream.suspend(Wait::Async, handle);
+      stream.callout_done_ = false;
+      stream.sending_ = true;
+      const size_t sent = envoy_dynamic_module_http_send_callout(
+          stream.envoy_filter_instance_.raw(), detail::toRaw(cluster), cluster.size(),
+          const_cast<Header*>(headers.begin()), headers.size(), detail::toRaw(body), body.size(),
+          timeout.count(), onCalloutDone, &stream);
+      stream.sending_ = false;
+      if (sent == 0) {
+        stream.callout_headers_ = nullptr;
+        stream.callout_body_ = nullptr;
+        stream.callout_done_ = true;
+      }
+      // The response might have been received before send_callout returned.
+      return !stream.callout_done_;
+    }
+    CalloutResponse await_resume() noexcept {
+      stream.waiting_ = Wait::None;
+      return CalloutResponse{ResponseHeaders(stream.callout_headers_),
+                             ResponseBodyBuffer(stream.callout_body_)};
+    }
+
+    StreamBase& stream;
+    std::string_view cluster;
+    std::initializer_list<Header> headers;
+    std::string_view body;
+    std::chrono::milliseconds timeout;
+  };
+
+  /**
+   * Sends an HTTP request to the cluster, and suspends the task until the response is received.
+   * See envoy_dynamic_module_http_send_callout for the arguments. GCC 12 doesn't compile a braced
+   * list of headers in a co_await expression, so declare the std::initializer_list before it.
+   */
+  CalloutAwaiter callout(std::string_view cluster, std::initializer_list<Header> headers,
+                         std::string_view body = {},
+                         std::chrono::milliseconds timeout = std::chrono::milliseconds(0)) {
+    return CalloutAwaiter{*this, cluster, headers, body, timeout};
+  }
+
+protected:
+  // What the task is suspended on.
+  enum class Wait {
+    None,
+    Frame,
+    EndOfStream,
+    // A timer or a callout.
+    Async,
+    // The end of the stream, which was received while the body was buffered, so the task is
+    // resumed on the next iteration of the worker with the whole buffered body.
+    Post,
+  };
+
+  StreamBase(Arena& arena, Lifetime& lifetime, EnvoyFilterInstance envoy_filter_instance,
+             const StreamFunctions& functions)
+      : arena_(arena), lifetime_(lifetime), envoy_filter_instance_(envoy_filter_instance),
+        functions_(functions) {}
+  ~StreamBase() = default;
+
+  /**
+   * Starts the task on the headers.
+   * @return whether the headers should continue.
+   */
+  template <class Start> bool onHeaders(bool end_of_stream, Start start) {
+    Lifetime::Running running(lifetime_);
+    end_of_stream_ = end_of_stream;
+    {
+      Arena::Scope scope(arena_);
+      task_ = start();
+    }
+    waiter_ = task_.handle_;
+    resume();
+    if (lifetime_.destroyed()) {
+      return false;
+    }
+    stopped_ = !proceeds();
+    return !stopped_;
+  }
+
+  /**
+   * Passes a body frame to the task if it is awaiting it.
+   * @return whether the frame should continue. Otherwise, Envoy buffers it.
+   */
+  bool onBody(void* frame, bool end_of_stream) {
+    Lifetime::Running running(lifetime_);
+    end_of_stream_ = end_of_stream_ || end_of_stream;
+    if (task_.done()) {
+      return true;
+    }
+    bool seen = false;
+    if (waiting_ == Wait::Frame) {
+      frame_ = frame;
+      frame_offset_ = 0;
+      frame_end_of_stream_ = end_of_stream;
+      seen = true;
+      resume();
+    } else if (waiting_ == Wait::EndOfStream && end_of_stream) {
+      void* buffered = functions_.buffered_body(envoy_filter_instance_.raw());
+      if (buffered == nullptr || functions_.body_length(buffered) == 0) {
+        // The frame is the whole body.
+        body_ = frame;
+        seen = true;
+        resume();
+      } else if (ensureTimer()) {
+        // The frame is appended to the buffered body once this returns.
+        waiting_ = Wait::Post;
+        envoy_dynamic_module_http_enable_timer(timer_, 0);
+      }
+    }
+    if (lifetime_.destroyed()) {
+      return false;
+    }
+    stopped_ = !proceeds();
+    if (!stopped_) {
+      // Envoy sends the buffered body along with the frame.
+      seen_ = 0;
+      unseen_ = false;
+    } else if (seen) {
+      seen_ += functions_.body_length(frame);
+    } else {
+      unseen_ = true;
+    }
+    return !stopped_;
+  }
+
+private:
+  template <class Traits> friend class StreamAwaiters;
+
+  // Whether the event the task is done with can continue.
+  bool proceeds() const { return task_.done() || waiting_ == Wait::Frame; }
+
+  void suspend(Wait wait, std::coroutine_handle<> handle) {
+    waiting_ = wait;
+    waiter_ = handle;
+  }
+
+  void resume() {
+    Arena::Scope scope(arena_);
+    std::coroutine_handle<> waiter = std::exchange(waiter_, nullptr);
+    waiter.resume();
+  }
+
+  // Resumes the task from a timer or a callout, and continues the direction if the task is done
+  // with the events stopped before.
+  void wake() {
+    Lifetime::Running running(lifetime_);
+    resume();
+    if (lifetime_.destroyed()) {
+      return;
+    }
+    if (stopped_ && proceeds()) {
+      stopped_ = false;
+      seen_ = 0;
+      unseen_ = false;
+      functions_.continue_stream(envoy_filter_instance_.raw());
+    }
+  }
+
+  // Takes the whole buffered body for the task, which has seen all of it afterwards.
+  void* takeBufferedBody() {
+    void* buffered = functions_.buffered_body(envoy_filter_instance_.raw());
+    seen_ = buffered == nullptr ? 0 : functions_.body_length(buffered);
+    unseen_ = false;
+    return buffered;
+  }
+
+  bool ensureTimer() {
+    if (timer_ == nullptr) {
+      timer_ = envoy_dynamic_module_http_create_timer(envoy_filter_instance_.raw(), onTimer, this);
+    }
+    return timer_ != nullptr;
+  }
+
+  static void onTimer(envoy_dynamic_module_type_HttpFilterInstancePtr, void* context) {
+    StreamBase& stream = *static_cast<StreamBase*>(context);
+    if (stream.waiting_ == Wait::Post) {
+      stream.body_ = stream.takeBufferedBody();
+    } else if (stream.waiting_ != Wait::Async) {
+      return;
+    }
+    stream.wake();
+  }
+
+  static void onCalloutDone(envoy_dynamic_module_type_HttpFilterInstancePtr, void* context,
+                            envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers,
+                            envoy_dynamic_module_type_HttpResponseBodyBufferPtr response_body) {
+    StreamBase& stream = *static_cast<StreamBase*>(context);
+    stream.callout_headers_ = response_headers;
+    stream.callout_body_ = response_body;
+    stream.callout_done_ = true;
+    if (!stream.sending_) {
+      stream.wake();
+    }
+  }
+
+  Arena& arena_;
+  Lifetime& lifetime_;
+  const EnvoyFilterInstance envoy_filter_instance_;
+  const StreamFunctions& functions_;
+  Task<> task_;
+  // The innermost coroutine of the task, which is suspended on waiting_.
+  std::coroutine_handle<> waiter_;
+  Wait waiting_ = Wait::None;
+  bool end_of_stream_ = false;
+  // Whether the last hook returned a stop status, and the direction has to be continued.
+  bool stopped_ = false;
+  // Whether Envoy has buffered frames the task hasn't seen, and how many bytes at the start of the
+  // buffered body the task has seen.
+  bool unseen_ = false;
+  size_t seen_ = 0;
+  void* frame_ = nullptr;
+  size_t frame_offset_ = 0;
+  bool frame_end_of_stream_ = false;
+  void* body_ = nullptr;
+  envoy_dynamic_module_type_TimerPtr timer_ = nullptr;
+  void* callout_headers_ = nullptr;
+  void* callout_body_ = nullptr;
+  bool callout_done_ = false;
+  bool sending_ = false;
+};
+
+/**
+ * The awaiters of the body, which are typed by the direction.
+ */
+template <class Traits> class StreamAwaiters : public StreamBase {
+public:
+  using Headers = typename Traits::Headers;
+  using BodyBuffer = typename Traits::BodyBuffer;
+  using Frame = BodyFrame<BodyBuffer>;
+
+  /**
+   * @return the headers of the direction, which are valid until the stream is destroyed. Note that
+   * the changes after the headers have continued have no effect.
+   */
+  Headers& headers() { return *headers_view_; }
+
+  struct FrameAwaiter {
+    bool await_ready() const noexcept {
+      StreamAwaiters& s = stream;
+      if (s.unseen_) {
+        s.frame_offset_ = s.seen_;
+        s.frame_ = s.takeBufferedBody();
+        s.frame_end_of_stream_ = s.end_of_stream_;
+        return true;
+      }
+      if (s.end_of_stream_) {
+        s.frame_ = nullptr;
+        s.frame_offset_ = 0;
+        s.frame_end_of_stream_ = true;
+        return true;
+      }
+      return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+      stream.suspend(Wait::Frame, handle);
+    }
+    Frame await_resume() noexcept {
+      stream.waiting_ = Wait::None;
+      return Frame{BodyBuffer(stream.frame_), stream.frame_offset_, stream.frame_end_of_stream_};
+    }
+
+    StreamAwaiters& stream;
+  };
+
+  /**
+   * Suspends the task until the next body frame. The frames the task doesn't stop at, i.e. it
+   * awaits the next frame or finishes right away, continue along with the changes made to them.
+   */
+  FrameAwaiter nextFrame() { return FrameAwaiter{*this}; }
+
+  struct EndOfStreamAwaiter {
+    bool await_ready() const noexcept {
+      if (stream.end_of_stream_) {
+        stream.body_ = stream.takeBufferedBody();
+        return true;
+      }
+      return false;
+    }
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+      stream.suspend(Wait::EndOfStream, handle);
+    }
+    BodyBuffer await_resume() noexcept {
+      stream.waiting_ = Wait::None;
+      return BodyBuffer(stream.body_);
+    }
+
+    StreamAwaiters& stream;
+  };
+
+  /**
+   * Suspends the task until the end of the stream, buffering the body in the meantime.
+   * @return the whole body, except for the frames that have already continued. This is falsy if
+   * there is no such body, and only valid until the next co_await.
+   */
+  EndOfStreamAwaiter endOfStream() { return EndOfStreamAwaiter{*this}; }
+
+protected:
+  StreamAwaiters(Arena& arena, Lifetime& lifetime, EnvoyFilterInstance envoy_filter_instance)
+      : StreamBase(arena, lifetime, envoy_filter_instance, Traits::Functions) {}
+
+  std::optional<Headers> headers_view_;
+};
+
+struct RequestTraits {
+  using Headers = RequestHeaders;
+  using BodyBuffer = RequestBodyBuffer;
+  static constexpr const StreamFunctions& Functions = RequestStreamFunctions;
+};
+
+struct ResponseTraits {
+  using Headers = ResponseHeaders;
+  using BodyBuffer = ResponseBodyBuffer;
+  static constexpr const StreamFunctions& Functions = ResponseStreamFunctions;
+};
+
+} // namespace detail
+
+template <class Handler, size_t ArenaSize> class CoroutineFilterInstance;
+
+/**
+ * The request direction of a stream, passed to the onRequest task of the handler.
+ */
+class RequestStream : public detail::StreamAwaiters<detail::RequestTraits> {
+private:
+  template <class Handler, size_t ArenaSize> friend class CoroutineFilterInstance;
+
+  RequestStream(Arena& arena, detail::Lifetime& lifetime,
+                EnvoyFilterInstance envoy_filter_instance)
+      : StreamAwaiters(arena, lifetime, envoy_filter_instance) {}
+
+  template <class Start>
+  RequestHeadersStatus onRequestHeaders(RequestHeaders& headers, bool end_of_stream, Start start) {
+    headers_view_.emplace(headers.raw());
+    return onHeaders(end_of_stream, start) ? RequestHeadersStatus::Continue
+                                           : RequestHeadersStatus::StopIteration;
+  }
+
+  RequestBodyStatus onRequestBody(RequestBodyBuffer& frame, bool end_of_stream) {
+    return onBody(frame.raw(), end_of_stream) ? RequestBodyStatus::Continue
+                                              : RequestBodyStatus::StopIterationAndBuffer;
+  }
+};
+
+/**
+ * The response direction of a stream, passed to the onResponse task of the handler.
+ */
+class ResponseStream : public detail::StreamAwaiters<detail::ResponseTraits> {
+private:
+  template <class Handler, size_t ArenaSize> friend class CoroutineFilterInstance;
+
+  ResponseStream(Arena& arena, detail::Lifetime& lifetime,
+                 EnvoyFilterInstance envoy_filter_instance)
+      : StreamAwaiters(arena, lifetime, envoy_filter_instance) {}
+
+  template <class Start>
+  ResponseHeadersStatus onResponseHeaders(ResponseHeaders& headers, bool end_of_stream,
+                                          Start start) {
+    headers_view_.emplace(headers.raw());
+    return onHeaders(end_of_stream, start) ? ResponseHeadersStatus::Continue
+                                           : ResponseHeadersStatus::StopIteration;
+  }
+
+  ResponseBodyStatus onResponseBody(ResponseBodyBuffer& frame, bool end_of_stream) {
+    return onBody(frame.raw(), end_of_stream) ? ResponseBodyStatus::Continue
+                                              : ResponseBodyStatus::StopIterationAndBuffer;
+  }
+};
+
+/**
+ * The HttpFilterInstance running the tasks of Handler, which is constructed from the filter and
+ * the EnvoyFilterInstance and declares either or both of:
+ *
+ *   Task<> onRequest(RequestStream& request);
+ *   Task<> onResponse(ResponseStream& response);
+ *
+ * These are called on the request and the response headers respectively, and the direction
+ * without a task continues without stopping. The first ArenaSize bytes of the frames are allocated
+ * in this instance, so most streams don't allocate anything else for them.
+ *
+ * The tasks, and then the handler, are destroyed when the stream is destroyed. Envoy cancels the
+ * timers and the callouts of the stream before that, so a suspended task is never resumed again.
+ * If a running task ends the stream, e.g. with EnvoyFilterInstance::sendResponse, they are only
+ * destroyed once the task suspends or returns, which it should do right away.
+ */
+template <class Handler, size_t ArenaSize = 1024>
+class CoroutineFilterInstance
+    : public HttpFilterInstance<CoroutineFilterInstance<Handler, ArenaSize>> {
+public:
+  template <class Filter>
+  CoroutineFilterInstance(Filter& filter, EnvoyFilterInstance envoy_filter_instance)
+      : arena_(storage_, ArenaSize),
+        lifetime_(this, [](void* self) { delete static_cast<CoroutineFilterInstance*>(self); }),
+        handler_(filter, envoy_filter_instance), request_(arena_, lifetime_, envoy_filter_instance),
+        response_(arena_, lifetime_, envoy_filter_instance) {}
+
+  RequestHeadersStatus onRequestHeaders(RequestHeaders& headers, bool end_of_stream) {
+    if constexpr (HasOnRequest) {
+      return request_.onRequestHeaders(headers, end_of_stream,
+                                       [this] { return handler_.onRequest(request_); });
+    } else {
+      return RequestHeadersStatus::Continue;
+    }
+  }
+
+  RequestBodyStatus onRequestBody(RequestBodyBuffer& frame, bool end_of_stream) {
+    if constexpr (HasOnRequest) {
+      return request_.onRequestBody(frame, end_of_stream);
+    } else {
+      return RequestBodyStatus::Continue;
+    }
+  }
+
+  ResponseHeadersStatus onResponseHeaders(ResponseHeaders& headers, bool end_of_stream) {
+    if constexpr (HasOnResponse) {
+      return response_.onResponseHeaders(headers, end_of_stream,
+                                         [this] { return handler_.onResponse(response_); });
+    } else {
+      return ResponseHeadersStatus::Continue;
+    }
+  }
+
+  ResponseBodyStatus onResponseBody(ResponseBodyBuffer& frame, bool end_of_stream) {
+    if constexpr (HasOnResponse) {
+      return response_.onResponseBody(frame, end_of_stream);
+    } else {
+      return ResponseBodyStatus::Continue;
+    }
+  }
+
+  Handler& handler() { return handler_; }
+
+  void destroy() { lifetime_.destroy(); }
+
+private:
+  static constexpr bool HasOnRequest = requires(Handler& handler, RequestStream& stream) {
+    { handler.onRequest(stream) } -> std::same_as<Task<>>;
+  };
+  static constexpr bool HasOnResponse = requires(Handler& handler, ResponseStream& stream) {
+    { handler.onResponse(stream) } -> std::same_as<Task<>>;
+  };
+
+  // The members are destroyed in the reverse order, so the frames are destroyed before the handler
+  // they might refer to, and the arena last.
+  alignas(Arena::Alignment) std::byte storage_[ArenaSize];
+  Arena arena_;
+  detail::Lifetime lifetime_;
+  Handler handler_;
+  RequestStream request_;
+  ResponseStream response_;
+};
+
+} // namespace envoy_dynamic_modules
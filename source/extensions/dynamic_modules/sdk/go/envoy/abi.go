@@ -4,6 +4,22 @@ package envoy
 
 /*
 #include "abi.h"
+
+// These take the slices as void* instead of envoy_dynamic_module_type_DataSliceVectorPtr, which is
+// an integer in C, so that cgo sees the Go pointer and the memory stays in place during the call.
+static inline size_t envoy_dynamic_module_go_get_request_body_buffer_slices(
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer, void* result_slices,
+    size_t result_slices_capacity) {
+  return envoy_dynamic_module_http_get_request_body_buffer_slices(
+      buffer, (envoy_dynamic_module_type_DataSliceVectorPtr)result_slices, result_slices_capacity);
+}
+
+static inline size_t envoy_dynamic_module_go_get_response_body_buffer_slices(
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer, void* result_slices,
+    size_t result_slices_capacity) {
+  return envoy_dynamic_module_http_get_response_body_buffer_slices(
+      buffer, (envoy_dynamic_module_type_DataSliceVectorPtr)result_slices, result_slices_capacity);
+}
 */
 import "C"
 import (
@@ -19,6 +35,13 @@ func envoy_dynamic_module_on_program_init() C.size_t {
 	return 0
 }
 
+//export envoy_dynamic_module_on_memory_pressure
+func envoy_dynamic_module_on_memory_pressure(pressure C.double) {
+	if OnMemoryPressure != nil {
+		OnMemoryPressure(float64(pressure))
+	}
+}
+
 //export envoy_dynamic_module_on_http_filter_init
 func envoy_dynamic_module_on_http_filter_init(
 	configPtr C.envoy_dynamic_module_type_HttpFilterConfigPtr,
@@ -29,16 +52,15 @@ func envoy_dynamic_module_on_http_filter_init(
 	copy(configStrCopy, rawStr)
 	// Call the exported function from the Go module.
 	httpFilter := NewHttpFilter(rawStr)
-	pined := memManager.pinHttpFilter(httpFilter)
-	return C.envoy_dynamic_module_type_HttpFilterPtr((uintptr)(unsafe.Pointer(pined)))
+	return C.envoy_dynamic_module_type_HttpFilterPtr(memManager.pinHttpFilter(httpFilter))
 }
 
 //export envoy_dynamic_module_on_http_filter_destroy
 func envoy_dynamic_module_on_http_filter_destroy(
 	httpFilterPtr C.envoy_dynamic_module_type_HttpFilterPtr) {
 	httpFilter := memManager.unwrapPinnedHttpFilter(uintptr(httpFilterPtr))
-	httpFilter.obj.Destroy()
-	memManager.unpinHttpFilter(httpFilter)
+	httpFilter.Destroy()
+	memManager.unpinHttpFilter(uintptr(httpFilterPtr))
 }
 
 //export envoy_dynamic_module_on_http_filter_instance_init
@@ -48,9 +70,9 @@ func envoy_dynamic_module_on_http_filter_instance_init(
 ) C.envoy_dynamic_module_type_HttpFilterInstancePtr {
 	envoyPtr := EnvoyFilterInstance{raw: envoyFilterPtr}
 	httpFilter := memManager.unwrapPinnedHttpFilter(uintptr(httpFilterPtr))
-	httpInstance := httpFilter.obj.NewInstance(envoyPtr)
-	pined := memManager.pinHttpFilterInstance(httpInstance)
-	return C.envoy_dynamic_module_type_HttpFilterInstancePtr(uintptr((unsafe.Pointer(pined))))
+	httpInstance := httpFilter.NewInstance(envoyPtr)
+	pined := memManager.pinHttpFilterInstance(httpInstance, uintptr(envoyFilterPtr))
+	return C.envoy_dynamic_module_type_HttpFilterInstancePtr(pined)
 }
 
 //export envoy_dynamic_module_on_http_filter_instance_request_headers
@@ -62,7 +84,7 @@ func envoy_dynamic_module_on_http_filter_instance_request_headers(
 	httpInstance := unwrapRawPinHttpFilterInstance(uintptr(httpFilterInstancePtr))
 	mapPtr := RequestHeaders{raw: requestHeadersPtr}
 	end := endOfStream != 0
-	result := httpInstance.obj.RequestHeaders(mapPtr, end)
+	result := httpInstance.RequestHeaders(mapPtr, end)
 	return C.envoy_dynamic_module_type_EventHttpRequestHeadersStatus(result)
 }
 
@@ -74,7 +96,7 @@ func envoy_dynamic_module_on_http_filter_instance_request_body(
 	httpInstance := unwrapRawPinHttpFilterInstance(uintptr(httpFilterInstancePtr))
 	buf := RequestBodyBuffer{raw: buffer}
 	end := endOfStream != 0
-	result := httpInstance.obj.RequestBody(buf, end)
+	result := httpInstance.RequestBody(buf, end)
 	return C.envoy_dynamic_module_type_EventHttpRequestBodyStatus(result)
 }
 
@@ -86,7 +108,7 @@ func envoy_dynamic_module_on_http_filter_instance_response_headers(
 	httpInstance := unwrapRawPinHttpFilterInstance(uintptr(httpFilterInstancePtr))
 	mapPtr := ResponseHeaders{raw: responseHeadersMapPtr}
 	end := endOfStream != 0
-	result := httpInstance.obj.ResponseHeaders(mapPtr, end)
+	result := httpInstance.ResponseHeaders(mapPtr, end)
 	return C.envoy_dynamic_module_type_EventHttpResponseHeadersStatus(result)
 }
 
@@ -98,7 +120,7 @@ func envoy_dynamic_module_on_http_filter_instance_response_body(
 	httpInstance := unwrapRawPinHttpFilterInstance(uintptr(httpFilterInstancePtr))
 	buf := ResponseBodyBuffer{raw: buffer}
 	end := endOfStream != 0
-	result := httpInstance.obj.ResponseBody(buf, end)
+	result := httpInstance.ResponseBody(buf, end)
 	return C.envoy_dynamic_module_type_EventHttpResponseBodyStatus(result)
 }
 
@@ -106,8 +128,8 @@ func envoy_dynamic_module_on_http_filter_instance_response_body(
 func envoy_dynamic_module_on_http_filter_instance_destroy(
 	httpFilterInstancePtr C.envoy_dynamic_module_type_HttpFilterInstancePtr) {
 	httpInstance := unwrapRawPinHttpFilterInstance(uintptr(httpFilterInstancePtr))
-	httpInstance.obj.Destroy()
-	memManager.unpinHttpFilterInstance((*pinedHttpFilterInstance)(unsafe.Pointer(uintptr(httpFilterInstancePtr))))
+	httpInstance.Destroy()
+	memManager.unpinHttpFilterInstance(uintptr(httpFilterInstancePtr))
 }
 
 // envoyFilterInstance implements the EnvoyFilterInstance interface in abi_nocgo.go which is not included in the shared library.
@@ -125,6 +147,31 @@ func (c EnvoyFilterInstance) ContinueResponse() {
 	C.envoy_dynamic_module_http_continue_response(c.raw)
 }
 
+// StreamHandle implements EnvoyFilterInstance interface in abi_nocgo.go which is not included in the shared library.
+func (c EnvoyFilterInstance) StreamHandle() StreamHandle {
+	return StreamHandle{raw: C.envoy_dynamic_module_http_get_stream_handle(c.raw)}
+}
+
+// WorkerIndex implements EnvoyFilterInstance interface in abi_nocgo.go which is not included in the shared library.
+func (c EnvoyFilterInstance) WorkerIndex() uint32 {
+	return uint32(C.envoy_dynamic_module_http_get_worker_index(c.raw))
+}
+
+// StreamHandle implements the StreamHandle interface in abi_nocgo.go which is not included in the shared library.
+type StreamHandle struct {
+	raw C.envoy_dynamic_module_type_StreamHandle
+}
+
+// ContinueRequest implements StreamHandle interface in abi_nocgo.go which is not included in the shared library.
+func (h StreamHandle) ContinueRequest() bool {
+	return C.envoy_dynamic_module_http_continue_request_by_handle(h.raw) != 0
+}
+
+// ContinueResponse implements StreamHandle interface in abi_nocgo.go which is not included in the shared library.
+func (h StreamHandle) ContinueResponse() bool {
+	return C.envoy_dynamic_module_http_continue_response_by_handle(h.raw) != 0
+}
+
 // GetRequestBodyBuffer implements EnvoyFilterInstance interface in abi_nocgo.go which is not included in the shared library.
 func (c EnvoyFilterInstance) GetRequestBodyBuffer() RequestBodyBuffer {
 	return RequestBodyBuffer{raw: C.envoy_dynamic_module_http_get_request_body_buffer(c.raw)}
@@ -156,6 +203,21 @@ func (c EnvoyFilterInstance) SendResponse(statusCode int, headers [][2]string, b
 	)
 }
 
+// bodyDataSlices writes the slices of the body buffer to dst up to its length, and returns the total
+// number of the slices. This is used by hotpath.go.
+func bodyDataSlices(body bodyRef, dst []dataSlice) int {
+	// The pointer is passed as is in the call expression, so that it is never held as an integer
+	// while the memory could move.
+	if body.response {
+		return int(C.envoy_dynamic_module_go_get_response_body_buffer_slices(
+			C.envoy_dynamic_module_type_HttpResponseBodyBufferPtr(body.raw),
+			unsafe.Pointer(unsafe.SliceData(dst)), C.size_t(len(dst))))
+	}
+	return int(C.envoy_dynamic_module_go_get_request_body_buffer_slices(
+		C.envoy_dynamic_module_type_HttpRequestBodyBufferPtr(body.raw),
+		unsafe.Pointer(unsafe.SliceData(dst)), C.size_t(len(dst))))
+}
+
 // RequestHeaders implements RequestHeaders interface in abi_nocgo.go which is not included in the shared library.
 type RequestHeaders struct {
 	raw C.envoy_dynamic_module_type_HttpRequestHeadersMapPtr
@@ -340,38 +402,33 @@ func (r RequestBodyBuffer) Length() int {
 	return int(C.envoy_dynamic_module_http_get_request_body_buffer_length(r.raw))
 }
 
-// Slice implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+// Slices implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r RequestBodyBuffer) Slices(iter func(view []byte)) {
-	sliceCount := r.slicesCount()
-	for i := 0; i < sliceCount; i++ {
-		iter(r.sliceAt(i))
-	}
+	forEachBodySlice(r.ref(), iter)
 }
 
-func (r RequestBodyBuffer) slicesCount() int {
-	return int(C.envoy_dynamic_module_http_get_request_body_buffer_slices_count(r.raw))
+func (r RequestBodyBuffer) ref() bodyRef {
+	return bodyRef{raw: uintptr(r.raw), response: false}
 }
 
-func (r RequestBodyBuffer) sliceAt(index int) []byte {
-	var ptr *byte
-	var size int
-	C.envoy_dynamic_module_http_get_request_body_buffer_slice(r.raw,
-		C.size_t(index),
-		C.envoy_dynamic_module_type_DataSliceLengthResult(uintptr(unsafe.Pointer(&ptr))),
-		C.envoy_dynamic_module_type_DataSliceLengthResult(uintptr(unsafe.Pointer(&size))),
-	)
-	return unsafe.Slice(ptr, size)
+// WriteTo implements io.WriterTo, and RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r RequestBodyBuffer) WriteTo(w io.Writer) (int64, error) {
+	return writeBody(r.ref(), w)
+}
+
+// ReadFrom implements io.ReaderFrom, and RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r RequestBodyBuffer) ReadFrom(reader io.Reader) (int64, error) {
+	return readBodyFrom(reader, r.Append)
 }
 
 // Copy implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r RequestBodyBuffer) Copy() []byte {
-	bytes := make([]byte, r.Length())
-	offset := 0
-	r.Slices(func(view []byte) {
-		copy(bytes[offset:], view)
-		offset += len(view)
-	})
-	return bytes
+	return appendBody(r.ref(), make([]byte, 0, r.Length()))
+}
+
+// AppendTo implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r RequestBodyBuffer) AppendTo(dst []byte) []byte {
+	return appendBody(r.ref(), dst)
 }
 
 // ReadAt implements io.ReaderAt, and RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
@@ -385,50 +442,27 @@ func (r RequestBodyBuffer) ReadAt(p []byte, off int64) (n int, err error) {
 		p = p[:diff]
 		err = io.EOF
 	}
-	C.envoy_dynamic_module_http_copy_out_response_body_buffer(
+	if len(p) == 0 {
+		return 0, err
+	}
+	C.envoy_dynamic_module_http_copy_out_request_body_buffer(
 		r.raw, C.size_t(off), C.size_t(len(p)),
 		C.envoy_dynamic_module_type_InModuleBufferPtr(uintptr(unsafe.Pointer(&p[0]))),
 	)
 	return len(p), err
 }
 
-// Reader implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+// NewReader implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r RequestBodyBuffer) NewReader() io.Reader {
-	return &requestBufferReader{buffer: r}
-}
-
-// requestBufferReader implements io.Reader for the RequestBodyBuffer.
-type requestBufferReader struct {
-	buffer             RequestBodyBuffer
-	currentSliceIndex  int
-	currentSliceOffset int
-}
-
-// Read implements io.Reader for the RequestBodyBuffer.
-func (r *requestBufferReader) Read(buf []byte) (int, error) {
-	totalRead := 0
-	slicesCount := r.buffer.slicesCount()
-	// TODO: below obviously can be optimized. But for now, this is fine for the PoC.
-	for totalRead < len(buf) {
-		if r.currentSliceIndex >= slicesCount {
-			return totalRead, io.EOF
-		}
-		currentSlice := r.buffer.sliceAt(r.currentSliceIndex)
-		currentSliceLen := len(currentSlice)
-		if r.currentSliceOffset >= currentSliceLen {
-			r.currentSliceOffset = 0
-			r.currentSliceIndex++
-			continue
-		}
-
-		remaining := len(buf) - totalRead
-		remainingSlice := currentSliceLen - r.currentSliceOffset
-		readSize := min(remaining, remainingSlice)
-		copy(buf[totalRead:totalRead+readSize], currentSlice[r.currentSliceOffset:r.currentSliceOffset+readSize])
-		r.currentSliceOffset += readSize
-		totalRead += readSize
-	}
-	return totalRead, nil
+	reader := &BodyReader{}
+	reader.reset(r.ref())
+	return reader
+}
+
+// ResetReader implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r RequestBodyBuffer) ResetReader(reader *BodyReader) io.Reader {
+	reader.reset(r.ref())
+	return reader
 }
 
 // Length implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
@@ -436,41 +470,36 @@ func (r ResponseBodyBuffer) Length() int {
 	return int(C.envoy_dynamic_module_http_get_response_body_buffer_length(r.raw))
 }
 
-// Slice implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+// Slices implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r ResponseBodyBuffer) Slices(iter func(view []byte)) {
-	sliceCount := r.slicesCount()
-	for i := 0; i < sliceCount; i++ {
-		iter(r.sliceAt(i))
-	}
+	forEachBodySlice(r.ref(), iter)
 }
 
-func (r ResponseBodyBuffer) slicesCount() int {
-	return int(C.envoy_dynamic_module_http_get_response_body_buffer_slices_count(r.raw))
+func (r ResponseBodyBuffer) ref() bodyRef {
+	return bodyRef{raw: uintptr(r.raw), response: true}
 }
 
-func (r ResponseBodyBuffer) sliceAt(index int) []byte {
-	var ptr *byte
-	var size int
-	C.envoy_dynamic_module_http_get_response_body_buffer_slice(r.raw,
-		C.size_t(index),
-		C.envoy_dynamic_module_type_DataSliceLengthResult(uintptr(unsafe.Pointer(&ptr))),
-		C.envoy_dynamic_module_type_DataSliceLengthResult(uintptr(unsafe.Pointer(&size))),
-	)
-	return unsafe.Slice(ptr, size)
+// WriteTo implements io.WriterTo, and ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r ResponseBodyBuffer) WriteTo(w io.Writer) (int64, error) {
+	return writeBody(r.ref(), w)
+}
+
+// ReadFrom implements io.ReaderFrom, and ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r ResponseBodyBuffer) ReadFrom(reader io.Reader) (int64, error) {
+	return readBodyFrom(reader, r.Append)
 }
 
 // Copy implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r ResponseBodyBuffer) Copy() []byte {
-	bytes := make([]byte, r.Length())
-	offset := 0
-	r.Slices(func(view []byte) {
-		copy(bytes[offset:], view)
-		offset += len(view)
-	})
-	return bytes
+	return appendBody(r.ref(), make([]byte, 0, r.Length()))
 }
 
-// ReadAt implements io.ReaderAt, and RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+// AppendTo implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r ResponseBodyBuffer) AppendTo(dst []byte) []byte {
+	return appendBody(r.ref(), dst)
+}
+
+// ReadAt implements io.ReaderAt, and ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r ResponseBodyBuffer) ReadAt(p []byte, off int64) (n int, err error) {
 	length := r.Length()
 	if off >= int64(length) {
@@ -481,6 +510,9 @@ func (r ResponseBodyBuffer) ReadAt(p []byte, off int64) (n int, err error) {
 		p = p[:diff]
 		err = io.EOF
 	}
+	if len(p) == 0 {
+		return 0, err
+	}
 	C.envoy_dynamic_module_http_copy_out_response_body_buffer(
 		r.raw, C.size_t(off), C.size_t(len(p)),
 		C.envoy_dynamic_module_type_InModuleBufferPtr(uintptr(unsafe.Pointer(&p[0]))),
@@ -490,6 +522,9 @@ func (r ResponseBodyBuffer) ReadAt(p []byte, off int64) (n int, err error) {
 
 // Append implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r RequestBodyBuffer) Append(data []byte) {
+	if len(data) == 0 {
+		return
+	}
 	C.envoy_dynamic_module_http_append_request_body_buffer(
 		r.raw,
 		C.envoy_dynamic_module_type_InModuleBufferPtr(uintptr(unsafe.Pointer(&data[0]))),
@@ -500,6 +535,9 @@ func (r RequestBodyBuffer) Append(data []byte) {
 
 // Prepend implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r RequestBodyBuffer) Prepend(data []byte) {
+	if len(data) == 0 {
+		return
+	}
 	C.envoy_dynamic_module_http_prepend_request_body_buffer(
 		r.raw,
 		C.envoy_dynamic_module_type_InModuleBufferPtr(uintptr(unsafe.Pointer(&data[0]))),
@@ -521,6 +559,9 @@ func (r RequestBodyBuffer) Replace(data []byte) {
 
 // Append implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r ResponseBodyBuffer) Append(data []byte) {
+	if len(data) == 0 {
+		return
+	}
 	C.envoy_dynamic_module_http_append_response_body_buffer(
 		r.raw,
 		C.envoy_dynamic_module_type_InModuleBufferPtr(uintptr(unsafe.Pointer(&data[0]))),
@@ -531,6 +572,9 @@ func (r ResponseBodyBuffer) Append(data []byte) {
 
 // Prepend implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r ResponseBodyBuffer) Prepend(data []byte) {
+	if len(data) == 0 {
+		return
+	}
 	C.envoy_dynamic_module_http_prepend_response_body_buffer(
 		r.raw,
 		C.envoy_dynamic_module_type_InModuleBufferPtr(uintptr(unsafe.Pointer(&data[0]))),
@@ -550,43 +594,17 @@ func (r ResponseBodyBuffer) Replace(data []byte) {
 	r.Append(data)
 }
 
-// Reader implements RequestBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+// NewReader implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
 func (r ResponseBodyBuffer) NewReader() io.Reader {
-	return &responseBufferReader{buffer: r}
-}
-
-// responseBufferReader implements io.Reader for the ResponseBodyBuffer.
-type responseBufferReader struct {
-	buffer             ResponseBodyBuffer
-	currentSliceIndex  int
-	currentSliceOffset int
-}
-
-// Read implements io.Reader for the ResponseBodyBuffer.
-func (r *responseBufferReader) Read(buf []byte) (int, error) {
-	totalRead := 0
-	slicesCount := r.buffer.slicesCount()
-	// TODO: below obviously can be optimized. But for now, this is fine for the PoC.
-	for totalRead < len(buf) {
-		if r.currentSliceIndex >= slicesCount {
-			return totalRead, io.EOF
-		}
-		currentSlice := r.buffer.sliceAt(r.currentSliceIndex)
-		currentSliceLen := len(currentSlice)
-		if r.currentSliceOffset >= currentSliceLen {
-			r.currentSliceOffset = 0
-			r.currentSliceIndex++
-			continue
-		}
-
-		remaining := len(buf) - totalRead
-		remainingSlice := currentSliceLen - r.currentSliceOffset
-		readSize := min(remaining, remainingSlice)
-		copy(buf[totalRead:totalRead+readSize], currentSlice[r.currentSliceOffset:r.currentSliceOffset+readSize])
-		r.currentSliceOffset += readSize
-		totalRead += readSize
-	}
-	return totalRead, nil
+	reader := &BodyReader{}
+	reader.reset(r.ref())
+	return reader
+}
+
+// ResetReader implements ResponseBodyBuffer interface in abi_nocgo.go which is not included in the shared library.
+func (r ResponseBodyBuffer) ResetReader(reader *BodyReader) io.Reader {
+	reader.reset(r.ref())
+	return reader
 }
 
 // HeaderValue represents a single header value whose data is owned by the Envoy.
@@ -619,6 +637,21 @@ func (h HeaderValue) Bytes() []byte {
 	return ret
 }
 
+// UnsafeString implements HeaderValue interface in abi_nocgo.go which is not included in the shared library.
+func (h HeaderValue) UnsafeString() string {
+	return unsafeView(h.data, h.size)
+}
+
+// UnsafeBytes implements HeaderValue interface in abi_nocgo.go which is not included in the shared library.
+func (h HeaderValue) UnsafeBytes() []byte {
+	return h.rawBytes()
+}
+
+// AppendTo implements HeaderValue interface in abi_nocgo.go which is not included in the shared library.
+func (h HeaderValue) AppendTo(dst []byte) []byte {
+	return append(dst, h.rawBytes()...)
+}
+
 func (h HeaderValue) rawBytes() []byte {
 	if h.data == nil {
 		return nil
@@ -2,7 +2,11 @@
 
 package envoy
 
-import "io"
+import (
+	"bytes"
+	"io"
+	"unsafe"
+)
 
 // This file is only included when cgo is disabled which is used for testing purposes.
 
@@ -19,6 +23,23 @@ type EnvoyFilterInstance interface {
 	ContinueResponse()
 	// SendResponse is a function that sends the response to the downstream.
 	SendResponse(statusCode int, headers [][2]string, body []byte)
+	// StreamHandle returns the handle of the stream which can be used from other goroutines to
+	// continue the stream. This must be called in one of the HttpFilterInstance methods.
+	StreamHandle() StreamHandle
+	// WorkerIndex returns the index of the Envoy worker thread running the stream, starting from 0.
+	// This can be passed to Executor.Submit so that the work of the streams on the same worker shares
+	// a queue.
+	WorkerIndex() uint32
+}
+
+// StreamHandle refers to a stream from any goroutine, unlike EnvoyFilterInstance which must only be
+// used in the HttpFilterInstance methods. It is safe to use after the stream is destroyed, in which
+// case it has no effect.
+type StreamHandle interface {
+	// ContinueRequest continues the request processing. Returns false if the stream is already destroyed.
+	ContinueRequest() bool
+	// ContinueResponse continues the response processing. Returns false if the stream is already destroyed.
+	ContinueResponse() bool
 }
 
 // RequestHeaders is an opaque object that represents the underlying Envoy Http request headers map.
@@ -59,9 +80,12 @@ type ResponseHeaders interface {
 //
 // This provides a zero-copy view of the HTTP request body buffer.
 //
-// This implements io.ReaderAt interface.
+// This implements io.ReaderAt, io.WriterTo and io.ReaderFrom interfaces. io.Copy to and from the
+// buffer goes through the latter two, which don't need an intermediate buffer to read the body.
 type RequestBodyBuffer interface {
 	io.ReaderAt
+	io.WriterTo
+	io.ReaderFrom
 
 	// Length returns the total number of bytes in the buffer.
 	Length() int
@@ -79,8 +103,15 @@ type RequestBodyBuffer interface {
 	// Replace replaces the buffer with the given data. This doesn't take the ownership of the data.
 	// Therefore, data will be copied to the buffer internally.
 	Replace(data []byte)
-	// NewReader returns an io.Reader for the buffer.
+	// AppendTo appends the bytes in the buffer to dst and returns the extended slice like append.
+	// Unlike Copy, this doesn't allocate if dst has enough capacity, e.g. a buffer from GetScratch.
+	AppendTo(dst []byte) []byte
+	// NewReader returns an io.Reader for the buffer. The reader is a *BodyReader, which also
+	// implements io.WriterTo, io.ReaderAt and io.Seeker.
 	NewReader() io.Reader
+	// ResetReader points the reader to the buffer and returns it as an io.Reader. Unlike NewReader,
+	// this doesn't allocate, so the same reader can be reused across the event hooks.
+	ResetReader(reader *BodyReader) io.Reader
 }
 
 // ResponseBodyBuffer is an opaque object that represents the underlying Envoy Http response body buffer.
@@ -89,9 +120,12 @@ type RequestBodyBuffer interface {
 //
 // This provides a zero-copy view of the HTTP response body buffer.
 //
-// This implements io.ReaderAt interface.
+// This implements io.ReaderAt, io.WriterTo and io.ReaderFrom interfaces. io.Copy to and from the
+// buffer goes through the latter two, which don't need an intermediate buffer to read the body.
 type ResponseBodyBuffer interface {
 	io.ReaderAt
+	io.WriterTo
+	io.ReaderFrom
 
 	// Length returns the total number of bytes in the buffer.
 	Length() int
@@ -109,8 +143,15 @@ type ResponseBodyBuffer interface {
 	// Replace replaces the buffer with the given data. This doesn't take the ownership of the data.
 	// Therefore, data will be copied to the buffer internally.
 	Replace(data []byte)
-	// NewReader returns an io.Reader for the buffer.
+	// AppendTo appends the bytes in the buffer to dst and returns the extended slice like append.
+	// Unlike Copy, this doesn't allocate if dst has enough capacity, e.g. a buffer from GetScratch.
+	AppendTo(dst []byte) []byte
+	// NewReader returns an io.Reader for the buffer. The reader is a *BodyReader, which also
+	// implements io.WriterTo, io.ReaderAt and io.Seeker.
 	NewReader() io.Reader
+	// ResetReader points the reader to the buffer and returns it as an io.Reader. Unlike NewReader,
+	// this doesn't allocate, so the same reader can be reused across the event hooks.
+	ResetReader(reader *BodyReader) io.Reader
 }
 
 // HeaderValue represents a single header value whose data is owned by the Envoy.
@@ -130,8 +171,171 @@ type HeaderValue interface {
 	// Bytes returns the copied data of the header value.
 	Bytes() []byte
 
+	// UnsafeString returns the header value as a string without copying it. The string is only valid
+	// until the event hook returns, so it must not be retained or used from other goroutines.
+	UnsafeString() string
+
+	// UnsafeBytes returns the header value without copying it. The slice is only valid until the
+	// event hook returns, and must not be modified.
+	UnsafeBytes() []byte
+
+	// AppendTo appends the header value to dst and returns the extended slice like append.
+	AppendTo(dst []byte) []byte
+
 	// Equal returns true if the header value is equal to the given string.
 	//
 	// This doesn't copy the data and compares the data directly.
 	Equal(str string) bool
 }
+
+// stubBodies holds the body buffers created by newStubBody. bodyRef.raw is the index in it.
+var stubBodies [][][]byte
+
+// newStubBody creates a body buffer consisting of the slices for testing the helpers in
+// hotpath.go without Envoy.
+func newStubBody(slices ...[]byte) bodyRef {
+	stubBodies = append(stubBodies, slices)
+	return bodyRef{raw: uintptr(len(stubBodies) - 1)}
+}
+
+// stubCrossings counts the calls to bodyDataSlices, which would be the calls into Envoy.
+var stubCrossings int
+
+// bodyDataSlices is the stub of the one in abi.go.
+func bodyDataSlices(body bodyRef, dst []dataSlice) int {
+	stubCrossings++
+	slices := stubBodies[body.raw]
+	for i := 0; i < len(slices) && i < len(dst); i++ {
+		dst[i] = dataSlice{data: unsafe.SliceData(slices[i]), length: len(slices[i])}
+	}
+	return len(slices)
+}
+
+// stubBodyBuffer implements RequestBodyBuffer and ResponseBodyBuffer on a body created by
+// newStubBody in the same way as abi.go, so that the public methods can be benchmarked without
+// Envoy.
+type stubBodyBuffer struct {
+	ref bodyRef
+}
+
+var (
+	_ RequestBodyBuffer  = stubBodyBuffer{}
+	_ ResponseBodyBuffer = stubBodyBuffer{}
+)
+
+// Length implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Length() int {
+	length := 0
+	for _, s := range stubBodies[b.ref.raw] {
+		length += len(s)
+	}
+	return length
+}
+
+// Slices implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Slices(iter func(view []byte)) {
+	forEachBodySlice(b.ref, iter)
+}
+
+// WriteTo implements io.WriterTo.
+func (b stubBodyBuffer) WriteTo(w io.Writer) (int64, error) {
+	return writeBody(b.ref, w)
+}
+
+// ReadFrom implements io.ReaderFrom.
+func (b stubBodyBuffer) ReadFrom(reader io.Reader) (int64, error) {
+	return readBodyFrom(reader, b.Append)
+}
+
+// ReadAt implements io.ReaderAt.
+func (b stubBodyBuffer) ReadAt(p []byte, off int64) (int, error) {
+	var reader BodyReader
+	reader.reset(b.ref)
+	return reader.ReadAt(p, off)
+}
+
+// Copy implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Copy() []byte {
+	return appendBody(b.ref, make([]byte, 0, b.Length()))
+}
+
+// Append implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Append(data []byte) {
+	stubBodies[b.ref.raw] = append(stubBodies[b.ref.raw], bytes.Clone(data))
+}
+
+// Prepend implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Prepend(data []byte) {
+	stubBodies[b.ref.raw] = append([][]byte{bytes.Clone(data)}, stubBodies[b.ref.raw]...)
+}
+
+// Drain implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Drain(length int) {
+	b.Replace(b.Copy()[min(length, b.Length()):])
+}
+
+// Replace implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) Replace(data []byte) {
+	stubBodies[b.ref.raw] = [][]byte{bytes.Clone(data)}
+}
+
+// AppendTo implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) AppendTo(dst []byte) []byte {
+	return appendBody(b.ref, dst)
+}
+
+// NewReader implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) NewReader() io.Reader {
+	reader := &BodyReader{}
+	reader.reset(b.ref)
+	return reader
+}
+
+// ResetReader implements RequestBodyBuffer and ResponseBodyBuffer.
+func (b stubBodyBuffer) ResetReader(reader *BodyReader) io.Reader {
+	reader.reset(b.ref)
+	return reader
+}
+
+// stubHeaderValue implements HeaderValue on the data in the same way as abi.go.
+type stubHeaderValue struct {
+	data *byte
+	size int
+}
+
+var _ HeaderValue = stubHeaderValue{}
+
+// newStubHeaderValue returns a header value viewing the data without copying it.
+func newStubHeaderValue(data []byte) stubHeaderValue {
+	return stubHeaderValue{data: unsafe.SliceData(data), size: len(data)}
+}
+
+// String implements HeaderValue.
+func (h stubHeaderValue) String() string {
+	return string(h.UnsafeBytes())
+}
+
+// Bytes implements HeaderValue.
+func (h stubHeaderValue) Bytes() []byte {
+	return bytes.Clone(h.UnsafeBytes())
+}
+
+// UnsafeString implements HeaderValue.
+func (h stubHeaderValue) UnsafeString() string {
+	return unsafeView(h.data, h.size)
+}
+
+// UnsafeBytes implements HeaderValue.
+func (h stubHeaderValue) UnsafeBytes() []byte {
+	return dataSlice{data: h.data, length: h.size}.bytes()
+}
+
+// AppendTo implements HeaderValue.
+func (h stubHeaderValue) AppendTo(dst []byte) []byte {
+	return append(dst, h.UnsafeBytes()...)
+}
+
+// Equal implements HeaderValue.
+func (h stubHeaderValue) Equal(str string) bool {
+	return h.UnsafeString() == str
+}
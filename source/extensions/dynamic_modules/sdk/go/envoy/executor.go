@@ -0,0 +1,111 @@
+package envoy
+
+import (
+	"runtime"
+	"sync"
+)
+
+// ExecutorConfig is the configuration of NewExecutor. The zero value uses the defaults.
+type ExecutorConfig struct {
+	// Queues is the number of the queues. The work submitted for a worker goes to the queue at the
+	// worker index modulo this, so setting this to the concurrency of Envoy gives each worker its own
+	// queue. Defaults to runtime.GOMAXPROCS(0).
+	Queues int
+	// WorkersPerQueue is the number of the goroutines running the work of each queue. This bounds the
+	// number of the concurrent work per queue, so it should be larger for the work mostly waiting on
+	// I/O. Defaults to 16.
+	WorkersPerQueue int
+	// QueueSize is the number of the pending work each queue holds before Submit rejects more.
+	// Defaults to 1024.
+	QueueSize int
+}
+
+// Executor runs the asynchronous work of the filter instances, e.g. waiting for an external
+// service before continuing the request, on a fixed set of goroutines started up front. Unlike
+// starting a goroutine per request, this bounds the number of the goroutines and their stacks
+// regardless of the load, and rejects the work once the queue of the worker is full so that the
+// filter can decide what to do under the overload.
+//
+// The work usually ends by calling StreamHandle.ContinueRequest or StreamHandle.ContinueResponse.
+// Envoy collects these calls per worker and processes them together in a single wake up of the
+// worker, so there is no need to batch them here.
+type Executor struct {
+	queues     []chan func()
+	wg         sync.WaitGroup
+	cancel     chan struct{}
+	cancelOnce sync.Once
+}
+
+// NewExecutor creates an Executor and starts its goroutines. This is usually called when creating
+// the HttpFilter, and closed in HttpFilter.Destroy.
+func NewExecutor(config ExecutorConfig) *Executor {
+	if config.Queues <= 0 {
+		config.Queues = runtime.GOMAXPROCS(0)
+	}
+	if config.WorkersPerQueue <= 0 {
+		config.WorkersPerQueue = 16
+	}
+	if config.QueueSize <= 0 {
+		config.QueueSize = 1024
+	}
+	e := &Executor{queues: make([]chan func(), config.Queues), cancel: make(chan struct{})}
+	for i := range e.queues {
+		queue := make(chan func(), config.QueueSize)
+		e.queues[i] = queue
+		e.wg.Add(config.WorkersPerQueue)
+		for j := 0; j < config.WorkersPerQueue; j++ {
+			go func() {
+				defer e.wg.Done()
+				for {
+					select {
+					case <-e.cancel:
+						return
+					case work, ok := <-queue:
+						if !ok {
+							return
+						}
+						// Both might be ready at once, in which case select picks either.
+						select {
+						case <-e.cancel:
+							return
+						default:
+						}
+						work()
+					}
+				}
+			}()
+		}
+	}
+	return e
+}
+
+// Submit queues the work on the queue of the worker, usually EnvoyFilterInstance.WorkerIndex. This
+// never blocks, and returns false without running the work if the queue is full. In that case, the
+// filter can either reject the request, e.g. with EnvoyFilterInstance.SendResponse, or fail open by
+// continuing without the work. This can be called from any goroutine, but not after Close.
+func (e *Executor) Submit(worker uint32, work func()) bool {
+	select {
+	case e.queues[worker%uint32(len(e.queues))] <- work:
+		return true
+	default:
+		return false
+	}
+}
+
+// Close waits for the queued work to finish and stops the goroutines. This must be called after all
+// the calls to Submit have returned. This blocks until all the queued work is done, so see Cancel to
+// stop the executor from HttpFilter.Destroy, which runs on an Envoy thread.
+func (e *Executor) Close() {
+	for _, queue := range e.queues {
+		close(queue)
+	}
+	e.wg.Wait()
+}
+
+// Cancel drops the queued work and stops the goroutines once their running work returns, without
+// waiting for it. This never blocks, so it suits HttpFilter.Destroy when the work only continues the
+// streams of the filter, since they are all destroyed by the time the filter is. Neither Submit nor
+// Close can be called after this.
+func (e *Executor) Cancel() {
+	e.cancelOnce.Do(func() { close(e.cancel) })
+}
@@ -0,0 +1,109 @@
+package envoy
+
+import (
+	"sync"
+	"sync/atomic"
+	"testing"
+)
+
+func TestExecutor(t *testing.T) {
+	e := NewExecutor(ExecutorConfig{Queues: 4, WorkersPerQueue: 2})
+	var done atomic.Int32
+	for i := uint32(0); i < 100; i++ {
+		if !e.Submit(i, func() { done.Add(1) }) {
+			t.Fatalf("work %d rejected", i)
+		}
+	}
+	// Close waits for the queued work.
+	e.Close()
+	if got := done.Load(); got != 100 {
+		t.Fatalf("got %d, want 100", got)
+	}
+}
+
+func TestExecutorRejectsWhenSaturated(t *testing.T) {
+	e := NewExecutor(ExecutorConfig{Queues: 2, WorkersPerQueue: 1, QueueSize: 1})
+	block := make(chan struct{})
+	started := make(chan struct{})
+	// Occupy the only goroutine of the queue of the worker 0, then fill its queue.
+	if !e.Submit(0, func() { close(started); <-block }) {
+		t.Fatal("first work rejected")
+	}
+	<-started
+	if !e.Submit(0, func() {}) {
+		t.Fatal("queued work rejected")
+	}
+	if e.Submit(0, func() {}) {
+		t.Fatal("work accepted over the queue size")
+	}
+	// The worker 2 shares the queue with the worker 0, but the worker 1 has its own.
+	if e.Submit(2, func() {}) {
+		t.Fatal("work accepted over the queue size")
+	}
+	if !e.Submit(1, func() {}) {
+		t.Fatal("work on another queue rejected")
+	}
+	close(block)
+	e.Close()
+}
+
+func TestExecutorCancel(t *testing.T) {
+	e := NewExecutor(ExecutorConfig{Queues: 1, WorkersPerQueue: 1})
+	block := make(chan struct{})
+	started := make(chan struct{})
+	if !e.Submit(0, func() { close(started); <-block }) {
+		t.Fatal("first work rejected")
+	}
+	<-started
+	var queuedRan atomic.Bool
+	if !e.Submit(0, func() { queuedRan.Store(true) }) {
+		t.Fatal("queued work rejected")
+	}
+	// Cancel returns while the work is still running.
+	e.Cancel()
+	e.Cancel()
+	close(block)
+	e.wg.Wait()
+	if queuedRan.Load() {
+		t.Fatal("queued work ran after Cancel")
+	}
+}
+
+// benchmarkAsyncWork runs b.N work items each waiting for a completion signal, to compare the
+// executor with a goroutine per work.
+func benchmarkAsyncWork(b *testing.B, submit func(worker uint32, work func())) {
+	b.ReportAllocs()
+	var wg sync.WaitGroup
+	var worker atomic.Uint32
+	b.RunParallel(func(pb *testing.PB) {
+		w := worker.Add(1)
+		for pb.Next() {
+			wg.Add(1)
+			submit(w, func() {
+				var buf [512]byte // Something on the stack as the real work would have.
+				_ = buf
+				wg.Done()
+			})
+		}
+	})
+	wg.Wait()
+}
+
+func BenchmarkExecutor(b *testing.B) {
+	e := NewExecutor(ExecutorConfig{})
+	defer e.Close()
+	benchmarkAsyncWork(b, func(worker uint32, work func()) {
+		if !e.Submit(worker, work) {
+			// Saturated, which a filter would handle by rejecting or failing open.
+			work()
+		}
+	})
+}
+
+// BenchmarkGoroutinePerWork is the baseline starting a goroutine per work, which is what the
+// examples used to do.
+func BenchmarkGoroutinePerWork(b *testing.B) {
+	benchmarkAsyncWork(b, func(_ uint32, work func()) {
+		go work()
+	})
+}
@@ -0,0 +1,282 @@
+package envoy
+
+import (
+	"errors"
+	"io"
+	"sync"
+	"unsafe"
+)
+
+// This file holds the allocation free helpers shared by the cgo implementation in abi.go and the
+// stub in abi_nocgo.go, so that they can be benchmarked without Envoy. The access to the body
+// buffers goes through bodyDataSlices which is defined by each of them.
+
+// bodyRef refers to a request or response body buffer of Envoy.
+type bodyRef struct {
+	raw      uintptr
+	response bool
+}
+
+// dataSlice matches envoy_dynamic_module_type_DataSlice in abi.h.
+type dataSlice struct {
+	data   *byte
+	length int
+}
+
+func (s dataSlice) bytes() []byte {
+	if s.data == nil {
+		return nil
+	}
+	return unsafe.Slice(s.data, s.length)
+}
+
+// bodySliceCapacity is the number of the slices fetched by the helpers below before growing the
+// destination. Envoy's slices are usually 16KB, so this covers 1MB.
+const bodySliceCapacity = 64
+
+// bodySlicePool holds the destinations of the slices used by the helpers below. They are pooled
+// rather than put on the stack, since the memory passed to Envoy is moved to the heap anyway.
+var bodySlicePool = sync.Pool{
+	New: func() any {
+		s := make([]dataSlice, 0, bodySliceCapacity)
+		return &s
+	},
+}
+
+// fetchBodySlices returns all the slices of the body buffer reusing the capacity of dst. This only
+// calls into Envoy once unless the buffer has more slices than the capacity.
+func fetchBodySlices(body bodyRef, dst []dataSlice) []dataSlice {
+	dst = dst[:cap(dst)]
+	total := bodyDataSlices(body, dst)
+	if total > len(dst) {
+		dst = make([]dataSlice, total)
+		total = bodyDataSlices(body, dst)
+	}
+	return dst[:total]
+}
+
+// BodyReader reads a body buffer through the view of its slices fetched once when the reader is
+// reset, so reading in small pieces, e.g. by json.Decoder, doesn't call into Envoy for each read.
+// This implements io.Reader, io.WriterTo, io.ReaderAt and io.Seeker.
+//
+// Use RequestBodyBuffer.ResetReader or ResponseBodyBuffer.ResetReader to point it to a buffer, and
+// reuse it across the calls to avoid allocating a reader each time. The zero value reads nothing.
+//
+// The view is invalidated when the buffer is modified, and it must only be used during the event
+// hook it was reset in.
+type BodyReader struct {
+	slices []dataSlice
+	length int64
+	// pos is the position of the next read, which is at offset in slices[index].
+	pos    int64
+	index  int
+	offset int
+}
+
+func (r *BodyReader) reset(body bodyRef) {
+	if r.slices == nil {
+		r.slices = make([]dataSlice, 0, bodySliceCapacity)
+	}
+	r.slices = fetchBodySlices(body, r.slices[:0])
+	r.length = 0
+	for _, s := range r.slices {
+		r.length += int64(s.length)
+	}
+	r.pos, r.index, r.offset = 0, 0, 0
+}
+
+// Len returns the number of the unread bytes.
+func (r *BodyReader) Len() int {
+	if r.pos >= r.length {
+		return 0
+	}
+	return int(r.length - r.pos)
+}
+
+// Size returns the length of the body when the reader was reset.
+func (r *BodyReader) Size() int64 {
+	return r.length
+}
+
+// Read implements io.Reader.
+func (r *BodyReader) Read(buf []byte) (int, error) {
+	totalRead := 0
+	for totalRead < len(buf) {
+		if r.index >= len(r.slices) {
+			return totalRead, io.EOF
+		}
+		current := r.slices[r.index].bytes()
+		if r.offset >= len(current) {
+			r.offset = 0
+			r.index++
+			continue
+		}
+		n := copy(buf[totalRead:], current[r.offset:])
+		r.offset += n
+		r.pos += int64(n)
+		totalRead += n
+	}
+	return totalRead, nil
+}
+
+// WriteTo implements io.WriterTo. This passes the slices to the writer without copying them, so
+// io.Copy from the reader doesn't need an intermediate buffer.
+func (r *BodyReader) WriteTo(w io.Writer) (int64, error) {
+	var written int64
+	for ; r.index < len(r.slices); r.index, r.offset = r.index+1, 0 {
+		current := r.slices[r.index].bytes()
+		if r.offset >= len(current) {
+			continue
+		}
+		n, err := w.Write(current[r.offset:])
+		r.offset += n
+		r.pos += int64(n)
+		written += int64(n)
+		if err != nil {
+			return written, err
+		}
+	}
+	return written, nil
+}
+
+// ReadAt implements io.ReaderAt. This doesn't change the position of the reader.
+func (r *BodyReader) ReadAt(buf []byte, off int64) (int, error) {
+	if off < 0 {
+		return 0, errors.New("envoy.BodyReader.ReadAt: negative offset")
+	}
+	index, offset := r.locate(off)
+	totalRead := 0
+	for ; totalRead < len(buf) && index < len(r.slices); index, offset = index+1, 0 {
+		totalRead += copy(buf[totalRead:], r.slices[index].bytes()[offset:])
+	}
+	if totalRead < len(buf) {
+		return totalRead, io.EOF
+	}
+	return totalRead, nil
+}
+
+// Seek implements io.Seeker. Seeking beyond the end is allowed, and the reads from there return
+// io.EOF.
+func (r *BodyReader) Seek(offset int64, whence int) (int64, error) {
+	var pos int64
+	switch whence {
+	case io.SeekStart:
+		pos = offset
+	case io.SeekCurrent:
+		pos = r.pos + offset
+	case io.SeekEnd:
+		pos = r.length + offset
+	default:
+		return 0, errors.New("envoy.BodyReader.Seek: invalid whence")
+	}
+	if pos < 0 {
+		return 0, errors.New("envoy.BodyReader.Seek: negative position")
+	}
+	r.pos = pos
+	r.index, r.offset = r.locate(pos)
+	return pos, nil
+}
+
+// locate returns the slice and the offset in it at the position.
+func (r *BodyReader) locate(pos int64) (index, offset int) {
+	for index = 0; index < len(r.slices); index++ {
+		if pos < int64(r.slices[index].length) {
+			return index, int(pos)
+		}
+		pos -= int64(r.slices[index].length)
+	}
+	return len(r.slices), 0
+}
+
+// forEachBodySlice calls iter with each slice of the body buffer, calling into Envoy only once.
+func forEachBodySlice(body bodyRef, iter func(view []byte)) {
+	slices := bodySlicePool.Get().(*[]dataSlice)
+	defer bodySlicePool.Put(slices)
+	*slices = fetchBodySlices(body, (*slices)[:0])
+	for _, s := range *slices {
+		iter(s.bytes())
+	}
+}
+
+// appendBody appends the contents of the body buffer to dst, which is grown only if it doesn't
+// have enough capacity.
+func appendBody(body bodyRef, dst []byte) []byte {
+	slices := bodySlicePool.Get().(*[]dataSlice)
+	defer bodySlicePool.Put(slices)
+	*slices = fetchBodySlices(body, (*slices)[:0])
+	for _, s := range *slices {
+		dst = append(dst, s.bytes()...)
+	}
+	return dst
+}
+
+// writeBody writes the contents of the body buffer to w without copying it.
+func writeBody(body bodyRef, w io.Writer) (int64, error) {
+	slices := bodySlicePool.Get().(*[]dataSlice)
+	defer bodySlicePool.Put(slices)
+	*slices = fetchBodySlices(body, (*slices)[:0])
+	var written int64
+	for _, s := range *slices {
+		n, err := w.Write(s.bytes())
+		written += int64(n)
+		if err != nil {
+			return written, err
+		}
+	}
+	return written, nil
+}
+
+// readBodyFrom reads r until EOF through a scratch buffer and passes the data to appendFn.
+func readBodyFrom(r io.Reader, appendFn func(data []byte)) (int64, error) {
+	scratch := GetScratch(32 * 1024)
+	defer PutScratch(scratch)
+	buf := (*scratch)[:cap(*scratch)]
+	var read int64
+	for {
+		n, err := r.Read(buf)
+		if n > 0 {
+			appendFn(buf[:n])
+			read += int64(n)
+		}
+		if err == io.EOF {
+			return read, nil
+		}
+		if err != nil {
+			return read, err
+		}
+	}
+}
+
+// unsafeView returns the data owned by Envoy as a string without copying it.
+func unsafeView(data *byte, size int) string {
+	if data == nil {
+		return ""
+	}
+	return unsafe.String(data, size)
+}
+
+// scratchPool holds the buffers returned by PutScratch.
+var scratchPool = sync.Pool{
+	New: func() any {
+		b := make([]byte, 0, 4096)
+		return &b
+	},
+}
+
+// GetScratch returns an empty buffer with at least the given capacity from a process wide pool, to
+// be used e.g. with RequestBodyBuffer.AppendTo without allocating a new buffer per stream. Return
+// it with PutScratch once done.
+func GetScratch(capacity int) *[]byte {
+	b := scratchPool.Get().(*[]byte)
+	if cap(*b) < capacity {
+		*b = make([]byte, 0, capacity)
+	}
+	*b = (*b)[:0]
+	return b
+}
+
+// PutScratch returns the buffer obtained by GetScratch to the pool. The buffer must not be used
+// afterwards.
+func PutScratch(b *[]byte) {
+	scratchPool.Put(b)
+}
@@ -0,0 +1,258 @@
+//go:build !cgo
+
+package envoy
+
+import (
+	"bytes"
+	"encoding/json"
+	"io"
+	"strings"
+	"testing"
+)
+
+// assertNoAllocs fails if f allocates, so that the benchmarks below catch the regressions of the
+// hot path even when they are only run as tests with -benchtime=1x.
+func assertNoAllocs(tb testing.TB, f func()) {
+	tb.Helper()
+	if allocs := testing.AllocsPerRun(100, f); allocs != 0 {
+		tb.Fatalf("got %v allocs/op, want 0", allocs)
+	}
+}
+
+func testBody() bodyRef {
+	return newStubBody([]byte("hello "), []byte(""), []byte("world"), bytes.Repeat([]byte("!"), 1024))
+}
+
+func TestBodyReader(t *testing.T) {
+	body := testBody()
+	want := appendBody(body, nil)
+	if !bytes.HasPrefix(want, []byte("hello world!")) || len(want) != 1035 {
+		t.Fatalf("unexpected body: %q", want)
+	}
+
+	var reader BodyReader
+	for _, size := range []int{1, 3, 7, 1024, 4096} {
+		reader.reset(body)
+		var got []byte
+		buf := make([]byte, size)
+		for {
+			n, err := reader.Read(buf)
+			got = append(got, buf[:n]...)
+			if err == io.EOF {
+				break
+			}
+		}
+		if !bytes.Equal(got, want) {
+			t.Fatalf("size %d: got %q, want %q", size, got, want)
+		}
+	}
+
+	// The zero value reads nothing.
+	n, err := (&BodyReader{}).Read(make([]byte, 8))
+	if n != 0 || err != io.EOF {
+		t.Fatalf("got %d, %v", n, err)
+	}
+}
+
+func TestBodyReaderSeekAndReadAt(t *testing.T) {
+	body := testBody()
+	want := appendBody(body, nil)
+	var reader BodyReader
+	reader.reset(body)
+	if reader.Size() != int64(len(want)) || reader.Len() != len(want) {
+		t.Fatalf("unexpected size: %d, %d", reader.Size(), reader.Len())
+	}
+
+	buf := make([]byte, 7)
+	for _, off := range []int64{0, 3, 6, 10, int64(len(want)) - 7} {
+		n, err := reader.ReadAt(buf, off)
+		if n != 7 || err != nil || !bytes.Equal(buf, want[off:off+7]) {
+			t.Fatalf("ReadAt(%d): %d, %v, %q", off, n, err, buf[:n])
+		}
+	}
+	if n, err := reader.ReadAt(buf, int64(len(want))-3); n != 3 || err != io.EOF {
+		t.Fatalf("ReadAt at the end: %d, %v", n, err)
+	}
+
+	for _, c := range []struct {
+		offset int64
+		whence int
+		want   int64
+	}{
+		{6, io.SeekStart, 6},
+		{2, io.SeekCurrent, 8},
+		{-5, io.SeekEnd, int64(len(want)) - 5},
+	} {
+		if _, err := reader.Seek(6, io.SeekStart); err != nil {
+			t.Fatal(err)
+		}
+		pos, err := reader.Seek(c.offset, c.whence)
+		if err != nil || pos != c.want {
+			t.Fatalf("Seek(%d, %d): %d, %v", c.offset, c.whence, pos, err)
+		}
+		rest, _ := io.ReadAll(&reader)
+		if !bytes.Equal(rest, want[pos:]) {
+			t.Fatalf("after Seek(%d, %d): got %q", c.offset, c.whence, rest)
+		}
+	}
+	if _, err := reader.Seek(-1, io.SeekStart); err == nil {
+		t.Fatal("negative position not rejected")
+	}
+}
+
+func TestBodyReaderWriteTo(t *testing.T) {
+	body := testBody()
+	var reader BodyReader
+	reader.reset(body)
+	if _, err := reader.Seek(3, io.SeekStart); err != nil {
+		t.Fatal(err)
+	}
+	var out bytes.Buffer
+	n, err := io.Copy(&out, &reader)
+	want := appendBody(body, nil)[3:]
+	if err != nil || n != int64(len(want)) || !bytes.Equal(out.Bytes(), want) {
+		t.Fatalf("got %d, %v, %q", n, err, out.Bytes())
+	}
+	if reader.Len() != 0 {
+		t.Fatalf("reader not drained: %d", reader.Len())
+	}
+
+	out.Reset()
+	if _, err := writeBody(body, &out); err != nil || !bytes.Equal(out.Bytes(), appendBody(body, nil)) {
+		t.Fatalf("writeBody: %v, %q", err, out.Bytes())
+	}
+}
+
+func TestReadBodyFrom(t *testing.T) {
+	var got []byte
+	src := strings.Repeat("x", 100*1024)
+	n, err := readBodyFrom(strings.NewReader(src), func(data []byte) { got = append(got, data...) })
+	if err != nil || n != int64(len(src)) || string(got) != src {
+		t.Fatalf("got %d, %v", n, err)
+	}
+}
+
+// largeJSONBody returns a JSON document of about 1MB split into 16KB slices like Envoy does.
+func largeJSONBody() bodyRef {
+	var doc bytes.Buffer
+	doc.WriteString(`{"items":[`)
+	for i := 0; doc.Len() < 1<<20; i++ {
+		if i > 0 {
+			doc.WriteByte(',')
+		}
+		doc.WriteString(`{"name":"item","value":12345}`)
+	}
+	doc.WriteString(`]}`)
+	var slices [][]byte
+	for data := doc.Bytes(); len(data) > 0; {
+		n := min(len(data), 16*1024)
+		slices = append(slices, data[:n])
+		data = data[n:]
+	}
+	return newStubBody(slices...)
+}
+
+func TestBodyReaderSingleCrossing(t *testing.T) {
+	body := largeJSONBody()
+	// The reader grows its view to fit the body on the first use, and is reused afterwards.
+	var reader BodyReader
+	reader.reset(body)
+	before := stubCrossings
+	reader.reset(body)
+	var doc struct {
+		Items []struct {
+			Name  string `json:"name"`
+			Value int    `json:"value"`
+		} `json:"items"`
+	}
+	if err := json.NewDecoder(&reader).Decode(&doc); err != nil {
+		t.Fatal(err)
+	}
+	if len(doc.Items) == 0 || doc.Items[0].Value != 12345 {
+		t.Fatalf("unexpected document: %d items", len(doc.Items))
+	}
+	if crossings := stubCrossings - before; crossings != 1 {
+		t.Fatalf("got %d crossings, want 1", crossings)
+	}
+}
+
+func TestScratch(t *testing.T) {
+	b := GetScratch(8192)
+	if len(*b) != 0 || cap(*b) < 8192 {
+		t.Fatalf("unexpected scratch: len=%d cap=%d", len(*b), cap(*b))
+	}
+	*b = append(*b, "data"...)
+	PutScratch(b)
+	if b := GetScratch(0); len(*b) != 0 {
+		t.Fatalf("scratch not reset: %q", *b)
+	}
+}
+
+func BenchmarkBodyReaderReuse(b *testing.B) {
+	var body RequestBodyBuffer = stubBodyBuffer{ref: testBody()}
+	var reader BodyReader
+	buf := make([]byte, 256)
+	read := func() {
+		r := body.ResetReader(&reader)
+		for {
+			if _, err := r.Read(buf); err == io.EOF {
+				break
+			}
+		}
+	}
+	assertNoAllocs(b, read)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		read()
+	}
+}
+
+func BenchmarkBodyReaderWriteTo(b *testing.B) {
+	var body RequestBodyBuffer = stubBodyBuffer{ref: largeJSONBody()}
+	var reader BodyReader
+	writeTo := func() {
+		body.ResetReader(&reader)
+		if _, err := reader.WriteTo(io.Discard); err != nil {
+			b.Fatal(err)
+		}
+	}
+	assertNoAllocs(b, writeTo)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		writeTo()
+	}
+}
+
+func BenchmarkBodyAppendToScratch(b *testing.B) {
+	var body RequestBodyBuffer = stubBodyBuffer{ref: testBody()}
+	appendTo := func() {
+		scratch := GetScratch(0)
+		*scratch = body.AppendTo(*scratch)
+		PutScratch(scratch)
+	}
+	assertNoAllocs(b, appendTo)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		appendTo()
+	}
+}
+
+func BenchmarkHeaderValueUnsafeString(b *testing.B) {
+	var value HeaderValue = newStubHeaderValue([]byte("application/json"))
+	var matched bool
+	view := func() {
+		matched = value.UnsafeString() == "application/json"
+	}
+	assertNoAllocs(b, view)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		view()
+	}
+	if !matched {
+		b.Fatal("unexpected view")
+	}
+}
@@ -2,96 +2,152 @@ package envoy
 
 import (
 	"sync"
-	"unsafe"
+	"sync/atomic"
 )
 
 var memManager memoryManager
 
 type (
 	// memoryManager manages the heap allocated objects.
-	// It is used to pin the objects to the heap to avoid them being garbage collected by the Go runtime.
-	//
-	// TODO: shard the linked lists to reduce contention. E.g. we can use the thread id to shard the linked lists.
+	// It is used to pin the objects to the heap to avoid them being garbage collected by the Go runtime,
+	// while Envoy holds the handles to them.
 	memoryManager struct {
-		// httpFilters holds a linked lists of HttpFilter.
-		httpFilters      *pinedHttpFilter
-		httpFiltersMutex sync.Mutex
-
-		// httpFilterInstances holds a linked lists of HttpFilterInstance.
-		httpFilterInstances      *pinedHttpFilterInstance
-		httpFilterInstancesMutex sync.Mutex
+		// httpFilters holds the pinned HttpFilter(s).
+		httpFilters slotTable[HttpFilter]
+		// httpFilterInstances holds the pinned HttpFilterInstance(s).
+		httpFilterInstances slotTable[HttpFilterInstance]
 	}
+)
 
-	// pinedHttpFilter holds a pinned HttpFilter managed by the memory manager.
-	pinedHttpFilter = linkedList[HttpFilter]
+// pinHttpFilter pins the HttpFilter to the memory manager, and returns the handle to pass to Envoy.
+func (m *memoryManager) pinHttpFilter(filter HttpFilter) uintptr {
+	// The filters are created on the main thread, so there is no point in spreading them.
+	return uintptr(m.httpFilters.pin(filter, 0))
+}
 
-	// pinedHttpFilterInstance holds a pinned HttpFilterInstance managed by the memory manager.
-	pinedHttpFilterInstance = linkedList[HttpFilterInstance]
+// unpinHttpFilter unpins the HttpFilter for the handle returned by pinHttpFilter.
+func (m *memoryManager) unpinHttpFilter(raw uintptr) {
+	m.httpFilters.unpin(slotHandle(raw))
+}
 
-	linkedList[T any] struct {
-		obj        T
-		next, prev *linkedList[T]
-	}
+// unwrapPinnedHttpFilter returns the HttpFilter for the handle returned by pinHttpFilter.
+func (m *memoryManager) unwrapPinnedHttpFilter(raw uintptr) HttpFilter {
+	return m.httpFilters.get(slotHandle(raw))
+}
+
+// pinHttpFilterInstance pins the http filter instance to the memory manager, and returns the handle
+// to pass to Envoy. hint is used to pick the shard, e.g. the address of the Envoy filter instance,
+// so that the streams on different workers are unlikely to contend on the same shard.
+func (m *memoryManager) pinHttpFilterInstance(filterInstance HttpFilterInstance, hint uintptr) uintptr {
+	return uintptr(m.httpFilterInstances.pin(filterInstance, hint))
+}
+
+// unpinHttpFilterInstance unpins the http filter instance for the handle returned by pinHttpFilterInstance.
+func (m *memoryManager) unpinHttpFilterInstance(raw uintptr) {
+	m.httpFilterInstances.unpin(slotHandle(raw))
+}
+
+// unwrapRawPinHttpFilterInstance returns the http filter instance for the handle returned by pinHttpFilterInstance.
+func unwrapRawPinHttpFilterInstance(raw uintptr) HttpFilterInstance {
+	return memManager.httpFilterInstances.get(slotHandle(raw))
+}
+
+const (
+	slotShardBits  = 6
+	slotShards     = 1 << slotShardBits
+	slotChunkBits  = 10
+	slotChunkSize  = 1 << slotChunkBits
+	slotMaxChunks  = 256
+	slotIndexBits  = 18 // log2(slotChunkSize * slotMaxChunks)
+	slotHashFactor = 0x9e3779b97f4a7c15
 )
 
-// pinHttpFilter pins the HttpFilter to the memory manager.
-func (m *memoryManager) pinHttpFilter(filter HttpFilter) *pinedHttpFilter {
-	m.httpFiltersMutex.Lock()
-	defer m.httpFiltersMutex.Unlock()
+type (
+	// slotHandle refers to a slot in a slotTable. The upper 32 bits are the generation of the slot,
+	// followed by the shard and the index in the shard. The generation is odd while the slot is in
+	// use, so a handle is never zero, and a stale handle of a reused slot never matches.
+	slotHandle uint64
 
-	item := &pinedHttpFilter{obj: filter, next: m.httpFilters, prev: nil}
-	if m.httpFilters != nil {
-		m.httpFilters.prev = item
+	// slotTable pins the objects while Envoy holds the handles to them. The slots are spread over
+	// the shards each with its own lock and free list, so that pinning and unpinning on different
+	// workers rarely contend. Looking up a handle doesn't take any lock.
+	slotTable[T any] struct {
+		shards [slotShards]slotShard[T]
 	}
-	m.httpFilters = item
-	return item
-}
 
-func (m *memoryManager) unpinHttpFilter(filter *pinedHttpFilter) {
-	m.httpFiltersMutex.Lock()
-	defer m.httpFiltersMutex.Unlock()
-	if filter.prev != nil {
-		filter.prev.next = filter.next
-	} else {
-		m.httpFilters = filter.next
+	slotShard[T any] struct {
+		mu sync.Mutex
+		// free is the indexes of the released slots.
+		free []uint32
+		// used is the number of the slots ever allocated in the shard.
+		used uint32
+		// chunks are never moved once allocated, so the lookups can read them without the lock.
+		// This also keeps the locks of the shards apart from each other.
+		chunks [slotMaxChunks]atomic.Pointer[[slotChunkSize]slot[T]]
 	}
-	if filter.next != nil {
-		filter.next.prev = filter.prev
+
+	slot[T any] struct {
+		generation atomic.Uint32
+		obj        T
 	}
-}
+)
 
-// unwrapPinnedHttpFilter unwraps the pinned http filter.
-func (m *memoryManager) unwrapPinnedHttpFilter(raw uintptr) *pinedHttpFilter {
-	return (*pinedHttpFilter)(unsafe.Pointer(raw))
-}
+// pin stores the object in a free slot of the shard picked by the hint, and returns its handle.
+func (t *slotTable[T]) pin(obj T, hint uintptr) slotHandle {
+	shardIndex := uint32((uint64(hint) * slotHashFactor) >> (64 - slotShardBits))
+	shard := &t.shards[shardIndex]
+	shard.mu.Lock()
+	defer shard.mu.Unlock()
 
-// pinHttpFilterInstance pins the http filter instance to the memory manager.
-func (m *memoryManager) pinHttpFilterInstance(filterInstance HttpFilterInstance) *pinedHttpFilterInstance {
-	m.httpFilterInstancesMutex.Lock()
-	defer m.httpFilterInstancesMutex.Unlock()
-	item := &pinedHttpFilterInstance{obj: filterInstance, next: m.httpFilterInstances, prev: nil}
-	if m.httpFilterInstances != nil {
-		m.httpFilterInstances.prev = item
+	var index uint32
+	if n := len(shard.free); n > 0 {
+		index = shard.free[n-1]
+		shard.free = shard.free[:n-1]
+	} else {
+		index = shard.used
+		chunk := index >> slotChunkBits
+		if chunk >= slotMaxChunks {
+			panic("envoy: too many pinned objects")
+		}
+		if index&(slotChunkSize-1) == 0 {
+			shard.chunks[chunk].Store(new([slotChunkSize]slot[T]))
+		}
+		shard.used++
 	}
-	m.httpFilterInstances = item
-	return item
+	s := shard.slot(index)
+	s.obj = obj
+	generation := s.generation.Add(1)
+	return slotHandle(uint64(generation)<<32 | uint64(shardIndex)<<slotIndexBits | uint64(index))
 }
 
-// unwrapPinnedHttpFilterInstance unwraps the pinned http filter instance from the memory manager.
-func (m *memoryManager) unpinHttpFilterInstance(filterInstance *pinedHttpFilterInstance) {
-	m.httpFilterInstancesMutex.Lock()
-	defer m.httpFilterInstancesMutex.Unlock()
-	if filterInstance.prev != nil {
-		filterInstance.prev.next = filterInstance.next
-	} else {
-		m.httpFilterInstances = filterInstance.next
+// unpin releases the slot of the handle so that the object can be garbage collected.
+func (t *slotTable[T]) unpin(h slotHandle) {
+	shard := &t.shards[h.shard()]
+	shard.mu.Lock()
+	defer shard.mu.Unlock()
+	s := shard.slot(h.index())
+	if s.generation.Load() != h.generation() {
+		panic("envoy: unpinning a stale handle")
 	}
-	if filterInstance.next != nil {
-		filterInstance.next.prev = filterInstance.prev
+	var zero T
+	s.obj = zero
+	s.generation.Add(1)
+	shard.free = append(shard.free, h.index())
+}
+
+// get returns the object of the handle.
+func (t *slotTable[T]) get(h slotHandle) T {
+	s := t.shards[h.shard()].slot(h.index())
+	if s.generation.Load() != h.generation() {
+		panic("envoy: stale handle")
 	}
+	return s.obj
 }
 
-// unwrapRawPinHttpFilterInstance unwraps the raw pointer to the pinned http filter instance.
-func unwrapRawPinHttpFilterInstance(raw uintptr) *pinedHttpFilterInstance {
-	return (*pinedHttpFilterInstance)(unsafe.Pointer(raw))
+func (s *slotShard[T]) slot(index uint32) *slot[T] {
+	return &s.chunks[index>>slotChunkBits].Load()[index&(slotChunkSize-1)]
 }
+
+func (h slotHandle) generation() uint32 { return uint32(h >> 32) }
+func (h slotHandle) shard() uint32      { return uint32(h>>slotIndexBits) & (slotShards - 1) }
+func (h slotHandle) index() uint32      { return uint32(h) & (1<<slotIndexBits - 1) }
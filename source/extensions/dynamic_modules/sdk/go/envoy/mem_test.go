@@ -0,0 +1,143 @@
+package envoy
+
+import (
+	"runtime"
+	"sync"
+	"sync/atomic"
+	"testing"
+)
+
+func TestSlotTable(t *testing.T) {
+	var table slotTable[int]
+	h1 := table.pin(1, 0)
+	h2 := table.pin(2, 0)
+	if h1 == 0 || h2 == 0 || h1 == h2 {
+		t.Fatalf("unexpected handles: %x, %x", h1, h2)
+	}
+	if got := table.get(h1); got != 1 {
+		t.Fatalf("got %d, want 1", got)
+	}
+	if got := table.get(h2); got != 2 {
+		t.Fatalf("got %d, want 2", got)
+	}
+
+	// The released slot is reused with a new generation.
+	table.unpin(h1)
+	h3 := table.pin(3, 0)
+	if h3.shard() != h1.shard() || h3.index() != h1.index() || h3.generation() == h1.generation() {
+		t.Fatalf("slot not reused: %x, %x", h1, h3)
+	}
+	if got := table.get(h3); got != 3 {
+		t.Fatalf("got %d, want 3", got)
+	}
+	func() {
+		defer func() {
+			if recover() == nil {
+				t.Fatal("stale handle not detected")
+			}
+		}()
+		table.get(h1)
+	}()
+}
+
+func TestSlotTableGrows(t *testing.T) {
+	var table slotTable[int]
+	handles := make([]slotHandle, 3*slotChunkSize)
+	for i := range handles {
+		handles[i] = table.pin(i, 0)
+	}
+	for i, h := range handles {
+		if got := table.get(h); got != i {
+			t.Fatalf("got %d, want %d", got, i)
+		}
+		table.unpin(h)
+	}
+}
+
+func TestSlotTableConcurrent(t *testing.T) {
+	var table slotTable[int]
+	var wg sync.WaitGroup
+	for g := 0; g < 16; g++ {
+		wg.Add(1)
+		go func(g int) {
+			defer wg.Done()
+			for i := 0; i < 10000; i++ {
+				h := table.pin(g*10000+i, uintptr(g*64+i))
+				if got := table.get(h); got != g*10000+i {
+					t.Errorf("got %d, want %d", got, g*10000+i)
+					return
+				}
+				table.unpin(h)
+			}
+		}(g)
+	}
+	wg.Wait()
+}
+
+// benchmarkPinUnpin pins and unpins an object per iteration from parallel goroutines, like streams
+// starting and finishing on multiple workers. Run with -cpu=1,2,4,8 to see the scaling.
+func benchmarkPinUnpin(b *testing.B, pinUnpin func(hint uintptr)) {
+	var nextWorker atomic.Uintptr
+	b.ReportAllocs()
+	b.RunParallel(func(pb *testing.PB) {
+		// Each goroutine uses its own range of hints like the addresses of the streams on a worker.
+		hint := nextWorker.Add(1) << 32
+		for pb.Next() {
+			hint += 64
+			pinUnpin(hint)
+		}
+	})
+}
+
+func BenchmarkSlotTablePinUnpin(b *testing.B) {
+	var table slotTable[HttpFilterInstance]
+	benchmarkPinUnpin(b, func(hint uintptr) {
+		table.unpin(table.pin(nil, hint))
+	})
+}
+
+// BenchmarkGlobalMutexPinUnpin is the baseline pinning the objects in a single linked list guarded
+// by a mutex, which is what the memory manager used to do.
+func BenchmarkGlobalMutexPinUnpin(b *testing.B) {
+	type linkedList struct {
+		obj        HttpFilterInstance
+		next, prev *linkedList
+	}
+	var mu sync.Mutex
+	var head *linkedList
+	benchmarkPinUnpin(b, func(uintptr) {
+		mu.Lock()
+		item := &linkedList{next: head}
+		if head != nil {
+			head.prev = item
+		}
+		head = item
+		mu.Unlock()
+
+		mu.Lock()
+		if item.prev != nil {
+			item.prev.next = item.next
+		} else {
+			head = item.next
+		}
+		if item.next != nil {
+			item.next.prev = item.prev
+		}
+		mu.Unlock()
+	})
+}
+
+func BenchmarkSlotTableGet(b *testing.B) {
+	var table slotTable[HttpFilterInstance]
+	handles := make([]slotHandle, runtime.GOMAXPROCS(0)*64)
+	for i := range handles {
+		handles[i] = table.pin(nil, uintptr(i)*64)
+	}
+	b.RunParallel(func(pb *testing.PB) {
+		i := 0
+		for pb.Next() {
+			_ = table.get(handles[i%len(handles)])
+			i++
+		}
+	})
+}
@@ -0,0 +1,114 @@
+package envoy
+
+import (
+	"math"
+	"runtime"
+	"runtime/debug"
+	"runtime/metrics"
+	"sync"
+)
+
+// OnMemoryPressure is called with the memory pressure of Envoy from 0 (none) to 1 (saturated)
+// each time it changes, when memory_pressure is set in the filter config. This lets the Go heap
+// shrink while Envoy sheds load, instead of growing until the next GC.
+//
+// Defaults to AdjustMemoryLimit, and can be replaced or set to nil in the init function of the
+// program. The function is only called by the main thread, and must not block.
+var OnMemoryPressure = AdjustMemoryLimit
+
+// AdjustMemoryLimit lowers the memory limit of the Go runtime (see debug.SetMemoryLimit) towards
+// the memory in use as the pressure rises, and starts a GC so that the limit takes effect now. At
+// the pressure 1, the limit leaves no room for the heap to grow beyond the live objects, and the
+// freed memory is returned to the OS. The limit set before the pressure, e.g. by GOMEMLIMIT, is
+// restored once the pressure goes back to 0, and the limit is never raised above it.
+//
+// Note that the runtime caps the CPU time spent by GC when the limit cannot be met, so this bounds
+// the GC overhead rather than the memory when the live objects alone exceed the limit.
+func AdjustMemoryLimit(pressure float64) {
+	defaultMemoryLimiter.onPressure(pressure)
+}
+
+var defaultMemoryLimiter = memoryLimiter{
+	memoryInUse: readMemoryInUse,
+	setLimit:    debug.SetMemoryLimit,
+	collect: func(saturated bool) {
+		// Collect on another goroutine since this is called by the Envoy main thread.
+		if saturated {
+			go debug.FreeOSMemory()
+		} else {
+			go runtime.GC()
+		}
+	},
+}
+
+// memoryLimiter implements AdjustMemoryLimit. The runtime calls are replaceable for testing.
+type memoryLimiter struct {
+	mu sync.Mutex
+	// original is the limit before the pressure, which is restored when the pressure goes away.
+	original int64
+	limited  bool
+
+	memoryInUse func() (overhead, live uint64)
+	setLimit    func(limit int64) int64
+	collect     func(saturated bool)
+}
+
+func (l *memoryLimiter) onPressure(pressure float64) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	if pressure <= 0 || math.IsNaN(pressure) {
+		if l.limited {
+			l.setLimit(l.original)
+			l.limited = false
+		}
+		return
+	}
+	if pressure > 1 {
+		pressure = 1
+	}
+	if !l.limited {
+		// A negative value only reads the current limit.
+		l.original = l.setLimit(-1)
+		l.limited = true
+	}
+	// The room for the heap to grow shrinks from the live heap itself, which is what the default
+	// GOGC=100 allows, down to nothing at the pressure 1.
+	overhead, live := l.memoryInUse()
+	limit := float64(overhead) + float64(live)*(2-pressure)
+	if limit < float64(l.original) {
+		l.setLimit(int64(limit))
+	} else {
+		l.setLimit(l.original)
+	}
+	l.collect(pressure >= 1)
+}
+
+// memoryMetrics are the metrics read by readMemoryInUse.
+var memoryMetrics = []string{
+	"/memory/classes/total:bytes",
+	"/memory/classes/heap/released:bytes",
+	"/memory/classes/heap/objects:bytes",
+	"/gc/heap/live:bytes",
+}
+
+// readMemoryInUse returns the memory counted by the memory limit except for the heap objects, such
+// as the goroutine stacks and the runtime metadata, and the heap objects live as of the last GC.
+func readMemoryInUse() (overhead, live uint64) {
+	samples := make([]metrics.Sample, len(memoryMetrics))
+	for i, name := range memoryMetrics {
+		samples[i].Name = name
+	}
+	metrics.Read(samples)
+	values := make([]uint64, len(samples))
+	for i, s := range samples {
+		if s.Value.Kind() == metrics.KindUint64 {
+			values[i] = s.Value.Uint64()
+		}
+	}
+	total, released, objects := values[0], values[1], values[2]
+	live = values[3]
+	if mapped := total - released; mapped > objects {
+		overhead = mapped - objects
+	}
+	return overhead, live
+}
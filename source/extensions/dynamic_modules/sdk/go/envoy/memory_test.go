@@ -0,0 +1,61 @@
+package envoy
+
+import (
+	"math"
+	"testing"
+)
+
+func TestMemoryLimiter(t *testing.T) {
+	limit := int64(math.MaxInt64)
+	var collected []bool
+	l := memoryLimiter{
+		memoryInUse: func() (uint64, uint64) { return 100, 1000 },
+		setLimit: func(newLimit int64) int64 {
+			old := limit
+			if newLimit >= 0 {
+				limit = newLimit
+			}
+			return old
+		},
+		collect: func(saturated bool) { collected = append(collected, saturated) },
+	}
+
+	l.onPressure(0.5)
+	if limit != 100+1500 {
+		t.Fatalf("got limit %d, want %d", limit, 100+1500)
+	}
+	l.onPressure(1)
+	if limit != 100+1000 {
+		t.Fatalf("got limit %d, want %d", limit, 100+1000)
+	}
+	if len(collected) != 2 || collected[0] || !collected[1] {
+		t.Fatalf("unexpected collections: %v", collected)
+	}
+
+	// The limit before the pressure is restored.
+	l.onPressure(0)
+	if limit != math.MaxInt64 {
+		t.Fatalf("got limit %d, want no limit", limit)
+	}
+	if len(collected) != 2 {
+		t.Fatalf("unexpected collections: %v", collected)
+	}
+
+	// The limit is never raised above the original one.
+	limit = 1200
+	l.onPressure(0.1)
+	if limit != 1200 {
+		t.Fatalf("got limit %d, want 1200", limit)
+	}
+	l.onPressure(0)
+	if limit != 1200 {
+		t.Fatalf("got limit %d, want 1200", limit)
+	}
+}
+
+func TestReadMemoryInUse(t *testing.T) {
+	overhead, live := readMemoryInUse()
+	if overhead == 0 || live == 0 {
+		t.Fatalf("unexpected memory in use: overhead %d, live %d", overhead, live)
+	}
+}
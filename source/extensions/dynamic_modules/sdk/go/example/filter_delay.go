@@ -10,21 +10,30 @@ import (
 
 // delayHttpFilter implements envoy.HttpFilter.
 //
-// This is to demonstrate how to delay the request and response by using Gorooutines.
-type delayHttpFilter struct{ requestCounts atomic.Int32 }
+// This is to demonstrate how to delay the request and response by running the work on an
+// envoy.Executor, which bounds the number of the goroutines regardless of the load.
+type delayHttpFilter struct {
+	requestCounts atomic.Int32
+	executor      *envoy.Executor
+}
 
-func newDelayHttpFilter(string) envoy.HttpFilter { return &delayHttpFilter{} }
+func newDelayHttpFilter(string) envoy.HttpFilter {
+	return &delayHttpFilter{executor: envoy.NewExecutor(envoy.ExecutorConfig{})}
+}
 
 // NewInstance implements envoy.HttpFilter.
 func (m *delayHttpFilter) NewInstance(e envoy.EnvoyFilterInstance) envoy.HttpFilterInstance {
 	// NewInstance is called for each new Http request, so we can use a counter to track the number of requests.
 	// On the other hand, that means this function must be thread-safe.
 	id := m.requestCounts.Add(1)
-	return &delayHttpFilterInstance{id: id, envoyFilter: e}
+	return &delayHttpFilterInstance{id: id, envoyFilter: e, executor: m.executor}
 }
 
 // Destroy implements envoy.HttpFilter.
 func (m *delayHttpFilter) Destroy() {
+	// Close would block this Envoy thread until the queued sleeps are done, while the work left only
+	// continues the streams which are already destroyed, so it is dropped instead.
+	m.executor.Cancel()
 	fmt.Println("Destroy called")
 }
 
@@ -32,20 +41,24 @@ func (m *delayHttpFilter) Destroy() {
 type delayHttpFilterInstance struct {
 	id          int32
 	envoyFilter envoy.EnvoyFilterInstance
-	destroyed   bool
+	executor    *envoy.Executor
 }
 
 // RequestHeaders implements envoy.HttpFilterInstance.
 func (h *delayHttpFilterInstance) RequestHeaders(_ envoy.RequestHeaders, _ bool) envoy.RequestHeadersStatus {
 	if h.id == 1 {
-		go func() {
+		handle := h.envoyFilter.StreamHandle()
+		if !h.executor.Submit(h.envoyFilter.WorkerIndex(), func() {
 			fmt.Println("blocking for 1 second at RequestHeaders with id", h.id)
 			time.Sleep(1 * time.Second)
 			fmt.Println("calling ContinueRequest with id", h.id)
-			if !h.destroyed { // By the time when calling ContinueResponse, the filter might have been destroyed.
-				h.envoyFilter.ContinueRequest()
-			}
-		}()
+			// The stream might have been destroyed by now, in which case this is a no-op.
+			handle.ContinueRequest()
+		}) {
+			// The executor is saturated, so fail open by continuing without the delay.
+			fmt.Println("RequestHeaders continuing without the delay with id", h.id)
+			return envoy.HeadersStatusContinue
+		}
 		fmt.Println("RequestHeaders returning StopAllIterationAndBuffer with id", h.id)
 		return envoy.RequestHeadersStatusStopAllIterationAndBuffer
 	}
@@ -56,14 +69,18 @@ func (h *delayHttpFilterInstance) RequestHeaders(_ envoy.RequestHeaders, _ bool)
 // RequestBody implements envoy.HttpFilterInstance.
 func (h *delayHttpFilterInstance) RequestBody(_ envoy.RequestBodyBuffer, _ bool) envoy.RequestBodyStatus {
 	if h.id == 2 {
-		go func() {
+		handle := h.envoyFilter.StreamHandle()
+		if !h.executor.Submit(h.envoyFilter.WorkerIndex(), func() {
 			fmt.Println("blocking for 1 second at RequestBody with id", h.id)
 			time.Sleep(1 * time.Second)
 			fmt.Println("calling ContinueRequest with id", h.id)
-			if !h.destroyed { // By the time when calling ContinueResponse, the filter might have been destroyed.
-				h.envoyFilter.ContinueRequest()
-			}
-		}()
+			// The stream might have been destroyed by now, in which case this is a no-op.
+			handle.ContinueRequest()
+		}) {
+			// The executor is saturated, so fail open by continuing without the delay.
+			fmt.Println("RequestBody continuing without the delay with id", h.id)
+			return envoy.RequestBodyStatusContinue
+		}
 		fmt.Println("RequestBody returning StopIterationAndBuffer with id", h.id)
 		return envoy.RequestBodyStatusStopIterationAndBuffer
 	}
@@ -74,14 +91,18 @@ func (h *delayHttpFilterInstance) RequestBody(_ envoy.RequestBodyBuffer, _ bool)
 // ResponseHeaders implements envoy.HttpFilterInstance.
 func (h *delayHttpFilterInstance) ResponseHeaders(_ envoy.ResponseHeaders, _ bool) envoy.ResponseHeadersStatus {
 	if h.id == 3 {
-		go func() {
+		handle := h.envoyFilter.StreamHandle()
+		if !h.executor.Submit(h.envoyFilter.WorkerIndex(), func() {
 			fmt.Println("blocking for 1 second at ResponseHeaders with id", h.id)
 			time.Sleep(1 * time.Second)
 			fmt.Println("calling ContinueResponse with id", h.id)
-			if !h.destroyed { // By the time when calling ContinueResponse, the filter might have been destroyed.
-				h.envoyFilter.ContinueResponse()
-			}
-		}()
+			// The stream might have been destroyed by now, in which case this is a no-op.
+			handle.ContinueResponse()
+		}) {
+			// The executor is saturated, so fail open by continuing without the delay.
+			fmt.Println("ResponseHeaders continuing without the delay with id", h.id)
+			return envoy.ResponseHeadersStatusContinue
+		}
 		fmt.Println("ResponseHeaders returning StopAllIterationAndBuffer with id", h.id)
 		return envoy.ResponseHeadersStatusStopAllIterationAndBuffer
 	}
@@ -92,14 +113,18 @@ func (h *delayHttpFilterInstance) ResponseHeaders(_ envoy.ResponseHeaders, _ boo
 // ResponseBody implements envoy.HttpFilterInstance.
 func (h *delayHttpFilterInstance) ResponseBody(_ envoy.ResponseBodyBuffer, _ bool) envoy.ResponseBodyStatus {
 	if h.id == 4 {
-		go func() {
+		handle := h.envoyFilter.StreamHandle()
+		if !h.executor.Submit(h.envoyFilter.WorkerIndex(), func() {
 			fmt.Println("blocking for 1 second at ResponseBody with id", h.id)
 			time.Sleep(1 * time.Second)
 			fmt.Println("calling ContinueResponse with id", h.id)
-			if !h.destroyed { // By the time when calling ContinueResponse, the filter might have been destroyed.
-				h.envoyFilter.ContinueResponse()
-			}
-		}()
+			// The stream might have been destroyed by now, in which case this is a no-op.
+			handle.ContinueResponse()
+		}) {
+			// The executor is saturated, so fail open by continuing without the delay.
+			fmt.Println("ResponseBody continuing without the delay with id", h.id)
+			return envoy.ResponseBodyStatusContinue
+		}
 		fmt.Println("ResponseBody returning StopIterationAndBuffer with id", h.id)
 		return envoy.ResponseBodyStatusStopIterationAndBuffer
 	}
@@ -108,4 +133,4 @@ func (h *delayHttpFilterInstance) ResponseBody(_ envoy.ResponseBodyBuffer, _ boo
 }
 
 // Destroy implements envoy.HttpFilterInstance.
-func (h *delayHttpFilterInstance) Destroy() { h.destroyed = true }
+func (h *delayHttpFilterInstance) Destroy() {}
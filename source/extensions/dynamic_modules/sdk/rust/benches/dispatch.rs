@@ -0,0 +1,99 @@
+//! Compares the cost of the event hooks generated by `init!` for a filter with the concrete
+//! instance type and for a `Box<dyn HttpFilter>`, by calling the same functions as the hooks.
+//!
+//! Run with `cargo bench`.
+
+use std::hint::black_box;
+use std::time::{Duration, Instant};
+
+use envoy_dynamic_modules_rust_sdk::__private::*;
+use envoy_dynamic_modules_rust_sdk::*;
+
+struct CountingFilter {}
+
+impl HttpFilter for CountingFilter {
+    fn new_instance(&mut self, _: EnvoyFilterInstance) -> Box<dyn HttpFilterInstance> {
+        Box::new(CountingFilterInstance { count: 0 })
+    }
+}
+
+impl TypedHttpFilter for CountingFilter {
+    type Instance = CountingFilterInstance;
+
+    fn new_instance(&mut self, _: EnvoyFilterInstance) -> CountingFilterInstance {
+        CountingFilterInstance { count: 0 }
+    }
+}
+
+struct CountingFilterInstance {
+    count: usize,
+}
+
+impl HttpFilterInstance for CountingFilterInstance {
+    fn request_headers(&mut self, _: &RequestHeaders, _: bool) -> RequestHeadersStatus {
+        self.count += 1;
+        RequestHeadersStatus::Continue
+    }
+}
+
+fn new_static_filter(_: &str) -> CountingFilter {
+    CountingFilter {}
+}
+
+fn new_dyn_filter(_: &str) -> Box<dyn HttpFilter> {
+    Box::new(CountingFilter {})
+}
+
+const ITERATIONS: u32 = 10_000_000;
+
+/// Runs `f` ITERATIONS times after a warm up, and prints the average time per call.
+fn bench(name: &str, mut f: impl FnMut()) {
+    for _ in 0..ITERATIONS / 10 {
+        f();
+    }
+    let start = Instant::now();
+    for _ in 0..ITERATIONS {
+        f();
+    }
+    let elapsed = start.elapsed();
+    println!(
+        "{:<40} {:>8.2} ns/iter",
+        name,
+        elapsed.as_nanos() as f64 / ITERATIONS as f64
+    );
+}
+
+/// Benchmarks the hooks for the filter created by `new_filter_fn`: a request header event on an
+/// existing instance, and the lifetime of an instance from its creation to its destruction.
+fn bench_hooks<F: TypedHttpFilter>(name: &str, new_filter_fn: impl Fn(&str) -> F) {
+    let config = "bench";
+    unsafe {
+        let filter = on_http_filter_init(&new_filter_fn, config.as_ptr() as usize, config.len());
+        let instance = on_http_filter_instance_init(&new_filter_fn, 0, filter);
+        bench(&format!("{}/request_headers", name), || {
+            black_box(on_http_filter_instance_request_headers(
+                &new_filter_fn,
+                black_box(instance),
+                0,
+                0,
+            ));
+        });
+        on_http_filter_instance_destroy(&new_filter_fn, instance);
+
+        bench(&format!("{}/instance_lifetime", name), || {
+            let instance = on_http_filter_instance_init(&new_filter_fn, 0, black_box(filter));
+            on_http_filter_instance_destroy(&new_filter_fn, black_box(instance));
+        });
+        on_http_filter_destroy(&new_filter_fn, filter);
+    }
+}
+
+fn main() {
+    // Let the CPU frequency settle before measuring.
+    let start = Instant::now();
+    while start.elapsed() < Duration::from_millis(100) {
+        black_box(());
+    }
+    bench_hooks("static", new_static_filter);
+    bench_hooks("dyn", new_dyn_filter);
+}
@@ -3,6 +3,7 @@ use std::{
     sync::{Arc, Mutex},
 };
 
+use envoy_dynamic_modules_rust_sdk::async_filter::*;
 use envoy_dynamic_modules_rust_sdk::*;
 use serde::{Deserialize, Serialize};
 
@@ -23,6 +24,7 @@ fn new_http_filter(config: &str) -> Box<dyn HttpFilter> {
         "bodies_replace" => Box::new(BodiesReplace {}),
         "send_response" => Box::new(SendResponseFilter {}),
         "validate_json" => Box::new(ValidateJsonFilter {}),
+        "async_delay" => Box::new(AsyncDelayFilter {}),
         _ => panic!("Unknown config: {}", config),
     }
 }
@@ -129,8 +131,7 @@ impl HttpFilterInstance for HeadersFilterInstance {
         }
 
         request_headers
-            .values(b"multiple-values")
-            .iter()
+            .values_iter(b"multiple-values")
             .for_each(|value| {
                 println!("multiple-values: {}", std::str::from_utf8(value).unwrap());
             });
@@ -158,8 +159,7 @@ impl HttpFilterInstance for HeadersFilterInstance {
         }
 
         response_headers
-            .values(b"this-is-2")
-            .iter()
+            .values_iter(b"this-is-2")
             .for_each(|value| {
                 println!("this-is-2: {}", std::str::from_utf8(value).unwrap());
             });
@@ -390,7 +390,7 @@ impl HttpFilterInstance for BodiesFilterInstance {
         }
 
         // Replace the entire body with 'Y' without copying.
-        for i in entire_body.slices() {
+        for i in entire_body.slices_iter() {
             for j in i {
                 *j = b'X';
             }
@@ -437,7 +437,7 @@ impl HttpFilterInstance for BodiesFilterInstance {
         }
 
         // Replace the entire body with 'Y' without copying.
-        for i in entire_body.slices() {
+        for i in entire_body.slices_iter() {
             for j in i {
                 *j = b'Y';
             }
@@ -672,12 +672,9 @@ impl HttpFilterInstance for ValidateJsonFilterInstance {
             return RequestBodyStatus::StopIterationAndBuffer;
         }
 
-        let reader = self
-            .envoy_filter_instance
-            .get_request_body_buffer()
-            .reader();
-
-        match serde_json::from_reader(reader) {
+        // The reader borrows the buffer, so the buffer must outlive it.
+        let body = self.envoy_filter_instance.get_request_body_buffer();
+        match serde_json::from_reader(body.reader()) {
             Ok(body) => {
                 let _body: ValidateJsonFilterBody = body;
             }
@@ -688,3 +685,38 @@ impl HttpFilterInstance for ValidateJsonFilterInstance {
         RequestBodyStatus::Continue
     }
 }
+
+/// AsyncDelayFilter is a filter that delays the request headers with an async hook.
+///
+/// This implements the [`HttpFilter`] trait, and will be created per each filter chain.
+struct AsyncDelayFilter {}
+
+impl HttpFilter for AsyncDelayFilter {
+    fn new_instance(
+        &mut self,
+        envoy_filter_instance: EnvoyFilterInstance,
+    ) -> Box<dyn HttpFilterInstance> {
+        Box::new(AsyncFilterInstance::new(
+            envoy_filter_instance,
+            AsyncDelayFilterInstance {},
+        ))
+    }
+}
+
+/// AsyncDelayFilterInstance waits on a timer of the worker thread instead of a thread of its own.
+///
+/// This implements the [`AsyncHttpFilterInstance`] trait, and will be created per each request.
+struct AsyncDelayFilterInstance {}
+
+impl AsyncHttpFilterInstance for AsyncDelayFilterInstance {
+    async fn request_headers(
+        &mut self,
+        ctx: &AsyncContext,
+        _request_headers: RequestHeaders,
+        _end_of_stream: bool,
+    ) -> RequestHeadersStatus {
+        ctx.sleep(std::time::Duration::from_millis(100)).await;
+        println!("RequestHeaders continued after 100ms");
+        RequestHeadersStatus::Continue
+    }
+}
@@ -0,0 +1,1143 @@
+//! An optional layer to write the filter instances with `async fn` event hooks.
+//!
+//! The futures are polled on the Envoy worker thread of the stream, and woken by the events of its
+//! dispatcher, i.e. the timers of [`AsyncContext::sleep`] and the responses of
+//! [`AsyncContext::callout`]. There is no runtime or thread of its own, so the futures don't need
+//! to be `Send`.
+//!
+//! ## Example
+//!
+//! ```
+//! use envoy_dynamic_modules_rust_sdk::async_filter::*;
+//! use envoy_dynamic_modules_rust_sdk::*;
+//! use std::time::Duration;
+//!
+//! struct DelayFilter {}
+//!
+//! impl TypedHttpFilter for DelayFilter {
+//!     type Instance = AsyncFilterInstance<DelayFilterInstance>;
+//!
+//!     fn new_instance(&mut self, envoy_filter_instance: EnvoyFilterInstance) -> Self::Instance {
+//!         AsyncFilterInstance::new(envoy_filter_instance, DelayFilterInstance {})
+//!     }
+//! }
+//!
+//! struct DelayFilterInstance {}
+//!
+//! impl AsyncHttpFilterInstance for DelayFilterInstance {
+//!     async fn request_headers(
+//!         &mut self,
+//!         ctx: &AsyncContext,
+//!         _request_headers: RequestHeaders,
+//!         _end_of_stream: bool,
+//!     ) -> RequestHeadersStatus {
+//!         ctx.sleep(Duration::from_millis(100)).await;
+//!         RequestHeadersStatus::Continue
+//!     }
+//! }
+//!
+//! fn new_http_filter(_config: &str) -> DelayFilter {
+//!     DelayFilter {}
+//! }
+//! init!(new_http_filter);
+//! ```
+
+use std::cell::{Cell, RefCell, UnsafeCell};
+use std::collections::VecDeque;
+use std::future::Future;
+use std::pin::Pin;
+use std::rc::Rc;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
+use std::task::{Context, Poll, Wake, Waker};
+use std::time::Duration;
+
+use crate::*;
+
+/// A filter instance whose event hooks are `async fn`. This is wrapped in [`AsyncFilterInstance`]
+/// to be returned by [`HttpFilter::new_instance`] or [`TypedHttpFilter::new_instance`].
+///
+/// While the future returned by a hook is pending, the stream is stopped, and it is continued once
+/// the future resolves to the continue status. The events of the stream received in the meantime
+/// are buffered and the hooks for them are called after that, with the buffered body instead of
+/// the frame for the body events. So the hooks of a stream never run concurrently.
+///
+/// The futures are dropped when the stream is destroyed, before [`AsyncHttpFilterInstance::destroy`]
+/// is called. A future ending the stream, e.g. with [`EnvoyFilterInstance::send_response`], might
+/// have it destroyed while it is polled, in which case it is dropped once it returns `Pending`.
+///
+/// Only the futures of [`AsyncContext`] wake the stream. A future woken from another thread, e.g.
+/// a channel fed by a thread of the module, is only polled again at the next event of the stream,
+/// since there is no way to run it on the worker thread from there. Such work should be driven
+/// from the worker instead, e.g. by polling it with [`AsyncContext::sleep`] in between.
+#[allow(async_fn_in_trait)] // The futures are never sent to another thread.
+pub trait AsyncHttpFilterInstance: 'static {
+    /// This is called when request headers are received. The headers can be used until the
+    /// future resolves.
+    async fn request_headers(
+        &mut self,
+        _ctx: &AsyncContext,
+        _request_headers: RequestHeaders,
+        _end_of_stream: bool,
+    ) -> RequestHeadersStatus {
+        RequestHeadersStatus::Continue
+    }
+
+    /// This is called when a request body frame is received. The buffer can only be used until
+    /// the first `await`, after which the buffered body is available with
+    /// [`EnvoyFilterInstance::get_request_body_buffer`].
+    async fn request_body(
+        &mut self,
+        _ctx: &AsyncContext,
+        _request_body_frame: RequestBodyBuffer,
+        _end_of_stream: bool,
+    ) -> RequestBodyStatus {
+        RequestBodyStatus::Continue
+    }
+
+    /// This is called when response headers are received. The headers can be used until the
+    /// future resolves.
+    async fn response_headers(
+        &mut self,
+        _ctx: &AsyncContext,
+        _response_headers: ResponseHeaders,
+        _end_of_stream: bool,
+    ) -> ResponseHeadersStatus {
+        ResponseHeadersStatus::Continue
+    }
+
+    /// This is called when a response body frame is received. The buffer can only be used until
+    /// the first `await`, after which the buffered body is available with
+    /// [`EnvoyFilterInstance::get_response_body_buffer`].
+    async fn response_body(
+        &mut self,
+        _ctx: &AsyncContext,
+        _response_body_frame: ResponseBodyBuffer,
+        _end_of_stream: bool,
+    ) -> ResponseBodyStatus {
+        ResponseBodyStatus::Continue
+    }
+
+    /// This is called when the stream is completed or reset, after the pending future is dropped.
+    fn destroy(&mut self) {}
+}
+
+/// The context of a stream passed to the hooks of [`AsyncHttpFilterInstance`], which creates the
+/// futures woken by the dispatcher of the stream.
+pub struct AsyncContext {
+    envoy_filter_instance: EnvoyFilterInstance,
+    // Polls the pending future of the stream, with the address of the stream.
+    resume: unsafe fn(*const ()),
+    stream: Cell<*const ()>,
+    woken: Arc<WakeFlag>,
+    waker: Waker,
+    // The timers not used by any Sleep. Envoy frees the timers with the stream.
+    free_timers: RefCell<Vec<Box<TimerSlot>>>,
+    // The callouts in flight, released by their done callback or with the stream.
+    callouts: RefCell<Vec<Rc<dyn std::any::Any>>>,
+    destroyed: Cell<bool>,
+}
+
+impl AsyncContext {
+    /// Returns the filter instance of the stream, e.g. to send a local response.
+    pub fn envoy_filter_instance(&self) -> EnvoyFilterInstance {
+        self.envoy_filter_instance
+    }
+
+    /// Returns a future that resolves after the given duration, using a timer on the dispatcher of
+    /// the stream. The timers are reused by the later sleeps of the stream.
+    pub fn sleep(&self, duration: Duration) -> Sleep<'_> {
+        Sleep {
+            ctx: self,
+            duration,
+            slot: None,
+        }
+    }
+
+    /// Sends an HTTP request to the upstream cluster named `cluster_name`, and returns a future
+    /// that resolves to the result of `on_response` called with the response, or None if the
+    /// request failed. The headers must contain `:method`, `:path` and `:authority`, and
+    /// `timeout` of zero means no timeout.
+    ///
+    /// `on_response` is called as soon as the response is received, since the response can't be
+    /// used after that, even if the future is dropped in the meantime.
+    pub fn callout<F, R>(
+        &self,
+        cluster_name: &str,
+        headers: &[(&[u8], &[u8])],
+        body: &[u8],
+        timeout: Duration,
+        on_response: F,
+    ) -> Callout<F, R>
+    where
+        F: FnOnce(&ResponseHeaders, &ResponseBodyBuffer) -> R + 'static,
+        R: 'static,
+    {
+        let slot = Rc::new(CalloutSlot {
+            ctx: self,
+            on_response: Cell::new(Some(on_response)),
+            result: Cell::new(None),
+        });
+        // Registered first, since the done callback might be called before this returns.
+        self.callouts.borrow_mut().push(slot.clone());
+        let headers_ptr = if headers.is_empty() {
+            ptr::null()
+        } else {
+            &headers[0] as *const _ as *const u8
+        };
+        let sent = unsafe {
+            abi::envoy_dynamic_module_http_send_callout(
+                self.envoy_filter_instance.raw_addr,
+                cluster_name.as_ptr() as usize,
+                cluster_name.len(),
+                headers_ptr as usize,
+                headers.len(),
+                body.as_ptr() as usize,
+                body.len(),
+                timeout.as_millis() as u64,
+                Some(on_callout_done::<F, R>),
+                Rc::as_ptr(&slot) as usize,
+            )
+        };
+        if sent == 0 {
+            self.release_callout(Rc::as_ptr(&slot) as *const ());
+            slot.result.set(Some(None));
+        }
+        Callout { slot }
+    }
+
+    fn release_callout(&self, slot: *const ()) {
+        self.callouts
+            .borrow_mut()
+            .retain(|c| Rc::as_ptr(c) as *const () != slot);
+    }
+
+    // Polls the pending future of the stream, or has it polled again if it is being polled.
+    fn wake(&self) {
+        unsafe { (self.resume)(self.stream.get()) }
+    }
+}
+
+/// Wakes the stream when set while it is polled. A future woken from another thread is polled at
+/// the next event of the stream, as there is no way to run it on the worker thread from there.
+#[derive(Default)]
+struct WakeFlag(AtomicBool);
+
+impl Wake for WakeFlag {
+    fn wake(self: Arc<Self>) {
+        self.0.store(true, Ordering::Release);
+    }
+
+    fn wake_by_ref(self: &Arc<Self>) {
+        self.0.store(true, Ordering::Release);
+    }
+}
+
+struct TimerSlot {
+    timer: abi::envoy_dynamic_module_type_TimerPtr,
+    ctx: *const AsyncContext,
+    fired: Cell<bool>,
+}
+
+unsafe extern "C" fn on_timer(
+    _: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+    context: abi::envoy_dynamic_module_raw_pointer,
+) {
+    let slot = &*(context as *const TimerSlot);
+    slot.fired.set(true);
+    (*slot.ctx).wake();
+}
+
+/// The future returned by [`AsyncContext::sleep`].
+pub struct Sleep<'a> {
+    ctx: &'a AsyncContext,
+    duration: Duration,
+    slot: Option<Box<TimerSlot>>,
+}
+
+impl Future for Sleep<'_> {
+    type Output = ();
+
+    fn poll(self: Pin<&mut Self>, _: &mut Context<'_>) -> Poll<()> {
+        let this = self.get_mut();
+        let ctx = this.ctx;
+        match &this.slot {
+            None => {
+                let mut slot = ctx.free_timers.borrow_mut().pop().unwrap_or_else(|| {
+                    Box::new(TimerSlot {
+                        timer: 0,
+                        ctx,
+                        fired: Cell::new(false),
+                    })
+                });
+                if slot.timer == 0 {
+                    slot.timer = unsafe {
+                        abi::envoy_dynamic_module_http_create_timer(
+                            ctx.envoy_filter_instance.raw_addr,
+                            Some(on_timer),
+                            &*slot as *const TimerSlot as usize,
+                        )
+                    };
+                }
+                if slot.timer == 0 {
+                    // Not on a worker thread, so there is nothing to wait for.
+                    return Poll::Ready(());
+                }
+                slot.fired.set(false);
+                unsafe {
+                    abi::envoy_dynamic_module_http_enable_timer(
+                        slot.timer,
+                        this.duration.as_millis() as u64,
+                    )
+                };
+                this.slot = Some(slot);
+                Poll::Pending
+            }
+            Some(slot) if slot.fired.get() => {
+                ctx.free_timers.borrow_mut().push(this.slot.take().unwrap());
+                Poll::Ready(())
+            }
+            Some(_) => Poll::Pending,
+        }
+    }
+}
+
+impl Drop for Sleep<'_> {
+    fn drop(&mut self) {
+        if let Some(slot) = self.slot.take() {
+            // The timers are already freed by Envoy when the stream is destroyed.
+            if !self.ctx.destroyed.get() {
+                unsafe { abi::envoy_dynamic_module_http_disable_timer(slot.timer) };
+            }
+            self.ctx.free_timers.borrow_mut().push(slot);
+        }
+    }
+}
+
+struct CalloutSlot<F, R> {
+    ctx: *const AsyncContext,
+    on_response: Cell<Option<F>>,
+    // Set to Some when the callout is done, with None if it failed.
+    result: Cell<Option<Option<R>>>,
+}
+
+unsafe extern "C" fn on_callout_done<F, R>(
+    _: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+    context: abi::envoy_dynamic_module_raw_pointer,
+    response_headers: abi::envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
+    response_body: abi::envoy_dynamic_module_type_HttpResponseBodyBufferPtr,
+) where
+    F: FnOnce(&ResponseHeaders, &ResponseBodyBuffer) -> R + 'static,
+    R: 'static,
+{
+    let slot = &*(context as *const CalloutSlot<F, R>);
+    let ctx = &*slot.ctx;
+    let result = match slot.on_response.take() {
+        Some(on_response) if response_headers != 0 => Some(on_response(
+            &ResponseHeaders {
+                raw: response_headers,
+            },
+            &ResponseBodyBuffer { raw: response_body },
+        )),
+        _ => None,
+    };
+    slot.result.set(Some(result));
+    // This drops the slot if the future is already dropped.
+    ctx.release_callout(context as *const ());
+    ctx.wake();
+}
+
+/// The future returned by [`AsyncContext::callout`].
+pub struct Callout<F, R> {
+    slot: Rc<CalloutSlot<F, R>>,
+}
+
+impl<F, R> Future for Callout<F, R> {
+    type Output = Option<R>;
+
+    fn poll(self: Pin<&mut Self>, _: &mut Context<'_>) -> Poll<Option<R>> {
+        match self.slot.result.take() {
+            Some(result) => Poll::Ready(result),
+            None => Poll::Pending,
+        }
+    }
+}
+
+/// Adapts an [`AsyncHttpFilterInstance`] to [`HttpFilterInstance`], by polling the futures of its
+/// hooks on the worker thread of the stream.
+pub struct AsyncFilterInstance<T: AsyncHttpFilterInstance> {
+    stream: Rc<Stream<T>>,
+}
+
+impl<T: AsyncHttpFilterInstance> AsyncFilterInstance<T> {
+    /// Creates the filter instance for the stream of `envoy_filter_instance`.
+    pub fn new(envoy_filter_instance: EnvoyFilterInstance, instance: T) -> Self {
+        let woken = Arc::new(WakeFlag::default());
+        let stream = Rc::new(Stream {
+            task: RefCell::new(None),
+            deferred: RefCell::new(VecDeque::new()),
+            continue_request: Cell::new(false),
+            continue_response: Cell::new(false),
+            busy: Cell::new(false),
+            ctx: AsyncContext {
+                envoy_filter_instance,
+                resume: Stream::<T>::resume_erased,
+                stream: Cell::new(ptr::null()),
+                waker: Waker::from(woken.clone()),
+                woken,
+                free_timers: RefCell::new(Vec::new()),
+                callouts: RefCell::new(Vec::new()),
+                destroyed: Cell::new(false),
+            },
+            instance: UnsafeCell::new(instance),
+        });
+        stream.ctx.stream.set(Rc::as_ptr(&stream) as *const ());
+        AsyncFilterInstance { stream }
+    }
+}
+
+type Task = Pin<Box<dyn Future<Output = Outcome>>>;
+
+enum Event {
+    RequestHeaders(RequestHeaders, bool),
+    RequestBody(RequestBodyBuffer, bool),
+    ResponseHeaders(ResponseHeaders, bool),
+    ResponseBody(ResponseBodyBuffer, bool),
+}
+
+impl Event {
+    fn is_request(&self) -> bool {
+        matches!(self, Event::RequestHeaders(..) | Event::RequestBody(..))
+    }
+}
+
+enum Outcome {
+    RequestHeaders(RequestHeadersStatus),
+    RequestBody(RequestBodyStatus),
+    ResponseHeaders(ResponseHeadersStatus),
+    ResponseBody(ResponseBodyStatus),
+}
+
+// The state of a stream. The fields are dropped in this order, so that the pending future is
+// dropped before the context and the instance it borrows.
+struct Stream<T: AsyncHttpFilterInstance> {
+    // The future of the hook being waited on, if any.
+    task: RefCell<Option<Task>>,
+    // The events received while the task is pending, with the body frames of the same direction
+    // merged into one.
+    deferred: RefCell<VecDeque<Event>>,
+    // Whether the direction should be continued once no deferred event is left for it.
+    continue_request: Cell<bool>,
+    continue_response: Cell<bool>,
+    // Set while a future is polled, during which the hooks might be called back by Envoy.
+    busy: Cell<bool>,
+    ctx: AsyncContext,
+    instance: UnsafeCell<T>,
+}
+
+impl<T: AsyncHttpFilterInstance> Stream<T> {
+    unsafe fn resume_erased(stream: *const ()) {
+        // The stream is held until the poll returns, since Envoy might destroy it in the meantime.
+        let stream = stream as *const Stream<T>;
+        Rc::increment_strong_count(stream);
+        Rc::from_raw(stream).resume()
+    }
+
+    /// Handles an event from Envoy, and returns the outcome of the hook if it resolves right away.
+    /// Otherwise, the caller should stop the stream.
+    fn dispatch(&self, event: Event) -> Option<Outcome> {
+        if self.busy.get() || self.task.borrow().is_some() {
+            self.defer(event);
+            return None;
+        }
+        let outcome = self.poll(self.start(event))?;
+        // The hooks called back while polling are handled now.
+        self.drain();
+        Some(outcome)
+    }
+
+    fn defer(&self, event: Event) {
+        let mut deferred = self.deferred.borrow_mut();
+        match (deferred.back_mut(), &event) {
+            (Some(Event::RequestBody(_, eos)), Event::RequestBody(_, end_of_stream))
+            | (Some(Event::ResponseBody(_, eos)), Event::ResponseBody(_, end_of_stream)) => {
+                *eos |= *end_of_stream;
+            }
+            _ => deferred.push_back(event),
+        }
+    }
+
+    fn resume(&self) {
+        if self.busy.get() {
+            self.ctx.woken.wake_by_ref();
+            return;
+        }
+        if self.ctx.destroyed.get() {
+            return;
+        }
+        let Some(task) = self.task.borrow_mut().take() else {
+            return;
+        };
+        if let Some(outcome) = self.poll(task) {
+            self.record(outcome);
+            self.drain();
+        }
+    }
+
+    // Runs the hooks for the deferred events until one of them is pending, and continues the
+    // directions which are done.
+    fn drain(&self) {
+        loop {
+            self.flush_continues();
+            // Continuing might have called a hook which is now pending.
+            if self.task.borrow().is_some() {
+                return;
+            }
+            let Some(event) = self.deferred.borrow_mut().pop_front() else {
+                return;
+            };
+            // The frames are gone, so the body hooks see the buffered body instead.
+            let event = match event {
+                Event::RequestBody(_, end_of_stream) => Event::RequestBody(
+                    self.ctx.envoy_filter_instance.get_request_body_buffer(),
+                    end_of_stream,
+                ),
+                Event::ResponseBody(_, end_of_stream) => Event::ResponseBody(
+                    self.ctx.envoy_filter_instance.get_response_body_buffer(),
+                    end_of_stream,
+                ),
+                event => event,
+            };
+            match self.poll(self.start(event)) {
+                Some(outcome) => self.record(outcome),
+                None => return,
+            }
+        }
+    }
+
+    // Records the outcome of a hook for which the stream was stopped.
+    fn record(&self, outcome: Outcome) {
+        match outcome {
+            Outcome::RequestHeaders(status) => self
+                .continue_request
+                .set(matches!(status, RequestHeadersStatus::Continue)),
+            Outcome::RequestBody(status) => self
+                .continue_request
+                .set(matches!(status, RequestBodyStatus::Continue)),
+            Outcome::ResponseHeaders(status) => self
+                .continue_response
+                .set(matches!(status, ResponseHeadersStatus::Continue)),
+            Outcome::ResponseBody(status) => self
+                .continue_response
+                .set(matches!(status, ResponseBodyStatus::Continue)),
+        }
+    }
+
+    fn flush_continues(&self) {
+        let (pending_request, pending_response) = {
+            let deferred = self.deferred.borrow();
+            (
+                deferred.iter().any(Event::is_request),
+                deferred.iter().any(|e| !e.is_request()),
+            )
+        };
+        if self.continue_request.get() && !pending_request {
+            self.continue_request.set(false);
+            self.ctx.envoy_filter_instance.continue_request();
+        }
+        if self.continue_response.get() && !pending_response {
+            self.continue_response.set(false);
+            self.ctx.envoy_filter_instance.continue_response();
+        }
+    }
+
+    fn start(&self, event: Event) -> Task {
+        // SAFETY: the stream is reference counted and outlives the task, which is dropped first in
+        // destroy or in the drop of the stream. The instance is only borrowed by one task at a time, since
+        // the events are deferred while a task is pending.
+        let instance: &'static mut T = unsafe { &mut *self.instance.get() };
+        let ctx: &'static AsyncContext = unsafe { &*(&self.ctx as *const AsyncContext) };
+        match event {
+            Event::RequestHeaders(headers, end_of_stream) => Box::pin(async move {
+                Outcome::RequestHeaders(instance.request_headers(ctx, headers, end_of_stream).await)
+            }),
+            Event::RequestBody(buffer, end_of_stream) => Box::pin(async move {
+                Outcome::RequestBody(instance.request_body(ctx, buffer, end_of_stream).await)
+            }),
+            Event::ResponseHeaders(headers, end_of_stream) => Box::pin(async move {
+                Outcome::ResponseHeaders(
+                    instance.response_headers(ctx, headers, end_of_stream).await,
+                )
+            }),
+            Event::ResponseBody(buffer, end_of_stream) => Box::pin(async move {
+                Outcome::ResponseBody(instance.response_body(ctx, buffer, end_of_stream).await)
+            }),
+        }
+    }
+
+    // Polls the task, and returns its outcome if it is ready. Otherwise, the task is kept as the
+    // pending one, or dropped if Envoy destroyed the stream while it was polled.
+    fn poll(&self, mut task: Task) -> Option<Outcome> {
+        let mut cx = Context::from_waker(&self.ctx.waker);
+        self.busy.set(true);
+        let result = loop {
+            self.ctx.woken.0.store(false, Ordering::Relaxed);
+            let result = task.as_mut().poll(&mut cx);
+            // Polled again right away if woken while polling, e.g. by a callout which failed
+            // before being sent.
+            if result.is_ready() || !self.ctx.woken.0.load(Ordering::Acquire) {
+                break result;
+            }
+        };
+        self.busy.set(false);
+        if self.ctx.destroyed.get() {
+            drop(task);
+            self.destroy();
+            return None;
+        }
+        match result {
+            Poll::Ready(outcome) => Some(outcome),
+            Poll::Pending => {
+                *self.task.borrow_mut() = Some(task);
+                None
+            }
+        }
+    }
+
+    // Drops the pending future and destroys the instance. This is deferred to the end of the poll
+    // if the stream is destroyed by the future being polled, which still borrows the instance.
+    fn destroy(&self) {
+        self.ctx.destroyed.set(true);
+        if self.busy.get() {
+            return;
+        }
+        drop(self.task.borrow_mut().take());
+        self.deferred.borrow_mut().clear();
+        unsafe { (*self.instance.get()).destroy() }
+    }
+}
+
+impl<T: AsyncHttpFilterInstance> HttpFilterInstance for AsyncFilterInstance<T> {
+    fn request_headers(
+        &mut self,
+        request_headers: &RequestHeaders,
+        end_of_stream: bool,
+    ) -> RequestHeadersStatus {
+        match self
+            .stream
+            .clone()
+            .dispatch(Event::RequestHeaders(*request_headers, end_of_stream))
+        {
+            Some(Outcome::RequestHeaders(status)) => status,
+            _ => RequestHeadersStatus::StopAllIterationAndBuffer,
+        }
+    }
+
+    fn request_body(
+        &mut self,
+        request_body_frame: &RequestBodyBuffer,
+        end_of_stream: bool,
+    ) -> RequestBodyStatus {
+        match self
+            .stream
+            .clone()
+            .dispatch(Event::RequestBody(*request_body_frame, end_of_stream))
+        {
+            Some(Outcome::RequestBody(status)) => status,
+            _ => RequestBodyStatus::StopIterationAndBuffer,
+        }
+    }
+
+    fn response_headers(
+        &mut self,
+        response_headers: &ResponseHeaders,
+        end_of_stream: bool,
+    ) -> ResponseHeadersStatus {
+        match self
+            .stream
+            .clone()
+            .dispatch(Event::ResponseHeaders(*response_headers, end_of_stream))
+        {
+            Some(Outcome::ResponseHeaders(status)) => status,
+            _ => ResponseHeadersStatus::StopAllIterationAndBuffer,
+        }
+    }
+
+    fn response_body(
+        &mut self,
+        response_body_frame: &ResponseBodyBuffer,
+        end_of_stream: bool,
+    ) -> ResponseBodyStatus {
+        match self
+            .stream
+            .clone()
+            .dispatch(Event::ResponseBody(*response_body_frame, end_of_stream))
+        {
+            Some(Outcome::ResponseBody(status)) => status,
+            _ => ResponseBodyStatus::StopIterationAndBuffer,
+        }
+    }
+
+    fn destroy(&mut self) {
+        self.stream.destroy()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// The state of a mock Envoy filter instance, which is per test thread as the hooks and the
+    /// callbacks all run on it.
+    #[derive(Default)]
+    struct MockEnvoy {
+        // The calls into Envoy and into the hooks of the instance, in order.
+        log: Vec<String>,
+        timers: Vec<(abi::envoy_dynamic_module_type_TimerCallback, usize)>,
+        // Creating a timer fails as if not on a worker thread.
+        no_timers: bool,
+        callouts: Vec<(abi::envoy_dynamic_module_type_HttpCalloutDone, usize)>,
+    }
+
+    thread_local! {
+        static MOCK: RefCell<MockEnvoy> = RefCell::new(MockEnvoy::default());
+    }
+
+    fn log(entry: String) {
+        MOCK.with(|mock| mock.borrow_mut().log.push(entry));
+    }
+
+    fn take_log() -> Vec<String> {
+        MOCK.with(|mock| std::mem::take(&mut mock.borrow_mut().log))
+    }
+
+    fn fire_timer(timer: usize) {
+        let (callback, context) = MOCK.with(|mock| mock.borrow().timers[timer - 1]);
+        unsafe { callback.unwrap()(0, context) }
+    }
+
+    fn complete_callout(callout: usize, response_headers: usize, response_body: usize) {
+        let (done, context) = MOCK.with(|mock| mock.borrow().callouts[callout - 1]);
+        unsafe { done.unwrap()(0, context, response_headers, response_body) }
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_continue_request(_: usize) {
+        log("continue_request".to_string());
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_continue_response(_: usize) {
+        log("continue_response".to_string());
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_request_body_buffer(_: usize) -> usize {
+        0x99
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_response_body_buffer(_: usize) -> usize {
+        0x98
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_create_timer(
+        _: usize,
+        callback: abi::envoy_dynamic_module_type_TimerCallback,
+        context: usize,
+    ) -> usize {
+        MOCK.with(|mock| {
+            let mut mock = mock.borrow_mut();
+            if mock.no_timers {
+                return 0;
+            }
+            mock.timers.push((callback, context));
+            let timer = mock.timers.len();
+            mock.log.push(format!("create_timer {}", timer));
+            timer
+        })
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_enable_timer(timer: usize, timeout_milliseconds: u64) {
+        log(format!("enable_timer {} {}", timer, timeout_milliseconds));
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_disable_timer(timer: usize) {
+        log(format!("disable_timer {}", timer));
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_send_callout(
+        _: usize,
+        cluster_name: usize,
+        cluster_name_length: usize,
+        _: usize,
+        headers_size: usize,
+        _: usize,
+        body_length: usize,
+        timeout_milliseconds: u64,
+        done: abi::envoy_dynamic_module_type_HttpCalloutDone,
+        context: usize,
+    ) -> usize {
+        let cluster_name =
+            unsafe { std::slice::from_raw_parts(cluster_name as *const u8, cluster_name_length) };
+        let cluster_name = std::str::from_utf8(cluster_name).unwrap();
+        log(format!(
+            "send_callout {} {} {} {}",
+            cluster_name, headers_size, body_length, timeout_milliseconds
+        ));
+        if cluster_name == "unknown" {
+            return 0;
+        }
+        MOCK.with(|mock| mock.borrow_mut().callouts.push((done, context)));
+        1
+    }
+
+    fn new_filter<T: AsyncHttpFilterInstance>(instance: T) -> AsyncFilterInstance<T> {
+        AsyncFilterInstance::new(EnvoyFilterInstance { raw_addr: 0x1 }, instance)
+    }
+
+    // Logs that the future of a hook is dropped before it resolves.
+    struct PendingGuard(&'static str);
+
+    impl Drop for PendingGuard {
+        fn drop(&mut self) {
+            log(format!("{} dropped", self.0));
+        }
+    }
+
+    /// Sleeps in the header hooks for the given durations, if any.
+    struct SleepInstance {
+        request_headers_sleeps: Vec<u64>,
+        response_headers_sleeps: Vec<u64>,
+    }
+
+    impl AsyncHttpFilterInstance for SleepInstance {
+        async fn request_headers(
+            &mut self,
+            ctx: &AsyncContext,
+            request_headers: RequestHeaders,
+            end_of_stream: bool,
+        ) -> RequestHeadersStatus {
+            log(format!(
+                "request_headers {:#x} {}",
+                request_headers.raw, end_of_stream
+            ));
+            let guard = PendingGuard("request_headers");
+            for sleep in &self.request_headers_sleeps {
+                ctx.sleep(Duration::from_millis(*sleep)).await;
+            }
+            std::mem::forget(guard);
+            log("request_headers done".to_string());
+            RequestHeadersStatus::Continue
+        }
+
+        async fn request_body(
+            &mut self,
+            _ctx: &AsyncContext,
+            request_body_frame: RequestBodyBuffer,
+            end_of_stream: bool,
+        ) -> RequestBodyStatus {
+            log(format!(
+                "request_body {:#x} {}",
+                request_body_frame.raw, end_of_stream
+            ));
+            RequestBodyStatus::Continue
+        }
+
+        async fn response_headers(
+            &mut self,
+            ctx: &AsyncContext,
+            response_headers: ResponseHeaders,
+            end_of_stream: bool,
+        ) -> ResponseHeadersStatus {
+            log(format!(
+                "response_headers {:#x} {}",
+                response_headers.raw, end_of_stream
+            ));
+            for sleep in &self.response_headers_sleeps {
+                ctx.sleep(Duration::from_millis(*sleep)).await;
+            }
+            log("response_headers done".to_string());
+            ResponseHeadersStatus::Continue
+        }
+
+        async fn response_body(
+            &mut self,
+            _ctx: &AsyncContext,
+            response_body_frame: ResponseBodyBuffer,
+            end_of_stream: bool,
+        ) -> ResponseBodyStatus {
+            log(format!(
+                "response_body {:#x} {}",
+                response_body_frame.raw, end_of_stream
+            ));
+            ResponseBodyStatus::Continue
+        }
+
+        fn destroy(&mut self) {
+            log("destroy".to_string());
+        }
+    }
+
+    #[test]
+    fn resolved_hooks_are_not_stopped() {
+        let mut filter = new_filter(SleepInstance {
+            request_headers_sleeps: vec![],
+            response_headers_sleeps: vec![],
+        });
+        assert!(matches!(
+            filter.request_headers(&RequestHeaders { raw: 0x10 }, false),
+            RequestHeadersStatus::Continue
+        ));
+        assert!(matches!(
+            filter.request_body(&RequestBodyBuffer { raw: 0x11 }, true),
+            RequestBodyStatus::Continue
+        ));
+        filter.destroy();
+        assert_eq!(
+            take_log(),
+            [
+                "request_headers 0x10 false",
+                "request_headers done",
+                "request_body 0x11 true",
+                "destroy",
+            ]
+        );
+    }
+
+    #[test]
+    fn continue_after_defer() {
+        let mut filter = new_filter(SleepInstance {
+            request_headers_sleeps: vec![100],
+            response_headers_sleeps: vec![],
+        });
+        assert!(matches!(
+            filter.request_headers(&RequestHeaders { raw: 0x10 }, false),
+            RequestHeadersStatus::StopAllIterationAndBuffer
+        ));
+        // The body frames received in the meantime are merged into one event.
+        assert!(matches!(
+            filter.request_body(&RequestBodyBuffer { raw: 0x11 }, false),
+            RequestBodyStatus::StopIterationAndBuffer
+        ));
+        assert!(matches!(
+            filter.request_body(&RequestBodyBuffer { raw: 0x12 }, true),
+            RequestBodyStatus::StopIterationAndBuffer
+        ));
+        assert_eq!(
+            take_log(),
+            [
+                "request_headers 0x10 false",
+                "create_timer 1",
+                "enable_timer 1 100",
+            ]
+        );
+
+        // The body hook sees the buffered body, and the request is continued only after it.
+        fire_timer(1);
+        assert_eq!(
+            take_log(),
+            [
+                "request_headers done",
+                "request_body 0x99 true",
+                "continue_request",
+            ]
+        );
+
+        filter.destroy();
+        assert_eq!(take_log(), ["destroy"]);
+    }
+
+    #[test]
+    fn drain_deferred_events() {
+        let mut filter = new_filter(SleepInstance {
+            request_headers_sleeps: vec![100],
+            response_headers_sleeps: vec![200],
+        });
+        filter.request_headers(&RequestHeaders { raw: 0x10 }, false);
+        assert!(matches!(
+            filter.response_headers(&ResponseHeaders { raw: 0x20 }, false),
+            ResponseHeadersStatus::StopAllIterationAndBuffer
+        ));
+        assert!(matches!(
+            filter.response_body(&ResponseBodyBuffer { raw: 0x21 }, true),
+            ResponseBodyStatus::StopIterationAndBuffer
+        ));
+        filter.request_body(&RequestBodyBuffer { raw: 0x11 }, true);
+        take_log();
+
+        // The deferred events run in order until one of them is pending. The request isn't
+        // continued yet since its body event is still deferred.
+        fire_timer(1);
+        assert_eq!(
+            take_log(),
+            [
+                "request_headers done",
+                "response_headers 0x20 false",
+                "enable_timer 1 200",
+            ]
+        );
+
+        fire_timer(1);
+        assert_eq!(
+            take_log(),
+            [
+                "response_headers done",
+                "response_body 0x98 true",
+                "continue_response",
+                "request_body 0x99 true",
+                "continue_request",
+            ]
+        );
+
+        // Events received once the queue is drained run right away.
+        assert!(matches!(
+            filter.response_body(&ResponseBodyBuffer { raw: 0x22 }, true),
+            ResponseBodyStatus::Continue
+        ));
+        assert_eq!(take_log(), ["response_body 0x22 true"]);
+        filter.destroy();
+        take_log();
+    }
+
+    #[test]
+    fn destroy_while_pending() {
+        let mut filter = new_filter(SleepInstance {
+            request_headers_sleeps: vec![100],
+            response_headers_sleeps: vec![],
+        });
+        filter.request_headers(&RequestHeaders { raw: 0x10 }, false);
+        filter.request_body(&RequestBodyBuffer { raw: 0x11 }, true);
+        take_log();
+
+        // The pending future is dropped before the instance is destroyed, without touching the
+        // timer which Envoy frees with the stream, and the deferred events are never run.
+        filter.destroy();
+        assert_eq!(take_log(), ["request_headers dropped", "destroy"]);
+        drop(filter);
+        assert!(take_log().is_empty());
+    }
+
+    #[test]
+    fn timer_slot_reuse() {
+        let mut filter = new_filter(SleepInstance {
+            request_headers_sleeps: vec![100, 50],
+            response_headers_sleeps: vec![],
+        });
+        filter.request_headers(&RequestHeaders { raw: 0x10 }, false);
+        fire_timer(1);
+        assert_eq!(
+            take_log(),
+            [
+                "request_headers 0x10 false",
+                "create_timer 1",
+                "enable_timer 1 100",
+                "enable_timer 1 50",
+            ]
+        );
+        fire_timer(1);
+        assert_eq!(take_log(), ["request_headers done", "continue_request"]);
+        assert_eq!(filter.stream.ctx.free_timers.borrow().len(), 1);
+        filter.destroy();
+        take_log();
+    }
+
+    #[test]
+    fn sleep_without_timer() {
+        MOCK.with(|mock| mock.borrow_mut().no_timers = true);
+        let mut filter = new_filter(SleepInstance {
+            request_headers_sleeps: vec![100],
+            response_headers_sleeps: vec![],
+        });
+        assert!(matches!(
+            filter.request_headers(&RequestHeaders { raw: 0x10 }, true),
+            RequestHeadersStatus::Continue
+        ));
+        assert_eq!(
+            take_log(),
+            ["request_headers 0x10 true", "request_headers done"]
+        );
+        filter.destroy();
+        take_log();
+    }
+
+    /// Sends a callout which succeeds, one which fails to be sent, and one whose future is dropped.
+    struct CalloutInstance {}
+
+    impl AsyncHttpFilterInstance for CalloutInstance {
+        async fn request_headers(
+            &mut self,
+            ctx: &AsyncContext,
+            _request_headers: RequestHeaders,
+            _end_of_stream: bool,
+        ) -> RequestHeadersStatus {
+            let headers: [(&[u8], &[u8]); 1] = [(b":path", b"/")];
+            let response = ctx
+                .callout(
+                    "cluster",
+                    &headers,
+                    b"body",
+                    Duration::from_millis(5),
+                    |headers, body| (headers.raw, body.raw),
+                )
+                .await;
+            log(format!("callout {:x?}", response));
+            let failed = ctx
+                .callout("unknown", &[], b"", Duration::ZERO, |_, _| ())
+                .await;
+            log(format!("failed {:?}", failed));
+            drop(
+                ctx.callout("cluster", &[], b"", Duration::ZERO, |headers, _| {
+                    log(format!("dropped callout response {:#x}", headers.raw))
+                }),
+            );
+            RequestHeadersStatus::Continue
+        }
+    }
+
+    #[test]
+    fn callout_slot_release() {
+        let mut filter = new_filter(CalloutInstance {});
+        filter.request_headers(&RequestHeaders { raw: 0x10 }, false);
+        assert_eq!(take_log(), ["send_callout cluster 1 4 5"]);
+        assert_eq!(filter.stream.ctx.callouts.borrow().len(), 1);
+
+        complete_callout(1, 0x30, 0x31);
+        assert_eq!(
+            take_log(),
+            [
+                "callout Some((30, 31))",
+                "send_callout unknown 0 0 0",
+                "failed None",
+                "send_callout cluster 0 0 0",
+                "continue_request",
+            ]
+        );
+        // The slot of the dropped future is kept until the callout is done.
+        assert_eq!(filter.stream.ctx.callouts.borrow().len(), 1);
+
+        complete_callout(2, 0x40, 0x41);
+        assert_eq!(take_log(), ["dropped callout response 0x40"]);
+        assert!(filter.stream.ctx.callouts.borrow().is_empty());
+        filter.destroy();
+    }
+
+    #[test]
+    fn callout_failed_response() {
+        let mut filter = new_filter(CalloutInstance {});
+        filter.request_headers(&RequestHeaders { raw: 0x10 }, false);
+        take_log();
+
+        // A failed callout resolves to None without calling on_response.
+        complete_callout(1, 0, 0);
+        assert_eq!(take_log()[0], "callout None");
+        complete_callout(2, 0, 0);
+        assert!(take_log().is_empty());
+        assert!(filter.stream.ctx.callouts.borrow().is_empty());
+        filter.destroy();
+    }
+}
@@ -4,20 +4,29 @@
 #![allow(dead_code)]
 
 use log::{Level, Log, Metadata, Record, SetLoggerError};
+use std::marker::PhantomData;
 use std::ptr;
 
-mod abi {
+pub mod async_filter;
+
+#[doc(hidden)]
+pub mod abi {
     include!(concat!(env!("OUT_DIR"), "/bindings.rs"));
 }
 
-/// Define the init function for the module.
+/// Define the init function and the event hooks for the module.
 /// This macro should be used in the root of the module.
 ///
 /// ## Arguments
 ///
-/// * `$new_filter_fn` - The function that creates a new HttpFilter object: `fn(&str) -> Box<dyn HttpFilter>`.
-///     This function is called for each new filter chain configuration and should return a new HttpFilter object
-///     based on the configuration string.
+/// * `$new_filter_fn` - The function that creates a new filter object: `fn(&str) -> F` where `F`
+///     implements [`TypedHttpFilter`]. This function is called for each new filter chain
+///     configuration and should return a new filter object based on the configuration string.
+///
+/// The event hooks are generated for `F`, so when `F` and its [`TypedHttpFilter::Instance`] are
+/// concrete types, each hook is a direct call into them which the compiler can inline. Returning
+/// `Box<dyn HttpFilter>` is also supported to pick the filter by the configuration at runtime, at
+/// the cost of a dynamic dispatch in each hook.
 ///
 /// ## Example
 ///
@@ -27,6 +36,33 @@ mod abi {
 /// struct HelloWorldFilter {}
 /// struct HelloWorldFilterInstance {}
 ///
+/// impl TypedHttpFilter for HelloWorldFilter {
+///     type Instance = HelloWorldFilterInstance;
+///
+///     fn new_instance(&mut self, _envoy_filter_instance: EnvoyFilterInstance) -> HelloWorldFilterInstance {
+///         HelloWorldFilterInstance {}
+///     }
+/// }
+///
+/// impl HttpFilterInstance for HelloWorldFilterInstance {}
+///
+/// fn new_http_filter(config: &str) -> HelloWorldFilter {
+///     match config {
+///         "helloworld" => HelloWorldFilter {},
+///         _ => panic!("Unknown config: {}", config),
+///     }
+/// }
+/// init!(new_http_filter);
+/// ```
+///
+/// With dynamic dispatch:
+///
+/// ```
+/// use envoy_dynamic_modules_rust_sdk::*;
+///
+/// struct HelloWorldFilter {}
+/// struct HelloWorldFilterInstance {}
+///
 /// impl HttpFilter for HelloWorldFilter {
 ///    fn new_instance(&mut self, _envoy_filter_instance: EnvoyFilterInstance) -> Box<dyn HttpFilterInstance> {
 ///       Box::new(HelloWorldFilterInstance {})
@@ -42,144 +78,286 @@ mod abi {
 ///    }
 /// }
 /// init!(new_http_filter);
-///
-// TODO: eliminating the entire use of dyn keyword is possible. One idea is to take types as arguments to the macro,
-// and then generates the enum and dispatching logic accordingly. That way, we can also eliminate the double
-// boxing in raw pointer passing.
+/// ```
 #[macro_export]
 macro_rules! init {
     ($new_filter_fn:expr) => {
         #[no_mangle]
         pub extern "C" fn envoy_dynamic_module_on_program_init() -> usize {
-            unsafe {
-                envoy_dynamic_modules_rust_sdk::NEW_HTTP_FILTER_FN = $new_filter_fn;
-            }
             0
         }
-    };
-}
 
-pub static mut NEW_HTTP_FILTER_FN: fn(&str) -> Box<dyn HttpFilter> = |_: &str| {
-    panic!("NEW_HTTP_FILTER_FN is not set");
-};
-
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_init(
-    config_ptr: abi::envoy_dynamic_module_type_HttpFilterConfigPtr,
-    config_size: abi::envoy_dynamic_module_type_HttpFilterConfigSize,
-) -> abi::envoy_dynamic_module_type_HttpFilterPtr {
-    // Convert the raw pointer to the str.
-    let config = {
-        let slice = std::slice::from_raw_parts(config_ptr as *const u8, config_size);
-        std::str::from_utf8(slice).unwrap()
-    };
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_init(
+            config_ptr: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterConfigPtr,
+            config_size: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterConfigSize,
+        ) -> $crate::__private::abi::envoy_dynamic_module_type_HttpFilterPtr {
+            $crate::__private::on_http_filter_init(&$new_filter_fn, config_ptr, config_size)
+        }
 
-    let boxed_filter = Box::into_raw(NEW_HTTP_FILTER_FN(config));
-    let boxed_filter_ptr = Box::into_raw(Box::new(boxed_filter));
-    boxed_filter_ptr as abi::envoy_dynamic_module_type_HttpFilterPtr
-}
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_destroy(
+            http_filter: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterPtr,
+        ) {
+            $crate::__private::on_http_filter_destroy(&$new_filter_fn, http_filter)
+        }
+
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_init(
+            envoy_filter_instance_ptr: $crate::__private::abi::envoy_dynamic_module_type_EnvoyFilterInstancePtr,
+            http_filter: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterPtr,
+        ) -> $crate::__private::abi::envoy_dynamic_module_type_HttpFilterInstancePtr {
+            $crate::__private::on_http_filter_instance_init(
+                &$new_filter_fn,
+                envoy_filter_instance_ptr,
+                http_filter,
+            )
+        }
+
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_request_headers(
+            http_filter_instance: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+            request_headers_ptr: $crate::__private::abi::envoy_dynamic_module_type_HttpRequestHeadersMapPtr,
+            end_of_stream: $crate::__private::abi::envoy_dynamic_module_type_EndOfStream,
+        ) -> $crate::__private::abi::envoy_dynamic_module_type_EventHttpRequestHeadersStatus {
+            $crate::__private::on_http_filter_instance_request_headers(
+                &$new_filter_fn,
+                http_filter_instance,
+                request_headers_ptr,
+                end_of_stream,
+            )
+        }
+
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_request_body(
+            http_filter_instance: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+            buffer: $crate::__private::abi::envoy_dynamic_module_type_HttpRequestBodyBufferPtr,
+            end_of_stream: $crate::__private::abi::envoy_dynamic_module_type_EndOfStream,
+        ) -> $crate::__private::abi::envoy_dynamic_module_type_EventHttpRequestBodyStatus {
+            $crate::__private::on_http_filter_instance_request_body(
+                &$new_filter_fn,
+                http_filter_instance,
+                buffer,
+                end_of_stream,
+            )
+        }
+
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_response_headers(
+            http_filter_instance: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+            response_headers_map_ptr: $crate::__private::abi::envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
+            end_of_stream: $crate::__private::abi::envoy_dynamic_module_type_EndOfStream,
+        ) -> $crate::__private::abi::envoy_dynamic_module_type_EventHttpResponseHeadersStatus {
+            $crate::__private::on_http_filter_instance_response_headers(
+                &$new_filter_fn,
+                http_filter_instance,
+                response_headers_map_ptr,
+                end_of_stream,
+            )
+        }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_destroy(
-    http_filter: abi::envoy_dynamic_module_type_HttpFilterPtr,
-) {
-    let http_filter = http_filter as *mut *mut dyn HttpFilter;
-    (**http_filter).destroy();
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_response_body(
+            http_filter_instance: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+            buffer: $crate::__private::abi::envoy_dynamic_module_type_HttpResponseBodyBufferPtr,
+            end_of_stream: $crate::__private::abi::envoy_dynamic_module_type_EndOfStream,
+        ) -> $crate::__private::abi::envoy_dynamic_module_type_EventHttpResponseBodyStatus {
+            $crate::__private::on_http_filter_instance_response_body(
+                &$new_filter_fn,
+                http_filter_instance,
+                buffer,
+                end_of_stream,
+            )
+        }
 
-    // Drop the Box<dyn HttpFilter> and the Box<*mut dyn HttpFilter>
-    let _outer = Box::from_raw(http_filter);
-    let _inner = Box::from_raw(*http_filter);
+        #[no_mangle]
+        unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_destroy(
+            http_filter_instance: $crate::__private::abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+        ) {
+            $crate::__private::on_http_filter_instance_destroy(&$new_filter_fn, http_filter_instance)
+        }
+    };
 }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_init(
-    envoy_filter_instance_ptr: abi::envoy_dynamic_module_type_EnvoyFilterInstancePtr,
-    http_filter: abi::envoy_dynamic_module_type_HttpFilterPtr,
-) -> abi::envoy_dynamic_module_type_HttpFilterInstancePtr {
-    let http_filter = http_filter as *mut *mut dyn HttpFilter;
+/// The implementation of the event hooks generated by [`init!`]. Each function is generic over the
+/// filter type `F`, which is inferred from the function creating the filter passed as the first
+/// argument. The filter and each filter instance are passed to Envoy as a pointer to a single box.
+///
+/// This is not a part of the public API.
+#[doc(hidden)]
+pub mod __private {
+    use super::*;
+    pub use crate::abi;
+
+    pub unsafe fn on_http_filter_init<F: TypedHttpFilter>(
+        new_filter_fn: &impl Fn(&str) -> F,
+        config_ptr: abi::envoy_dynamic_module_type_HttpFilterConfigPtr,
+        config_size: abi::envoy_dynamic_module_type_HttpFilterConfigSize,
+    ) -> abi::envoy_dynamic_module_type_HttpFilterPtr {
+        // Convert the raw pointer to the str.
+        let config = {
+            let slice = std::slice::from_raw_parts(config_ptr as *const u8, config_size);
+            std::str::from_utf8(slice).unwrap()
+        };
+        Box::into_raw(Box::new(new_filter_fn(config)))
+            as abi::envoy_dynamic_module_type_HttpFilterPtr
+    }
+
+    pub unsafe fn on_http_filter_destroy<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        http_filter: abi::envoy_dynamic_module_type_HttpFilterPtr,
+    ) {
+        let http_filter = Box::from_raw(http_filter as *mut F);
+        http_filter.destroy();
+    }
 
-    let instance = {
-        let instance_boxed = (**http_filter).new_instance(EnvoyFilterInstance {
+    pub unsafe fn on_http_filter_instance_init<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        envoy_filter_instance_ptr: abi::envoy_dynamic_module_type_EnvoyFilterInstancePtr,
+        http_filter: abi::envoy_dynamic_module_type_HttpFilterPtr,
+    ) -> abi::envoy_dynamic_module_type_HttpFilterInstancePtr {
+        let http_filter = &mut *(http_filter as *mut F);
+        let instance = http_filter.new_instance(EnvoyFilterInstance {
             raw_addr: envoy_filter_instance_ptr,
         });
-        Box::into_raw(instance_boxed)
-    };
+        Box::into_raw(Box::new(instance)) as abi::envoy_dynamic_module_type_HttpFilterInstancePtr
+    }
 
-    let http_filter_instance = Box::into_raw(Box::new(instance));
-    http_filter_instance as abi::envoy_dynamic_module_type_HttpFilterInstancePtr
-}
+    #[inline]
+    unsafe fn instance<'a, F: TypedHttpFilter>(
+        http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+    ) -> &'a mut F::Instance {
+        &mut *(http_filter_instance as *mut F::Instance)
+    }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_request_headers(
-    http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
-    request_headers_ptr: abi::envoy_dynamic_module_type_HttpRequestHeadersMapPtr,
-    end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
-) -> abi::envoy_dynamic_module_type_EventHttpRequestHeadersStatus {
-    let http_filter_instance = http_filter_instance as *mut *mut dyn HttpFilterInstance;
-    let http_filter_instance = &mut **http_filter_instance;
-    http_filter_instance
-        .request_headers(
-            &RequestHeaders {
-                raw: request_headers_ptr,
-            },
-            end_of_stream == 1,
-        )
-        .into()
-}
+    pub unsafe fn on_http_filter_instance_request_headers<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+        request_headers_ptr: abi::envoy_dynamic_module_type_HttpRequestHeadersMapPtr,
+        end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
+    ) -> abi::envoy_dynamic_module_type_EventHttpRequestHeadersStatus {
+        instance::<F>(http_filter_instance)
+            .request_headers(
+                &RequestHeaders {
+                    raw: request_headers_ptr,
+                },
+                end_of_stream == 1,
+            )
+            .into()
+    }
+
+    pub unsafe fn on_http_filter_instance_request_body<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+        buffer: abi::envoy_dynamic_module_type_HttpRequestBodyBufferPtr,
+        end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
+    ) -> abi::envoy_dynamic_module_type_EventHttpRequestBodyStatus {
+        instance::<F>(http_filter_instance)
+            .request_body(&RequestBodyBuffer { raw: buffer }, end_of_stream == 1)
+            .into()
+    }
+
+    pub unsafe fn on_http_filter_instance_response_headers<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+        response_headers_map_ptr: abi::envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
+        end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
+    ) -> abi::envoy_dynamic_module_type_EventHttpResponseHeadersStatus {
+        instance::<F>(http_filter_instance)
+            .response_headers(
+                &ResponseHeaders {
+                    raw: response_headers_map_ptr,
+                },
+                end_of_stream == 1,
+            )
+            .into()
+    }
+
+    pub unsafe fn on_http_filter_instance_response_body<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+        buffer: abi::envoy_dynamic_module_type_HttpResponseBodyBufferPtr,
+        end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
+    ) -> abi::envoy_dynamic_module_type_EventHttpResponseBodyStatus {
+        instance::<F>(http_filter_instance)
+            .response_body(&ResponseBodyBuffer { raw: buffer }, end_of_stream == 1)
+            .into()
+    }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_request_body(
-    http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
-    buffer: abi::envoy_dynamic_module_type_HttpRequestBodyBufferPtr,
-    end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
-) -> abi::envoy_dynamic_module_type_EventHttpRequestBodyStatus {
-    let http_filter_instance = http_filter_instance as *mut *mut dyn HttpFilterInstance;
-    let http_filter_instance = &mut **http_filter_instance;
-    http_filter_instance
-        .request_body(&RequestBodyBuffer { raw: buffer }, end_of_stream == 1)
-        .into()
+    pub unsafe fn on_http_filter_instance_destroy<F: TypedHttpFilter>(
+        _: &impl Fn(&str) -> F,
+        http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+    ) {
+        let mut http_filter_instance = Box::from_raw(http_filter_instance as *mut F::Instance);
+        http_filter_instance.destroy();
+    }
 }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_response_headers(
-    http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
-    response_headers_map_ptr: abi::envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
-    end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
-) -> abi::envoy_dynamic_module_type_EventHttpResponseHeadersStatus {
-    let http_filter_instance = http_filter_instance as *mut *mut dyn HttpFilterInstance;
-    let http_filter_instance = &mut **http_filter_instance;
-    http_filter_instance
-        .response_headers(
-            &ResponseHeaders {
-                raw: response_headers_map_ptr,
-            },
-            end_of_stream == 1,
-        )
-        .into()
+/// A filter that creates the instances of a concrete type, so that the event hooks generated by
+/// [`init!`] call into them without dynamic dispatch. This is the statically dispatched
+/// counterpart of [`HttpFilter`], which is implemented for `Box<dyn HttpFilter>`.
+///
+/// This is only created once per filter chain configuration via the function passed to [`init!`].
+pub trait TypedHttpFilter {
+    /// The type of the filter instances created for each HTTP request.
+    type Instance: HttpFilterInstance;
+
+    /// This is called for each new HTTP request. This should return a new instance to handle the
+    /// request. See [`HttpFilter::new_instance`].
+    fn new_instance(&mut self, envoy_filter_instance: EnvoyFilterInstance) -> Self::Instance;
+
+    /// destroy is called when this filter is destroyed. See [`HttpFilter::destroy`].
+    fn destroy(&self) {}
 }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_response_body(
-    http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
-    buffer: abi::envoy_dynamic_module_type_HttpResponseBodyBufferPtr,
-    end_of_stream: abi::envoy_dynamic_module_type_EndOfStream,
-) -> abi::envoy_dynamic_module_type_EventHttpResponseBodyStatus {
-    let http_filter_instance = http_filter_instance as *mut *mut dyn HttpFilterInstance;
-    let http_filter_instance = &mut **http_filter_instance;
-    http_filter_instance
-        .response_body(&ResponseBodyBuffer { raw: buffer }, end_of_stream == 1)
-        .into()
+impl<T: HttpFilter + ?Sized> TypedHttpFilter for Box<T> {
+    type Instance = Box<dyn HttpFilterInstance>;
+
+    fn new_instance(&mut self, envoy_filter_instance: EnvoyFilterInstance) -> Self::Instance {
+        (**self).new_instance(envoy_filter_instance)
+    }
+
+    fn destroy(&self) {
+        (**self).destroy()
+    }
 }
 
-#[no_mangle]
-unsafe extern "C" fn envoy_dynamic_module_on_http_filter_instance_destroy(
-    http_filter_instance: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
-) {
-    let http_filter_instance = http_filter_instance as *mut *mut dyn HttpFilterInstance;
-    (**http_filter_instance).destroy();
+impl<T: HttpFilterInstance + ?Sized> HttpFilterInstance for Box<T> {
+    fn request_headers(
+        &mut self,
+        request_headers: &RequestHeaders,
+        end_of_stream: bool,
+    ) -> RequestHeadersStatus {
+        (**self).request_headers(request_headers, end_of_stream)
+    }
+
+    fn request_body(
+        &mut self,
+        request_body_frame: &RequestBodyBuffer,
+        end_of_stream: bool,
+    ) -> RequestBodyStatus {
+        (**self).request_body(request_body_frame, end_of_stream)
+    }
+
+    fn response_headers(
+        &mut self,
+        response_headers: &ResponseHeaders,
+        end_of_stream: bool,
+    ) -> ResponseHeadersStatus {
+        (**self).response_headers(response_headers, end_of_stream)
+    }
+
+    fn response_body(
+        &mut self,
+        response_body_frame: &ResponseBodyBuffer,
+        end_of_stream: bool,
+    ) -> ResponseBodyStatus {
+        (**self).response_body(response_body_frame, end_of_stream)
+    }
 
-    let _outer = Box::from_raw(http_filter_instance);
-    let _inner = Box::from_raw(&mut **http_filter_instance);
+    fn destroy(&mut self) {
+        (**self).destroy()
+    }
 }
 
 /// A trait that represents a single HTTP filter in the Envoy filter chain.
@@ -267,6 +445,28 @@ pub trait HttpFilterInstance {
     fn destroy(&mut self) {}
 }
 
+/// A handle to a stream which can be used from any thread, unlike [`EnvoyFilterInstance`].
+///
+/// Using it after the stream is destroyed is safe and has no effect.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct StreamHandle {
+    raw: abi::envoy_dynamic_module_type_StreamHandle,
+}
+
+impl StreamHandle {
+    /// Used to resume the request processing after the filter has stopped it. Returns false if the
+    /// stream is already destroyed.
+    pub fn continue_request(&self) -> bool {
+        unsafe { abi::envoy_dynamic_module_http_continue_request_by_handle(self.raw) != 0 }
+    }
+
+    /// Used to resume the response processing after the filter has stopped it. Returns false if the
+    /// stream is already destroyed.
+    pub fn continue_response(&self) -> bool {
+        unsafe { abi::envoy_dynamic_module_http_continue_response_by_handle(self.raw) != 0 }
+    }
+}
+
 /// An opaque object that represents the underlying Envoy Http filter instance.
 /// This is used to interact with it from the module code.
 ///
@@ -290,6 +490,13 @@ impl EnvoyFilterInstance {
         unsafe { abi::envoy_dynamic_module_http_continue_response(self.raw_addr) }
     }
 
+    /// Returns the handle of the stream which can be sent to other threads to continue the stream
+    /// from there. This must be called in one of the [`HttpFilterInstance`] methods.
+    pub fn stream_handle(&self) -> StreamHandle {
+        let raw = unsafe { abi::envoy_dynamic_module_http_get_stream_handle(self.raw_addr) };
+        StreamHandle { raw }
+    }
+
     /// Returns the entire request body buffer.
     pub fn get_request_body_buffer(&self) -> RequestBodyBuffer {
         let buffer =
@@ -329,6 +536,74 @@ impl EnvoyFilterInstance {
             )
         }
     }
+
+    /// Runs `work` on a thread of the offload pool of the module, e.g. to parse a large body off
+    /// the worker thread, and then `done` on the worker thread of the stream. `done` gets the
+    /// result of `work`, or None if the stream was destroyed in the meantime. In that case, `done`
+    /// may be called on the main thread when the pool is shut down, so it must be `Send` as well.
+    ///
+    /// The hook should return a stop status, and `done` should continue the stream. This must be
+    /// called in one of the [`HttpFilterInstance`] methods. If the offload pool is not configured
+    /// or its queue is full, this returns both functions back so that the work can be done inline.
+    pub fn offload<W, T, D>(&self, work: W, done: D) -> Result<(), (W, D)>
+    where
+        W: FnOnce() -> T + Send + 'static,
+        T: Send + 'static,
+        D: FnOnce(Option<T>) + Send + 'static,
+    {
+        let context = Box::into_raw(Box::new(Offload::<W, T, D> {
+            work: Some(work),
+            result: None,
+            done,
+        }));
+        let offloaded = unsafe {
+            abi::envoy_dynamic_module_http_offload(
+                self.raw_addr,
+                Some(offload_work::<W, T, D>),
+                Some(offload_done::<W, T, D>),
+                context as usize,
+            )
+        };
+        if offloaded == 0 {
+            let offload = unsafe { Box::from_raw(context) };
+            return Err((offload.work.unwrap(), offload.done));
+        }
+        Ok(())
+    }
+}
+
+// The context of EnvoyFilterInstance::offload. Only work and result are touched by the thread of
+// the offload pool, and done is only touched on the worker thread after Envoy posts it back, or on
+// the main thread if the pool is shut down before the work starts.
+struct Offload<W, T, D> {
+    work: Option<W>,
+    result: Option<T>,
+    done: D,
+}
+
+unsafe extern "C" fn offload_work<W, T, D>(context: abi::envoy_dynamic_module_raw_pointer)
+where
+    W: FnOnce() -> T,
+{
+    let offload = &mut *(context as *mut Offload<W, T, D>);
+    if let Some(work) = offload.work.take() {
+        offload.result = Some(work());
+    }
+}
+
+unsafe extern "C" fn offload_done<W, T, D>(
+    http_filter_instance_ptr: abi::envoy_dynamic_module_type_HttpFilterInstancePtr,
+    context: abi::envoy_dynamic_module_raw_pointer,
+) where
+    D: FnOnce(Option<T>),
+{
+    let Offload { result, done, .. } = *Box::from_raw(context as *mut Offload<W, T, D>);
+    // The work is skipped if the pool is shut down after the stream is destroyed.
+    done(if http_filter_instance_ptr == 0 {
+        None
+    } else {
+        result
+    });
 }
 
 /// An opaque object that represents the underlying Envoy Http request headers map.
@@ -371,45 +646,18 @@ impl RequestHeaders {
 
     /// Returns all the header values for the given key.
     pub fn values(&self, key: &[u8]) -> Vec<&[u8]> {
-        let key_ptr = key.as_ptr();
-        let key_size = key.len();
-
-        let mut result_ptr: *const u8 = ptr::null();
-        let mut result_size: usize = 0;
-
-        let mut values = Vec::new();
-        let total = unsafe {
-            abi::envoy_dynamic_module_http_get_request_header_value(
-                self.raw,
-                key_ptr as *const _ as usize,
-                key_size,
-                &mut result_ptr as *mut _ as usize,
-                &mut result_size as *mut _ as usize,
-            )
-        };
-
-        if total == 0 {
-            return values;
-        }
-
-        values = Vec::with_capacity(total);
-        values.push(unsafe { std::slice::from_raw_parts(result_ptr, result_size) });
-
-        for i in 1..total {
-            unsafe {
-                abi::envoy_dynamic_module_http_get_request_header_value_nth(
-                    self.raw,
-                    key_ptr as *const _ as usize,
-                    key_size,
-                    &mut result_ptr as *mut _ as usize,
-                    &mut result_size as *mut _ as usize,
-                    i,
-                );
-            }
-            values.push(unsafe { std::slice::from_raw_parts(result_ptr, result_size) });
-        }
+        self.values_iter(key).collect()
+    }
 
-        values
+    /// Returns an iterator over all the header values for the given key. Unlike
+    /// [`RequestHeaders::values`], this borrows the values from Envoy without allocating.
+    pub fn values_iter<'k>(&self, key: &'k [u8]) -> HeaderValues<'_, 'k> {
+        HeaderValues::new(
+            self.raw,
+            key,
+            abi::envoy_dynamic_module_http_get_request_header_value,
+            abi::envoy_dynamic_module_http_get_request_header_value_nth,
+        )
     }
 
     /// Sets the value for the given key. If multiple values are set for the same key,
@@ -456,8 +704,6 @@ impl RequestHeaders {
 /// This corresponds to either a frame of the request body or the whole body.
 ///
 /// This is a shallow wrapper around the raw pointer to the Envoy request body buffer.
-///
-/// TODO: implement the `std::io::Read` trait for this object.
 #[derive(Debug, Clone, Copy)]
 pub struct RequestBodyBuffer {
     raw: abi::envoy_dynamic_module_type_HttpRequestBodyBufferPtr,
@@ -477,56 +723,43 @@ impl RequestBodyBuffer {
     /// Returns the slices of the buffer.
     /// The slices are the contiguous memory regions that represent the buffer.
     pub fn slices(&self) -> Vec<&mut [u8]> {
-        let mut slices = Vec::new();
-        let slices_count = self.slices_count();
-        for i in 0..slices_count {
-            let mut slice_ptr: *mut u8 = ptr::null_mut();
-            let mut slice_size: usize = 0;
-            unsafe {
-                abi::envoy_dynamic_module_http_get_request_body_buffer_slice(
-                    self.raw,
-                    i,
-                    &mut slice_ptr as *mut _ as usize,
-                    &mut slice_size as *mut _ as usize,
-                );
-            }
-            slices.push(unsafe { std::slice::from_raw_parts_mut(slice_ptr, slice_size) });
-        }
-        slices
+        self.slices_iter().collect()
     }
 
-    fn slice_at(&self, index: usize) -> Option<&mut [u8]> {
-        if index >= self.slices_count() {
-            return None;
-        }
-
-        let mut slice_ptr: *mut u8 = ptr::null_mut();
-        let mut slice_size: usize = 0;
-        unsafe {
-            abi::envoy_dynamic_module_http_get_request_body_buffer_slice(
-                self.raw,
-                index,
-                &mut slice_ptr as *mut _ as usize,
-                &mut slice_size as *mut _ as usize,
-            );
-        }
-
-        Some(unsafe { std::slice::from_raw_parts_mut(slice_ptr, slice_size) })
+    /// Returns an iterator over the slices of the buffer. Unlike [`RequestBodyBuffer::slices`],
+    /// this borrows the slices from Envoy without allocating.
+    pub fn slices_iter(&self) -> BodySlices<'_, Self> {
+        BodySlices::new(*self)
     }
 
     /// Copies the entire buffer into a single contiguous Vec<u8> managed in Rust.
     pub fn copy(&self) -> Vec<u8> {
         let mut buffer = Vec::new();
-        let slices = self.slices();
-        for slice in slices {
-            buffer.extend_from_slice(slice);
-        }
+        self.copy_into(&mut buffer);
         buffer
     }
 
-    /// Returns a reader that implements the [`std::io::Read`] trait.
-    pub fn reader(&self) -> RequestBodyBufferReader {
-        RequestBodyBufferReader::from(*self)
+    /// Copies the entire buffer into the given Vec<u8>, replacing its contents. This reuses the
+    /// capacity of the Vec, so it doesn't allocate when the Vec is reused across calls.
+    pub fn copy_into(&self, buffer: &mut Vec<u8>) {
+        let length = self.length();
+        buffer.clear();
+        buffer.reserve(length);
+        unsafe {
+            abi::envoy_dynamic_module_http_copy_out_request_body_buffer(
+                self.raw,
+                0,
+                length,
+                buffer.as_mut_ptr() as usize,
+            );
+            buffer.set_len(length);
+        }
+    }
+
+    /// Returns a reader that implements the [`std::io::Read`], [`std::io::BufRead`] and
+    /// [`bytes::Buf`] traits without copying the slices.
+    pub fn reader(&self) -> RequestBodyBufferReader<'_> {
+        BodyBufferReader::new(self.slices_iter(), self.length())
     }
 
     /// Appends the given data to the buffer.
@@ -577,53 +810,38 @@ impl RequestBodyBuffer {
     }
 }
 
-pub struct RequestBodyBufferReader {
-    buffer: RequestBodyBuffer,
-    // The current index of the slice.
-    current_slice_index: usize,
-    // The current offset in the current slice.
-    current_slice_offset: usize,
-}
+/// This implements the [`std::io::Read`], [`std::io::BufRead`] and [`bytes::Buf`] traits for the
+/// [`RequestBodyBuffer`] object.
+pub type RequestBodyBufferReader<'a> = BodyBufferReader<'a, RequestBodyBuffer>;
 
-impl From<RequestBodyBuffer> for RequestBodyBufferReader {
-    fn from(buffer: RequestBodyBuffer) -> Self {
-        RequestBodyBufferReader {
-            buffer,
-            current_slice_index: 0,
-            current_slice_offset: 0,
+impl sealed::BodyBuffer for RequestBodyBuffer {
+    fn raw_slice(&self, index: usize) -> (*mut u8, usize) {
+        let mut slice_ptr: *mut u8 = ptr::null_mut();
+        let mut slice_size: usize = 0;
+        unsafe {
+            abi::envoy_dynamic_module_http_get_request_body_buffer_slice(
+                self.raw,
+                index,
+                &mut slice_ptr as *mut _ as usize,
+                &mut slice_size as *mut _ as usize,
+            );
         }
+        (slice_ptr, slice_size)
     }
-}
-
-impl std::io::Read for RequestBodyBufferReader {
-    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
-        // TODO: below obviously can be optimized. But for now, this is fine for the PoC.
-        let mut total_read = 0;
-        while total_read < buf.len() {
-            let current_slice = match self.buffer.slice_at(self.current_slice_index) {
-                Some(slice) => slice,
-                None => break,
-            };
-            let current_slice_len = current_slice.len();
-            if self.current_slice_offset >= current_slice_len {
-                self.current_slice_offset = 0;
-                self.current_slice_index += 1;
-                continue;
-            }
 
-            let remaining = buf.len() - total_read;
-            let remaining_slice = current_slice_len - self.current_slice_offset;
-            let read_size = std::cmp::min(remaining, remaining_slice);
-            buf[total_read..total_read + read_size].copy_from_slice(
-                &current_slice[self.current_slice_offset..self.current_slice_offset + read_size],
-            );
-            self.current_slice_offset += read_size;
-            total_read += read_size;
+    fn raw_slices(&self, slices: &mut [abi::envoy_dynamic_module_type_DataSlice]) -> usize {
+        unsafe {
+            abi::envoy_dynamic_module_http_get_request_body_buffer_slices(
+                self.raw,
+                slices.as_mut_ptr() as usize,
+                slices.len(),
+            )
         }
-        Ok(total_read)
     }
 }
 
+impl BodyBuffer for RequestBodyBuffer {}
+
 /// An opaque object that represents the underlying Envoy Http response headers map.
 /// This is used to interact with it from the module code.
 ///
@@ -662,45 +880,18 @@ impl ResponseHeaders {
 
     /// Returns all the header values for the given key.
     pub fn values(&self, key: &[u8]) -> Vec<&[u8]> {
-        let key_ptr = key.as_ptr();
-        let key_size = key.len();
-
-        let mut result_ptr: *const u8 = ptr::null();
-        let mut result_size: usize = 0;
-
-        let mut values = Vec::new();
-        let total = unsafe {
-            abi::envoy_dynamic_module_http_get_response_header_value(
-                self.raw,
-                key_ptr as *const _ as usize,
-                key_size,
-                &mut result_ptr as *mut _ as usize,
-                &mut result_size as *mut _ as usize,
-            )
-        };
-
-        if total == 0 {
-            return values;
-        }
-
-        values = Vec::with_capacity(total);
-        values.push(unsafe { std::slice::from_raw_parts(result_ptr, result_size) });
-
-        for i in 1..total {
-            unsafe {
-                abi::envoy_dynamic_module_http_get_response_header_value_nth(
-                    self.raw,
-                    key_ptr as *const _ as usize,
-                    key_size,
-                    &mut result_ptr as *mut _ as usize,
-                    &mut result_size as *mut _ as usize,
-                    i,
-                );
-            }
-            values.push(unsafe { std::slice::from_raw_parts(result_ptr, result_size) });
-        }
+        self.values_iter(key).collect()
+    }
 
-        values
+    /// Returns an iterator over all the header values for the given key. Unlike
+    /// [`ResponseHeaders::values`], this borrows the values from Envoy without allocating.
+    pub fn values_iter<'k>(&self, key: &'k [u8]) -> HeaderValues<'_, 'k> {
+        HeaderValues::new(
+            self.raw,
+            key,
+            abi::envoy_dynamic_module_http_get_response_header_value,
+            abi::envoy_dynamic_module_http_get_response_header_value_nth,
+        )
     }
 
     /// Sets the value for the given key. If multiple values are set for the same key,
@@ -762,57 +953,45 @@ impl ResponseBodyBuffer {
     }
 
     /// Returns the slices of the buffer.
+    /// The slices are the contiguous memory regions that represent the buffer.
     pub fn slices(&self) -> Vec<&mut [u8]> {
-        let mut slices = Vec::new();
-        let slices_count = self.slices_count();
-        for i in 0..slices_count {
-            let mut slice_ptr: *mut u8 = ptr::null_mut();
-            let mut slice_size: usize = 0;
-            unsafe {
-                abi::envoy_dynamic_module_http_get_response_body_buffer_slice(
-                    self.raw,
-                    i,
-                    &mut slice_ptr as *mut _ as usize,
-                    &mut slice_size as *mut _ as usize,
-                );
-            }
-            slices.push(unsafe { std::slice::from_raw_parts_mut(slice_ptr, slice_size) });
-        }
-        slices
+        self.slices_iter().collect()
     }
 
-    fn slice_at(&self, index: usize) -> Option<&mut [u8]> {
-        if index >= self.slices_count() {
-            return None;
-        }
-
-        let mut slice_ptr: *mut u8 = ptr::null_mut();
-        let mut slice_size: usize = 0;
-        unsafe {
-            abi::envoy_dynamic_module_http_get_response_body_buffer_slice(
-                self.raw,
-                index,
-                &mut slice_ptr as *mut _ as usize,
-                &mut slice_size as *mut _ as usize,
-            );
-        }
-
-        Some(unsafe { std::slice::from_raw_parts_mut(slice_ptr, slice_size) })
+    /// Returns an iterator over the slices of the buffer. Unlike [`ResponseBodyBuffer::slices`],
+    /// this borrows the slices from Envoy without allocating.
+    pub fn slices_iter(&self) -> BodySlices<'_, Self> {
+        BodySlices::new(*self)
     }
 
     /// Copies the entire buffer into a single contiguous Vec<u8> managed in Rust.
     pub fn copy(&self) -> Vec<u8> {
         let mut buffer = Vec::new();
-        let slices = self.slices();
-        for slice in slices {
-            buffer.extend_from_slice(slice);
-        }
+        self.copy_into(&mut buffer);
         buffer
     }
 
-    /// Returns a reader that implements the [`std::io::Read`] trait.
-    pub fn reader(&self) -> ResponseBodyBufferReader {
-        ResponseBodyBufferReader::from(*self)
+    /// Copies the entire buffer into the given Vec<u8>, replacing its contents. This reuses the
+    /// capacity of the Vec, so it doesn't allocate when the Vec is reused across calls.
+    pub fn copy_into(&self, buffer: &mut Vec<u8>) {
+        let length = self.length();
+        buffer.clear();
+        buffer.reserve(length);
+        unsafe {
+            abi::envoy_dynamic_module_http_copy_out_response_body_buffer(
+                self.raw,
+                0,
+                length,
+                buffer.as_mut_ptr() as usize,
+            );
+            buffer.set_len(length);
+        }
+    }
+
+    /// Returns a reader that implements the [`std::io::Read`], [`std::io::BufRead`] and
+    /// [`bytes::Buf`] traits without copying the slices.
+    pub fn reader(&self) -> ResponseBodyBufferReader<'_> {
+        BodyBufferReader::new(self.slices_iter(), self.length())
     }
 
     /// Appends the given data to the buffer.
@@ -863,54 +1042,286 @@ impl ResponseBodyBuffer {
     }
 }
 
-/// This implements the [`std::io::Read`] trait for the [`ResponseBodyBuffer`] object.]
-pub struct ResponseBodyBufferReader {
-    buffer: ResponseBodyBuffer,
-    // The current index of the slice.
-    current_slice_index: usize,
-    // The current offset in the current slice.
-    current_slice_offset: usize,
-}
+/// This implements the [`std::io::Read`], [`std::io::BufRead`] and [`bytes::Buf`] traits for the
+/// [`ResponseBodyBuffer`] object.
+pub type ResponseBodyBufferReader<'a> = BodyBufferReader<'a, ResponseBodyBuffer>;
 
-impl From<ResponseBodyBuffer> for ResponseBodyBufferReader {
-    fn from(buffer: ResponseBodyBuffer) -> Self {
-        ResponseBodyBufferReader {
-            buffer,
-            current_slice_index: 0,
-            current_slice_offset: 0,
-        }
-    }
+impl sealed::BodyBuffer for ResponseBodyBuffer {
+    fn raw_slice(&self, index: usize) -> (*mut u8, usize) {
+        let mut slice_ptr: *mut u8 = ptr::null_mut();
+        let mut slice_size: usize = 0;
+        unsafe {
+            abi::envoy_dynamic_module_http_get_response_body_buffer_slice(
+                self.raw,
+                index,
+                &mut slice_ptr as *mut _ as usize,
+                &mut slice_size as *mut _ as usize,
+            );
+        }
+        (slice_ptr, slice_size)
+    }
+
+    fn raw_slices(&self, slices: &mut [abi::envoy_dynamic_module_type_DataSlice]) -> usize {
+        unsafe {
+            abi::envoy_dynamic_module_http_get_response_body_buffer_slices(
+                self.raw,
+                slices.as_mut_ptr() as usize,
+                slices.len(),
+            )
+        }
+    }
 }
 
-impl std::io::Read for ResponseBodyBufferReader {
-    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
-        // TODO: below obviously can be optimized. But for now, this is fine for the PoC.
-        let mut total_read = 0;
-        while total_read < buf.len() {
-            let current_slice = match self.buffer.slice_at(self.current_slice_index) {
-                Some(slice) => slice,
-                None => break,
-            };
-            let current_slice_len = current_slice.len();
-            if self.current_slice_offset >= current_slice_len {
-                self.current_slice_offset = 0;
-                self.current_slice_index += 1;
-                continue;
-            }
+impl BodyBuffer for ResponseBodyBuffer {}
 
-            let remaining = buf.len() - total_read;
-            let remaining_slice = current_slice_len - self.current_slice_offset;
-            let read_size = std::cmp::min(remaining, remaining_slice);
-            buf[total_read..total_read + read_size].copy_from_slice(
-                &current_slice[self.current_slice_offset..self.current_slice_offset + read_size],
+/// Creates a slice from a pointer and a length returned by Envoy, which may be null when empty.
+unsafe fn slice_from_raw<'a>(data: *mut u8, length: usize) -> &'a mut [u8] {
+    if length == 0 {
+        return &mut [];
+    }
+    std::slice::from_raw_parts_mut(data, length)
+}
+
+/// An iterator over the values of a header, which borrows the values from Envoy without copying.
+/// This is returned by [`RequestHeaders::values_iter`] and [`ResponseHeaders::values_iter`].
+pub struct HeaderValues<'a, 'k> {
+    raw: abi::envoy_dynamic_module_raw_pointer,
+    key: &'k [u8],
+    get_nth: HeaderValueNthFn,
+    first: Option<&'a [u8]>,
+    index: usize,
+    total: usize,
+}
+
+type HeaderValueFn = unsafe extern "C" fn(usize, usize, usize, usize, usize) -> usize;
+type HeaderValueNthFn = unsafe extern "C" fn(usize, usize, usize, usize, usize, usize);
+
+impl<'a, 'k> HeaderValues<'a, 'k> {
+    fn new(
+        raw: abi::envoy_dynamic_module_raw_pointer,
+        key: &'k [u8],
+        get: HeaderValueFn,
+        get_nth: HeaderValueNthFn,
+    ) -> Self {
+        let mut result_ptr: *mut u8 = ptr::null_mut();
+        let mut result_size: usize = 0;
+        // The first value comes with the total number of values.
+        let total = unsafe {
+            get(
+                raw,
+                key.as_ptr() as usize,
+                key.len(),
+                &mut result_ptr as *mut _ as usize,
+                &mut result_size as *mut _ as usize,
+            )
+        };
+        HeaderValues {
+            raw,
+            key,
+            get_nth,
+            first: (total > 0).then(|| unsafe { &*slice_from_raw(result_ptr, result_size) }),
+            index: 0,
+            total,
+        }
+    }
+}
+
+impl<'a, 'k> Iterator for HeaderValues<'a, 'k> {
+    type Item = &'a [u8];
+
+    fn next(&mut self) -> Option<&'a [u8]> {
+        if self.index >= self.total {
+            return None;
+        }
+        let index = self.index;
+        self.index += 1;
+        if index == 0 {
+            return self.first;
+        }
+
+        let mut result_ptr: *mut u8 = ptr::null_mut();
+        let mut result_size: usize = 0;
+        unsafe {
+            (self.get_nth)(
+                self.raw,
+                self.key.as_ptr() as usize,
+                self.key.len(),
+                &mut result_ptr as *mut _ as usize,
+                &mut result_size as *mut _ as usize,
+                index,
             );
-            self.current_slice_offset += read_size;
+            Some(slice_from_raw(result_ptr, result_size))
+        }
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let remaining = self.total - self.index;
+        (remaining, Some(remaining))
+    }
+}
+
+impl ExactSizeIterator for HeaderValues<'_, '_> {}
+
+/// Either [`RequestBodyBuffer`] or [`ResponseBodyBuffer`], over which [`BodySlices`] and
+/// [`BodyBufferReader`] are implemented.
+pub trait BodyBuffer: Copy + sealed::BodyBuffer {}
+
+mod sealed {
+    use super::abi;
+
+    /// The raw operations of a body buffer, which can't be implemented outside of this crate.
+    pub trait BodyBuffer {
+        fn raw_slice(&self, index: usize) -> (*mut u8, usize);
+        /// Writes the first slices up to the length of `slices`, and returns the total number.
+        fn raw_slices(&self, slices: &mut [abi::envoy_dynamic_module_type_DataSlice]) -> usize;
+    }
+}
+
+/// The number of slices fetched at once by [`BodySlices`]. The slices of Envoy are typically 16KiB,
+/// so most bodies are fetched with a single call.
+const BODY_SLICES_BATCH: usize = 8;
+
+/// An iterator over the slices of a body buffer, which borrows the slices from Envoy without
+/// copying. This is returned by [`RequestBodyBuffer::slices_iter`] and
+/// [`ResponseBodyBuffer::slices_iter`].
+///
+/// The first slices are fetched at once into the iterator itself, and the rest one by one, so this
+/// doesn't allocate. The iterator must not be used after the buffer is modified.
+pub struct BodySlices<'a, B: BodyBuffer> {
+    buffer: B,
+    batch: [abi::envoy_dynamic_module_type_DataSlice; BODY_SLICES_BATCH],
+    index: usize,
+    count: usize,
+    _marker: PhantomData<&'a mut [u8]>,
+}
+
+impl<'a, B: BodyBuffer> BodySlices<'a, B> {
+    fn new(buffer: B) -> Self {
+        let mut batch =
+            [abi::envoy_dynamic_module_type_DataSlice { data: 0, length: 0 }; BODY_SLICES_BATCH];
+        let count = buffer.raw_slices(&mut batch);
+        BodySlices {
+            buffer,
+            batch,
+            index: 0,
+            count,
+            _marker: PhantomData,
+        }
+    }
+}
+
+impl<'a, B: BodyBuffer> Iterator for BodySlices<'a, B> {
+    type Item = &'a mut [u8];
+
+    fn next(&mut self) -> Option<&'a mut [u8]> {
+        if self.index >= self.count {
+            return None;
+        }
+        let (data, length) = match self.batch.get(self.index) {
+            Some(slice) => (slice.data as *mut u8, slice.length),
+            None => self.buffer.raw_slice(self.index),
+        };
+        self.index += 1;
+        Some(unsafe { slice_from_raw(data, length) })
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        let remaining = self.count - self.index;
+        (remaining, Some(remaining))
+    }
+}
+
+impl<B: BodyBuffer> ExactSizeIterator for BodySlices<'_, B> {}
+
+/// A reader over a body buffer, which reads the slices of Envoy in place. This implements
+/// [`std::io::BufRead`] and [`bytes::Buf`], so that parsers consuming them can read the body
+/// without copying it, as well as [`std::io::Read`].
+///
+/// The reader must not be used after the buffer is modified.
+pub struct BodyBufferReader<'a, B: BodyBuffer> {
+    slices: BodySlices<'a, B>,
+    // The unread part of the current slice, only empty at the end of the buffer.
+    current: &'a [u8],
+    // The number of bytes not read yet, including the current slice.
+    remaining: usize,
+}
+
+impl<'a, B: BodyBuffer> BodyBufferReader<'a, B> {
+    fn new(slices: BodySlices<'a, B>, length: usize) -> Self {
+        let mut reader = BodyBufferReader {
+            slices,
+            current: &[],
+            remaining: length,
+        };
+        reader.next_slice();
+        reader
+    }
+
+    // Moves to the next non-empty slice if the current one is read.
+    fn next_slice(&mut self) {
+        while self.current.is_empty() {
+            match self.slices.next() {
+                Some(slice) => self.current = slice,
+                None => return,
+            }
+        }
+    }
+
+    fn consume_current(&mut self, amt: usize) {
+        self.current = &self.current[amt..];
+        self.remaining -= amt;
+        self.next_slice();
+    }
+}
+
+impl<B: BodyBuffer> std::io::Read for BodyBufferReader<'_, B> {
+    fn read(&mut self, buf: &mut [u8]) -> std::io::Result<usize> {
+        let mut total_read = 0;
+        while total_read < buf.len() && !self.current.is_empty() {
+            let read_size = std::cmp::min(buf.len() - total_read, self.current.len());
+            buf[total_read..total_read + read_size].copy_from_slice(&self.current[..read_size]);
+            self.consume_current(read_size);
             total_read += read_size;
         }
         Ok(total_read)
     }
 }
 
+impl<B: BodyBuffer> std::io::BufRead for BodyBufferReader<'_, B> {
+    fn fill_buf(&mut self) -> std::io::Result<&[u8]> {
+        Ok(self.current)
+    }
+
+    fn consume(&mut self, amt: usize) {
+        self.consume_current(amt);
+    }
+}
+
+impl<B: BodyBuffer> bytes::Buf for BodyBufferReader<'_, B> {
+    fn remaining(&self) -> usize {
+        self.remaining
+    }
+
+    fn chunk(&self) -> &[u8] {
+        self.current
+    }
+
+    fn advance(&mut self, mut cnt: usize) {
+        assert!(
+            cnt <= self.remaining,
+            "cannot advance past the end of the buffer"
+        );
+        while cnt > 0 {
+            let n = std::cmp::min(cnt, self.current.len());
+            if n == 0 {
+                break;
+            }
+            self.consume_current(n);
+            cnt -= n;
+        }
+    }
+}
+
 /// The status of the processing after the [`HttpFilterInstance::request_headers`] is called.
 pub enum RequestHeadersStatus {
     /// Should be returned when the operation should continue.
@@ -1093,3 +1504,661 @@ impl Log for EnvoyLogger {
 
     fn flush(&self) {}
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use bytes::Buf;
+    use std::io::{BufRead, Read};
+
+    /// A fake body buffer of Envoy, whose address is passed to the SDK as the raw buffer pointer.
+    struct FakeBody {
+        slices: Vec<Vec<u8>>,
+    }
+
+    impl FakeBody {
+        fn new(slices: &[&[u8]]) -> Self {
+            FakeBody {
+                slices: slices.iter().map(|s| s.to_vec()).collect(),
+            }
+        }
+
+        fn request(&self) -> RequestBodyBuffer {
+            RequestBodyBuffer {
+                raw: self as *const _ as usize,
+            }
+        }
+
+        fn response(&self) -> ResponseBodyBuffer {
+            ResponseBodyBuffer {
+                raw: self as *const _ as usize,
+            }
+        }
+
+        fn bytes(&self) -> Vec<u8> {
+            self.slices.concat()
+        }
+    }
+
+    unsafe fn fake_body<'a>(buffer: usize) -> &'a mut FakeBody {
+        &mut *(buffer as *mut FakeBody)
+    }
+
+    fn fake_body_length(buffer: usize) -> usize {
+        unsafe { fake_body(buffer) }
+            .slices
+            .iter()
+            .map(Vec::len)
+            .sum()
+    }
+
+    fn fake_body_slice(buffer: usize, nth: usize, result_ptr: usize, result_length: usize) {
+        let slice = &mut unsafe { fake_body(buffer) }.slices[nth];
+        unsafe {
+            // Envoy may return a null pointer for an empty slice.
+            *(result_ptr as *mut *mut u8) = if slice.is_empty() {
+                ptr::null_mut()
+            } else {
+                slice.as_mut_ptr()
+            };
+            *(result_length as *mut usize) = slice.len();
+        }
+    }
+
+    fn fake_body_slices(buffer: usize, result: usize, capacity: usize) -> usize {
+        let slices = &mut unsafe { fake_body(buffer) }.slices;
+        let result = result as *mut abi::envoy_dynamic_module_type_DataSlice;
+        for (i, slice) in slices.iter_mut().take(capacity).enumerate() {
+            unsafe {
+                *result.add(i) = abi::envoy_dynamic_module_type_DataSlice {
+                    data: slice.as_mut_ptr() as usize,
+                    length: slice.len(),
+                };
+            }
+        }
+        slices.len()
+    }
+
+    fn fake_body_copy_out(buffer: usize, offset: usize, length: usize, result: usize) {
+        let bytes = unsafe { fake_body(buffer) }.bytes();
+        let result = unsafe { std::slice::from_raw_parts_mut(result as *mut u8, length) };
+        result.copy_from_slice(&bytes[offset..offset + length]);
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_request_body_buffer_length(buffer: usize) -> usize {
+        fake_body_length(buffer)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_response_body_buffer_length(
+        buffer: usize,
+    ) -> usize {
+        fake_body_length(buffer)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_request_body_buffer_slice(
+        buffer: usize,
+        nth: usize,
+        result_ptr: usize,
+        result_length: usize,
+    ) {
+        fake_body_slice(buffer, nth, result_ptr, result_length)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_response_body_buffer_slice(
+        buffer: usize,
+        nth: usize,
+        result_ptr: usize,
+        result_length: usize,
+    ) {
+        fake_body_slice(buffer, nth, result_ptr, result_length)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_request_body_buffer_slices(
+        buffer: usize,
+        result: usize,
+        capacity: usize,
+    ) -> usize {
+        fake_body_slices(buffer, result, capacity)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_response_body_buffer_slices(
+        buffer: usize,
+        result: usize,
+        capacity: usize,
+    ) -> usize {
+        fake_body_slices(buffer, result, capacity)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_copy_out_request_body_buffer(
+        buffer: usize,
+        offset: usize,
+        length: usize,
+        result: usize,
+    ) {
+        fake_body_copy_out(buffer, offset, length, result)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_copy_out_response_body_buffer(
+        buffer: usize,
+        offset: usize,
+        length: usize,
+        result: usize,
+    ) {
+        fake_body_copy_out(buffer, offset, length, result)
+    }
+
+    /// A fake header map of Envoy, whose address is passed to the SDK as the raw map pointer.
+    struct FakeHeaders {
+        headers: Vec<(&'static [u8], &'static [u8])>,
+    }
+
+    fn fake_header_values(headers: usize, key: usize, key_length: usize) -> Vec<&'static [u8]> {
+        let headers = unsafe { &*(headers as *const FakeHeaders) };
+        let key = unsafe { std::slice::from_raw_parts(key as *const u8, key_length) };
+        headers
+            .headers
+            .iter()
+            .filter(|(k, _)| *k == key)
+            .map(|(_, v)| *v)
+            .collect()
+    }
+
+    fn fake_header_value_nth(
+        headers: usize,
+        key: usize,
+        key_length: usize,
+        result_ptr: usize,
+        result_length: usize,
+        nth: usize,
+    ) -> usize {
+        let values = fake_header_values(headers, key, key_length);
+        let value = values.get(nth).copied().unwrap_or_default();
+        unsafe {
+            *(result_ptr as *mut *const u8) = value.as_ptr();
+            *(result_length as *mut usize) = value.len();
+        }
+        values.len()
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_request_header_value(
+        headers: usize,
+        key: usize,
+        key_length: usize,
+        result_ptr: usize,
+        result_length: usize,
+    ) -> usize {
+        fake_header_value_nth(headers, key, key_length, result_ptr, result_length, 0)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_request_header_value_nth(
+        headers: usize,
+        key: usize,
+        key_length: usize,
+        result_ptr: usize,
+        result_length: usize,
+        nth: usize,
+    ) {
+        fake_header_value_nth(headers, key, key_length, result_ptr, result_length, nth);
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_response_header_value(
+        headers: usize,
+        key: usize,
+        key_length: usize,
+        result_ptr: usize,
+        result_length: usize,
+    ) -> usize {
+        fake_header_value_nth(headers, key, key_length, result_ptr, result_length, 0)
+    }
+
+    #[no_mangle]
+    extern "C" fn envoy_dynamic_module_http_get_response_header_value_nth(
+        headers: usize,
+        key: usize,
+        key_length: usize,
+        result_ptr: usize,
+        result_length: usize,
+        nth: usize,
+    ) {
+        fake_header_value_nth(headers, key, key_length, result_ptr, result_length, nth);
+    }
+
+    // More slices than BODY_SLICES_BATCH, so that the rest are fetched one by one, with empty
+    // slices at the start, in the middle, across the batch boundary and at the end.
+    fn multi_slice_body() -> FakeBody {
+        FakeBody::new(&[
+            b"", b"ab", b"c", b"", b"def", b"g", b"hi", b"", b"", b"jkl", b"m", b"",
+        ])
+    }
+
+    #[test]
+    fn slices_iter() {
+        let body = multi_slice_body();
+        assert!(body.slices.len() > BODY_SLICES_BATCH);
+
+        let buffer = body.request();
+        let slices = buffer.slices_iter();
+        assert_eq!(slices.len(), body.slices.len());
+        let slices: Vec<Vec<u8>> = slices.map(|s| s.to_vec()).collect();
+        assert_eq!(slices, body.slices);
+
+        let slices: Vec<Vec<u8>> = body
+            .response()
+            .slices()
+            .iter()
+            .map(|s| s.to_vec())
+            .collect();
+        assert_eq!(slices, body.slices);
+
+        let buffer = body.request();
+        let mut slices = buffer.slices_iter();
+        slices.nth(BODY_SLICES_BATCH - 1);
+        assert_eq!(slices.len(), body.slices.len() - BODY_SLICES_BATCH);
+        assert_eq!(slices.next().unwrap(), b"");
+        assert_eq!(slices.next().unwrap(), b"jkl");
+    }
+
+    #[test]
+    fn slices_iter_in_place() {
+        let body = FakeBody::new(&[b"abc", b"def"]);
+        for slice in body.request().slices_iter() {
+            slice.make_ascii_uppercase();
+        }
+        assert_eq!(body.bytes(), b"ABCDEF");
+    }
+
+    #[test]
+    fn slices_iter_empty() {
+        let body = FakeBody::new(&[]);
+        assert_eq!(body.request().slices_iter().len(), 0);
+        assert!(body.response().slices_iter().next().is_none());
+    }
+
+    #[test]
+    fn values_iter() {
+        let headers = FakeHeaders {
+            headers: vec![(b"a", b"1"), (b"b", b"x"), (b"a", b""), (b"a", b"3")],
+        };
+        let raw = &headers as *const _ as usize;
+        let request_headers = RequestHeaders { raw };
+        let response_headers = ResponseHeaders { raw };
+
+        let values = request_headers.values_iter(b"a");
+        assert_eq!(values.len(), 3);
+        assert_eq!(values.collect::<Vec<_>>(), [&b"1"[..], b"", b"3"]);
+        assert_eq!(response_headers.values(b"b"), [b"x"]);
+        assert_eq!(request_headers.values_iter(b"c").len(), 0);
+        assert!(response_headers.values_iter(b"c").next().is_none());
+    }
+
+    #[test]
+    fn copy_into() {
+        let body = multi_slice_body();
+
+        // A destination shorter than the body grows to fit it.
+        let mut buffer = Vec::with_capacity(1);
+        buffer.push(b'x');
+        body.request().copy_into(&mut buffer);
+        assert_eq!(buffer, body.bytes());
+
+        // A destination longer than the body is truncated to it.
+        let mut buffer = vec![b'x'; 64];
+        body.response().copy_into(&mut buffer);
+        assert_eq!(buffer, body.bytes());
+
+        FakeBody::new(&[]).request().copy_into(&mut buffer);
+        assert!(buffer.is_empty());
+        assert_eq!(body.response().copy(), body.bytes());
+    }
+
+    #[test]
+    fn reader_read() {
+        let body = multi_slice_body();
+
+        // Reads smaller than the slices, and across the slice boundaries.
+        let buffer = body.request();
+        let mut reader = buffer.reader();
+        let mut buf = [0; 3];
+        let mut read = Vec::new();
+        loop {
+            let n = reader.read(&mut buf).unwrap();
+            if n == 0 {
+                break;
+            }
+            read.extend_from_slice(&buf[..n]);
+        }
+        assert_eq!(read, body.bytes());
+        assert_eq!(reader.read(&mut buf).unwrap(), 0);
+
+        let mut read = Vec::new();
+        body.response().reader().read_to_end(&mut read).unwrap();
+        assert_eq!(read, body.bytes());
+    }
+
+    #[test]
+    fn reader_buf_read() {
+        let body = multi_slice_body();
+        let buffer = body.request();
+        let mut reader = buffer.reader();
+
+        // The leading empty slice is skipped.
+        assert_eq!(reader.fill_buf().unwrap(), b"ab");
+        reader.consume(1);
+        assert_eq!(reader.fill_buf().unwrap(), b"b");
+        reader.consume(1);
+        assert_eq!(reader.fill_buf().unwrap(), b"c");
+        // Consuming the slice to the end skips the following empty slice.
+        reader.consume(1);
+        assert_eq!(reader.fill_buf().unwrap(), b"def");
+        reader.consume(0);
+        assert_eq!(reader.fill_buf().unwrap(), b"def");
+        reader.consume(3);
+        reader.consume(1);
+        // Across the empty slices before and after the batch boundary.
+        assert_eq!(reader.fill_buf().unwrap(), b"hi");
+        reader.consume(2);
+        assert_eq!(reader.fill_buf().unwrap(), b"jkl");
+
+        let mut rest = String::new();
+        reader.read_line(&mut rest).unwrap();
+        assert_eq!(rest, "jklm");
+        assert!(reader.fill_buf().unwrap().is_empty());
+    }
+
+    #[test]
+    fn reader_buf() {
+        let body = multi_slice_body();
+        let buffer = body.request();
+        let mut reader = buffer.reader();
+        assert_eq!(reader.remaining(), body.bytes().len());
+        assert_eq!(reader.chunk(), b"ab");
+
+        reader.advance(1);
+        assert_eq!(reader.remaining(), body.bytes().len() - 1);
+        assert_eq!(reader.chunk(), b"b");
+        // Across the slice boundaries and the empty slices.
+        reader.advance(5);
+        assert_eq!(reader.chunk(), b"g");
+        assert_eq!(reader.copy_to_bytes(4), &b"ghij"[..]);
+        assert_eq!(reader.chunk(), b"kl");
+        reader.advance(reader.remaining());
+        assert_eq!(reader.remaining(), 0);
+        assert!(reader.chunk().is_empty());
+        assert!(!reader.has_remaining());
+    }
+
+    #[test]
+    #[should_panic(expected = "cannot advance past the end of the buffer")]
+    fn reader_buf_advance_past_end() {
+        let body = FakeBody::new(&[b"ab", b"c"]);
+        body.response().reader().advance(4);
+    }
+
+    #[test]
+    fn reader_empty_slices() {
+        let body = FakeBody::new(&[b"", b""]);
+        let buffer = body.request();
+        let mut reader = buffer.reader();
+        assert_eq!(reader.remaining(), 0);
+        assert!(reader.fill_buf().unwrap().is_empty());
+        assert_eq!(reader.read(&mut [0; 4]).unwrap(), 0);
+
+        let body = FakeBody::new(&[]);
+        assert_eq!(body.response().reader().read(&mut [0; 4]).unwrap(), 0);
+    }
+
+    thread_local! {
+        // The calls into the filters in order, which the hooks run on the calling thread.
+        static CALLS: std::cell::RefCell<Vec<String>> = const { std::cell::RefCell::new(Vec::new()) };
+    }
+
+    fn record(call: String) {
+        CALLS.with(|calls| calls.borrow_mut().push(call));
+    }
+
+    fn take_calls() -> Vec<String> {
+        CALLS.with(|calls| calls.take())
+    }
+
+    /// Records each call with the raw pointers passed to it, and its drop, so that the tests can
+    /// check that each hook reaches the right method and each box is freed exactly once.
+    struct RecordingInstance {
+        name: String,
+    }
+
+    impl HttpFilterInstance for RecordingInstance {
+        fn request_headers(
+            &mut self,
+            request_headers: &RequestHeaders,
+            end_of_stream: bool,
+        ) -> RequestHeadersStatus {
+            record(format!(
+                "{} request_headers {:#x} {}",
+                self.name, request_headers.raw, end_of_stream
+            ));
+            RequestHeadersStatus::StopIteration
+        }
+
+        fn request_body(
+            &mut self,
+            request_body_frame: &RequestBodyBuffer,
+            end_of_stream: bool,
+        ) -> RequestBodyStatus {
+            record(format!(
+                "{} request_body {:#x} {}",
+                self.name, request_body_frame.raw, end_of_stream
+            ));
+            RequestBodyStatus::StopIterationAndBuffer
+        }
+
+        fn response_headers(
+            &mut self,
+            response_headers: &ResponseHeaders,
+            end_of_stream: bool,
+        ) -> ResponseHeadersStatus {
+            record(format!(
+                "{} response_headers {:#x} {}",
+                self.name, response_headers.raw, end_of_stream
+            ));
+            ResponseHeadersStatus::StopAllIterationAndBuffer
+        }
+
+        fn response_body(
+            &mut self,
+            response_body_frame: &ResponseBodyBuffer,
+            end_of_stream: bool,
+        ) -> ResponseBodyStatus {
+            record(format!(
+                "{} response_body {:#x} {}",
+                self.name, response_body_frame.raw, end_of_stream
+            ));
+            ResponseBodyStatus::Continue
+        }
+
+        fn destroy(&mut self) {
+            record(format!("{} destroy", self.name));
+        }
+    }
+
+    impl Drop for RecordingInstance {
+        fn drop(&mut self) {
+            record(format!("{} drop", self.name));
+        }
+    }
+
+    struct TypedFilter {
+        config: String,
+        instances: usize,
+    }
+
+    impl TypedHttpFilter for TypedFilter {
+        type Instance = RecordingInstance;
+
+        fn new_instance(
+            &mut self,
+            envoy_filter_instance: EnvoyFilterInstance,
+        ) -> RecordingInstance {
+            self.instances += 1;
+            let name = format!("{}/{}", self.config, self.instances);
+            record(format!(
+                "{} new {:#x}",
+                name, envoy_filter_instance.raw_addr
+            ));
+            RecordingInstance { name }
+        }
+
+        fn destroy(&self) {
+            record(format!("{} destroy", self.config));
+        }
+    }
+
+    impl Drop for TypedFilter {
+        fn drop(&mut self) {
+            record(format!("{} drop", self.config));
+        }
+    }
+
+    fn new_typed_filter(config: &str) -> TypedFilter {
+        record(format!("{} new", config));
+        TypedFilter {
+            config: config.to_string(),
+            instances: 0,
+        }
+    }
+
+    struct DynFilter {
+        config: String,
+        instances: usize,
+    }
+
+    impl HttpFilter for DynFilter {
+        fn new_instance(
+            &mut self,
+            envoy_filter_instance: EnvoyFilterInstance,
+        ) -> Box<dyn HttpFilterInstance> {
+            self.instances += 1;
+            let name = format!("{}/{}", self.config, self.instances);
+            record(format!(
+                "{} new {:#x}",
+                name, envoy_filter_instance.raw_addr
+            ));
+            Box::new(RecordingInstance { name })
+        }
+
+        fn destroy(&self) {
+            record(format!("{} destroy", self.config));
+        }
+    }
+
+    impl Drop for DynFilter {
+        fn drop(&mut self) {
+            record(format!("{} drop", self.config));
+        }
+    }
+
+    fn new_dyn_filter(config: &str) -> Box<dyn HttpFilter> {
+        record(format!("{} new", config));
+        Box::new(DynFilter {
+            config: config.to_string(),
+            instances: 0,
+        })
+    }
+
+    init!(new_typed_filter);
+
+    // The calls expected from the hooks run by the tests below, in order.
+    fn expected_calls(config: &str) -> Vec<String> {
+        [
+            format!("{config} new"),
+            format!("{config}/1 new 0x10"),
+            format!("{config}/2 new 0x20"),
+            format!("{config}/1 request_headers 0x11 false"),
+            format!("{config}/1 request_body 0x12 true"),
+            format!("{config}/2 response_headers 0x21 true"),
+            format!("{config}/2 response_body 0x22 false"),
+            format!("{config}/1 destroy"),
+            format!("{config}/1 drop"),
+            format!("{config}/2 destroy"),
+            format!("{config}/2 drop"),
+            format!("{config} destroy"),
+            format!("{config} drop"),
+        ]
+        .to_vec()
+    }
+
+    #[test]
+    fn typed_filter_hooks() {
+        let config = "typed";
+        unsafe {
+            assert_eq!(envoy_dynamic_module_on_program_init(), 0);
+            let filter =
+                envoy_dynamic_module_on_http_filter_init(config.as_ptr() as usize, config.len());
+            let first = envoy_dynamic_module_on_http_filter_instance_init(0x10, filter);
+            let second = envoy_dynamic_module_on_http_filter_instance_init(0x20, filter);
+            assert_eq!(
+                envoy_dynamic_module_on_http_filter_instance_request_headers(first, 0x11, 0),
+                abi::envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopIteration
+            );
+            assert_eq!(
+                envoy_dynamic_module_on_http_filter_instance_request_body(first, 0x12, 1),
+                abi::envoy_dynamic_module_type_EventHttpRequestBodyStatusStopIterationAndBuffer
+            );
+            assert_eq!(
+                envoy_dynamic_module_on_http_filter_instance_response_headers(second, 0x21, 1),
+                abi::envoy_dynamic_module_type_EventHttpResponseHeadersStatusStopAllIterationAndBuffer
+            );
+            assert_eq!(
+                envoy_dynamic_module_on_http_filter_instance_response_body(second, 0x22, 0),
+                abi::envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue
+            );
+            envoy_dynamic_module_on_http_filter_instance_destroy(first);
+            envoy_dynamic_module_on_http_filter_instance_destroy(second);
+            envoy_dynamic_module_on_http_filter_destroy(filter);
+        }
+        assert_eq!(take_calls(), expected_calls(config));
+    }
+
+    #[test]
+    fn dyn_filter_hooks() {
+        // The hooks generated by init! for new_dyn_filter, which returns Box<dyn HttpFilter>.
+        use __private::*;
+        let new_filter = &new_dyn_filter;
+        let config = "dyn";
+        unsafe {
+            let filter = on_http_filter_init(new_filter, config.as_ptr() as usize, config.len());
+            let first = on_http_filter_instance_init(new_filter, 0x10, filter);
+            let second = on_http_filter_instance_init(new_filter, 0x20, filter);
+            assert_eq!(
+                on_http_filter_instance_request_headers(new_filter, first, 0x11, 0),
+                abi::envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopIteration
+            );
+            assert_eq!(
+                on_http_filter_instance_request_body(new_filter, first, 0x12, 1),
+                abi::envoy_dynamic_module_type_EventHttpRequestBodyStatusStopIterationAndBuffer
+            );
+            assert_eq!(
+                on_http_filter_instance_response_headers(new_filter, second, 0x21, 1),
+                abi::envoy_dynamic_module_type_EventHttpResponseHeadersStatusStopAllIterationAndBuffer
+            );
+            assert_eq!(
+                on_http_filter_instance_response_body(new_filter, second, 0x22, 0),
+                abi::envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue
+            );
+            on_http_filter_instance_destroy(new_filter, first);
+            on_http_filter_instance_destroy(new_filter, second);
+            on_http_filter_destroy(new_filter, filter);
+        }
+        assert_eq!(take_calls(), expected_calls(config));
+    }
+}
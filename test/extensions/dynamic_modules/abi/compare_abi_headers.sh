@@ -5,6 +5,8 @@ set -e
 ORIGINAL_ABI=$1
 GO_ABI=$2
 RUST_ABI=$3
+CPP_ABI=$4
 
 diff "$ORIGINAL_ABI" "$GO_ABI" || (echo "abi.h in Go SDK must be updated" && exit 1)
-diff "$ORIGINAL_ABI" "$RUST_ABI" || (echo "abi.h in Rust SDK must be updated" && exit 1)
\ No newline at end of file
+diff "$ORIGINAL_ABI" "$RUST_ABI" || (echo "abi.h in Rust SDK must be updated" && exit 1)
+diff "$ORIGINAL_ABI" "$CPP_ABI" || (echo "abi.h in C++ SDK must be updated" && exit 1)
\ No newline at end of file
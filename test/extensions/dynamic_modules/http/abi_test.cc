@@ -538,6 +538,30 @@ TEST(TestABI, BufferCopyOut) {
   }
 }
 
+TEST(TestABI, GetBodySlices) {
+  Buffer::OwnedImpl buffer;
+  buffer.appendSliceForTest("hello");
+  buffer.appendSliceForTest(" ");
+  buffer.appendSliceForTest("world");
+  const auto expected = buffer.getRawSlices();
+  ASSERT_EQ(expected.size(), 3);
+
+  std::vector<envoy_dynamic_module_type_DataSlice> slices(3);
+  EXPECT_EQ(envoy_dynamic_module_http_get_request_body_buffer_slices(&buffer, slices.data(), 3), 3);
+  std::string result;
+  for (const auto& slice : slices) {
+    EXPECT_EQ(slice.data, expected[&slice - slices.data()].mem_);
+    result.append(static_cast<const char*>(slice.data), slice.length);
+  }
+  EXPECT_EQ(result, "hello world");
+
+  // Only the slices fitting the capacity are written, and the total count is returned.
+  std::vector<envoy_dynamic_module_type_DataSlice> small(1);
+  EXPECT_EQ(envoy_dynamic_module_http_get_response_body_buffer_slices(&buffer, small.data(), 1), 3);
+  EXPECT_EQ(std::string(static_cast<const char*>(small[0].data), small[0].length), "hello");
+  EXPECT_EQ(envoy_dynamic_module_http_get_response_body_buffer_slices(&buffer, nullptr, 0), 3);
+}
+
 } // namespace Http
 } // namespace DynamicModules
 } // namespace Extensions
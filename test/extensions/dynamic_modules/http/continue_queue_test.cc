@@ -0,0 +1,134 @@
+#include "gtest/gtest.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "source/extensions/dynamic_modules/http/continue_queue.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+using testing::ReturnRef;
+
+class ContinueQueueTest : public testing::Test {
+public:
+  void SetUp() override {
+    module_ = loadTestDynamicModule("stream_init", "");
+    ON_CALL(dispatcher_, post(_)).WillByDefault([this](Event::PostCb callback) {
+      posted_.push_back(std::move(callback));
+    });
+  }
+
+  std::shared_ptr<HttpFilter> newStream(NiceMock<Http::MockStreamDecoderFilterCallbacks>& decoder,
+                                        NiceMock<Http::MockStreamEncoderFilterCallbacks>& encoder) {
+    ON_CALL(decoder, dispatcher()).WillByDefault(ReturnRef(dispatcher_));
+    auto filter = std::make_shared<HttpFilter>(module_);
+    filter->setDecoderFilterCallbacks(decoder);
+    filter->setEncoderFilterCallbacks(encoder);
+    return filter;
+  }
+
+  void runPosted() {
+    std::vector<Event::PostCb> posted;
+    posted.swap(posted_);
+    for (auto& callback : posted) {
+      callback();
+    }
+  }
+
+  HttpDynamicModuleSharedPtr module_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  std::vector<Event::PostCb> posted_;
+};
+
+TEST_F(ContinueQueueTest, SameQueueForWorker) {
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder1, decoder2;
+  NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder1, encoder2;
+  auto filter1 = newStream(decoder1, encoder1);
+  auto filter2 = newStream(decoder2, encoder2);
+  EXPECT_NE(filter1->continue_queue_, nullptr);
+  EXPECT_EQ(filter1->continue_queue_, filter2->continue_queue_);
+
+  NiceMock<Event::MockDispatcher> other_dispatcher;
+  EXPECT_NE(ContinueQueue::forDispatcher(other_dispatcher), filter1->continue_queue_);
+}
+
+TEST_F(ContinueQueueTest, BurstIsDrainedInSingleWakeup) {
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder1, decoder2;
+  NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder1, encoder2;
+  auto filter1 = newStream(decoder1, encoder1);
+  auto filter2 = newStream(decoder2, encoder2);
+  ContinueQueueSharedPtr queue = filter1->continue_queue_;
+
+  queue->push(filter1, ContinueQueue::Direction::Request);
+  queue->push(filter2, ContinueQueue::Direction::Response);
+  // Continuing the same stream twice must not call into the callbacks twice.
+  queue->push(filter1, ContinueQueue::Direction::Request);
+  EXPECT_EQ(posted_.size(), 1);
+  EXPECT_EQ(queue->wakeups(), 1);
+
+  EXPECT_CALL(decoder1, continueDecoding());
+  EXPECT_CALL(encoder2, continueEncoding());
+  runPosted();
+  EXPECT_TRUE(filter1->in_continue_);
+  EXPECT_TRUE(filter2->in_continue_);
+
+  // The next push after the drain wakes up the worker again.
+  filter1->in_continue_ = false;
+  queue->push(filter1, ContinueQueue::Direction::Request);
+  EXPECT_EQ(posted_.size(), 1);
+  EXPECT_EQ(queue->wakeups(), 2);
+  EXPECT_CALL(decoder1, continueDecoding());
+  runPosted();
+}
+
+TEST_F(ContinueQueueTest, PushFromManyThreads) {
+  constexpr int streams = 16;
+  std::vector<std::unique_ptr<NiceMock<Http::MockStreamDecoderFilterCallbacks>>> decoders;
+  std::vector<std::unique_ptr<NiceMock<Http::MockStreamEncoderFilterCallbacks>>> encoders;
+  std::vector<std::shared_ptr<HttpFilter>> filters;
+  for (int i = 0; i < streams; i++) {
+    decoders.push_back(std::make_unique<NiceMock<Http::MockStreamDecoderFilterCallbacks>>());
+    encoders.push_back(std::make_unique<NiceMock<Http::MockStreamEncoderFilterCallbacks>>());
+    filters.push_back(newStream(*decoders.back(), *encoders.back()));
+    EXPECT_CALL(*decoders.back(), continueDecoding());
+  }
+  ContinueQueueSharedPtr queue = filters[0]->continue_queue_;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < streams; i++) {
+    threads.emplace_back([&, i]() { queue->push(filters[i], ContinueQueue::Direction::Request); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(posted_.size(), 1);
+  runPosted();
+}
+
+TEST_F(ContinueQueueTest, DestroyedStreamIsNotContinued) {
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder;
+  NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder;
+  auto filter = newStream(decoder, encoder);
+  filter->continue_queue_->push(filter, ContinueQueue::Direction::Request);
+  filter->onDestroy();
+
+  EXPECT_CALL(decoder, continueDecoding()).Times(0);
+  runPosted();
+  EXPECT_FALSE(filter->in_continue_);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+#include <memory>
+#include <vector>
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/http/message_impl.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/upstream/cluster_manager.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+
+// Runs the cpp_coroutine test program, which is written with the coroutine layer of the C++ SDK.
+// Envoy's buffering of the frames stopped with StopIterationAndBuffer is done by hand.
+class CppCoroutineTest : public testing::Test {
+public:
+  void SetUp() override {
+    module_ = loadTestDynamicModule("cpp_coroutine", "");
+    live_frames_ = module_->dynamic_module_->getFunctionPointer<size_t (*)()>(
+        "cpp_coroutine_live_frames");
+    ASSERT_NE(live_frames_, nullptr);
+
+    ON_CALL(decoder_.dispatcher_, post(_)).WillByDefault([this](Event::PostCb callback) {
+      posted_.push_back(std::move(callback));
+    });
+    ON_CALL(decoder_, decodingBuffer()).WillByDefault([this]() -> const Buffer::Instance* {
+      return request_buffered_.length() > 0 ? &request_buffered_ : nullptr;
+    });
+    ON_CALL(encoder_, encodingBuffer()).WillByDefault([this]() -> const Buffer::Instance* {
+      return response_buffered_.length() > 0 ? &response_buffered_ : nullptr;
+    });
+    cluster_manager_.initializeThreadLocalClusters({"auth"});
+    filter_ = std::make_shared<HttpFilter>(module_, nullptr, &cluster_manager_);
+    filter_->setDecoderFilterCallbacks(decoder_);
+    filter_->setEncoderFilterCallbacks(encoder_);
+  }
+
+  void runPosted() {
+    std::vector<Event::PostCb> posted;
+    posted.swap(posted_);
+    for (auto& callback : posted) {
+      callback();
+    }
+  }
+
+  HttpDynamicModuleSharedPtr module_;
+  size_t (*live_frames_)() = nullptr;
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_;
+  NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder_;
+  std::vector<Event::PostCb> posted_;
+  Buffer::OwnedImpl request_buffered_;
+  Buffer::OwnedImpl response_buffered_;
+  NiceMock<Upstream::MockClusterManager> cluster_manager_;
+  NiceMock<Http::MockAsyncClientRequest> request_{
+      &cluster_manager_.thread_local_cluster_.async_client_};
+  std::shared_ptr<HttpFilter> filter_;
+};
+
+TEST_F(CppCoroutineTest, RequestFrames) {
+  auto* timer = new NiceMock<Event::MockTimer>(&decoder_.dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(100), _));
+  Http::TestRequestHeaderMapImpl headers{{"delay", "100"}};
+  EXPECT_EQ(filter_->decodeHeaders(headers, false), FilterHeadersStatus::StopIteration);
+  EXPECT_EQ(live_frames_(), 1);
+
+  // The frame is buffered while the task sleeps.
+  Buffer::OwnedImpl hello("hello");
+  EXPECT_EQ(filter_->decodeData(hello, false), FilterDataStatus::StopIterationAndBuffer);
+  request_buffered_.move(hello);
+
+  // The task sees the buffered frame after waking up, and continues the request once it awaits the
+  // next frame.
+  timer->invokeCallback();
+  EXPECT_EQ(headers.get_("x-delayed"), "true");
+  EXPECT_EQ(request_buffered_.toString(), "HELLO");
+  EXPECT_CALL(decoder_, continueDecoding());
+  runPosted();
+  request_buffered_.drain(request_buffered_.length());
+
+  // The next frame passes through the awaiting task.
+  Buffer::OwnedImpl world("world");
+  EXPECT_EQ(filter_->decodeData(world, true), FilterDataStatus::Continue);
+  EXPECT_EQ(world.toString(), "WORLD");
+  EXPECT_EQ(headers.get_("x-length"), "10");
+  EXPECT_EQ(live_frames_(), 0);
+}
+
+TEST_F(CppCoroutineTest, ResponseEndOfStream) {
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter_->decodeHeaders(request_headers, true), FilterHeadersStatus::Continue);
+  EXPECT_EQ(request_headers.get_("x-length"), "0");
+
+  Http::TestResponseHeaderMapImpl headers{};
+  EXPECT_EQ(filter_->encodeHeaders(headers, false), FilterHeadersStatus::StopIteration);
+  Buffer::OwnedImpl first("abc");
+  EXPECT_EQ(filter_->encodeData(first, false), FilterDataStatus::StopIterationAndBuffer);
+  response_buffered_.move(first);
+
+  // The last frame is appended to the buffered body after the hook, so the task is resumed with the
+  // whole body by a timer.
+  auto* timer = new NiceMock<Event::MockTimer>(&decoder_.dispatcher_);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(0), _));
+  Buffer::OwnedImpl last("de");
+  EXPECT_EQ(filter_->encodeData(last, true), FilterDataStatus::StopIterationAndBuffer);
+  response_buffered_.move(last);
+
+  timer->invokeCallback();
+  EXPECT_EQ(response_buffered_.toString(), "abcde (5)");
+  EXPECT_CALL(encoder_, continueEncoding());
+  runPosted();
+  EXPECT_EQ(live_frames_(), 0);
+}
+
+TEST_F(CppCoroutineTest, ResponseSingleFrame) {
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter_->decodeHeaders(request_headers, true), FilterHeadersStatus::Continue);
+
+  Http::TestResponseHeaderMapImpl headers{};
+  EXPECT_EQ(filter_->encodeHeaders(headers, false), FilterHeadersStatus::StopIteration);
+  Buffer::OwnedImpl body("xyz");
+  EXPECT_EQ(filter_->encodeData(body, true), FilterDataStatus::Continue);
+  EXPECT_EQ(body.toString(), "xyz (3)");
+}
+
+TEST_F(CppCoroutineTest, LocalReplyFromResumedTask) {
+  auto* timer = new NiceMock<Event::MockTimer>(&decoder_.dispatcher_);
+  Http::TestRequestHeaderMapImpl headers{{"delay", "100"}, {"reject", "true"}};
+  EXPECT_EQ(filter_->decodeHeaders(headers, false), FilterHeadersStatus::StopIteration);
+
+  // Envoy destroys the stream while sending the local reply, which is deferred until the task
+  // returns. The timer is destroyed along with the stream, so its callback is copied out.
+  EXPECT_CALL(decoder_, sendLocalReply(Http::Code::Forbidden, _, _, _, _))
+      .WillOnce(testing::InvokeWithoutArgs([this]() { filter_->onDestroy(); }));
+  EXPECT_CALL(decoder_, continueDecoding()).Times(0);
+  Event::TimerCb callback = timer->callback_;
+  callback();
+  runPosted();
+  EXPECT_EQ(filter_->http_filter_instance_, nullptr);
+  EXPECT_EQ(live_frames_(), 0);
+}
+
+TEST_F(CppCoroutineTest, Callout) {
+  AsyncClient::Callbacks* callbacks = nullptr;
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce([&](RequestMessagePtr& message, AsyncClient::Callbacks& cb,
+                    const AsyncClient::RequestOptions&) -> AsyncClient::Request* {
+        EXPECT_EQ(message->headers().getPathValue(), "/check");
+        callbacks = &cb;
+        return &request_;
+      });
+  Http::TestRequestHeaderMapImpl headers{{"callout", "auth"}};
+  EXPECT_EQ(filter_->decodeHeaders(headers, true), FilterHeadersStatus::StopIteration);
+  EXPECT_EQ(live_frames_(), 1);
+
+  ResponseMessagePtr response(new ResponseMessageImpl(
+      ResponseHeaderMapPtr{new TestResponseHeaderMapImpl{{":status", "200"}}}));
+  callbacks->onSuccess(request_, std::move(response));
+  EXPECT_EQ(headers.get_("x-callout"), "200");
+  EXPECT_EQ(headers.get_("x-length"), "0");
+  EXPECT_EQ(live_frames_(), 0);
+  EXPECT_CALL(decoder_, continueDecoding());
+  runPosted();
+}
+
+TEST_F(CppCoroutineTest, CalloutCompletedBeforeSendReturns) {
+  // The callout fails inside send_callout, so the task goes on without suspending.
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce([this](RequestMessagePtr&, AsyncClient::Callbacks& cb,
+                       const AsyncClient::RequestOptions&) -> AsyncClient::Request* {
+        cb.onFailure(request_, AsyncClient::FailureReason::Reset);
+        return nullptr;
+      });
+  Http::TestRequestHeaderMapImpl headers{{"callout", "auth"}};
+  EXPECT_EQ(filter_->decodeHeaders(headers, true), FilterHeadersStatus::Continue);
+  EXPECT_EQ(headers.get_("x-callout"), "failed");
+  EXPECT_EQ(live_frames_(), 0);
+}
+
+TEST_F(CppCoroutineTest, CalloutToUnknownCluster) {
+  Http::TestRequestHeaderMapImpl headers{{"callout", "unknown"}};
+  EXPECT_EQ(filter_->decodeHeaders(headers, true), FilterHeadersStatus::Continue);
+  EXPECT_EQ(headers.get_("x-callout"), "failed");
+}
+
+TEST_F(CppCoroutineTest, DestroyWhileSuspended) {
+  new NiceMock<Event::MockTimer>(&decoder_.dispatcher_);
+  Http::TestRequestHeaderMapImpl request_headers{{"delay", "100"}};
+  EXPECT_EQ(filter_->decodeHeaders(request_headers, false), FilterHeadersStatus::StopIteration);
+  Http::TestResponseHeaderMapImpl response_headers{};
+  EXPECT_EQ(filter_->encodeHeaders(response_headers, false), FilterHeadersStatus::StopIteration);
+  EXPECT_EQ(live_frames_(), 2);
+
+  filter_->onDestroy();
+  EXPECT_EQ(live_frames_(), 0);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
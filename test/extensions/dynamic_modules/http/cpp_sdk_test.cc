@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+#include <memory>
+
+#include "source/common/buffer/buffer_impl.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+// Runs the cpp_sdk test program, which is written with the C++ SDK and implements only the request
+// hooks.
+class CppSdkTest : public testing::Test {
+public:
+  void SetUp() override {
+    module_ = loadTestDynamicModule("cpp_sdk", "config");
+    EXPECT_TRUE(module_->hasVtable());
+    filter_ = std::make_shared<HttpFilter>(module_);
+  }
+
+  HttpDynamicModuleSharedPtr module_;
+  std::shared_ptr<HttpFilter> filter_;
+};
+
+TEST(CppSdkInitTest, FilterCreateFails) {
+  EXPECT_THROW_WITH_REGEX(loadTestDynamicModule("cpp_sdk", "fail", "cpp_sdk"), EnvoyException,
+                          "http filter init in cpp_sdk failed");
+}
+
+TEST_F(CppSdkTest, RequestHeaders) {
+  Http::TestRequestHeaderMapImpl request_headers{
+      {"key", "a"}, {"key", "b"}, {"remove-me", "x"}, {"stop", "1"}};
+  EXPECT_EQ(filter_->decodeHeaders(request_headers, false), FilterHeadersStatus::StopIteration);
+  EXPECT_EQ(request_headers.get_("x-values"), "a,b");
+  EXPECT_EQ(request_headers.get_("x-config"), "config");
+  EXPECT_FALSE(request_headers.has("remove-me"));
+}
+
+TEST_F(CppSdkTest, RequestHeadersSetEmptyValueRemoves) {
+  // Without any value of "key", the filter sets "x-values" to an empty value, which removes it.
+  Http::TestRequestHeaderMapImpl request_headers{{"x-values", "stale"}};
+  EXPECT_EQ(filter_->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  EXPECT_FALSE(request_headers.has("x-values"));
+  EXPECT_EQ(request_headers.get_("x-config"), "config");
+}
+
+TEST_F(CppSdkTest, RequestBody) {
+  // More slices than the SDK fetches in a single batch.
+  Buffer::OwnedImpl request_body;
+  for (int i = 0; i < 10; i++) {
+    request_body.appendSliceForTest(i % 2 == 0 ? "hello" : " ");
+  }
+  EXPECT_EQ(filter_->decodeData(request_body, false), FilterDataStatus::Continue);
+  EXPECT_EQ(request_body.toString(), "HELLO HELLO HELLO HELLO HELLO ");
+
+  Buffer::OwnedImpl last("end");
+  EXPECT_EQ(filter_->decodeData(last, true), FilterDataStatus::Continue);
+  EXPECT_EQ(last.toString(), "END!");
+}
+
+TEST_F(CppSdkTest, ResponseHooksNotImplemented) {
+  // The response hooks are not implemented by the filter, so the SDK continues without reading.
+  Http::TestResponseHeaderMapImpl response_headers{{"foo", "bar"}};
+  EXPECT_EQ(filter_->encodeHeaders(response_headers, false), FilterHeadersStatus::Continue);
+  EXPECT_EQ(response_headers.get_("foo"), "bar");
+  Buffer::OwnedImpl response_body("body");
+  EXPECT_EQ(filter_->encodeData(response_body, true), FilterDataStatus::Continue);
+  EXPECT_EQ(response_body.toString(), "body");
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,127 @@
+#include <memory>
+#include <string>
+
+#include "envoy/registry/registry.h"
+#include "envoy/server/filter_config.h"
+
+#include "source/extensions/dynamic_modules/http/config.pb.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/init/mocks.h"
+#include "test/mocks/server/factory_context.h"
+#include "test/test_common/utility.h"
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+
+// Creates the filter factory with parallel_init, and drives its init target by hand. The module is
+// loaded on the thread of the ModuleInitPool, which posts the rest to the main thread.
+class ParallelInitFactoryTest : public testing::Test {
+public:
+  FilterFactoryCb createFactory(const std::string& program) {
+    envoy::extensions::filters::http::dynamic_modules::v3::DynamicModuleConfig config;
+    config.set_file_path(
+        fmt::format("./test/extensions/dynamic_modules/http/test_programs/lib{}.so", program));
+    config.set_name(program);
+    config.set_parallel_init(true);
+
+    ON_CALL(context_.server_factory_context_.dispatcher_, post(_))
+        .WillByDefault([this](Event::PostCb callback) {
+          posted_ = std::move(callback);
+          posted_notification_.Notify();
+        });
+    EXPECT_CALL(context_.init_manager_, add(_)).WillOnce([this](const Init::Target& target) {
+      init_target_handle_ = target.createHandle("test");
+    });
+    auto* factory =
+        Registry::FactoryRegistry<Server::Configuration::NamedHttpFilterConfigFactory>::getFactory(
+            "envoy.http.dynamic_modules");
+    EXPECT_NE(factory, nullptr);
+    auto factory_cb = factory->createFilterFactoryFromProto(config, "", context_);
+    EXPECT_TRUE(factory_cb.ok());
+    return factory_cb.value();
+  }
+
+  // Loads the module, and makes the init target ready on the main thread.
+  void initialize() {
+    EXPECT_CALL(init_watcher_, ready());
+    EXPECT_TRUE(init_target_handle_->initialize(init_watcher_));
+    posted_notification_.WaitForNotification();
+    posted_();
+  }
+
+  // Runs the filter factory for a request, and returns the decoder filter it added.
+  StreamDecoderFilterSharedPtr createDecoderFilter(const FilterFactoryCb& factory_cb) {
+    StreamDecoderFilterSharedPtr decoder_filter;
+    NiceMock<MockFilterChainFactoryCallbacks> callbacks;
+    EXPECT_CALL(callbacks, addStreamDecoderFilter(_))
+        .WillOnce([&](StreamDecoderFilterSharedPtr filter) { decoder_filter = filter; });
+    factory_cb(callbacks);
+    return decoder_filter;
+  }
+
+  // Expects the filter to reject the request as the module failed to initialize.
+  void expectInitFailed(StreamDecoderFilterSharedPtr filter) {
+    ASSERT_NE(filter, nullptr);
+    EXPECT_EQ(dynamic_cast<HttpFilter*>(filter.get()), nullptr);
+    NiceMock<MockStreamDecoderFilterCallbacks> decoder_callbacks;
+    filter->setDecoderFilterCallbacks(decoder_callbacks);
+    EXPECT_CALL(decoder_callbacks, sendLocalReply(Code::InternalServerError, "", _, _,
+                                                  "dynamic_module_init_failed"));
+    TestRequestHeaderMapImpl headers{};
+    EXPECT_EQ(filter->decodeHeaders(headers, true), FilterHeadersStatus::StopIteration);
+  }
+
+  NiceMock<Server::Configuration::MockFactoryContext> context_;
+  Init::TargetHandlePtr init_target_handle_;
+  Init::ExpectableWatcherImpl init_watcher_;
+  absl::Notification posted_notification_;
+  Event::PostCb posted_;
+};
+
+TEST_F(ParallelInitFactoryTest, InitSuccess) {
+  FilterFactoryCb factory_cb = createFactory("stream_init");
+  initialize();
+
+  NiceMock<MockFilterChainFactoryCallbacks> callbacks;
+  StreamDecoderFilterSharedPtr decoder_filter;
+  StreamEncoderFilterSharedPtr encoder_filter;
+  EXPECT_CALL(callbacks, addStreamDecoderFilter(_))
+      .WillOnce([&](StreamDecoderFilterSharedPtr filter) { decoder_filter = filter; });
+  EXPECT_CALL(callbacks, addStreamEncoderFilter(_))
+      .WillOnce([&](StreamEncoderFilterSharedPtr filter) { encoder_filter = filter; });
+  factory_cb(callbacks);
+  EXPECT_NE(dynamic_cast<HttpFilter*>(decoder_filter.get()), nullptr);
+  EXPECT_EQ(dynamic_cast<HttpFilter*>(decoder_filter.get()),
+            dynamic_cast<HttpFilter*>(encoder_filter.get()));
+}
+
+TEST_F(ParallelInitFactoryTest, InitFailure) {
+  FilterFactoryCb factory_cb = createFactory("http_filter_init_fail");
+  // The init target gets ready even though the module failed, so the listener isn't held back.
+  initialize();
+  expectInitFailed(createDecoderFilter(factory_cb));
+}
+
+TEST_F(ParallelInitFactoryTest, RequestBeforeReady) {
+  FilterFactoryCb factory_cb = createFactory("stream_init");
+  // The module isn't initialized yet, so the request is rejected instead of reaching it.
+  expectInitFailed(createDecoderFilter(factory_cb));
+
+  initialize();
+  EXPECT_NE(dynamic_cast<HttpFilter*>(createDecoderFilter(factory_cb).get()), nullptr);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
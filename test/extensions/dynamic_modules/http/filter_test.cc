@@ -1,9 +1,13 @@
 #include "gtest/gtest.h"
 #include <memory>
 
+#include "source/common/buffer/buffer_impl.h"
+#include "source/common/stats/isolated_store_impl.h"
 #include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
 #include "source/extensions/dynamic_modules/http/filter.h"
 
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
 #include "test/test_common/utility.h"
 #include "test/extensions/dynamic_modules/http/test_util.h"
 
@@ -12,6 +16,8 @@ namespace Extensions {
 namespace DynamicModules {
 namespace Http {
 
+using testing::_;
+
 TEST(TestHttpFilter, StreamContextNull) {
   HttpDynamicModuleSharedPtr module = loadTestDynamicModule("init", "config");
   auto filter = std::make_shared<HttpFilter>(module);
@@ -35,6 +41,138 @@ TEST(TestHttpFilter, StreamContextOK) {
   EXPECT_EQ(*value, 999999);
 }
 
+TEST(TestHttpFilter, CallbackBudgetCountOnly) {
+  CallbackBudget budget{std::chrono::milliseconds(1), CallbackBudget::OverrunPolicy::CountOnly};
+  HttpDynamicModuleSharedPtr module =
+      loadTestDynamicModule("slow_request_headers", "", "", false, budget);
+  Stats::IsolatedStoreImpl store;
+  const auto stats = generateStats("test.", *store.rootScope());
+  for (int i = 0; i < 2; i++) {
+    auto filter = std::make_shared<HttpFilter>(module, nullptr, nullptr, stats);
+    Http::TestRequestHeaderMapImpl request_headers{};
+    EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+    EXPECT_NE(filter->http_filter_instance_, nullptr);
+  }
+  EXPECT_EQ(stats->callback_budget_overrun_.value(), 2);
+  EXPECT_EQ(store.counterFromString("test.callback_budget_overrun").value(), 2);
+  EXPECT_FALSE(module->isDegraded());
+}
+
+TEST(TestHttpFilter, CallbackBudgetFailOpen) {
+  CallbackBudget budget{std::chrono::milliseconds(1), CallbackBudget::OverrunPolicy::FailOpen,
+                        std::chrono::seconds(100)};
+  HttpDynamicModuleSharedPtr module =
+      loadTestDynamicModule("slow_request_headers", "", "", false, budget);
+  Stats::IsolatedStoreImpl store;
+  const auto stats = generateStats("test.", *store.rootScope());
+  auto filter = std::make_shared<HttpFilter>(module, nullptr, nullptr, stats);
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  EXPECT_EQ(stats->callback_budget_overrun_.value(), 1);
+  EXPECT_TRUE(module->isDegraded());
+
+  // The next stream must bypass the module entirely.
+  auto bypassed = std::make_shared<HttpFilter>(module, nullptr, nullptr, stats);
+  EXPECT_EQ(bypassed->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  EXPECT_TRUE(bypassed->bypassed_);
+  EXPECT_EQ(bypassed->http_filter_instance_, nullptr);
+  Buffer::OwnedImpl data;
+  EXPECT_EQ(bypassed->decodeData(data, true), FilterDataStatus::Continue);
+  Http::TestResponseHeaderMapImpl response_headers{};
+  EXPECT_EQ(bypassed->encodeHeaders(response_headers, true), FilterHeadersStatus::Continue);
+  EXPECT_EQ(stats->callback_budget_overrun_.value(), 1);
+}
+
+TEST(TestHttpFilter, CallbackBudgetFailClosed) {
+  CallbackBudget budget{std::chrono::milliseconds(1), CallbackBudget::OverrunPolicy::FailClosed,
+                        std::chrono::seconds(100)};
+  HttpDynamicModuleSharedPtr module =
+      loadTestDynamicModule("slow_request_headers", "", "", false, budget);
+  auto filter = std::make_shared<HttpFilter>(module);
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  EXPECT_TRUE(module->isDegraded());
+
+  // The next stream must be rejected without calling into the module.
+  auto rejected = std::make_shared<HttpFilter>(module);
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  rejected->setDecoderFilterCallbacks(decoder_callbacks);
+  EXPECT_CALL(decoder_callbacks,
+              sendLocalReply(Http::Code::ServiceUnavailable, testing::_, testing::_, testing::_,
+                             "dynamic_module_degraded"));
+  EXPECT_EQ(rejected->decodeHeaders(request_headers, false), FilterHeadersStatus::StopIteration);
+  EXPECT_EQ(rejected->http_filter_instance_, nullptr);
+}
+
+struct TimerContext {
+  void* instance_ = nullptr;
+  int calls_ = 0;
+};
+
+void onTimer(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+             envoy_dynamic_module_raw_pointer context) {
+  auto* timer_context = static_cast<TimerContext*>(context);
+  timer_context->instance_ = http_filter_instance_ptr;
+  timer_context->calls_++;
+}
+
+TEST(TestHttpFilter, TimerCallsIntoModule) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  filter->setDecoderFilterCallbacks(decoder_callbacks);
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+
+  auto* mock_timer = new testing::NiceMock<Event::MockTimer>(&decoder_callbacks.dispatcher_);
+  TimerContext context;
+  Event::Timer* timer = filter->createTimer(onTimer, &context);
+  EXPECT_EQ(timer, mock_timer);
+  EXPECT_CALL(*mock_timer, enableTimer(std::chrono::milliseconds(100), _));
+  timer->enableTimer(std::chrono::milliseconds(100));
+
+  mock_timer->invokeCallback();
+  EXPECT_EQ(context.calls_, 1);
+  EXPECT_EQ(context.instance_, filter->http_filter_instance_);
+}
+
+TEST(TestHttpFilter, TimersAreCancelledOnDestroy) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  filter->setDecoderFilterCallbacks(decoder_callbacks);
+
+  new testing::NiceMock<Event::MockTimer>(&decoder_callbacks.dispatcher_);
+  TimerContext context;
+  EXPECT_NE(filter->createTimer(onTimer, &context), nullptr);
+  EXPECT_EQ(filter->timers_.size(), 1);
+  filter->onDestroy();
+  EXPECT_TRUE(filter->timers_.empty());
+  EXPECT_EQ(context.calls_, 0);
+}
+
+TEST(TestHttpFilter, TimerWithoutCallbacks) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+  TimerContext context;
+  EXPECT_EQ(filter->createTimer(onTimer, &context), nullptr);
+}
+
+TEST(TestHttpFilter, WorkerIndex) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+  EXPECT_EQ(filter->workerIndex(), 0);
+
+  testing::NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  filter->setDecoderFilterCallbacks(decoder_callbacks);
+  ON_CALL(decoder_callbacks.dispatcher_, name())
+      .WillByDefault(testing::ReturnRefOfCopy(std::string("worker_3")));
+  EXPECT_EQ(filter->workerIndex(), 3);
+  ON_CALL(decoder_callbacks.dispatcher_, name())
+      .WillByDefault(testing::ReturnRefOfCopy(std::string("main_thread")));
+  EXPECT_EQ(filter->workerIndex(), 0);
+}
+
 } // namespace Http
 } // namespace DynamicModules
 } // namespace Extensions
@@ -0,0 +1,212 @@
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "source/common/http/message_impl.h"
+#include "source/common/stats/isolated_store_impl.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+#include "source/extensions/dynamic_modules/http/http_callout.h"
+
+#include "test/mocks/http/mocks.h"
+#include "test/mocks/upstream/cluster_manager.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+using testing::Return;
+
+struct CalloutContext {
+  void* instance_ = nullptr;
+  bool has_response_ = false;
+  std::string status_;
+  std::string body_;
+  int calls_ = 0;
+  HttpFilter* filter_ = nullptr;
+};
+
+void onCalloutDone(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                   envoy_dynamic_module_raw_pointer context,
+                   envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers,
+                   envoy_dynamic_module_type_HttpResponseBodyBufferPtr response_body) {
+  auto* callout_context = static_cast<CalloutContext*>(context);
+  callout_context->instance_ = http_filter_instance_ptr;
+  callout_context->calls_++;
+  callout_context->has_response_ = response_headers != nullptr;
+  if (response_headers != nullptr) {
+    callout_context->status_ =
+        std::string(static_cast<ResponseHeaderMap*>(response_headers)->getStatusValue());
+    callout_context->body_ = static_cast<Buffer::Instance*>(response_body)->toString();
+  }
+}
+
+// Rejects the stream from the done function, like an auth module would on a failed lookup.
+void onCalloutDoneSendResponse(envoy_dynamic_module_type_HttpFilterInstancePtr,
+                               envoy_dynamic_module_raw_pointer context,
+                               envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
+                               envoy_dynamic_module_type_HttpResponseBodyBufferPtr) {
+  auto* callout_context = static_cast<CalloutContext*>(context);
+  callout_context->calls_++;
+  envoy_dynamic_module_http_send_response(callout_context->filter_, 403, nullptr, 0, nullptr, 0);
+}
+
+// Takes longer than the callback budget of the module.
+void onCalloutDoneSlow(envoy_dynamic_module_type_HttpFilterInstancePtr,
+                       envoy_dynamic_module_raw_pointer context,
+                       envoy_dynamic_module_type_HttpResponseHeaderMapPtr,
+                       envoy_dynamic_module_type_HttpResponseBodyBufferPtr) {
+  static_cast<CalloutContext*>(context)->calls_++;
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+}
+
+class HttpCalloutTest : public testing::Test {
+public:
+  void SetUp() override {
+    cluster_manager_.initializeThreadLocalClusters({"auth"});
+    filter_ = std::make_shared<HttpFilter>(loadTestDynamicModule("stream_init", ""), nullptr,
+                                           &cluster_manager_);
+    Http::TestRequestHeaderMapImpl request_headers{};
+    EXPECT_EQ(filter_->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  }
+
+  RequestMessagePtr newRequest() {
+    auto message = std::make_unique<RequestMessageImpl>();
+    message->headers().setMethod("GET");
+    message->headers().setPath("/check");
+    message->headers().setHost("auth");
+    return message;
+  }
+
+  NiceMock<Upstream::MockClusterManager> cluster_manager_;
+  NiceMock<Http::MockAsyncClientRequest> request_{
+      &cluster_manager_.thread_local_cluster_.async_client_};
+  std::shared_ptr<HttpFilter> filter_;
+};
+
+TEST_F(HttpCalloutTest, Success) {
+  AsyncClient::Callbacks* callbacks = nullptr;
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce([&](RequestMessagePtr& message, AsyncClient::Callbacks& cb,
+                    const AsyncClient::RequestOptions& options) -> AsyncClient::Request* {
+        EXPECT_EQ(message->headers().getPathValue(), "/check");
+        EXPECT_EQ(options.timeout, std::chrono::milliseconds(100));
+        callbacks = &cb;
+        return &request_;
+      });
+  CalloutContext context;
+  EXPECT_TRUE(filter_->sendCallout("auth", newRequest(), std::chrono::milliseconds(100),
+                                   onCalloutDone, &context));
+  EXPECT_EQ(filter_->callouts_.size(), 1);
+
+  ResponseMessagePtr response(new ResponseMessageImpl(
+      ResponseHeaderMapPtr{new TestResponseHeaderMapImpl{{":status", "200"}}}));
+  response->body().add("ok");
+  callbacks->onSuccess(request_, std::move(response));
+  EXPECT_EQ(context.calls_, 1);
+  EXPECT_TRUE(context.has_response_);
+  EXPECT_EQ(context.status_, "200");
+  EXPECT_EQ(context.body_, "ok");
+  EXPECT_EQ(context.instance_, filter_->http_filter_instance_);
+  EXPECT_TRUE(filter_->callouts_.empty());
+}
+
+TEST_F(HttpCalloutTest, Failure) {
+  AsyncClient::Callbacks* callbacks = nullptr;
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce([&](RequestMessagePtr&, AsyncClient::Callbacks& cb,
+                    const AsyncClient::RequestOptions& options) -> AsyncClient::Request* {
+        // A zero timeout means no timeout.
+        EXPECT_FALSE(options.timeout.has_value());
+        callbacks = &cb;
+        return &request_;
+      });
+  CalloutContext context;
+  EXPECT_TRUE(filter_->sendCallout("auth", newRequest(), std::chrono::milliseconds(0),
+                                   onCalloutDone, &context));
+  callbacks->onFailure(request_, AsyncClient::FailureReason::Reset);
+  EXPECT_EQ(context.calls_, 1);
+  EXPECT_FALSE(context.has_response_);
+  EXPECT_TRUE(filter_->callouts_.empty());
+}
+
+TEST_F(HttpCalloutTest, CancelledOnDestroy) {
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce(Return(&request_));
+  CalloutContext context;
+  EXPECT_TRUE(filter_->sendCallout("auth", newRequest(), std::chrono::milliseconds(0),
+                                   onCalloutDone, &context));
+  EXPECT_CALL(request_, cancel());
+  filter_->onDestroy();
+  EXPECT_TRUE(filter_->callouts_.empty());
+  EXPECT_EQ(context.calls_, 0);
+}
+
+TEST_F(HttpCalloutTest, DoneSendsLocalReply) {
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  filter_->setDecoderFilterCallbacks(decoder_callbacks);
+  AsyncClient::Callbacks* callbacks = nullptr;
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce([&](RequestMessagePtr&, AsyncClient::Callbacks& cb,
+                    const AsyncClient::RequestOptions&) -> AsyncClient::Request* {
+        callbacks = &cb;
+        return &request_;
+      });
+  CalloutContext context;
+  context.filter_ = filter_.get();
+  EXPECT_TRUE(filter_->sendCallout("auth", newRequest(), std::chrono::milliseconds(0),
+                                   onCalloutDoneSendResponse, &context));
+
+  // Envoy may destroy the filter instance synchronously while sending the local reply, which
+  // destroys the callouts of the filter while the done function is still running.
+  EXPECT_CALL(decoder_callbacks, sendLocalReply(Http::Code::Forbidden, _, _, _, _))
+      .WillOnce(testing::InvokeWithoutArgs([&]() { filter_->onDestroy(); }));
+  callbacks->onFailure(request_, AsyncClient::FailureReason::Reset);
+  EXPECT_EQ(context.calls_, 1);
+  EXPECT_TRUE(filter_->callouts_.empty());
+  EXPECT_EQ(filter_->http_filter_instance_, nullptr);
+}
+
+TEST_F(HttpCalloutTest, DoneCountsBudgetOverrun) {
+  CallbackBudget budget{std::chrono::milliseconds(1), CallbackBudget::OverrunPolicy::CountOnly};
+  Stats::IsolatedStoreImpl store;
+  const auto stats = generateStats("test.", *store.rootScope());
+  auto filter = std::make_shared<HttpFilter>(
+      loadTestDynamicModule("stream_init", "", "", false, budget), nullptr, &cluster_manager_,
+      stats);
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  AsyncClient::Callbacks* callbacks = nullptr;
+  EXPECT_CALL(cluster_manager_.thread_local_cluster_.async_client_, send_(_, _, _))
+      .WillOnce([&](RequestMessagePtr&, AsyncClient::Callbacks& cb,
+                    const AsyncClient::RequestOptions&) -> AsyncClient::Request* {
+        callbacks = &cb;
+        return &request_;
+      });
+  CalloutContext context;
+  EXPECT_TRUE(filter->sendCallout("auth", newRequest(), std::chrono::milliseconds(0),
+                                  onCalloutDoneSlow, &context));
+  callbacks->onFailure(request_, AsyncClient::FailureReason::Reset);
+  EXPECT_EQ(context.calls_, 1);
+  EXPECT_EQ(stats->callback_budget_overrun_.value(), 1);
+}
+
+TEST_F(HttpCalloutTest, UnknownCluster) {
+  EXPECT_CALL(cluster_manager_, getThreadLocalCluster(absl::string_view("unknown")))
+      .WillOnce(Return(nullptr));
+  CalloutContext context;
+  EXPECT_FALSE(filter_->sendCallout("unknown", newRequest(), std::chrono::milliseconds(0),
+                                    onCalloutDone, &context));
+  EXPECT_TRUE(filter_->callouts_.empty());
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
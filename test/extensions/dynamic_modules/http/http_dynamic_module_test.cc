@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 #include <cstddef>
 #include <exception>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "source/extensions/dynamic_modules/http/http_dynamic_module.h"
@@ -47,7 +49,7 @@ TEST(TestDynamicModule, DoNotClose) {
 
 TEST(TestDynamicModule, ConstructorHappyPath) {
   // Ensures that the module can be loaded multiple times independently but only program init is
-  // called once.
+  // called once since the loaded object file is shared.
   std::vector<HttpDynamicModuleSharedPtr> modules;
   for (int i = 0; i < 10; i++) {
     std::string config = "config";
@@ -74,6 +76,137 @@ TEST(TestDynamicModule, ConstructorHappyPath) {
   first->envoy_dynamic_module_on_http_filter_instance_init_(nullptr, 0);
 }
 
+TEST(TestDynamicModule, Vtable) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("vtable");
+  EXPECT_TRUE(module->hasVtable());
+  EXPECT_EQ(module->capabilities_, 0U);
+  // The event hooks are not exported as symbols, so they must come from the table.
+  EXPECT_EQ(module->dynamic_module_->getFunctionPointer<decltype(
+                &envoy_dynamic_module_on_http_filter_instance_request_headers)>(
+                "envoy_dynamic_module_on_http_filter_instance_request_headers"),
+            nullptr);
+  ASSERT_NE(module->envoy_dynamic_module_on_http_filter_instance_request_headers_, nullptr);
+  EXPECT_EQ(module->envoy_dynamic_module_on_http_filter_instance_request_headers_(0, 0, 0),
+            envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopIteration);
+
+  HttpDynamicModuleSharedPtr legacy = loadTestDynamicModule("stream_init");
+  EXPECT_FALSE(legacy->hasVtable());
+}
+
+TEST(TestDynamicModule, VtableCapabilitiesInVersion1) {
+  EXPECT_THROW_WITH_REGEX(loadTestDynamicModule("vtable_capabilities"), EnvoyException,
+                          "http vtable version 1 in .* has nonzero capabilities: 1");
+}
+
+TEST(TestDynamicModule, LoadMode) {
+  LoadMode load_mode;
+  load_mode.eager_bind_ = true;
+  load_mode.prefault_ = true;
+  load_mode.mlock_ = true;
+  const auto dynamic_module = newDynamicModule(
+      "./test/extensions/dynamic_modules/http/test_programs/libstream_init.so", false, load_mode);
+  ASSERT_TRUE(dynamic_module.ok());
+  const LoadTimings& timings = dynamic_module.value()->load_timings_;
+  EXPECT_GT(timings.dlopen_.count(), 0);
+  EXPECT_GT(timings.program_init_.count(), 0);
+  EXPECT_GT(timings.prefault_.count(), 0);
+  EXPECT_GT(timings.mlock_.count(), 0);
+}
+
+TEST(TestDynamicModule, LoadModeOnlyOnFirstLoad) {
+  const auto first = newDynamicModule(
+      "./test/extensions/dynamic_modules/http/test_programs/libstream_init.so", false);
+  ASSERT_TRUE(first.ok());
+
+  // The already loaded module is returned as is, without prefaulting or locking it again.
+  LoadMode load_mode;
+  load_mode.prefault_ = true;
+  load_mode.mlock_ = true;
+  const auto second = newDynamicModule(
+      "./test/extensions/dynamic_modules/http/test_programs/libstream_init.so", false, load_mode);
+  ASSERT_TRUE(second.ok());
+  EXPECT_EQ(first.value(), second.value());
+  EXPECT_EQ(second.value()->load_timings_.prefault_.count(), 0);
+  EXPECT_EQ(second.value()->load_timings_.mlock_.count(), 0);
+}
+
+TEST(TestDynamicModule, SharedForIdenticalConfig) {
+  const auto dynamic_module = newDynamicModule(
+      "./test/extensions/dynamic_modules/http/test_programs/libstream_init.so", false);
+  ASSERT_TRUE(dynamic_module.ok());
+
+  HttpDynamicModuleSharedPtr first =
+      getOrCreateHttpDynamicModule("name", "config", dynamic_module.value());
+  HttpDynamicModuleSharedPtr second =
+      getOrCreateHttpDynamicModule("name", "config", dynamic_module.value());
+  EXPECT_EQ(first, second);
+
+  // Any difference in the name, the config or the budget creates a new one.
+  EXPECT_NE(first, getOrCreateHttpDynamicModule("other", "config", dynamic_module.value()));
+  EXPECT_NE(first, getOrCreateHttpDynamicModule("name", "other", dynamic_module.value()));
+  CallbackBudget callback_budget;
+  callback_budget.budget_ = std::chrono::milliseconds(1);
+  EXPECT_NE(first, getOrCreateHttpDynamicModule("name", "config", dynamic_module.value(),
+                                                callback_budget));
+
+  // Once released, a new one is created.
+  first.reset();
+  second.reset();
+  EXPECT_NE(getOrCreateHttpDynamicModule("name", "config", dynamic_module.value()), nullptr);
+}
+
+TEST(TestDynamicModule, SharedWhenModuleRewritesConfig) {
+  const auto dynamic_module =
+      newDynamicModule("./test/extensions/dynamic_modules/http/test_programs/libinit.so", false);
+  ASSERT_TRUE(dynamic_module.ok());
+
+  // The init program overwrites the config buffer, which must not affect the lookup.
+  std::string config = "config";
+  HttpDynamicModuleSharedPtr first =
+      getOrCreateHttpDynamicModule("name", config, dynamic_module.value());
+  EXPECT_EQ(config, "111111");
+  std::string same_config = "config";
+  EXPECT_EQ(first, getOrCreateHttpDynamicModule("name", same_config, dynamic_module.value()));
+}
+
+TEST(TestDynamicModule, CreatedOnceForConcurrentIdenticalConfigs) {
+  const auto dynamic_module = newDynamicModule(
+      "./test/extensions/dynamic_modules/http/test_programs/libslow_http_filter_init.so", false);
+  ASSERT_TRUE(dynamic_module.ok());
+
+  constexpr int kThreads = 4;
+  std::vector<HttpDynamicModuleSharedPtr> modules(kThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; i++) {
+    threads.emplace_back([&modules, &dynamic_module, i]() {
+      modules[i] = getOrCreateHttpDynamicModule("name", "config", dynamic_module.value());
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& module : modules) {
+    EXPECT_EQ(module, modules[0]);
+  }
+  const auto get_calls =
+      dynamic_module.value()->getFunctionPointer<size_t (*)()>("get_http_filter_init_calls");
+  ASSERT_NE(get_calls, nullptr);
+  EXPECT_EQ(get_calls(), 1);
+}
+
+TEST(TestDynamicModule, SharedAcrossLoads) {
+  // Loading the same object file while it is still referenced must reuse the loaded module.
+  HttpDynamicModuleSharedPtr first = loadTestDynamicModule("init", "config");
+  HttpDynamicModuleSharedPtr second = loadTestDynamicModule("init", "config");
+  EXPECT_EQ(first->dynamic_module_.get(), second->dynamic_module_.get());
+
+  // Once all the references are gone, the module can still be loaded again.
+  first.reset();
+  second.reset();
+  HttpDynamicModuleSharedPtr third = loadTestDynamicModule("init", "config");
+  EXPECT_NE(third->dynamic_module_->handleForTesting(), nullptr);
+}
+
 } // namespace Http
 } // namespace DynamicModules
 } // namespace Extensions
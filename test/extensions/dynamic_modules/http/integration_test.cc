@@ -6,17 +6,50 @@ class HttpFilterIntegrationTest : public HttpIntegrationTest,
 public:
   HttpFilterIntegrationTest() : HttpIntegrationTest(Http::CodecClient::Type::HTTP1, GetParam()) {}
 
-  void initializeDynamicFilter(const std::string& filter_name, const std::string& config = "") {
+  void initializeDynamicFilter(const std::string& filter_name, const std::string& config = "",
+                               const std::string& config_field = "filter_config") {
+    initializeDynamicFilterWithConfigYaml(filter_name,
+                                          fmt::format("{}: \"{}\"", config_field, config));
+  }
+
+  // config_yaml is placed under the typed_config of the filter as is, so the lines following the
+  // first one must be indented by two spaces.
+  void initializeDynamicFilterWithConfigYaml(const std::string& filter_name,
+                                             const std::string& config_yaml) {
     constexpr auto format = R"EOF(
 name: envoy.http.dynamic_modules
 typed_config:
   "@type": type.googleapis.com/envoy.extensions.filters.http.dynamic_modules.v3.DynamicModuleConfig
   file_path: {}
-  filter_config: "{}"
+  {}
 )EOF";
-    config_helper_.prependFilter(fmt::format(format, filter_name, config));
+    config_helper_.prependFilter(fmt::format(format, filter_name, config_yaml));
     initialize();
   }
+
+  // Sends a request through the integration_test_headers module configured with "should_wait",
+  // which stops the iteration on the response headers until the end of the stream.
+  void expectHeadersStopIteration() {
+    Http::TestRequestHeaderMapImpl headers{
+        {":method", "GET"}, {":path", "/"}, {":authority", "host"}};
+    Http::TestRequestHeaderMapImpl response_headers{{":status", "404"}};
+
+    IntegrationCodecClientPtr codec_client;
+    FakeHttpConnectionPtr fake_upstream_connection;
+    FakeStreamPtr request_stream;
+
+    codec_client = makeHttpConnection(lookupPort("http"));
+    auto response = codec_client->makeHeaderOnlyRequest(headers);
+    ASSERT_TRUE(fake_upstreams_[0]->waitForHttpConnection(*dispatcher_, fake_upstream_connection));
+    ASSERT_TRUE(fake_upstream_connection->waitForNewStream(*dispatcher_, request_stream));
+    ASSERT_TRUE(request_stream->waitForEndStream(*dispatcher_));
+    request_stream->encodeHeaders(response_headers, false);
+    request_stream->encodeData(0, true);
+    ASSERT_TRUE(response->waitForEndStream(std::chrono::milliseconds(3000)));
+    EXPECT_EQ("404", response->headers().getStatusValue());
+
+    codec_client->close();
+  }
 };
 
 INSTANTIATE_TEST_SUITE_P(IpVersions, HttpFilterIntegrationTest,
@@ -53,26 +86,25 @@ TEST_P(HttpFilterIntegrationTest, HeadersStopIteration) {
   initializeDynamicFilter(
       "./test/extensions/dynamic_modules/http/test_programs/libintegration_test_headers.so",
       "should_wait");
+  expectHeadersStopIteration();
+}
 
-  Http::TestRequestHeaderMapImpl headers{
-      {":method", "GET"}, {":path", "/"}, {":authority", "host"}};
-  Http::TestRequestHeaderMapImpl response_headers{{":status", "404"}};
-
-  IntegrationCodecClientPtr codec_client;
-  FakeHttpConnectionPtr fake_upstream_connection;
-  FakeStreamPtr request_stream;
-
-  codec_client = makeHttpConnection(lookupPort("http"));
-  auto response = codec_client->makeHeaderOnlyRequest(headers);
-  ASSERT_TRUE(fake_upstreams_[0]->waitForHttpConnection(*dispatcher_, fake_upstream_connection));
-  ASSERT_TRUE(fake_upstream_connection->waitForNewStream(*dispatcher_, request_stream));
-  ASSERT_TRUE(request_stream->waitForEndStream(*dispatcher_));
-  request_stream->encodeHeaders(response_headers, false);
-  request_stream->encodeData(0, true);
-  ASSERT_TRUE(response->waitForEndStream(std::chrono::milliseconds(3000)));
-  EXPECT_EQ("404", response->headers().getStatusValue());
+TEST_P(HttpFilterIntegrationTest, HeadersStopIterationWithConfigBytes) {
+  // The bytes field is base64 encoded in YAML, and this is "should_wait".
+  initializeDynamicFilter(
+      "./test/extensions/dynamic_modules/http/test_programs/libintegration_test_headers.so",
+      "c2hvdWxkX3dhaXQ=", "filter_config_bytes");
+  expectHeadersStopIteration();
+}
 
-  codec_client->close();
+TEST_P(HttpFilterIntegrationTest, HeadersStopIterationWithTypedConfig) {
+  // Only the serialized StringValue is passed to the module, which it accepts as "should_wait".
+  initializeDynamicFilterWithConfigYaml(
+      "./test/extensions/dynamic_modules/http/test_programs/libintegration_test_headers.so",
+      R"EOF(typed_filter_config:
+    "@type": type.googleapis.com/google.protobuf.StringValue
+    value: should_wait)EOF");
+  expectHeadersStopIteration();
 }
 
 TEST_P(HttpFilterIntegrationTest, Bodies) {
@@ -152,4 +184,34 @@ TEST_P(HttpFilterIntegrationTest, LocalResponse_OnRespnose) {
   codec_client->close();
 }
 
+TEST_P(HttpFilterIntegrationTest, HttpCallout) {
+  initializeDynamicFilter(
+      "./test/extensions/dynamic_modules/http/test_programs/libintegration_test_callout.so");
+
+  Http::TestRequestHeaderMapImpl headers{
+      {":method", "GET"}, {":path", "/"}, {":authority", "host"}};
+  Http::TestResponseHeaderMapImpl callout_response_headers{{":status", "201"}};
+
+  IntegrationCodecClientPtr codec_client;
+  FakeHttpConnectionPtr fake_upstream_connection;
+  FakeStreamPtr request_stream;
+
+  codec_client = makeHttpConnection(lookupPort("http"));
+  auto response = codec_client->makeHeaderOnlyRequest(headers);
+  // The callout is sent to the same fake upstream, and the module replies without forwarding the
+  // original request.
+  ASSERT_TRUE(fake_upstreams_[0]->waitForHttpConnection(*dispatcher_, fake_upstream_connection));
+  ASSERT_TRUE(fake_upstream_connection->waitForNewStream(*dispatcher_, request_stream));
+  ASSERT_TRUE(request_stream->waitForEndStream(*dispatcher_));
+  EXPECT_EQ("/callout", request_stream->headers().getPathValue());
+  EXPECT_EQ("callout", request_stream->headers().getHostValue());
+  request_stream->encodeHeaders(callout_response_headers, true);
+  ASSERT_TRUE(response->waitForEndStream());
+
+  auto callout_status = response->headers().get(Http::LowerCaseString("x-callout-status"));
+  EXPECT_EQ("201", callout_status.empty() ? "" : callout_status[0]->value().getStringView());
+  EXPECT_EQ("200", response->headers().getStatusValue());
+  codec_client->close();
+}
+
 } // namespace Envoy
@@ -0,0 +1,75 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "source/extensions/dynamic_modules/http/mapped_config_file.h"
+
+#include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+class MappedConfigFileTest : public testing::Test {
+public:
+  MappedConfigFileTest() : path_(TestEnvironment::temporaryPath("mapped_config_file_test")) {}
+  ~MappedConfigFileTest() override { std::filesystem::remove(path_); }
+
+  // Replaces the file with a new one, as a deployment would do.
+  void writeFile(const std::string& contents) {
+    const std::string tmp = path_ + ".tmp";
+    {
+      std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+      file << contents;
+    }
+    std::filesystem::rename(tmp, path_);
+  }
+
+  const std::string path_;
+};
+
+TEST_F(MappedConfigFileTest, InvalidPath) {
+  const auto result = MappedConfigFile::open("non_exist");
+  EXPECT_FALSE(result.ok());
+  EXPECT_EQ(result.status().code(), absl::StatusCode::kInvalidArgument);
+}
+
+TEST_F(MappedConfigFileTest, Contents) {
+  writeFile(std::string("binary\0config", 13));
+  const auto result = MappedConfigFile::open(path_);
+  ASSERT_TRUE(result.ok());
+  EXPECT_EQ(result.value()->contents(), std::string_view("binary\0config", 13));
+}
+
+TEST_F(MappedConfigFileTest, Empty) {
+  writeFile("");
+  const auto result = MappedConfigFile::open(path_);
+  ASSERT_TRUE(result.ok());
+  EXPECT_TRUE(result.value()->contents().empty());
+}
+
+TEST_F(MappedConfigFileTest, ReusedUntilChanged) {
+  writeFile("config");
+  const auto first = MappedConfigFile::open(path_);
+  const auto second = MappedConfigFile::open(path_);
+  ASSERT_TRUE(first.ok());
+  ASSERT_TRUE(second.ok());
+  EXPECT_EQ(first.value(), second.value());
+
+  writeFile("new config");
+  const auto third = MappedConfigFile::open(path_);
+  ASSERT_TRUE(third.ok());
+  EXPECT_NE(first.value(), third.value());
+  EXPECT_EQ(third.value()->contents(), "new config");
+  // The previous mapping is still valid while it is referenced.
+  EXPECT_EQ(first.value()->contents(), "config");
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
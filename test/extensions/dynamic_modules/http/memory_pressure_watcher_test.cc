@@ -0,0 +1,99 @@
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "source/extensions/dynamic_modules/http/memory_pressure_watcher.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/server/overload_manager.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+using testing::ReturnRef;
+
+std::vector<double> notified_pressures;
+
+void onMemoryPressure(double pressure) { notified_pressures.push_back(pressure); }
+
+TEST(MemoryPressureWatcherTest, NotifiesOnChange) {
+  notified_pressures.clear();
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<Server::MockOverloadManager> overload_manager;
+  Server::OverloadActionState state(UnitFloat::min());
+  ON_CALL(overload_manager.overload_state_,
+          getState(std::string(MemoryPressureWatcher::DefaultOverloadAction)))
+      .WillByDefault(ReturnRef(state));
+
+  auto* timer = new NiceMock<Event::MockTimer>(&dispatcher);
+  EXPECT_CALL(*timer, enableTimer(std::chrono::milliseconds(100), _)).Times(4);
+  MemoryPressureWatcher watcher(dispatcher, overload_manager,
+                                MemoryPressureWatcher::DefaultOverloadAction,
+                                std::chrono::milliseconds(100), onMemoryPressure);
+
+  // Unchanged from the initial state.
+  timer->invokeCallback();
+  EXPECT_TRUE(notified_pressures.empty());
+
+  state = Server::OverloadActionState(UnitFloat(0.5));
+  timer->invokeCallback();
+  EXPECT_EQ(notified_pressures, std::vector<double>({0.5}));
+  EXPECT_EQ(watcher.pressure(), 0.5);
+
+  // Notified only once for the same state.
+  timer->invokeCallback();
+  EXPECT_EQ(notified_pressures.size(), 1);
+
+  state = Server::OverloadActionState(UnitFloat::min());
+  watcher.poll();
+  EXPECT_EQ(notified_pressures, std::vector<double>({0.5, 0}));
+}
+
+TEST(MemoryPressureWatcherTest, GetOrCreate) {
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<Server::MockOverloadManager> overload_manager;
+  Server::OverloadActionState state(UnitFloat::max());
+  ON_CALL(overload_manager.overload_state_, getState("custom")).WillByDefault(ReturnRef(state));
+
+  // The module doesn't export envoy_dynamic_module_on_memory_pressure.
+  HttpDynamicModuleSharedPtr no_hook = loadTestDynamicModule("stream_init");
+  EXPECT_EQ(MemoryPressureWatcher::getOrCreate(no_hook->dynamic_module_, dispatcher,
+                                               overload_manager, "custom",
+                                               std::chrono::milliseconds(100)),
+            nullptr);
+
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("memory_pressure");
+  auto watcher = MemoryPressureWatcher::getOrCreate(
+      module->dynamic_module_, dispatcher, overload_manager, "custom",
+      std::chrono::milliseconds(100));
+  ASSERT_NE(watcher, nullptr);
+  // The same module is watched once.
+  EXPECT_EQ(MemoryPressureWatcher::getOrCreate(module->dynamic_module_, dispatcher,
+                                               overload_manager, "other",
+                                               std::chrono::milliseconds(200)),
+            watcher);
+
+  const auto last = module->dynamic_module_->getFunctionPointer<double (*)()>(
+      "memory_pressure_last");
+  const auto calls = module->dynamic_module_->getFunctionPointer<size_t (*)()>(
+      "memory_pressure_calls");
+  ASSERT_NE(last, nullptr);
+  ASSERT_NE(calls, nullptr);
+  watcher->poll();
+  EXPECT_EQ(last(), 1);
+  EXPECT_EQ(calls(), 1);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
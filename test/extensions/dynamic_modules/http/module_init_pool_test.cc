@@ -0,0 +1,49 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "source/extensions/dynamic_modules/http/module_init_pool.h"
+
+#include "test/test_common/utility.h"
+
+#include "absl/synchronization/blocking_counter.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+TEST(ModuleInitPoolTest, RunsAllWorkBounded) {
+  Api::ApiPtr api = Api::createApiForTest();
+  ModuleInitPool pool(api->threadFactory(), 2);
+
+  constexpr int kWorks = 8;
+  absl::BlockingCounter done(kWorks);
+  std::atomic<int> running{0};
+  std::atomic<int> max_running{0};
+  for (int i = 0; i < kWorks; i++) {
+    pool.post([&]() {
+      const int now = ++running;
+      int max = max_running.load();
+      while (now > max && !max_running.compare_exchange_weak(max, now)) {
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      --running;
+      done.DecrementCount();
+    });
+  }
+  done.Wait();
+  EXPECT_LE(max_running.load(), 2);
+  EXPECT_GE(max_running.load(), 1);
+}
+
+TEST(ModuleInitPoolTest, DefaultConcurrency) {
+  EXPECT_GE(ModuleInitPool::defaultConcurrency(), 1u);
+  EXPECT_LE(ModuleInitPool::defaultConcurrency(), 8u);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
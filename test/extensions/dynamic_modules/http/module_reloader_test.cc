@@ -0,0 +1,123 @@
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "source/extensions/dynamic_modules/http/module_reloader.h"
+
+#include "test/extensions/dynamic_modules/http/test_util.h"
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/filesystem/mocks.h"
+#include "test/mocks/thread_local/mocks.h"
+#include "test/test_common/environment.h"
+#include "test/test_common/utility.h"
+
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::NiceMock;
+using testing::Return;
+
+class HttpDynamicModuleReloaderTest : public testing::Test {
+public:
+  HttpDynamicModuleReloaderTest()
+      : symlink_path_(TestEnvironment::temporaryPath("dynamic_module_reloader_test.so")) {
+    std::filesystem::remove(symlink_path_);
+    pointSymlinkTo("stream_init");
+    EXPECT_CALL(dispatcher_, createFilesystemWatcher_()).WillOnce(Return(watcher_));
+  }
+
+  ~HttpDynamicModuleReloaderTest() override { std::filesystem::remove(symlink_path_); }
+
+  // Atomically re-points the symlink to the test program as a deployment would do.
+  void pointSymlinkTo(const std::string& name) {
+    const std::string target = std::filesystem::absolute(
+        fmt::format("./test/extensions/dynamic_modules/http/test_programs/lib{}.so", name));
+    const std::string tmp = symlink_path_ + ".tmp";
+    std::filesystem::remove(tmp);
+    std::filesystem::create_symlink(target, tmp);
+    std::filesystem::rename(tmp, symlink_path_);
+  }
+
+  HttpDynamicModuleSharedPtr loadModule() {
+    const auto dynamic_module = newDynamicModule(symlink_path_, false);
+    EXPECT_TRUE(dynamic_module.ok());
+    return std::make_shared<HttpDynamicModule>("reloader", "", dynamic_module.value());
+  }
+
+  std::unique_ptr<HttpDynamicModuleReloader>
+  createReloader(HttpDynamicModuleBuilder builder = [](DynamicModuleSharedPtr dynamic_module) {
+    return std::make_shared<HttpDynamicModule>("reloader", "", dynamic_module);
+  }) {
+    return std::make_unique<HttpDynamicModuleReloader>(
+        loadModule(), symlink_path_, false, LoadMode{}, std::move(builder), tls_, dispatcher_,
+        [this](const HttpDynamicModuleSharedPtr& module) { reloaded_.push_back(module); });
+  }
+
+  const std::string symlink_path_;
+  NiceMock<ThreadLocal::MockInstance> tls_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  NiceMock<Filesystem::MockWatcher>* watcher_ = new NiceMock<Filesystem::MockWatcher>();
+  // The modules passed to the reloaded callback.
+  std::vector<HttpDynamicModuleSharedPtr> reloaded_;
+};
+
+TEST_F(HttpDynamicModuleReloaderTest, SameFileIsNotReloaded) {
+  auto reloader = createReloader();
+  const HttpDynamicModuleSharedPtr initial = reloader->current();
+  reloader->reload();
+  EXPECT_EQ(reloader->current(), initial);
+  EXPECT_EQ(reloader->generation(), 0U);
+}
+
+TEST_F(HttpDynamicModuleReloaderTest, NewFileIsRoutedToNewStreams) {
+  auto reloader = createReloader();
+  // The in-flight stream holds the reference to the module it started with.
+  HttpDynamicModuleSharedPtr in_flight = reloader->current();
+
+  pointSymlinkTo("slow_request_headers");
+  reloader->reload();
+  EXPECT_EQ(reloader->generation(), 1U);
+  EXPECT_NE(reloader->current(), in_flight);
+  ASSERT_EQ(reloaded_.size(), 1U);
+  EXPECT_EQ(reloaded_[0], reloader->current());
+  reloaded_.clear();
+  EXPECT_NE(reloader->current()->dynamic_module_->handle(), in_flight->dynamic_module_->handle());
+
+  // The old module is still usable until the in-flight stream finishes.
+  EXPECT_NE(in_flight->envoy_dynamic_module_on_http_filter_instance_init_, nullptr);
+  in_flight.reset();
+}
+
+TEST_F(HttpDynamicModuleReloaderTest, FailedReloadKeepsCurrent) {
+  auto reloader = createReloader();
+  const HttpDynamicModuleSharedPtr initial = reloader->current();
+
+  pointSymlinkTo("no_init");
+  reloader->reload();
+  EXPECT_EQ(reloader->current(), initial);
+  EXPECT_EQ(reloader->generation(), 0U);
+}
+
+TEST_F(HttpDynamicModuleReloaderTest, BuilderExceptionKeepsCurrent) {
+  auto reloader = createReloader([](DynamicModuleSharedPtr) -> HttpDynamicModuleSharedPtr {
+    throw std::runtime_error("out of memory");
+  });
+  const HttpDynamicModuleSharedPtr initial = reloader->current();
+
+  pointSymlinkTo("slow_request_headers");
+  reloader->reload();
+  EXPECT_EQ(reloader->current(), initial);
+  EXPECT_EQ(reloader->generation(), 0U);
+  EXPECT_TRUE(reloaded_.empty());
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,226 @@
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "source/extensions/dynamic_modules/http/filter.h"
+#include "source/extensions/dynamic_modules/http/offload_pool.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+#include "absl/synchronization/notification.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+using testing::ReturnRef;
+
+TEST(OffloadPoolTest, RejectsWhenQueueIsFull) {
+  Api::ApiPtr api = Api::createApiForTest();
+  OffloadPool pool(api->threadFactory(), 1, 1);
+
+  absl::Notification started;
+  absl::Notification release;
+  EXPECT_TRUE(pool.tryPost(
+      [&]() {
+        started.Notify();
+        release.WaitForNotification();
+      },
+      []() {}));
+  started.WaitForNotification();
+
+  // The only thread is busy, so one more work fits in the queue and the next one doesn't.
+  absl::Notification queued_done;
+  EXPECT_TRUE(pool.tryPost([&]() { queued_done.Notify(); }, []() {}));
+  EXPECT_FALSE(pool.tryPost([]() {}, []() {}));
+
+  release.Notify();
+  queued_done.WaitForNotification();
+}
+
+TEST(OffloadPoolTest, CancelsQueuedWorkOnDestroy) {
+  Api::ApiPtr api = Api::createApiForTest();
+  auto pool = std::make_unique<OffloadPool>(api->threadFactory(), 1, 1);
+
+  absl::Notification started;
+  absl::Notification release;
+  EXPECT_TRUE(pool->tryPost(
+      [&]() {
+        started.Notify();
+        release.WaitForNotification();
+      },
+      []() {}));
+  started.WaitForNotification();
+
+  std::atomic<bool> ran{false};
+  absl::Notification cancelled;
+  EXPECT_TRUE(pool->tryPost([&]() { ran = true; }, [&]() { cancelled.Notify(); }));
+
+  // The queued work is cancelled before the destructor waits for the running one.
+  std::thread destroy([&pool]() { pool.reset(); });
+  cancelled.WaitForNotification();
+  release.Notify();
+  destroy.join();
+  EXPECT_FALSE(ran);
+}
+
+TEST(OffloadPoolTest, DestroyedOnMainThread) {
+  Api::ApiPtr api = Api::createApiForTest();
+  NiceMock<Event::MockDispatcher> main_thread_dispatcher;
+  Event::PostCb posted;
+  EXPECT_CALL(main_thread_dispatcher, isThreadSafe()).WillOnce(testing::Return(false));
+  EXPECT_CALL(main_thread_dispatcher, post(_)).WillOnce([&posted](Event::PostCb callback) {
+    posted = std::move(callback);
+  });
+
+  OffloadPoolSharedPtr pool =
+      OffloadPool::create(api->threadFactory(), main_thread_dispatcher, 1, 1);
+  absl::Notification done;
+  EXPECT_TRUE(pool->tryPost([&]() { done.Notify(); }, []() {}));
+  done.WaitForNotification();
+
+  // Releasing the last reference off the main thread only posts the deletion.
+  pool.reset();
+  ASSERT_NE(posted, nullptr);
+  posted();
+}
+
+TEST(OffloadPoolTest, SharedByModule) {
+  Api::ApiPtr api = Api::createApiForTest();
+  NiceMock<Event::MockDispatcher> main_thread_dispatcher;
+  ON_CALL(main_thread_dispatcher, isThreadSafe()).WillByDefault(testing::Return(true));
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "a");
+  HttpDynamicModuleSharedPtr other_config = loadTestDynamicModule("stream_init", "b");
+
+  // The filter configs of the same module with the same options share the threads.
+  OffloadPoolSharedPtr pool = OffloadPool::getOrCreate(
+      module->dynamic_module_, api->threadFactory(), main_thread_dispatcher, 1, 1);
+  EXPECT_EQ(OffloadPool::getOrCreate(other_config->dynamic_module_, api->threadFactory(),
+                                     main_thread_dispatcher, 1, 1),
+            pool);
+  EXPECT_NE(OffloadPool::getOrCreate(module->dynamic_module_, api->threadFactory(),
+                                     main_thread_dispatcher, 2, 1),
+            pool);
+}
+
+struct OffloadContext {
+  std::thread::id work_thread_;
+  void* done_instance_ = nullptr;
+  int done_calls_ = 0;
+};
+
+void offloadWork(envoy_dynamic_module_raw_pointer context) {
+  static_cast<OffloadContext*>(context)->work_thread_ = std::this_thread::get_id();
+}
+
+void offloadDone(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                 envoy_dynamic_module_raw_pointer context) {
+  auto* offload_context = static_cast<OffloadContext*>(context);
+  offload_context->done_instance_ = http_filter_instance_ptr;
+  offload_context->done_calls_++;
+}
+
+class OffloadFilterTest : public testing::Test {
+public:
+  void SetUp() override {
+    api_ = Api::createApiForTest();
+    pool_ = std::make_shared<OffloadPool>(api_->threadFactory(), 2, 16);
+    ON_CALL(dispatcher_, post(_)).WillByDefault([this](Event::PostCb callback) {
+      posted_ = std::move(callback);
+      posted_notification_.Notify();
+    });
+    ON_CALL(decoder_callbacks_, dispatcher()).WillByDefault(ReturnRef(dispatcher_));
+    filter_ = std::make_shared<HttpFilter>(loadTestDynamicModule("stream_init", ""), pool_);
+    filter_->setDecoderFilterCallbacks(decoder_callbacks_);
+    Http::TestRequestHeaderMapImpl request_headers{};
+    EXPECT_EQ(filter_->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  }
+
+  Api::ApiPtr api_;
+  OffloadPoolSharedPtr pool_;
+  NiceMock<Event::MockDispatcher> dispatcher_;
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks_;
+  absl::Notification posted_notification_;
+  Event::PostCb posted_;
+  std::shared_ptr<HttpFilter> filter_;
+};
+
+TEST_F(OffloadFilterTest, DoneIsCalledOnWorker) {
+  OffloadContext context;
+  ASSERT_TRUE(filter_->offload(offloadWork, offloadDone, &context));
+  posted_notification_.WaitForNotification();
+  EXPECT_NE(context.work_thread_, std::this_thread::get_id());
+  EXPECT_EQ(context.done_calls_, 0);
+
+  posted_();
+  EXPECT_EQ(context.done_calls_, 1);
+  EXPECT_EQ(context.done_instance_, filter_->http_filter_instance_);
+}
+
+TEST_F(OffloadFilterTest, StreamDestroyedBeforeDone) {
+  OffloadContext context;
+  ASSERT_TRUE(filter_->offload(offloadWork, offloadDone, &context));
+  posted_notification_.WaitForNotification();
+  filter_->onDestroy();
+  filter_.reset();
+
+  posted_();
+  EXPECT_EQ(context.done_calls_, 1);
+  EXPECT_EQ(context.done_instance_, nullptr);
+}
+
+TEST(OffloadFilterCancelTest, DoneIsCalledOnPoolDestroy) {
+  Api::ApiPtr api = Api::createApiForTest();
+  auto pool = std::make_shared<OffloadPool>(api->threadFactory(), 1, 1);
+  absl::Notification started;
+  absl::Notification release;
+  EXPECT_TRUE(pool->tryPost(
+      [&]() {
+        started.Notify();
+        release.WaitForNotification();
+      },
+      []() {}));
+  started.WaitForNotification();
+
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  ON_CALL(decoder_callbacks, dispatcher()).WillByDefault(ReturnRef(dispatcher));
+  auto filter = std::make_shared<HttpFilter>(loadTestDynamicModule("stream_init", ""), pool);
+  filter->setDecoderFilterCallbacks(decoder_callbacks);
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  OffloadContext context;
+  ASSERT_TRUE(filter->offload(offloadWork, offloadDone, &context));
+  filter->onDestroy();
+  filter.reset();
+
+  // The worker dispatcher may already be gone when the pool is destroyed, so the done function is
+  // called right away on the destroying thread instead of being posted to it.
+  EXPECT_CALL(dispatcher, post(_)).Times(0);
+  std::thread destroy([&pool]() { pool.reset(); });
+  release.Notify();
+  destroy.join();
+  EXPECT_EQ(context.done_calls_, 1);
+  EXPECT_EQ(context.done_instance_, nullptr);
+  EXPECT_EQ(context.work_thread_, std::thread::id());
+}
+
+TEST(OffloadFilterNoPoolTest, NotConfigured) {
+  auto filter = std::make_shared<HttpFilter>(loadTestDynamicModule("stream_init", ""));
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder_callbacks;
+  filter->setDecoderFilterCallbacks(decoder_callbacks);
+  OffloadContext context;
+  EXPECT_FALSE(filter->offload(offloadWork, offloadDone, &context));
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,125 @@
+// Compares the sharded SharedDataStore with a store behind a single global mutex as the workers
+// are added. Run with e.g. --benchmark_filter=Increment to see how the contention scales.
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "source/extensions/dynamic_modules/http/shared_data_store.h"
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "benchmark/benchmark.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+namespace {
+
+constexpr int KeyCount = 1024;
+constexpr std::chrono::milliseconds NoTtl{0};
+
+/**
+ * The baseline with the same operations as SharedDataStore behind a single lock.
+ */
+class GlobalMutexStore {
+public:
+  int64_t increment(std::string_view key, int64_t delta) {
+    absl::MutexLock lock(&mutex_);
+    return counters_[key] += delta;
+  }
+
+  std::optional<int64_t> get(std::string_view key) {
+    absl::MutexLock lock(&mutex_);
+    auto it = counters_.find(key);
+    if (it == counters_.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+private:
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, int64_t> counters_ ABSL_GUARDED_BY(mutex_);
+};
+
+const std::vector<std::string>& keys() {
+  static const std::vector<std::string>* keys = []() {
+    auto* keys = new std::vector<std::string>();
+    for (int i = 0; i < KeyCount; i++) {
+      keys->push_back(absl::StrCat("rate_limit:client:", i));
+    }
+    return keys;
+  }();
+  return *keys;
+}
+
+SharedDataStore& shardedStore() {
+  static SharedDataStore* store = new SharedDataStore();
+  return *store;
+}
+
+GlobalMutexStore& globalMutexStore() {
+  static GlobalMutexStore* store = new GlobalMutexStore();
+  return *store;
+}
+
+void bmShardedIncrement(benchmark::State& state) {
+  SharedDataStore& store = shardedStore();
+  const MonotonicTime now;
+  size_t i = state.thread_index() * 7919;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(store.increment(keys()[i++ % KeyCount], 1, NoTtl, now));
+  }
+}
+BENCHMARK(bmShardedIncrement)->ThreadRange(1, 64)->UseRealTime();
+
+void bmGlobalMutexIncrement(benchmark::State& state) {
+  GlobalMutexStore& store = globalMutexStore();
+  size_t i = state.thread_index() * 7919;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(store.increment(keys()[i++ % KeyCount], 1));
+  }
+}
+BENCHMARK(bmGlobalMutexIncrement)->ThreadRange(1, 64)->UseRealTime();
+
+void bmShardedGet(benchmark::State& state) {
+  SharedDataStore& store = shardedStore();
+  const MonotonicTime now;
+  if (state.thread_index() == 0) {
+    for (const std::string& key : keys()) {
+      store.increment(key, 0, NoTtl, now);
+    }
+  }
+  size_t i = state.thread_index() * 7919;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(store.get(keys()[i++ % KeyCount], now));
+  }
+}
+BENCHMARK(bmShardedGet)->ThreadRange(1, 64)->UseRealTime();
+
+void bmGlobalMutexGet(benchmark::State& state) {
+  GlobalMutexStore& store = globalMutexStore();
+  if (state.thread_index() == 0) {
+    for (const std::string& key : keys()) {
+      store.increment(key, 0);
+    }
+  }
+  size_t i = state.thread_index() * 7919;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(store.get(keys()[i++ % KeyCount]));
+  }
+}
+BENCHMARK(bmGlobalMutexGet)->ThreadRange(1, 64)->UseRealTime();
+
+} // namespace
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
@@ -0,0 +1,209 @@
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "source/extensions/dynamic_modules/abi/abi.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+#include "source/extensions/dynamic_modules/http/shared_data_store.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+#include "absl/strings/str_cat.h"
+#include "gtest/gtest.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::NiceMock;
+using testing::ReturnRef;
+
+constexpr std::chrono::milliseconds NoTtl{0};
+
+TEST(SharedDataStoreTest, GetAndSet) {
+  SharedDataStore store(4);
+  const MonotonicTime now;
+
+  EXPECT_FALSE(store.get("key", now).has_value());
+  const uint64_t version = store.set("key", "value", SharedDataStore::AnyVersion, NoTtl, now);
+  EXPECT_NE(version, 0);
+
+  auto result = store.get("key", now);
+  ASSERT_TRUE(result.has_value());
+  EXPECT_EQ(*result->value_, "value");
+  EXPECT_EQ(result->version_, version);
+
+  // The value read before stays unchanged after the key is overwritten.
+  const uint64_t new_version = store.set("key", "new", SharedDataStore::AnyVersion, NoTtl, now);
+  EXPECT_NE(new_version, version);
+  EXPECT_EQ(*result->value_, "value");
+  EXPECT_EQ(*store.get("key", now)->value_, "new");
+}
+
+TEST(SharedDataStoreTest, CompareAndSwap) {
+  SharedDataStore store(4);
+  const MonotonicTime now;
+
+  // Version 0 means the key must not exist.
+  const uint64_t version = store.set("key", "first", 0, NoTtl, now);
+  EXPECT_NE(version, 0);
+  EXPECT_EQ(store.set("key", "second", 0, NoTtl, now), 0);
+
+  // A stale version is rejected.
+  const uint64_t new_version = store.set("key", "second", version, NoTtl, now);
+  EXPECT_NE(new_version, 0);
+  EXPECT_EQ(store.set("key", "third", version, NoTtl, now), 0);
+  EXPECT_EQ(*store.get("key", now)->value_, "second");
+}
+
+TEST(SharedDataStoreTest, Expiry) {
+  // A single shard so that the sweep below covers all the keys.
+  SharedDataStore store(1);
+  const MonotonicTime now;
+
+  store.set("key", "value", SharedDataStore::AnyVersion, std::chrono::milliseconds(100), now);
+  EXPECT_TRUE(store.get("key", now + std::chrono::milliseconds(99)).has_value());
+  EXPECT_FALSE(store.get("key", now + std::chrono::milliseconds(100)).has_value());
+
+  // An expired key can be created again with version 0.
+  EXPECT_NE(store.set("key", "value", 0, NoTtl, now + std::chrono::milliseconds(100)), 0);
+
+  // The expired entries never read again are swept.
+  store.set("other", "value", SharedDataStore::AnyVersion, std::chrono::milliseconds(1), now);
+  EXPECT_EQ(store.size(), 2);
+  for (int i = 0; i < 4; i++) {
+    store.set(absl::StrCat("sweep", i), "value", SharedDataStore::AnyVersion, NoTtl,
+              now + std::chrono::seconds(10));
+  }
+  EXPECT_EQ(store.size(), 5);
+}
+
+TEST(SharedDataStoreTest, Increment) {
+  SharedDataStore store(4);
+  const MonotonicTime now;
+  const std::chrono::milliseconds window(1000);
+
+  EXPECT_EQ(store.increment("counter", 1, window, now), 1);
+  EXPECT_EQ(store.increment("counter", 5, window, now + std::chrono::milliseconds(500)), 6);
+  // The ttl is not extended by the increments, so the counter resets after the window.
+  EXPECT_EQ(store.increment("counter", 1, window, now + window), 1);
+
+  int64_t counter;
+  auto result = store.get("counter", now + window);
+  ASSERT_EQ(result->value_->size(), sizeof(counter));
+  std::memcpy(&counter, result->value_->data(), sizeof(counter));
+  EXPECT_EQ(counter, 1);
+
+  // A value which is not a counter can't be incremented.
+  store.set("string", "value", SharedDataStore::AnyVersion, NoTtl, now);
+  EXPECT_FALSE(store.increment("string", 1, NoTtl, now).has_value());
+}
+
+TEST(SharedDataStoreTest, IncrementOverflow) {
+  SharedDataStore store(4);
+  const MonotonicTime now;
+
+  EXPECT_EQ(store.increment("max", std::numeric_limits<int64_t>::max(), NoTtl, now),
+            std::numeric_limits<int64_t>::max());
+  EXPECT_FALSE(store.increment("max", 1, NoTtl, now).has_value());
+  EXPECT_EQ(store.increment("min", std::numeric_limits<int64_t>::min(), NoTtl, now),
+            std::numeric_limits<int64_t>::min());
+  EXPECT_FALSE(store.increment("min", -1, NoTtl, now).has_value());
+
+  // The counters are left unchanged.
+  EXPECT_EQ(store.increment("max", -1, NoTtl, now), std::numeric_limits<int64_t>::max() - 1);
+  EXPECT_EQ(store.increment("min", 1, NoTtl, now), std::numeric_limits<int64_t>::min() + 1);
+}
+
+TEST(SharedDataStoreTest, ConcurrentIncrement) {
+  SharedDataStore store(4);
+  const MonotonicTime now;
+  constexpr int Threads = 8;
+  constexpr int Increments = 6400;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < Threads; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < Increments; j++) {
+        store.increment("counter", 1, NoTtl, now);
+        store.increment(absl::StrCat("key", j % 64), 1, NoTtl, now);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(store.increment("counter", 0, NoTtl, now), Threads * Increments);
+  EXPECT_EQ(store.increment("key0", 0, NoTtl, now), Threads * Increments / 64);
+}
+
+TEST(SharedDataStoreTest, Abi) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  NiceMock<Event::MockDispatcher> dispatcher;
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder;
+  ON_CALL(decoder, dispatcher()).WillByDefault(ReturnRef(dispatcher));
+  auto filter = std::make_shared<HttpFilter>(module);
+  filter->setDecoderFilterCallbacks(decoder);
+
+  std::string key = "key";
+  char* data;
+  size_t length;
+  auto length_result = reinterpret_cast<envoy_dynamic_module_type_DataSliceLengthResult>(&length);
+  uint64_t version;
+  EXPECT_EQ(envoy_dynamic_module_http_shared_data_get(filter.get(), key.data(), key.size(), &data,
+                                                      length_result, &version),
+            nullptr);
+  EXPECT_EQ(version, 0);
+
+  std::string value = "value";
+  const uint64_t set_version = envoy_dynamic_module_http_shared_data_set(
+      filter.get(), key.data(), key.size(), value.data(), value.size(), 0, 0);
+  EXPECT_NE(set_version, 0);
+  EXPECT_EQ(envoy_dynamic_module_http_shared_data_set(filter.get(), key.data(), key.size(),
+                                                      value.data(), value.size(), 0, 0),
+            0);
+
+  envoy_dynamic_module_type_SharedDataValuePtr ref = envoy_dynamic_module_http_shared_data_get(
+      filter.get(), key.data(), key.size(), &data, length_result, &version);
+  ASSERT_NE(ref, nullptr);
+  EXPECT_EQ(std::string(data, length), "value");
+  EXPECT_EQ(version, set_version);
+
+  // The view stays valid until released even if the key is overwritten.
+  std::string new_value = "new";
+  EXPECT_NE(envoy_dynamic_module_http_shared_data_set(filter.get(), key.data(), key.size(),
+                                                      new_value.data(), new_value.size(),
+                                                      set_version, 0),
+            0);
+  EXPECT_EQ(std::string(data, length), "value");
+  envoy_dynamic_module_http_shared_data_release(ref);
+
+  // The store is shared by the streams of the module.
+  auto other = std::make_shared<HttpFilter>(module);
+  other->setDecoderFilterCallbacks(decoder);
+  std::string counter = "counter";
+  int64_t result;
+  EXPECT_EQ(envoy_dynamic_module_http_shared_data_increment(filter.get(), counter.data(),
+                                                            counter.size(), 2, 0, &result),
+            1);
+  EXPECT_EQ(envoy_dynamic_module_http_shared_data_increment(other.get(), counter.data(),
+                                                            counter.size(), 3, 0, &result),
+            1);
+  EXPECT_EQ(result, 5);
+  EXPECT_EQ(envoy_dynamic_module_http_shared_data_increment(filter.get(), key.data(), key.size(),
+                                                            1, 0, &result),
+            0);
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
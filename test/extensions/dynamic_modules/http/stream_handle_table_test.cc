@@ -0,0 +1,138 @@
+#include "gtest/gtest.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "source/extensions/dynamic_modules/abi/abi.h"
+#include "source/extensions/dynamic_modules/http/filter.h"
+#include "source/extensions/dynamic_modules/http/stream_handle_table.h"
+
+#include "test/mocks/event/mocks.h"
+#include "test/mocks/http/mocks.h"
+#include "test/test_common/utility.h"
+#include "test/extensions/dynamic_modules/http/test_util.h"
+
+namespace Envoy {
+namespace Extensions {
+namespace DynamicModules {
+namespace Http {
+
+using testing::_;
+using testing::NiceMock;
+using testing::ReturnRef;
+
+TEST(StreamHandleTableTest, AcquireLookupRelease) {
+  StreamHandleTable& table = StreamHandleTable::get();
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+
+  const uint64_t handle = table.acquire(filter);
+  EXPECT_NE(handle, 0);
+  EXPECT_EQ(table.lookup(handle), filter);
+
+  table.release(handle);
+  EXPECT_EQ(table.lookup(handle), nullptr);
+  // Releasing twice is a no-op.
+  table.release(handle);
+
+  // The slot is reused with a new generation, and the old handle stays invalid.
+  auto other = std::make_shared<HttpFilter>(module);
+  const uint64_t reused = table.acquire(other);
+  EXPECT_NE(reused, handle);
+  EXPECT_EQ(table.lookup(handle), nullptr);
+  EXPECT_EQ(table.lookup(reused), other);
+  table.release(reused);
+}
+
+TEST(StreamHandleTableTest, InvalidHandles) {
+  StreamHandleTable& table = StreamHandleTable::get();
+  EXPECT_EQ(table.lookup(0), nullptr);
+  EXPECT_EQ(table.lookup(~uint64_t(0)), nullptr);
+  EXPECT_EQ(table.lookup(uint64_t(2) << 32), nullptr);
+}
+
+TEST(StreamHandleTableTest, FilterGoneBeforeRelease) {
+  StreamHandleTable& table = StreamHandleTable::get();
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+  const uint64_t handle = table.acquire(filter);
+  // The table doesn't keep the filter alive.
+  filter.reset();
+  EXPECT_EQ(table.lookup(handle), nullptr);
+  table.release(handle);
+}
+
+TEST(StreamHandleTableTest, LookupRacingWithRelease) {
+  StreamHandleTable& table = StreamHandleTable::get();
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  auto filter = std::make_shared<HttpFilter>(module);
+  const uint64_t handle = table.acquire(filter);
+
+  std::atomic<bool> released = false;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+      while (true) {
+        const bool was_released = released.load();
+        std::shared_ptr<HttpFilter> found = table.lookup(handle);
+        if (was_released) {
+          EXPECT_EQ(found, nullptr);
+          return;
+        }
+        if (found != nullptr) {
+          EXPECT_EQ(found, filter);
+        }
+      }
+    });
+  }
+  table.release(handle);
+  released = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(StreamHandleTableTest, ContinueByHandle) {
+  HttpDynamicModuleSharedPtr module = loadTestDynamicModule("stream_init", "");
+  NiceMock<Event::MockDispatcher> dispatcher;
+  std::vector<Event::PostCb> posted;
+  ON_CALL(dispatcher, post(_)).WillByDefault([&](Event::PostCb callback) {
+    posted.push_back(std::move(callback));
+  });
+  NiceMock<Http::MockStreamDecoderFilterCallbacks> decoder;
+  NiceMock<Http::MockStreamEncoderFilterCallbacks> encoder;
+  ON_CALL(decoder, dispatcher()).WillByDefault(ReturnRef(dispatcher));
+  auto filter = std::make_shared<HttpFilter>(module);
+  filter->setDecoderFilterCallbacks(decoder);
+  filter->setEncoderFilterCallbacks(encoder);
+  Http::TestRequestHeaderMapImpl request_headers{};
+  EXPECT_EQ(filter->decodeHeaders(request_headers, false), FilterHeadersStatus::Continue);
+  filter->in_continue_ = false;
+
+  const envoy_dynamic_module_type_StreamHandle handle =
+      envoy_dynamic_module_http_get_stream_handle(filter.get());
+  EXPECT_NE(handle, 0);
+  EXPECT_EQ(envoy_dynamic_module_http_get_stream_handle(filter.get()), handle);
+
+  // Continue from another thread, as the module would do.
+  size_t result = 0;
+  std::thread([&]() { result = envoy_dynamic_module_http_continue_request_by_handle(handle); })
+      .join();
+  EXPECT_EQ(result, 1);
+  ASSERT_EQ(posted.size(), 1);
+  EXPECT_CALL(decoder, continueDecoding());
+  posted[0]();
+  posted.clear();
+
+  // The handle is stale once the stream is destroyed.
+  filter->onDestroy();
+  EXPECT_EQ(envoy_dynamic_module_http_continue_request_by_handle(handle), 0);
+  EXPECT_EQ(envoy_dynamic_module_http_continue_response_by_handle(handle), 0);
+  EXPECT_TRUE(posted.empty());
+}
+
+} // namespace Http
+} // namespace DynamicModules
+} // namespace Extensions
+} // namespace Envoy
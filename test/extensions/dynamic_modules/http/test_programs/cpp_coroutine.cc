@@ -0,0 +1,97 @@
+#include <cctype>
+#include <charconv>
+#include <string>
+
+#include "source/extensions/dynamic_modules/sdk/cpp/envoy_dynamic_modules_coroutine.h"
+
+// This program is written with the coroutine layer of the C++ SDK. The request task sleeps for the
+// milliseconds in the "delay" header, rejects the request if it has the "reject" header, and sends
+// a callout to the cluster in the "callout" header. Then it uppercases the body frame by frame. The
+// response task appends the length of the whole body to it.
+
+using namespace envoy_dynamic_modules;
+
+namespace {
+
+// The number of coroutine frames alive, which the test checks after destroying a suspended stream.
+size_t live_frames = 0;
+
+struct LiveFrame {
+  LiveFrame() { live_frames++; }
+  ~LiveFrame() { live_frames--; }
+};
+
+} // namespace
+
+extern "C" size_t cpp_coroutine_live_frames() { return live_frames; }
+
+class CppCoroutineHandler;
+
+class CppCoroutineFilter
+    : public HttpFilter<CppCoroutineFilter, CoroutineFilterInstance<CppCoroutineHandler>> {
+public:
+  explicit CppCoroutineFilter(std::string_view) {}
+};
+
+class CppCoroutineHandler {
+public:
+  CppCoroutineHandler(CppCoroutineFilter&, EnvoyFilterInstance) {}
+
+  Task<> onRequest(RequestStream& request) {
+    LiveFrame live;
+    if (std::optional<std::string_view> delay = request.headers().get("delay")) {
+      int milliseconds = 0;
+      std::from_chars(delay->data(), delay->data() + delay->size(), milliseconds);
+      co_await request.sleep(std::chrono::milliseconds(milliseconds));
+      request.headers().set("x-delayed", "true");
+    }
+    if (request.headers().get("reject")) {
+      // This ends the stream, so the task returns right away.
+      request.envoyFilterInstance().sendResponse(403, {});
+      co_return;
+    }
+    if (std::optional<std::string_view> cluster = request.headers().get("callout")) {
+      const std::initializer_list<Header> headers = {
+          {":method", "GET"}, {":path", "/check"}, {"host", "auth"}};
+      CalloutResponse response = co_await request.callout(*cluster, headers);
+      const std::string status =
+          response ? std::string(response.headers.get(":status").value_or("")) : "failed";
+      request.headers().set("x-callout", status);
+    }
+    const size_t length = co_await upperCase(request);
+    request.headers().set("x-length", std::to_string(length));
+  }
+
+  Task<> onResponse(ResponseStream& response) {
+    LiveFrame live;
+    ResponseBodyBuffer body = co_await response.endOfStream();
+    if (body) {
+      body.append(" (" + std::to_string(body.length()) + ")");
+    }
+  }
+
+private:
+  Task<size_t> upperCase(RequestStream& request) {
+    LiveFrame live;
+    size_t length = 0;
+    for (;;) {
+      auto frame = co_await request.nextFrame();
+      if (frame.buffer) {
+        size_t skip = frame.offset;
+        for (std::span<std::byte> span : frame.buffer.spans()) {
+          const size_t skipped = skip < span.size() ? skip : span.size();
+          skip -= skipped;
+          for (std::byte& b : span.subspan(skipped)) {
+            b = static_cast<std::byte>(std::toupper(static_cast<unsigned char>(b)));
+          }
+        }
+        length += frame.buffer.length() - frame.offset;
+      }
+      if (frame.end_of_stream) {
+        co_return length;
+      }
+    }
+  }
+};
+
+ENVOY_DYNAMIC_MODULE_HTTP_FILTER(CppCoroutineFilter)
@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cctype>
+#include <string>
+
+#include "source/extensions/dynamic_modules/sdk/cpp/envoy_dynamic_modules.h"
+
+// This program is written with the C++ SDK. The request hooks are implemented and the response
+// hooks are left to the SDK, which exports them as no-ops.
+
+using namespace envoy_dynamic_modules;
+
+class CppSdkFilterInstance;
+
+class CppSdkFilter : public HttpFilter<CppSdkFilter, CppSdkFilterInstance> {
+public:
+  explicit CppSdkFilter(std::string_view config) : config_(config) {}
+
+  static std::unique_ptr<CppSdkFilter> create(std::string_view config) {
+    if (config == "fail") {
+      return nullptr;
+    }
+    return std::make_unique<CppSdkFilter>(config);
+  }
+
+  const std::string config_;
+};
+
+class CppSdkFilterInstance : public HttpFilterInstance<CppSdkFilterInstance> {
+public:
+  CppSdkFilterInstance(CppSdkFilter& filter, EnvoyFilterInstance envoy_filter_instance)
+      : filter_(filter), envoy_filter_instance_(envoy_filter_instance) {}
+
+  RequestHeadersStatus onRequestHeaders(RequestHeaders& headers, bool) {
+    std::string joined;
+    for (std::string_view value : headers.values("key")) {
+      if (!joined.empty()) {
+        joined += ',';
+      }
+      joined += value;
+    }
+    headers.set("x-values", joined);
+    headers.set("x-config", filter_.config_);
+    headers.remove("remove-me");
+    return headers.get("stop") ? RequestHeadersStatus::StopIteration
+                               : RequestHeadersStatus::Continue;
+  }
+
+  RequestBodyStatus onRequestBody(RequestBodyBuffer& buffer, bool end_of_stream) {
+    for (std::span<std::byte> span : buffer.spans()) {
+      for (std::byte& b : span) {
+        b = static_cast<std::byte>(std::toupper(static_cast<unsigned char>(b)));
+      }
+    }
+    size_t length = 0;
+    for (std::string_view slice : buffer.slices()) {
+      length += slice.size();
+    }
+    if (length != buffer.length()) {
+      return RequestBodyStatus::StopIterationAndBuffer;
+    }
+    if (end_of_stream) {
+      buffer.append("!");
+    }
+    return RequestBodyStatus::Continue;
+  }
+
+private:
+  CppSdkFilter& filter_;
+  EnvoyFilterInstance envoy_filter_instance_;
+};
+
+static_assert(HttpFilterInstanceHooks<CppSdkFilterInstance>::request_headers);
+static_assert(HttpFilterInstanceHooks<CppSdkFilterInstance>::request_body);
+static_assert(!HttpFilterInstanceHooks<CppSdkFilterInstance>::response_headers);
+static_assert(!HttpFilterInstanceHooks<CppSdkFilterInstance>::response_body);
+
+ENVOY_DYNAMIC_MODULE_HTTP_FILTER(CppSdkFilter)
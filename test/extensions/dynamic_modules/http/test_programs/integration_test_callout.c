@@ -0,0 +1,116 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "source/extensions/dynamic_modules/abi/abi.h"
+
+typedef struct {
+  envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter;
+} filter_instance;
+
+static envoy_dynamic_module_type_InModuleHeader make_header(const char* key, const char* value) {
+  envoy_dynamic_module_type_InModuleHeader header;
+  header.header_key = (uintptr_t)key;
+  header.header_key_length = strlen(key);
+  header.header_value = (uintptr_t)value;
+  header.header_value_length = strlen(value);
+  return header;
+}
+
+static void
+on_callout_done(envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+                envoy_dynamic_module_raw_pointer context,
+                envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers,
+                envoy_dynamic_module_type_HttpResponseBodyBufferPtr response_body) {
+  filter_instance* instance = (filter_instance*)http_filter_instance_ptr;
+
+  // Reply with the status of the callout response in the header, or fail with 502.
+  char status[16] = "failed";
+  if (response_headers != 0) {
+    envoy_dynamic_module_type_DataSlicePtr value_ptr = 0;
+    envoy_dynamic_module_type_DataSliceLength value_length = 0;
+    const char* key = ":status";
+    if (envoy_dynamic_module_http_get_response_header_value(
+            response_headers, (uintptr_t)key, strlen(key), (uintptr_t)&value_ptr,
+            (uintptr_t)&value_length) > 0 &&
+        value_length < sizeof(status)) {
+      memcpy(status, (const char*)value_ptr, value_length);
+      status[value_length] = '\0';
+    }
+  }
+  envoy_dynamic_module_type_InModuleHeader header = make_header("x-callout-status", status);
+  envoy_dynamic_module_http_send_response(instance->envoy_filter, response_headers != 0 ? 200 : 502,
+                                          (envoy_dynamic_module_type_InModuleHeadersPtr)&header, 1,
+                                          0, 0);
+}
+
+envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_request_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  filter_instance* instance = (filter_instance*)http_filter_instance_ptr;
+  envoy_dynamic_module_type_InModuleHeader headers[3] = {
+      make_header(":method", "GET"),
+      make_header(":path", "/callout"),
+      make_header(":authority", "callout"),
+  };
+  const char* cluster = "cluster_0";
+  if (envoy_dynamic_module_http_send_callout(
+          instance->envoy_filter, (uintptr_t)cluster, strlen(cluster),
+          (envoy_dynamic_module_type_InModuleHeadersPtr)headers, 3, 0, 0, 5000, on_callout_done,
+          0) == 0) {
+    return envoy_dynamic_module_type_EventHttpRequestHeadersStatusContinue;
+  }
+  return envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopIteration;
+}
+
+envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_response_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_map_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpResponseHeadersStatusContinue;
+}
+
+envoy_dynamic_module_type_EventHttpRequestBodyStatus
+envoy_dynamic_module_on_http_filter_instance_request_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpRequestBodyStatusContinue;
+}
+
+envoy_dynamic_module_type_EventHttpResponseBodyStatus
+envoy_dynamic_module_on_http_filter_instance_response_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue;
+}
+
+envoy_dynamic_module_type_HttpFilterPtr envoy_dynamic_module_on_http_filter_init(
+    envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+    envoy_dynamic_module_type_HttpFilterConfigSize config_size) {
+  static size_t obj = 0;
+  return (uintptr_t)(&obj);
+}
+
+envoy_dynamic_module_type_HttpFilterInstancePtr envoy_dynamic_module_on_http_filter_instance_init(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {
+  filter_instance* instance = malloc(sizeof(filter_instance));
+  instance->envoy_filter = envoy_filter_instance_ptr;
+  return (uintptr_t)instance;
+}
+
+void envoy_dynamic_module_on_http_filter_instance_destroy(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr) {
+  free((void*)http_filter_instance_ptr);
+}
+
+void envoy_dynamic_module_on_http_filter_destroy(
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {}
+
+size_t envoy_dynamic_module_on_program_init() { return 0; }
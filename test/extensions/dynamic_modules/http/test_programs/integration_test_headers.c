@@ -82,6 +82,10 @@ envoy_dynamic_module_type_HttpFilterPtr envoy_dynamic_module_on_http_filter_init
   if (config_size == 11 && strncmp((char*)config_ptr, "should_wait", 11) == 0) {
     should_wait = 1;
   }
+  // The typed_filter_config is passed as the serialized google.protobuf.StringValue.
+  if (config_size == 13 && memcmp((char*)config_ptr, "\x0a\x0bshould_wait", 13) == 0) {
+    should_wait = 1;
+  }
 
   static size_t obj = 0;
   return (uintptr_t)(&obj);
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <unistd.h>
+#include "source/extensions/dynamic_modules/abi/abi.h"
+
+envoy_dynamic_module_type_HttpFilterInstancePtr envoy_dynamic_module_on_http_filter_instance_init(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {
+  static size_t obj = 999999;
+  return (uintptr_t)&obj;
+}
+
+void envoy_dynamic_module_on_http_filter_destroy(
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {}
+
+static size_t http_filter_init_calls = 0;
+
+// Returns how many times envoy_dynamic_module_on_http_filter_init was called.
+size_t get_http_filter_init_calls() {
+  return __atomic_load_n(&http_filter_init_calls, __ATOMIC_SEQ_CST);
+}
+
+envoy_dynamic_module_type_HttpFilterPtr envoy_dynamic_module_on_http_filter_init(
+    envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+    envoy_dynamic_module_type_HttpFilterConfigSize config_size) {
+  __atomic_add_fetch(&http_filter_init_calls, 1, __ATOMIC_SEQ_CST);
+  // Takes a while so that the concurrent calls for the same config overlap.
+  usleep(10 * 1000);
+  static size_t obj = 0;
+  return (uintptr_t)&obj;
+}
+
+envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_request_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_response_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_map_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+envoy_dynamic_module_type_EventHttpRequestBodyStatus
+envoy_dynamic_module_on_http_filter_instance_request_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+envoy_dynamic_module_type_EventHttpResponseBodyStatus
+envoy_dynamic_module_on_http_filter_instance_response_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+void envoy_dynamic_module_on_http_filter_instance_destroy(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr) {}
+
+size_t envoy_dynamic_module_on_program_init() { return 0; }
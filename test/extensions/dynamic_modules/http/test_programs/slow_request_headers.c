@@ -0,0 +1,59 @@
+#include <unistd.h>
+
+#include "source/extensions/dynamic_modules/abi/abi.h"
+
+size_t envoy_dynamic_module_on_program_init() { return 0; }
+
+envoy_dynamic_module_type_HttpFilterPtr envoy_dynamic_module_on_http_filter_init(
+    envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+    envoy_dynamic_module_type_HttpFilterConfigSize config_size) {
+  static size_t obj = 0;
+  return (uintptr_t)&obj;
+}
+
+void envoy_dynamic_module_on_http_filter_destroy(
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {}
+
+envoy_dynamic_module_type_HttpFilterInstancePtr envoy_dynamic_module_on_http_filter_instance_init(
+    envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {
+  static size_t obj = 0;
+  return (uintptr_t)&obj;
+}
+
+envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_request_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  // Blocks the worker thread for 50ms to exceed the budget in the test.
+  usleep(50 * 1000);
+  return envoy_dynamic_module_type_EventHttpRequestHeadersStatusContinue;
+}
+
+envoy_dynamic_module_type_EventHttpRequestBodyStatus
+envoy_dynamic_module_on_http_filter_instance_request_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+envoy_dynamic_module_on_http_filter_instance_response_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_map_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+envoy_dynamic_module_type_EventHttpResponseBodyStatus
+envoy_dynamic_module_on_http_filter_instance_response_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return 0;
+}
+
+void envoy_dynamic_module_on_http_filter_instance_destroy(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr) {}
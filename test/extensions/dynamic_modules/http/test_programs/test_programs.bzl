@@ -1,12 +1,13 @@
 load("@rules_cc//cc:defs.bzl", "cc_library")
 
-def test_program(name):
+def test_program(name, srcs = None, deps = []):
     cc_library(
         name = name,
-        srcs = [name + ".c", "//source/extensions/dynamic_modules/abi:abi.h"],
+        srcs = (srcs or [name + ".c"]) + ["//source/extensions/dynamic_modules/abi:abi.h"],
         linkopts = [
             "-shared",
             "-fPIC",
         ],
         linkstatic = False,
+        deps = deps,
     )
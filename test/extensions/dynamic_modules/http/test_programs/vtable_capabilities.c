@@ -0,0 +1,75 @@
+#include <stddef.h>
+#include "source/extensions/dynamic_modules/abi/abi.h"
+
+// This program is the same as vtable.c, but declares a capability in a version 1 table, which
+// must be rejected.
+
+size_t envoy_dynamic_module_on_program_init() { return 0; }
+
+static envoy_dynamic_module_type_HttpFilterPtr
+on_http_filter_init(envoy_dynamic_module_type_HttpFilterConfigPtr config_ptr,
+                    envoy_dynamic_module_type_HttpFilterConfigSize config_size) {
+  static size_t obj = 0;
+  return (uintptr_t)&obj;
+}
+
+static void on_http_filter_destroy(envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {}
+
+static envoy_dynamic_module_type_HttpFilterInstancePtr
+on_http_filter_instance_init(envoy_dynamic_module_type_EnvoyFilterInstancePtr envoy_filter_ptr,
+                             envoy_dynamic_module_type_HttpFilterPtr http_filter_ptr) {
+  static size_t obj = 0;
+  return (uintptr_t)&obj;
+}
+
+static envoy_dynamic_module_type_EventHttpRequestHeadersStatus
+on_http_filter_instance_request_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestHeadersMapPtr request_headers_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpRequestHeadersStatusStopIteration;
+}
+
+static envoy_dynamic_module_type_EventHttpRequestBodyStatus
+on_http_filter_instance_request_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpRequestBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpRequestBodyStatusContinue;
+}
+
+static envoy_dynamic_module_type_EventHttpResponseHeadersStatus
+on_http_filter_instance_response_headers(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseHeaderMapPtr response_headers_map_ptr,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpResponseHeadersStatusContinue;
+}
+
+static envoy_dynamic_module_type_EventHttpResponseBodyStatus
+on_http_filter_instance_response_body(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr,
+    envoy_dynamic_module_type_HttpResponseBodyBufferPtr buffer,
+    envoy_dynamic_module_type_EndOfStream end_of_stream) {
+  return envoy_dynamic_module_type_EventHttpResponseBodyStatusContinue;
+}
+
+static void on_http_filter_instance_destroy(
+    envoy_dynamic_module_type_HttpFilterInstancePtr http_filter_instance_ptr) {}
+
+static const envoy_dynamic_module_type_HttpVtable vtable = {
+    .version = 1,
+    .capabilities = 1,
+    .on_http_filter_init = on_http_filter_init,
+    .on_http_filter_destroy = on_http_filter_destroy,
+    .on_http_filter_instance_init = on_http_filter_instance_init,
+    .on_http_filter_instance_request_headers = on_http_filter_instance_request_headers,
+    .on_http_filter_instance_request_body = on_http_filter_instance_request_body,
+    .on_http_filter_instance_response_headers = on_http_filter_instance_response_headers,
+    .on_http_filter_instance_response_body = on_http_filter_instance_response_body,
+    .on_http_filter_instance_destroy = on_http_filter_instance_destroy,
+};
+
+const envoy_dynamic_module_type_HttpVtable* envoy_dynamic_module_get_http_vtable() {
+  return &vtable;
+}
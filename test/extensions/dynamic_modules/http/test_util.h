@@ -15,7 +15,8 @@ namespace Http {
 HttpDynamicModuleSharedPtr loadTestDynamicModule(const std::string& file_path,
                                                  const std::string& config = "",
                                                  const std::string& name = "",
-                                                 const bool do_not_dlclose = false) {
+                                                 const bool do_not_dlclose = false,
+                                                 const CallbackBudget& callback_budget = {}) {
   constexpr auto path_fmt = "./test/extensions/dynamic_modules/http/test_programs/lib{}.so";
   const auto path = fmt::format(path_fmt, file_path);
 
@@ -26,7 +27,7 @@ HttpDynamicModuleSharedPtr loadTestDynamicModule(const std::string& file_path,
 
   auto http_dynamic_module =
       std::make_shared<Envoy::Extensions::DynamicModules::Http::HttpDynamicModule>(
-          name, config, dynamic_module.value());
+          name, config, dynamic_module.value(), callback_budget);
 
   return http_dynamic_module;
 }
@@ -23,6 +23,12 @@ import (
 //go:embed envoy.yaml
 var envoyYaml string
 
+// The listener of the async_delay filter, which is only added when TEST_ASYNC_DELAY is set since
+// not all the examples implement it.
+//
+//go:embed envoy_async_delay.yaml
+var envoyAsyncDelayYaml string
+
 var (
 	stdOut                    *bytes.Buffer
 	testUpstreamHandler       = map[string]http.HandlerFunc{}
@@ -49,6 +55,10 @@ func TestMain(m *testing.M) {
 		log.Panicf("shared library at %s not found", derefSharedLibraryPath)
 	}
 
+	if os.Getenv("TEST_ASYNC_DELAY") != "" {
+		envoyYaml = strings.Replace(envoyYaml, "\n  clusters:", "\n"+envoyAsyncDelayYaml+"\n  clusters:", 1)
+	}
+
 	// Replace SHARED_LIBRARY_PATH with the actual path to the shared library.
 	envoyYaml = strings.ReplaceAll(string(envoyYaml), "SHARED_LIBRARY_PATH", derefSharedLibraryPath)
 
@@ -209,6 +219,37 @@ func TestDelayFilter(t *testing.T) {
 	)
 }
 
+func TestAsyncDelay(t *testing.T) {
+	if os.Getenv("TEST_ASYNC_DELAY") == "" {
+		t.Skip("the example doesn't implement the async_delay filter")
+	}
+
+	// The requests wait on the timers of the single worker thread concurrently.
+	wg := new(sync.WaitGroup)
+	wg.Add(4)
+	for i := 0; i < 4; i++ {
+		go func() {
+			defer wg.Done()
+			require.Eventually(t, func() bool {
+				start := time.Now()
+				req, err := http.NewRequest("GET", "http://localhost:15007", bytes.NewBufferString("hello"))
+				if err != nil {
+					return false
+				}
+				res, err := http.DefaultClient.Do(req)
+				if err != nil {
+					return false
+				}
+				defer res.Body.Close()
+				return res.StatusCode == http.StatusOK && time.Since(start) >= 100*time.Millisecond
+			}, 10*time.Second, 2*time.Second, "Envoy has not started: %s", stdOut.String())
+		}()
+	}
+	wg.Wait()
+
+	requireEventuallyContainsMessages(t, stdOut, "RequestHeaders continued after 100ms")
+}
+
 func TestHelloWorld(t *testing.T) {
 	require.Eventually(t, func() bool {
 		req, err := http.NewRequest("GET", "http://localhost:15000", bytes.NewBufferString("hello"))